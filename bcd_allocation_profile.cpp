@@ -0,0 +1,63 @@
+//
+// BCD_PROFILE_ALLOCATIONS下替换的全局operator new/delete, 按bcd_core.hpp中的当前阶段计数.
+// 替换函数不能是inline的, 整个程序里只能定义一次, 所以不放在头文件中; CMake把它作为INTERFACE源文件编进链接bcd_core的每个可执行文件.
+//
+
+#ifdef BCD_PROFILE_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+#include "bcd_core.hpp"
+
+// 替换的operator new/delete不内联, 否则GCC会把malloc/free与调用处的new/delete配对检查而误报
+#if defined(__GNUC__)
+#define BCD_ALLOCATION_NOINLINE __attribute__((noinline))
+#else
+#define BCD_ALLOCATION_NOINLINE
+#endif
+
+BCD_ALLOCATION_NOINLINE void* operator new(std::size_t size)
+{
+    AllocationStageCounter& counter = AllocationStageCounters()[CurrentAllocationStage()];
+    counter.allocations.fetch_add(1, std::memory_order_relaxed);
+    counter.bytes.fetch_add((long long)size, std::memory_order_relaxed);
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if(ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+BCD_ALLOCATION_NOINLINE void operator delete(void* ptr) noexcept
+{
+    if(ptr == nullptr)
+    {
+        return;
+    }
+    AllocationStageCounters()[CurrentAllocationStage()].deallocations.fetch_add(1, std::memory_order_relaxed);
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+#endif
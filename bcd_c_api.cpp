@@ -0,0 +1,144 @@
+#include <cstdlib>
+#include <new>
+
+#include "bcd_core.hpp"
+#include "bcd_c_api.h"
+
+struct BcdCellGraph
+{
+    std::vector<CellNode> cell_graph;
+};
+
+// 顶点超出地图时返回false, 否则光栅化时会越界写占据栅格
+static bool ReadVertices(const int* xy, int vertex_num, int map_width, int map_height, std::vector<Point2D>& vertices)
+{
+    vertices.clear();
+    for(int i = 0; i < vertex_num; i++)
+    {
+        int x = xy[2*i], y = xy[2*i+1];
+        if(x < 0 || x >= map_width || y < 0 || y >= map_height)
+        {
+            return false;
+        }
+        vertices.emplace_back(Point2D(x, y));
+    }
+    return true;
+}
+
+BcdCellGraph* bcd_decompose(int map_width, int map_height,
+                            const int* wall_xy, int wall_vertex_num,
+                            const int* obstacle_xy, const int* obstacle_vertex_nums, int obstacle_num)
+{
+    if(map_width <= 0 || map_height <= 0 || map_width > 65536 || map_height > 65536 || wall_xy == nullptr || wall_vertex_num < 3 || obstacle_num < 0
+       || (obstacle_num > 0 && (obstacle_xy == nullptr || obstacle_vertex_nums == nullptr)))
+    {
+        return nullptr;
+    }
+
+    try
+    {
+        std::vector<Point2D> wall_vertices;
+        if(!ReadVertices(wall_xy, wall_vertex_num, map_width, map_height, wall_vertices))
+        {
+            return nullptr;
+        }
+
+        std::vector<std::vector<Point2D>> obstacle_vertices(obstacle_num);
+        int offset = 0;
+        for(int i = 0; i < obstacle_num; i++)
+        {
+            if(obstacle_vertex_nums[i] <= 0 || !ReadVertices(obstacle_xy + 2*offset, obstacle_vertex_nums[i], map_width, map_height, obstacle_vertices[i]))
+            {
+                return nullptr;
+            }
+            offset += obstacle_vertex_nums[i];
+        }
+
+        OccupancyGrid occupancy_grid = ConstructOccupancyGrid(map_height, map_width, wall_vertices, obstacle_vertices);
+
+        BcdCellGraph* cell_graph = new BcdCellGraph;
+        cell_graph->cell_graph = ConstructCellGraph(occupancy_grid, wall_vertices, obstacle_vertices);
+        if(cell_graph->cell_graph.empty())
+        {
+            delete cell_graph;
+            return nullptr;
+        }
+        return cell_graph;
+    }
+    catch(const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+    catch(...)
+    {
+        // 异常不能穿过C接口
+        return nullptr;
+    }
+}
+
+int bcd_cell_num(const BcdCellGraph* cell_graph)
+{
+    return (cell_graph == nullptr) ? 0 : int(cell_graph->cell_graph.size());
+}
+
+int bcd_plan_coverage(const BcdCellGraph* cell_graph, int start_x, int start_y, int robot_radius, int** path_xy, int* point_num)
+{
+    if(cell_graph == nullptr || robot_radius < 0 || path_xy == nullptr || point_num == nullptr)
+    {
+        return BCD_INVALID_ARGUMENT;
+    }
+
+    try
+    {
+        // 规划会修改cell的访问标记, 在拷贝上进行
+        std::vector<CellNode> cells = cell_graph->cell_graph;
+        Point2D start(start_x, start_y);
+        if(DetermineCellIndex(cells, start).empty())
+        {
+            return BCD_NOT_IN_FREE_SPACE;
+        }
+
+        PathBuffer path = FilterTrajectoryCompact(StaticPathPlanningParallel(cells, start, robot_radius, 1));
+
+        // 空路径不分配: malloc(0)可能返回NULL, 不能当作内存不足
+        if(path.Size() == 0)
+        {
+            *path_xy = nullptr;
+            *point_num = 0;
+            return BCD_OK;
+        }
+
+        int* xy = static_cast<int*>(std::malloc(2 * path.Size() * sizeof(int)));
+        if(xy == nullptr)
+        {
+            return BCD_OUT_OF_MEMORY;
+        }
+        for(size_t i = 0; i < path.Size(); i++)
+        {
+            xy[2*i] = path.xs[i];
+            xy[2*i+1] = path.ys[i];
+        }
+
+        *path_xy = xy;
+        *point_num = int(path.Size());
+        return BCD_OK;
+    }
+    catch(const std::bad_alloc&)
+    {
+        return BCD_OUT_OF_MEMORY;
+    }
+    catch(...)
+    {
+        return BCD_INTERNAL_ERROR;
+    }
+}
+
+void bcd_free_path(int* path_xy)
+{
+    std::free(path_xy);
+}
+
+void bcd_destroy(BcdCellGraph* cell_graph)
+{
+    delete cell_graph;
+}
@@ -0,0 +1,47 @@
+//
+// 不依赖OpenCV的分解和路径生成的C接口, 由bcd_core静态库提供.
+//
+
+#ifndef BCD_PLANNER_BCD_C_API_H
+#define BCD_PLANNER_BCD_C_API_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 返回值 */
+#define BCD_OK                  0
+#define BCD_INVALID_ARGUMENT   -1
+#define BCD_NOT_IN_FREE_SPACE  -2
+#define BCD_OUT_OF_MEMORY      -3
+#define BCD_INTERNAL_ERROR     -4
+
+typedef struct BcdCellGraph BcdCellGraph;
+
+/*
+ * 对map_width*map_height的地图做牛耕式单元分解, 失败时返回NULL. 地图长宽都不能超过65536像素, 所有顶点都必须在地图内.
+ * 外墙和障碍物都是已经按机器人半径膨胀过的多边形顶点, 按(x0, y0, x1, y1, ...)排列, 顶点顺序与ExtractContours的输出一致;
+ * obstacle_xy中依次存放obstacle_num个障碍物的顶点, 第i个障碍物有obstacle_vertex_nums[i]个顶点.
+ */
+BcdCellGraph* bcd_decompose(int map_width, int map_height,
+                            const int* wall_xy, int wall_vertex_num,
+                            const int* obstacle_xy, const int* obstacle_vertex_nums, int obstacle_num);
+
+int bcd_cell_num(const BcdCellGraph* cell_graph);
+
+/*
+ * 从(start_x, start_y)出发的全覆盖路径, 车道间距为robot_radius+1.
+ * 成功时*path_xy指向按(x0, y0, x1, y1, ...)排列的*point_num个路径点, 由bcd_free_path释放;
+ * 路径为空时*path_xy为NULL, *point_num为0.
+ */
+int bcd_plan_coverage(const BcdCellGraph* cell_graph, int start_x, int start_y, int robot_radius, int** path_xy, int* point_num);
+
+void bcd_free_path(int* path_xy);
+
+void bcd_destroy(BcdCellGraph* cell_graph);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BCD_PLANNER_BCD_C_API_H
@@ -0,0 +1,4755 @@
+//
+// 不依赖OpenCV的核心部分: 扫描线事件生成、牛耕式单元分解和单元内/单元间的路径生成.
+// 函数直接定义在头文件中并声明为inline, 可以被多个编译单元包含; 分配统计替换的operator new/delete在bcd_allocation_profile.cpp中.
+//
+
+#ifndef BCD_PLANNER_BCD_CORE_HPP
+#define BCD_PLANNER_BCD_CORE_HPP
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <climits>
+#include <cmath>
+#include <type_traits>
+#include <new>
+#include <cstdlib>
+#include <string>
+
+#ifdef BCD_TRACE_EVENTS
+#include <fstream>
+#include <memory>
+#include <mutex>
+#endif
+
+
+enum EventType
+{
+    IN,
+    IN_TOP,
+    IN_BOTTOM,
+    OUT,
+    OUT_TOP,
+    OUT_BOTTOM,
+    INNER_IN,
+    INNER_IN_TOP,
+    INNER_IN_BOTTOM,
+    INNER_OUT,
+    INNER_OUT_TOP,
+    INNER_OUT_BOTTOM,
+
+    IN_EX,
+    IN_TOP_EX,
+    IN_BOTTOM_EX,
+    OUT_EX,
+    OUT_TOP_EX,
+    OUT_BOTTOM_EX,
+    INNER_IN_EX,
+    INNER_IN_TOP_EX,
+    INNER_IN_BOTTOM_EX,
+    INNER_OUT_EX,
+    INNER_OUT_TOP_EX,
+    INNER_OUT_BOTTOM_EX,
+
+    MIDDLE,
+    CEILING,
+    FLOOR,
+    UNALLOCATED
+};
+
+const int TOPLEFT = 0;
+const int BOTTOMLEFT = 1;
+const int BOTTOMRIGHT = 2;
+const int TOPRIGHT = 3;
+
+
+class Point2D
+{
+public:
+    Point2D()
+    {
+        x = INT_MAX;
+        y = INT_MAX;
+    }
+    Point2D(int x_pos, int y_pos)
+    {
+        x = x_pos;
+        y = y_pos;
+    }
+    int x;
+    int y;
+};
+
+// 拷贝构造和赋值都由编译器生成, vector/deque之间的拷贝可以直接按字节搬运
+static_assert(std::is_trivially_copyable<Point2D>::value, "Point2D should be trivially copyable");
+
+/** 多边形顶点按照逆时针旋转排序 **/
+typedef std::vector<Point2D> Polygon;
+typedef std::vector<Polygon> PolygonList;
+typedef std::vector<Point2D> Edge;
+
+/**
+ * 分段线性边界: 只存折点, 第x列的y由所在线段插值后四舍五入得到(y0 + floor((x-x0)*(y1-y0)/(x1-x0) + 1/2)),
+ * 由FitSegmentEdge生成时与逐列存储的Edge逐点相同. 下标和front/back/size的含义与Edge一致, 按下标取点需要O(log s)的二分查找.
+ **/
+class SegmentEdge
+{
+public:
+    std::vector<Point2D> vertices;  // 按x严格递增, 首尾为边界的两端
+
+    bool empty() const
+    {
+        return vertices.empty();
+    }
+
+    int size() const
+    {
+        return vertices.empty() ? 0 : vertices.back().x - vertices.front().x + 1;
+    }
+
+    Point2D front() const
+    {
+        return vertices.front();
+    }
+
+    Point2D back() const
+    {
+        return vertices.back();
+    }
+
+    int YAt(int x) const
+    {
+        auto upper = std::upper_bound(vertices.begin(), vertices.end(), x, [](int value, const Point2D& vertex){ return value < vertex.x; });
+        if(upper == vertices.begin())
+        {
+            return vertices.front().y;
+        }
+        if(upper == vertices.end())
+        {
+            return vertices.back().y;
+        }
+        const Point2D& start = *(upper - 1);
+        const Point2D& end = *upper;
+        long long numerator = 2LL * (x - start.x) * (end.y - start.y) + (end.x - start.x);
+        long long denominator = 2LL * (end.x - start.x);
+        long long quotient = numerator >= 0 ? numerator / denominator : -((-numerator + denominator - 1) / denominator);
+        return start.y + int(quotient);
+    }
+
+    Point2D operator[](int i) const
+    {
+        int x = vertices.front().x + i;
+        return Point2D(x, YAt(x));
+    }
+};
+
+class Event
+{
+public:
+    Event(int obstacle_idx, int x_pos, int y_pos, EventType type=UNALLOCATED)
+    {
+        obstacle_index = obstacle_idx;
+        x = x_pos;
+        y = y_pos;
+        event_type = type;
+        original_index_in_slice = INT_MAX;
+        isUsed = false;
+    }
+
+    int x;
+    int y;
+    int original_index_in_slice;
+    int obstacle_index;
+    EventType event_type;
+
+    bool isUsed;
+};
+
+class CellNode
+{
+public:
+    CellNode()
+    {
+        isVisited = false;
+        isCleaned = false;
+        parentIndex = INT_MAX;
+        cellIndex = INT_MAX;
+    }
+    bool isVisited;
+    bool isCleaned;
+    Edge ceiling;
+    Edge floor;
+
+    // 经CompressCellBoundary压缩后ceiling/floor清空, 边界改存在这里; 牛耕路径、cell内行走、cell间连接和定位cell直接读取,
+    // 其余按下标读ceiling/floor的入口(动态规划、局部重规划、日志、绘制)先用ExpandCellBoundary/ExpandCellGraph还原
+    SegmentEdge ceiling_segments;
+    SegmentEdge floor_segments;
+
+    int parentIndex;
+    std::deque<int> neighbor_indices;
+
+    int cellIndex;
+};
+
+/** 按位存储的二值栅格, 每个像素1位, 每行补齐到64位字, 1表示占据 **/
+class OccupancyGrid
+{
+public:
+    OccupancyGrid()
+    {
+        rows = 0;
+        cols = 0;
+        words_per_row = 0;
+    }
+    OccupancyGrid(int grid_rows, int grid_cols)
+    {
+        rows = grid_rows;
+        cols = grid_cols;
+        words_per_row = (grid_cols + 63) / 64;
+        words.assign(size_t(rows) * words_per_row, 0);
+    }
+    // 出界的像素视为空闲, 与原来先比较颜色再判断边界的写法结果一致
+    bool IsOccupied(int x, int y) const
+    {
+        if(x < 0 || y < 0 || x >= cols || y >= rows)
+        {
+            return false;
+        }
+        return (words[size_t(y) * words_per_row + (x >> 6)] >> (x & 63)) & 1;
+    }
+    void SetOccupied(int x, int y)
+    {
+        words[size_t(y) * words_per_row + (x >> 6)] |= (uint64_t(1) << (x & 63));
+    }
+    void SetFree(int x, int y)
+    {
+        words[size_t(y) * words_per_row + (x >> 6)] &= ~(uint64_t(1) << (x & 63));
+    }
+    uint64_t* Row(int y)
+    {
+        return &words[size_t(y) * words_per_row];
+    }
+    const uint64_t* Row(int y) const
+    {
+        return &words[size_t(y) * words_per_row];
+    }
+    size_t CountOccupied() const
+    {
+        size_t count = 0;
+        for(auto word : words)
+        {
+            count += __builtin_popcountll(word);
+        }
+        return count;
+    }
+    size_t MemoryBytes() const
+    {
+        return words.size() * sizeof(uint64_t);
+    }
+    int rows;
+    int cols;
+    int words_per_row;
+    std::vector<uint64_t> words;
+};
+
+inline bool operator<(const Point2D& p1, const Point2D& p2)
+{
+    return (p1.x < p2.x || (p1.x == p2.x && p1.y < p2.y));
+}
+
+// 同一位置两个事件的排序名次: 一般按类型枚举值的先后(IN类在OUT类之前, 外墙狭窄处CEILING在FLOOR之前).
+// 障碍物在某列只有一个像素厚时, 该像素既是上方cell的FLOOR又是下方cell的CEILING, CountCells要求先数到FLOOR, 因此障碍物的FLOOR排到CEILING之前
+inline int SameSpotEventRank(const Event& event)
+{
+    if(event.obstacle_index != INT_MAX && event.event_type == FLOOR)
+    {
+        return 2 * CEILING - 1;
+    }
+    return 2 * event.event_type;
+}
+
+// 同一多边形两次经过同一像素(狭窄处)时会在同一位置产生两个事件, 按SameSpotEventRank排序使结果确定
+inline bool operator<(const Event& e1, const Event& e2)
+{
+    return (e1.x < e2.x || (e1.x == e2.x && e1.y < e2.y) || (e1.x == e2.x && e1.y == e2.y && e1.obstacle_index < e2.obstacle_index)
+            || (e1.x == e2.x && e1.y == e2.y && e1.obstacle_index == e2.obstacle_index && SameSpotEventRank(e1) < SameSpotEventRank(e2)));
+}
+
+inline bool operator==(const Point2D& p1, const Point2D& p2)
+{
+    return (p1.x==p2.x && p1.y==p2.y);
+}
+
+inline bool operator!=(const Point2D& p1, const Point2D& p2)
+{
+    return !(p1==p2);
+}
+
+
+
+
+/** 路径规划功能函数 **/
+
+
+inline int WrappedIndex(int index, int list_length)
+{
+    int wrapped_index = (index%list_length+list_length)%list_length;
+    return wrapped_index;
+}
+
+inline double ElapsedMilliseconds(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-start).count();
+}
+
+/** 按流程阶段统计堆分配: 编译时定义BCD_PROFILE_ALLOCATIONS才由bcd_allocation_profile.cpp替换全局operator new/delete, 否则阶段标记为空操作 **/
+
+enum AllocationStageType
+{
+    STAGE_UNATTRIBUTED,
+    STAGE_CONTOUR_EXTRACTION,
+    STAGE_CONSTRUCT_OBSTACLES,
+    STAGE_EVENT_GENERATION,
+    STAGE_SLICE_LIST,
+    STAGE_CELL_DECOMPOSITION,
+    STAGE_BOUSTROPHEDON_PATH,
+    STAGE_LINKING,
+    STAGE_FILTER_TRAJECTORY,
+    STAGE_NUM
+};
+
+inline const char* AllocationStageName(int stage)
+{
+    static const char* names[STAGE_NUM] = {"unattributed", "contour extraction", "ConstructObstacles", "event generation",
+                                           "SliceListGenerator", "ExecuteCellDecomposition", "GetBoustrophedonPath",
+                                           "linking", "FilterTrajectory"};
+    return names[stage];
+}
+
+#ifdef BCD_PROFILE_ALLOCATIONS
+
+class AllocationStageCounter
+{
+public:
+    std::atomic<long long> calls{0};
+    std::atomic<long long> nanoseconds{0};
+    std::atomic<long long> allocations{0};
+    std::atomic<long long> deallocations{0};
+    std::atomic<long long> bytes{0};
+};
+
+// 计数器和当前阶段放在函数内的静态变量里, 头文件被多个编译单元包含时也只有一份; 两者都是常量初始化, operator new里调用不会引起递归
+inline AllocationStageCounter* AllocationStageCounters()
+{
+    static AllocationStageCounter counters[STAGE_NUM];
+    return counters;
+}
+
+// 每个线程各自记录当前所处阶段, 并行的单元内路径生成也能归到正确的阶段
+inline int& CurrentAllocationStage()
+{
+    thread_local int stage = STAGE_UNATTRIBUTED;
+    return stage;
+}
+
+// 在作用域内把当前线程的分配记到stage上, 退出时恢复外层阶段; 同一阶段重入时不重复计时
+class AllocationStage
+{
+public:
+    explicit AllocationStage(int stage)
+    {
+        previous_stage = CurrentAllocationStage();
+        is_reentrant = (previous_stage == stage);
+        CurrentAllocationStage() = stage;
+        start = std::chrono::steady_clock::now();
+    }
+    ~AllocationStage()
+    {
+        if(!is_reentrant)
+        {
+            AllocationStageCounter& counter = AllocationStageCounters()[CurrentAllocationStage()];
+            counter.calls.fetch_add(1, std::memory_order_relaxed);
+            counter.nanoseconds.fetch_add((long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start).count(), std::memory_order_relaxed);
+        }
+        CurrentAllocationStage() = previous_stage;
+    }
+    AllocationStage(const AllocationStage&) = delete;
+    AllocationStage& operator=(const AllocationStage&) = delete;
+
+    int previous_stage;
+    bool is_reentrant;
+    std::chrono::steady_clock::time_point start;
+};
+
+inline bool IsAllocationProfilingEnabled()
+{
+    return true;
+}
+
+inline void ResetAllocationProfile()
+{
+    for(int stage = 0; stage < STAGE_NUM; stage++)
+    {
+        AllocationStageCounter& counter = AllocationStageCounters()[stage];
+        counter.calls = 0;
+        counter.nanoseconds = 0;
+        counter.allocations = 0;
+        counter.deallocations = 0;
+        counter.bytes = 0;
+    }
+}
+
+// 每个阶段一行: 调用次数、累计耗时和分配次数/释放次数/分配字节数, 按iterations取平均
+inline void PrintAllocationProfile(int iterations=1)
+{
+    iterations = std::max(iterations, 1);
+    for(int stage = 0; stage < STAGE_NUM; stage++)
+    {
+        const AllocationStageCounter& counter = AllocationStageCounters()[stage];
+        if(counter.calls == 0 && counter.allocations == 0 && counter.deallocations == 0)
+        {
+            continue;
+        }
+        std::cout<<"  "<<AllocationStageName(stage)<<": "
+                 <<double(counter.calls)/iterations<<" calls, "
+                 <<double(counter.nanoseconds)/1e6/iterations<<" ms, "
+                 <<double(counter.allocations)/iterations<<" allocs, "
+                 <<double(counter.deallocations)/iterations<<" frees, "
+                 <<double(counter.bytes)/iterations<<" bytes"<<std::endl;
+    }
+}
+
+#else
+
+class AllocationStage
+{
+public:
+    explicit AllocationStage(int) {}
+};
+
+inline bool IsAllocationProfilingEnabled()
+{
+    return false;
+}
+
+inline void ResetAllocationProfile() {}
+
+inline void PrintAllocationProfile(int=1) {}
+
+#endif
+
+/**
+ * Chrome trace-event导出: 编译时定义BCD_TRACE_EVENTS才记录, 否则TraceSpan/TraceCounter为空操作.
+ * StartTraceRecording后各线程把span和计数器追加到自己的缓冲区, 不加锁; 规划线程全部结束后调用WriteTraceEvents写出JSON,
+ * 用chrome://tracing或Perfetto打开.
+ **/
+
+#ifdef BCD_TRACE_EVENTS
+
+class TraceEvent
+{
+public:
+    const char* name;       // 只保存指针, 须为字符串常量
+    char phase;             // 'X': 有持续时间的span, 'C': 计数器
+    double timestamp_us;    // 相对StartTraceRecording的时间
+    double duration_us;
+    const char* arg_name;   // 为nullptr时没有参数
+    long long arg_value;
+};
+
+class TraceBuffer
+{
+public:
+    int thread_id;
+    std::vector<TraceEvent> events;
+};
+
+class TraceRecorder
+{
+public:
+    std::atomic<bool> enabled{false};
+    std::chrono::steady_clock::time_point origin;
+    std::mutex mutex;                                   // 只保护buffers的注册
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;  // 线程退出后缓冲区仍由这里持有, 写出时才读取
+    int next_thread_id = 1;
+};
+
+inline TraceRecorder& GetTraceRecorder()
+{
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+// 线程第一次记录时注册自己的缓冲区, 之后只追加到本线程的vector
+inline TraceBuffer& GetThreadTraceBuffer()
+{
+    thread_local std::shared_ptr<TraceBuffer> buffer;
+    if(!buffer)
+    {
+        TraceRecorder& recorder = GetTraceRecorder();
+        buffer = std::make_shared<TraceBuffer>();
+        buffer->events.reserve(1024);
+        std::lock_guard<std::mutex> lock(recorder.mutex);
+        buffer->thread_id = recorder.next_thread_id++;
+        recorder.buffers.emplace_back(buffer);
+    }
+    return *buffer;
+}
+
+inline double TraceTimestampUs(const std::chrono::steady_clock::time_point& time)
+{
+    return std::chrono::duration<double, std::micro>(time - GetTraceRecorder().origin).count();
+}
+
+inline bool IsTraceEventsEnabled()
+{
+    return true;
+}
+
+// 清空之前记录的事件并开始记录, 须在没有规划线程运行时调用; 已退出线程的缓冲区在这里释放
+inline void StartTraceRecording()
+{
+    TraceRecorder& recorder = GetTraceRecorder();
+    {
+        std::lock_guard<std::mutex> lock(recorder.mutex);
+        std::vector<std::shared_ptr<TraceBuffer>> live_buffers;
+        for(auto& buffer : recorder.buffers)
+        {
+            if(buffer.use_count() > 1)
+            {
+                buffer->events.clear();
+                live_buffers.emplace_back(buffer);
+            }
+        }
+        recorder.buffers.swap(live_buffers);
+    }
+    recorder.origin = std::chrono::steady_clock::now();
+    recorder.enabled.store(true, std::memory_order_release);
+}
+
+inline void StopTraceRecording()
+{
+    GetTraceRecorder().enabled.store(false, std::memory_order_release);
+}
+
+// 在作用域内记录一个span, 构造时未开启记录则析构时也不记录
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name_, const char* arg_name_=nullptr, long long arg_value_=0)
+    {
+        is_recording = GetTraceRecorder().enabled.load(std::memory_order_relaxed);
+        if(is_recording)
+        {
+            name = name_;
+            arg_name = arg_name_;
+            arg_value = arg_value_;
+            start = std::chrono::steady_clock::now();
+        }
+    }
+    ~TraceSpan()
+    {
+        if(is_recording)
+        {
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            double start_us = TraceTimestampUs(start);
+            GetThreadTraceBuffer().events.emplace_back(TraceEvent{name, 'X', start_us, TraceTimestampUs(end) - start_us, arg_name, arg_value});
+        }
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    bool is_recording;
+    const char* name;
+    const char* arg_name;
+    long long arg_value;
+    std::chrono::steady_clock::time_point start;
+};
+
+inline void TraceCounter(const char* name, long long value)
+{
+    if(GetTraceRecorder().enabled.load(std::memory_order_relaxed))
+    {
+        double timestamp_us = TraceTimestampUs(std::chrono::steady_clock::now());
+        GetThreadTraceBuffer().events.emplace_back(TraceEvent{name, 'C', timestamp_us, 0.0, "value", value});
+    }
+}
+
+inline size_t RecordedTraceEventNum()
+{
+    TraceRecorder& recorder = GetTraceRecorder();
+    std::lock_guard<std::mutex> lock(recorder.mutex);
+    size_t event_num = 0;
+    for(const auto& buffer : recorder.buffers)
+    {
+        event_num += buffer->events.size();
+    }
+    return event_num;
+}
+
+// 写出Chrome trace-event JSON, 每个记录过的线程一条时间线; 须在记录的线程都结束或停止记录之后调用
+inline bool WriteTraceEvents(const std::string& file_name)
+{
+    std::ofstream file(file_name);
+    if(!file.is_open())
+    {
+        return false;
+    }
+
+    TraceRecorder& recorder = GetTraceRecorder();
+    std::lock_guard<std::mutex> lock(recorder.mutex);
+
+    file<<std::fixed;
+    file.precision(3);
+    file<<"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool is_first = true;
+    for(const auto& buffer : recorder.buffers)
+    {
+        if(buffer->events.empty())
+        {
+            continue;
+        }
+        file<<(is_first ? "\n" : ",\n")<<"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"<<buffer->thread_id
+            <<",\"args\":{\"name\":\"thread "<<buffer->thread_id<<"\"}}";
+        is_first = false;
+
+        for(const auto& event : buffer->events)
+        {
+            file<<",\n{\"name\":\""<<event.name<<"\",\"ph\":\""<<event.phase<<"\",\"pid\":1,\"tid\":"<<buffer->thread_id
+                <<",\"ts\":"<<event.timestamp_us;
+            if(event.phase == 'X')
+            {
+                file<<",\"dur\":"<<event.duration_us;
+            }
+            if(event.arg_name != nullptr)
+            {
+                file<<",\"args\":{\""<<event.arg_name<<"\":"<<event.arg_value<<"}";
+            }
+            file<<"}";
+        }
+    }
+    file<<"\n]}\n";
+    return file.good();
+}
+
+#else
+
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char*, const char* =nullptr, long long =0) {}
+};
+
+inline void TraceCounter(const char*, long long) {}
+
+inline bool IsTraceEventsEnabled()
+{
+    return false;
+}
+
+inline void StartTraceRecording() {}
+
+inline void StopTraceRecording() {}
+
+inline size_t RecordedTraceEventNum()
+{
+    return 0;
+}
+
+inline bool WriteTraceEvents(const std::string&)
+{
+    return false;
+}
+
+#endif
+
+/** 多边形光栅化: 与OpenCV的8连通LineIterator走法一致, 供不链接OpenCV的构建使用 **/
+
+// start到end的8连通直线上的像素(含两端点), 沿主方向每次走一步, 误差累计到负数时副方向也走一步
+inline std::vector<Point2D> TraceLine(const Point2D& start, const Point2D& end)
+{
+    int dx = std::abs(end.x - start.x);
+    int dy = std::abs(end.y - start.y);
+    int step_x = (end.x < start.x) ? -1 : 1;
+    int step_y = (end.y < start.y) ? -1 : 1;
+
+    bool y_major = dy > dx;
+    int major_length = y_major ? dy : dx;
+    int minor_length = y_major ? dx : dy;
+
+    std::vector<Point2D> line;
+    line.reserve(major_length + 1);
+
+    int x = start.x, y = start.y;
+    int error = major_length - 2 * minor_length;
+    for(int i = 0; i <= major_length; i++)
+    {
+        line.emplace_back(Point2D(x, y));
+
+        bool minor_step = error < 0;
+        error += -2 * minor_length + (minor_step ? 2 * major_length : 0);
+        if(y_major)
+        {
+            y += step_y;
+            x += minor_step ? step_x : 0;
+        }
+        else
+        {
+            x += step_x;
+            y += minor_step ? step_y : 0;
+        }
+    }
+
+    return line;
+}
+
+// 依次连接顶点(首尾相连)得到的闭合轮廓, 每条边不含终点
+inline Polygon TracePolygon(const std::vector<Point2D>& vertices)
+{
+    Polygon polygon;
+
+    for(int i = 0; i < vertices.size(); i++)
+    {
+        std::vector<Point2D> line = TraceLine(vertices[i], vertices[(i + 1) % vertices.size()]);
+        polygon.insert(polygon.end(), line.begin(), line.end() - 1);
+    }
+
+    return polygon;
+}
+
+// 把多边形内部和轮廓写成占据(occupied为true)或空闲, 内部按扫描线上像素中心的奇偶规则判断
+inline void FillPolygon(OccupancyGrid& occupancy_grid, const std::vector<Point2D>& vertices, bool occupied)
+{
+    auto set_pixel = [&](int x, int y)
+    {
+        if(x < 0 || y < 0 || x >= occupancy_grid.cols || y >= occupancy_grid.rows)
+        {
+            return;
+        }
+        if(occupied)
+        {
+            occupancy_grid.SetOccupied(x, y);
+        }
+        else
+        {
+            occupancy_grid.SetFree(x, y);
+        }
+    };
+
+    if(vertices.empty())
+    {
+        return;
+    }
+
+    int y_min = INT_MAX, y_max = INT_MIN;
+    for(const auto& vertex : vertices)
+    {
+        y_min = std::min(y_min, vertex.y);
+        y_max = std::max(y_max, vertex.y);
+    }
+    y_min = std::max(y_min, 0);
+    y_max = std::min(y_max, occupancy_grid.rows - 1);
+
+    // 每条边按[较小y, 较大y)计入所跨的各行, 顶点不会被数两次. 先数出每行的交点数, 再把交点按行连续存放
+    std::vector<int> row_offsets(std::max(y_max - y_min + 2, 1), 0);
+    auto for_each_crossing = [&](auto visit)
+    {
+        for(int i = 0; i < vertices.size(); i++)
+        {
+            const Point2D& a = vertices[i];
+            const Point2D& b = vertices[(i + 1) % vertices.size()];
+            for(int y = std::max(std::min(a.y, b.y), y_min); y < std::min(std::max(a.y, b.y), y_max + 1); y++)
+            {
+                visit(y, a, b);
+            }
+        }
+    };
+
+    for_each_crossing([&](int y, const Point2D&, const Point2D&)
+    {
+        row_offsets[y - y_min + 1]++;
+    });
+    for(int i = 1; i < row_offsets.size(); i++)
+    {
+        row_offsets[i] += row_offsets[i-1];
+    }
+
+    std::vector<double> crossings(row_offsets.back());
+    std::vector<int> row_ends(row_offsets.begin(), row_offsets.end() - 1);
+    for_each_crossing([&](int y, const Point2D& a, const Point2D& b)
+    {
+        crossings[row_ends[y - y_min]++] = a.x + double(y - a.y) * (b.x - a.x) / (b.y - a.y);
+    });
+
+    for(int y = y_min; y <= y_max; y++)
+    {
+        auto row_begin = crossings.begin() + row_offsets[y - y_min];
+        auto row_end = crossings.begin() + row_offsets[y - y_min + 1];
+        std::sort(row_begin, row_end);
+
+        for(auto crossing = row_begin; crossing + 1 < row_end; crossing += 2)
+        {
+            for(int x = int(std::ceil(*crossing)); x <= int(std::floor(*(crossing+1))); x++)
+            {
+                set_pixel(x, y);
+            }
+        }
+    }
+
+    for(const auto& point : TracePolygon(vertices))
+    {
+        set_pixel(point.x, point.y);
+    }
+}
+
+/** 膨胀后的可通行区域: 外墙以外和障碍物内部(含轮廓)为占据, 与ConstructOccupancyGrid(cv::Size, ...)含义相同 **/
+inline OccupancyGrid ConstructOccupancyGrid(int rows, int cols, const std::vector<Point2D>& wall_vertices, const std::vector<std::vector<Point2D>>& obstacle_vertices)
+{
+    TraceSpan trace_span("ConstructOccupancyGrid");
+    OccupancyGrid occupancy_grid(rows, cols);
+    for(auto& word : occupancy_grid.words)
+    {
+        word = ~uint64_t(0);
+    }
+
+    FillPolygon(occupancy_grid, wall_vertices, false);
+    for(const auto& vertices : obstacle_vertices)
+    {
+        FillPolygon(occupancy_grid, vertices, true);
+    }
+
+    return occupancy_grid;
+}
+
+/** 二值地图轮廓跟踪: 不经过cv::findContours直接得到外墙和墙内障碍物的轮廓, 顶点与ExtractRawContours原来两次调用findContours(RETR_EXTERNAL, CHAIN_APPROX_NONE)的结果一致 **/
+
+// 外墙是面积最大的可通行区域的外边界, 障碍物是外墙围住的占据区域的外边界, 都按边界像素逐个给出
+class BinaryMapContours
+{
+public:
+    Polygon wall;
+    PolygonList obstacles;
+};
+
+// 用thread_num个线程执行task(0)~task(task_num-1), 单线程时直接在当前线程执行
+template<typename Task>
+void RunParallel(int task_num, int thread_num, Task task)
+{
+    if(thread_num <= 1)
+    {
+        for(int task_index = 0; task_index < task_num; task_index++)
+        {
+            task(task_index);
+        }
+        return;
+    }
+
+    std::atomic<int> next_task(0);
+    std::vector<std::thread> workers;
+    for(int i = 0; i < std::min(thread_num, std::max(task_num, 1)); i++)
+    {
+        workers.emplace_back([&]()
+        {
+            for(int task_index = next_task++; task_index < task_num; task_index = next_task++)
+            {
+                task(task_index);
+            }
+        });
+    }
+    for(auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// 并查集总是把较大的根挂到较小的根下, 所以根就是连通域在光栅顺序中的第一个像素
+inline int FindComponentRoot(std::vector<int>& parent, int index)
+{
+    while(parent[index] != index)
+    {
+        parent[index] = parent[parent[index]];
+        index = parent[index];
+    }
+    return index;
+}
+
+inline void UniteComponents(std::vector<int>& parent, int index1, int index2)
+{
+    int root1 = FindComponentRoot(parent, index1);
+    int root2 = FindComponentRoot(parent, index2);
+    if(root1 < root2)
+    {
+        parent[root2] = root1;
+    }
+    else
+    {
+        parent[root1] = root2;
+    }
+}
+
+/**
+ * rows*cols区域的连通域标记, 前景8连通、背景4连通(与Suzuki边界跟踪的连通性一致), 返回每个像素所在连通域的根.
+ * 按行切成若干条带由多个线程分别标记, 再依次合并相邻条带的交界行.
+ **/
+template<typename ForegroundFunction>
+std::vector<int> LabelBinaryComponents(int rows, int cols, ForegroundFunction is_foreground, int thread_num)
+{
+    std::vector<int> labels(size_t(rows)*cols);
+
+    // 像素(x, y)与上一行相邻的同类像素合并
+    auto unite_with_upper_row = [&](int x, int y)
+    {
+        int index = y * cols + x;
+        bool foreground = is_foreground(x, y);
+        if(is_foreground(x, y-1) == foreground)
+        {
+            UniteComponents(labels, index, index-cols);
+        }
+        else if(foreground)
+        {
+            if(x > 0 && is_foreground(x-1, y-1))
+            {
+                UniteComponents(labels, index, index-cols-1);
+            }
+            if(x < cols-1 && is_foreground(x+1, y-1))
+            {
+                UniteComponents(labels, index, index-cols+1);
+            }
+        }
+    };
+
+    int band_num = std::min(rows, std::max(thread_num, 1) * 4);
+    int band_rows = (rows + band_num - 1) / band_num;
+    band_num = (rows + band_rows - 1) / band_rows;
+
+    RunParallel(band_num, thread_num, [&](int band_index)
+    {
+        int y_begin = band_index * band_rows;
+        int y_end = std::min(rows, y_begin + band_rows);
+
+        // 当前行和上一行每个像素是否为前景, 每个像素只判断一次
+        std::vector<char> upper_row(cols), current_row(cols);
+        for(int y = y_begin; y < y_end; y++)
+        {
+            for(int x = 0; x < cols; x++)
+            {
+                current_row[x] = is_foreground(x, y);
+            }
+
+            for(int x = 0; x < cols; x++)
+            {
+                int index = y * cols + x;
+                char foreground = current_row[x];
+                bool left_same = x > 0 && current_row[x-1] == foreground;
+
+                // 新像素先直接挂到第一个同类的邻居下, 其余同类邻居再合并
+                labels[index] = index;
+                if(y > y_begin && upper_row[x] == foreground)
+                {
+                    labels[index] = index-cols;
+                    // 上方是前景时, 左、左上、右上中的前景像素都已经和上方像素合并过; 背景只有左上也是背景时左边和上方才已连通
+                    if(!foreground && left_same && upper_row[x-1])
+                    {
+                        UniteComponents(labels, index, index-1);
+                    }
+                    continue;
+                }
+                if(left_same)
+                {
+                    labels[index] = index-1;
+                }
+                if(y > y_begin && foreground)
+                {
+                    if(x > 0 && upper_row[x-1])
+                    {
+                        UniteComponents(labels, index, index-cols-1);
+                    }
+                    if(x < cols-1 && upper_row[x+1])
+                    {
+                        UniteComponents(labels, index, index-cols+1);
+                    }
+                }
+            }
+
+            std::swap(upper_row, current_row);
+        }
+    });
+
+    for(int band_index = 1; band_index < band_num; band_index++)
+    {
+        for(int x = 0; x < cols; x++)
+        {
+            unite_with_upper_row(x, band_index * band_rows);
+        }
+    }
+
+    // 父节点下标总不大于自身, 按光栅顺序一遍即可让每个像素直接指向根
+    for(int index = 0; index < labels.size(); index++)
+    {
+        labels[index] = labels[labels[index]];
+    }
+
+    return labels;
+}
+
+// 不被其他前景连通域包围的前景连通域的根(按光栅顺序), 即findContours在RETR_EXTERNAL下会输出的轮廓.
+// 连通域第一个像素左边的背景连通域就是包围它的区域, 该背景接触区域边缘时连通域位于最外层.
+template<typename ForegroundFunction>
+std::vector<int> FindExternalComponents(const std::vector<int>& labels, int rows, int cols, ForegroundFunction is_foreground)
+{
+    std::vector<int> frame_roots;
+    for(int x = 0; x < cols; x++)
+    {
+        frame_roots.emplace_back(labels[x]);
+        frame_roots.emplace_back(labels[(rows-1)*cols+x]);
+    }
+    for(int y = 0; y < rows; y++)
+    {
+        frame_roots.emplace_back(labels[y*cols]);
+        frame_roots.emplace_back(labels[y*cols+cols-1]);
+    }
+    std::sort(frame_roots.begin(), frame_roots.end());
+
+    std::vector<int> external_roots;
+    for(int index = 0; index < labels.size(); index++)
+    {
+        int x = index % cols, y = index / cols;
+        if(labels[index] != index || !is_foreground(x, y))
+        {
+            continue;
+        }
+        if(x == 0 || std::binary_search(frame_roots.begin(), frame_roots.end(), labels[index-1]))
+        {
+            external_roots.emplace_back(index);
+        }
+    }
+
+    return external_roots;
+}
+
+// Suzuki外边界跟踪(与OpenCV的走法相同): 从连通域的第一个像素出发, 先顺时针找到上一个边界点, 之后每步从来向逆时针找下一个边界点.
+// 输出的顶点加上(x_offset, y_offset)
+inline Polygon TraceOuterBorder(const std::vector<int>& labels, int rows, int cols, int root, int x_offset=0, int y_offset=0)
+{
+    // 链码0~7依次为右、右上、上、左上、左、左下、下、右下
+    static const int dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+    static const int dy[8] = {0, -1, -1, -1, 0, 1, 1, 1};
+
+    auto in_component = [&](const Point2D& point)
+    {
+        return point.x >= 0 && point.y >= 0 && point.x < cols && point.y < rows && labels[size_t(point.y)*cols+point.x] == root;
+    };
+
+    Point2D start(root % cols, root / cols);
+    Polygon border;
+
+    int direction = 4;
+    do
+    {
+        direction = (direction + 7) & 7;
+    }
+    while(!in_component(Point2D(start.x+dx[direction], start.y+dy[direction])) && direction != 4);
+
+    // 孤立的单个像素
+    if(direction == 4)
+    {
+        border.emplace_back(Point2D(start.x+x_offset, start.y+y_offset));
+        return border;
+    }
+
+    Point2D last_point(start.x+dx[direction], start.y+dy[direction]);
+    Point2D current_point = start;
+    while(true)
+    {
+        Point2D next_point;
+        do
+        {
+            direction = (direction + 1) & 7;
+            next_point = Point2D(current_point.x+dx[direction], current_point.y+dy[direction]);
+        }
+        while(!in_component(next_point));
+
+        border.emplace_back(Point2D(current_point.x+x_offset, current_point.y+y_offset));
+        if(next_point == start && current_point == last_point)
+        {
+            break;
+        }
+        current_point = next_point;
+        direction = (direction + 4) & 7;
+    }
+
+    return border;
+}
+
+// 与cv::contourArea相同的多边形面积
+inline double ComputeBorderArea(const Polygon& border)
+{
+    double area = 0;
+    for(int i = 0; i < border.size(); i++)
+    {
+        const Point2D& p1 = border[i];
+        const Point2D& p2 = border[(i+1)%border.size()];
+        area += double(p1.x) * p2.y - double(p2.x) * p1.y;
+    }
+    return std::abs(area) / 2.0;
+}
+
+/**
+ * pixels按行存放, 每行row_step字节, 非0为可通行.
+ * 第一步标记整张地图的可通行连通域, 跟踪最外层连通域的边界, 取面积最大的作为外墙;
+ * 第二步只在外墙的外接矩形内, 把外墙多边形(含轮廓)里的占据像素作为前景再标记一次, 最外层连通域的边界就是障碍物.
+ * 不再需要整张图大小的mask和base, 也不需要按面积给所有轮廓排序; 标记和边界跟踪都分给thread_num个线程.
+ * 地图为空或没有可通行像素时返回false, 不输出空的外墙.
+ **/
+inline bool TraceBinaryMapContours(const uint8_t* pixels, int rows, int cols, size_t row_step, BinaryMapContours& contours, int thread_num=1)
+{
+    AllocationStage allocation_stage(STAGE_CONTOUR_EXTRACTION);
+    TraceSpan trace_span("TraceBinaryMapContours");
+    contours = BinaryMapContours();
+    if(rows <= 0 || cols <= 0)
+    {
+        return false;
+    }
+
+    auto is_free = [&](int x, int y)
+    {
+        return pixels[size_t(y)*row_step+x] != 0;
+    };
+
+    std::vector<int> labels = LabelBinaryComponents(rows, cols, is_free, thread_num);
+    std::vector<int> free_roots = FindExternalComponents(labels, rows, cols, is_free);
+    if(free_roots.empty())
+    {
+        return false;
+    }
+
+    std::vector<Polygon> free_borders(free_roots.size());
+    std::vector<double> free_areas(free_roots.size());
+    RunParallel(int(free_roots.size()), thread_num, [&](int root_index)
+    {
+        free_borders[root_index] = TraceOuterBorder(labels, rows, cols, free_roots[root_index]);
+        free_areas[root_index] = ComputeBorderArea(free_borders[root_index]);
+    });
+
+    int wall_index = int(std::max_element(free_areas.begin(), free_areas.end()) - free_areas.begin());
+    contours.wall = std::move(free_borders[wall_index]);
+
+    int x_min = cols, y_min = rows, x_max = 0, y_max = 0;
+    for(const auto& point : contours.wall)
+    {
+        x_min = std::min(x_min, point.x);
+        y_min = std::min(y_min, point.y);
+        x_max = std::max(x_max, point.x);
+        y_max = std::max(y_max, point.y);
+    }
+
+    OccupancyGrid wall_region(rows, cols);
+    FillPolygon(wall_region, contours.wall, true);
+
+    int box_rows = y_max - y_min + 1;
+    int box_cols = x_max - x_min + 1;
+    auto is_obstacle = [&](int x, int y)
+    {
+        return wall_region.IsOccupied(x+x_min, y+y_min) && !is_free(x+x_min, y+y_min);
+    };
+
+    labels = LabelBinaryComponents(box_rows, box_cols, is_obstacle, thread_num);
+    std::vector<int> obstacle_roots = FindExternalComponents(labels, box_rows, box_cols, is_obstacle);
+
+    // findContours按发现顺序的倒序输出轮廓
+    std::reverse(obstacle_roots.begin(), obstacle_roots.end());
+
+    contours.obstacles.resize(obstacle_roots.size());
+    RunParallel(int(obstacle_roots.size()), thread_num, [&](int root_index)
+    {
+        contours.obstacles[root_index] = TraceOuterBorder(labels, box_rows, box_cols, obstacle_roots[root_index], x_min, y_min);
+    });
+
+    return true;
+}
+
+/** 8连通Bresenham直线上(含两端点)是否全部空闲 **/
+inline bool IsSegmentClear(const OccupancyGrid& occupancy_grid, const Point2D& start, const Point2D& end)
+{
+    int dx = std::abs(end.x - start.x);
+    int dy = -std::abs(end.y - start.y);
+    int step_x = (start.x < end.x) ? 1 : -1;
+    int step_y = (start.y < end.y) ? 1 : -1;
+    int error = dx + dy;
+
+    int x = start.x;
+    int y = start.y;
+    while(true)
+    {
+        if(occupancy_grid.IsOccupied(x, y))
+        {
+            return false;
+        }
+        if(x == end.x && y == end.y)
+        {
+            return true;
+        }
+        int double_error = 2 * error;
+        if(double_error >= dy)
+        {
+            error += dy;
+            x += step_x;
+        }
+        if(double_error <= dx)
+        {
+            error += dx;
+            y += step_y;
+        }
+    }
+}
+
+/** 深度优先搜索遍历邻接图 **/
+inline void WalkThroughGraph(std::vector<CellNode>& cell_graph, int cell_index, int& unvisited_counter, std::deque<int>& path)
+{
+    if(!cell_graph[cell_index].isVisited)
+    {
+        cell_graph[cell_index].isVisited = true;
+        unvisited_counter--;
+    }
+    path.emplace_back(cell_index);
+
+//    for debugging
+//    std::cout<< "cell: " <<cell_graph[cell_index].cellIndex<<std::endl;
+//
+
+    // 只记录邻居的访问标记, 不拷贝邻居cell
+    bool is_neighbor_visited = false;
+    int neighbor_idx = INT_MAX;
+
+    for(int i = 0; i < cell_graph[cell_index].neighbor_indices.size(); i++)
+    {
+        neighbor_idx = cell_graph[cell_index].neighbor_indices[i];
+        is_neighbor_visited = cell_graph[neighbor_idx].isVisited;
+        if(!is_neighbor_visited)
+        {
+            break;
+        }
+    }
+
+    if(!is_neighbor_visited) // unvisited neighbor found
+    {
+        cell_graph[neighbor_idx].parentIndex = cell_graph[cell_index].cellIndex;
+        WalkThroughGraph(cell_graph, neighbor_idx, unvisited_counter, path);
+    }
+    else  // unvisited neighbor not found
+    {
+
+        if (cell_graph[cell_index].parentIndex == INT_MAX) // cannot go on back-tracking
+        {
+            return;
+        }
+        else if(unvisited_counter == 0)
+        {
+            return;
+        }
+        else
+        {
+            WalkThroughGraph(cell_graph, cell_graph[cell_index].parentIndex, unvisited_counter, path);
+        }
+    }
+}
+
+// 按访问顺序排列的cell下标, 回溯经过的cell会重复出现
+inline std::deque<int> GetVisittingOrder(std::vector<CellNode>& cell_graph, int first_cell_index)
+{
+    std::deque<int> visitting_order;
+
+    if(cell_graph.size()==1)
+    {
+        visitting_order.emplace_back(0);
+    }
+    else
+    {
+        int unvisited_counter = cell_graph.size();
+        WalkThroughGraph(cell_graph, first_cell_index, unvisited_counter, visitting_order);
+    }
+
+    return visitting_order;
+}
+
+inline std::deque<CellNode> GetVisittingPath(std::vector<CellNode>& cell_graph, int first_cell_index)
+{
+    std::deque<CellNode> visitting_path;
+
+    for(int cell_index : GetVisittingOrder(cell_graph, first_cell_index))
+    {
+        visitting_path.emplace_back(cell_graph[cell_index]);
+    }
+
+    return visitting_path;
+}
+
+// 贪心地把逐列的边界拟合成尽量长的线段: 第k列在斜率s下取整正确当且仅当 (2dy-1)/(2dx) <= s < (2dy+1)/(2dx),
+// 维护已跨过各列约束的交集, 终点连线的斜率落在交集内即可延伸到终点; 交集为空时不可能再延伸. 要求边界每列恰好一个点
+inline SegmentEdge FitSegmentEdge(const Edge& edge)
+{
+    SegmentEdge segment_edge;
+    if(edge.empty())
+    {
+        return segment_edge;
+    }
+
+    segment_edge.vertices.emplace_back(edge.front());
+
+    int start = 0;
+    int last = int(edge.size()) - 1;
+    while(start < last)
+    {
+        // 斜率下界lower_num/lower_den(闭), 上界upper_num/upper_den(开), 分母均为正
+        long long lower_num = -1, lower_den = 0;
+        long long upper_num = 1, upper_den = 0;
+        int end = start + 1;
+
+        for(int k = start + 1; k <= last; k++)
+        {
+            long long dx = k - start;
+            long long dy = edge[k].y - edge[start].y;
+
+            bool above_lower = (lower_den == 0) || (lower_num * dx <= dy * lower_den);
+            bool below_upper = (upper_den == 0) || (dy * upper_den < upper_num * dx);
+            if(above_lower && below_upper)
+            {
+                end = k;
+            }
+
+            if(lower_den == 0 || (2 * dy - 1) * lower_den > lower_num * (2 * dx))
+            {
+                lower_num = 2 * dy - 1;
+                lower_den = 2 * dx;
+            }
+            if(upper_den == 0 || (2 * dy + 1) * upper_den < upper_num * (2 * dx))
+            {
+                upper_num = 2 * dy + 1;
+                upper_den = 2 * dx;
+            }
+            if(lower_num * upper_den >= upper_num * lower_den)
+            {
+                break;
+            }
+        }
+
+        segment_edge.vertices.emplace_back(edge[end]);
+        start = end;
+    }
+
+    return segment_edge;
+}
+
+inline Edge ExpandSegmentEdge(const SegmentEdge& segment_edge)
+{
+    Edge edge;
+    edge.reserve(segment_edge.size());
+    for(int i = 0; i < segment_edge.size(); i++)
+    {
+        edge.emplace_back(segment_edge[i]);
+    }
+    return edge;
+}
+
+inline bool IsSegmentedCell(const CellNode& cell)
+{
+    return cell.ceiling.empty() && !cell.ceiling_segments.empty();
+}
+
+// 把cell的边界改存为分段线性形式并释放逐列的点; ceiling或floor不是每列恰好一个点时保持原样并返回false
+inline bool CompressCellBoundary(CellNode& cell)
+{
+    if(cell.ceiling.empty() || cell.ceiling.size() != cell.floor.size())
+    {
+        return false;
+    }
+    for(int i = 0; i < cell.ceiling.size(); i++)
+    {
+        if(cell.ceiling[i].x != cell.ceiling.front().x + i || cell.floor[i].x != cell.ceiling[i].x)
+        {
+            return false;
+        }
+    }
+
+    cell.ceiling_segments = FitSegmentEdge(cell.ceiling);
+    cell.floor_segments = FitSegmentEdge(cell.floor);
+    Edge().swap(cell.ceiling);
+    Edge().swap(cell.floor);
+    return true;
+}
+
+inline void ExpandCellBoundary(CellNode& cell)
+{
+    if(IsSegmentedCell(cell))
+    {
+        cell.ceiling = ExpandSegmentEdge(cell.ceiling_segments);
+        cell.floor = ExpandSegmentEdge(cell.floor_segments);
+        cell.ceiling_segments = SegmentEdge();
+        cell.floor_segments = SegmentEdge();
+    }
+}
+
+// 返回压缩成功的cell数
+inline int CompressCellGraph(std::vector<CellNode>& cell_graph)
+{
+    int compressed_num = 0;
+    for(auto& cell : cell_graph)
+    {
+        compressed_num += CompressCellBoundary(cell) ? 1 : 0;
+    }
+    return compressed_num;
+}
+
+inline void ExpandCellGraph(std::vector<CellNode>& cell_graph)
+{
+    for(auto& cell : cell_graph)
+    {
+        ExpandCellBoundary(cell);
+    }
+}
+
+// cell占据的列数, 即牛耕时可走的列数
+inline int CellColumnNum(const CellNode& cell)
+{
+    return IsSegmentedCell(cell) ? cell.ceiling_segments.size() : int(cell.ceiling.size());
+}
+
+inline std::vector<Point2D> ComputeCellCornerPoints(const CellNode& cell)
+{
+    if(IsSegmentedCell(cell))
+    {
+        return {cell.ceiling_segments.front(), cell.floor_segments.front(), cell.floor_segments.back(), cell.ceiling_segments.back()};
+    }
+
+    Point2D topleft = cell.ceiling.front();
+    Point2D bottomleft = cell.floor.front();
+    Point2D bottomright = cell.floor.back();
+    Point2D topright = cell.ceiling.back();
+
+    // 按照TOPLEFT、BOTTOMLEFT、BOTTOMRIGHT、TOPRIGHT的顺序储存corner points（逆时针）
+    std::vector<Point2D> corner_points = {topleft, bottomleft, bottomright, topright};
+
+    return corner_points;
+}
+
+inline std::vector<int> DetermineCellIndex(const std::vector<CellNode>& cell_graph, const Point2D& point)
+{
+    std::vector<int> cell_index;
+
+    for(int i = 0; i < cell_graph.size(); i++)
+    {
+        if(IsSegmentedCell(cell_graph[i]))
+        {
+            const CellNode& cell = cell_graph[i];
+            if(point.x >= cell.ceiling_segments.front().x && point.x <= cell.ceiling_segments.back().x
+               && point.y >= cell.ceiling_segments.YAt(point.x) && point.y <= cell.floor_segments.YAt(point.x))
+            {
+                cell_index.emplace_back(int(i));
+            }
+            continue;
+        }
+
+        for(int j = 0; j < cell_graph[i].ceiling.size(); j++)
+        {
+            if(point.x ==  cell_graph[i].ceiling[j].x && point.y >= cell_graph[i].ceiling[j].y && point.y <= cell_graph[i].floor[j].y)
+            {
+                cell_index.emplace_back(int(i));
+            }
+        }
+
+    }
+    return cell_index;
+}
+
+// 所有cell中离point最近的点(欧氏距离), point本身在某个cell中时返回point; cell图为空时返回point
+inline Point2D FindNearestCellPoint(const std::vector<CellNode>& cell_graph, const Point2D& point)
+{
+    Point2D nearest_point = point;
+    long long min_distance = LLONG_MAX;
+
+    for(const auto& cell : cell_graph)
+    {
+        bool is_segmented = IsSegmentedCell(cell);
+        int x_begin = is_segmented ? cell.ceiling_segments.front().x : cell.ceiling.front().x;
+        int x_end = is_segmented ? cell.ceiling_segments.back().x : cell.ceiling.back().x;
+        for(int x = x_begin; x <= x_end; x++)
+        {
+            int ceiling_y = is_segmented ? cell.ceiling_segments.YAt(x) : cell.ceiling[x - x_begin].y;
+            int floor_y = is_segmented ? cell.floor_segments.YAt(x) : cell.floor[x - x_begin].y;
+            int y = std::min(std::max(point.y, ceiling_y), floor_y);
+
+            long long distance = (long long)(x - point.x) * (x - point.x) + (long long)(y - point.y) * (y - point.y);
+            if(distance < min_distance)
+            {
+                min_distance = distance;
+                nearest_point = Point2D(x, y);
+            }
+        }
+    }
+
+    return nearest_point;
+}
+
+// ceiling/floor可以是逐列存储的Edge, 也可以是分段线性的SegmentEdge, 两者按下标取到的点相同
+template<typename EdgeType>
+void GetBoustrophedonPathAlongEdges(const std::vector<CellNode>& cell_graph, const CellNode& cell, const EdgeType& ceiling, const EdgeType& floor,
+                                    int corner_indicator, int robot_radius, std::deque<Point2D>& path)
+{
+    int delta, increment;
+
+    std::vector<Point2D> corner_points = ComputeCellCornerPoints(cell);
+
+    if(cell_graph[cell.cellIndex].isCleaned)
+    {
+        if(corner_indicator == TOPLEFT)
+        {
+            path.emplace_back(corner_points[TOPLEFT]);
+        }
+        if(corner_indicator == TOPRIGHT)
+        {
+            path.emplace_back(corner_points[TOPRIGHT]);
+        }
+        if(corner_indicator == BOTTOMLEFT)
+        {
+            path.emplace_back(corner_points[BOTTOMLEFT]);
+        }
+        if(corner_indicator == BOTTOMRIGHT)
+        {
+            path.emplace_back(corner_points[BOTTOMRIGHT]);
+        }
+    }
+    else
+    {
+        if(corner_indicator == TOPLEFT)
+        {
+            int x, y, y_start, y_end;
+            bool reverse = false;
+
+            for(int i = 0; i < ceiling.size(); i = i + (robot_radius+1))
+            {
+                x = ceiling[i].x;
+
+                if(!reverse)
+                {
+                    y_start = ceiling[i].y;
+                    y_end   = floor[i].y;
+
+                    for(y = y_start; y <= y_end; y++)
+                    {
+                        path.emplace_back(Point2D(x, y));
+                    }
+
+                    if((i+1<floor.size())&&(std::abs(floor[i+1].y-floor[i].y)>=2))
+                    {
+                        delta = floor[i+1].y-floor[i].y;
+                        increment = delta/abs(delta);
+                        for(int k = 1; k <= abs(delta); k++)
+                        {
+                            path.emplace_back(Point2D(floor[i].x, floor[i].y + increment * (k)));
+                        }
+                    }
+
+                    if(robot_radius != 0)
+                    {
+                        for(int j = 1; j <= robot_radius+1; j++)
+                        {
+                            // 沿着floor从左往右
+                            if( x+j >= floor.back().x)
+                            {
+                                i = i - (robot_radius - (j - 1));
+                                break;
+                            }
+
+                            //提前转
+                            else if((floor[i+(j)].y-floor[i+(j+1)].y>=2)
+                               &&(j<=robot_radius+1)
+                               &&(j+1<=robot_radius+1))
+                            {
+                                delta = floor[i+(j+1)].y-floor[i+(j)].y;
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(floor[i+(j)].x, floor[i+(j)].y+increment*(k)));
+                                }
+                            }
+                            //滞后转
+                            else if((floor[i+(j+1)].y-floor[i+(j)].y>=2)
+                                    &&(j+1<=robot_radius+1)
+                                    &&(j<=robot_radius+1))
+                            {
+                                path.emplace_back(Point2D(floor[i+(j)].x, floor[i+(j)].y));
+
+                                delta = floor[i+(j+1)].y-floor[i+(j)].y;
+
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(floor[i+(j+1)].x, floor[i+(j+1)].y-abs(delta) +increment*(k)));
+                                }
+                            }
+                            else
+                            {
+                                path.emplace_back(floor[i+(j)]);
+                            }
+
+                        }
+                    }
+
+                    reverse = !reverse;
+                }
+                else
+                {
+                    y_start = floor[i].y;
+                    y_end   = ceiling[i].y;
+
+                    for (y = y_start; y >= y_end; y--)
+                    {
+                        path.emplace_back(Point2D(x, y));
+                    }
+
+                    if((i+1<ceiling.size())&&(std::abs(ceiling[i+1].y-ceiling[i].y)>=2))
+                    {
+                        delta = ceiling[i+1].y-ceiling[i].y;
+                        increment = delta/abs(delta);
+                        for(int k = 1; k <= abs(delta); k++)
+                        {
+                            path.emplace_back(Point2D(ceiling[i].x, ceiling[i].y+increment*(k)));
+                        }
+                    }
+
+                    if(robot_radius != 0)
+                    {
+                        for(int j = 1; j <= robot_radius+1; j++)
+                        {
+                            // 沿着ceiling从左往右
+                            if(x+j >= ceiling.back().x)
+                            {
+                                i = i - (robot_radius - (j - 1));
+                                break;
+                            }
+
+                            // 提前转
+                            else if((ceiling[i+(j+1)].y-ceiling[i+(j)].y>=2)
+                               &&(j+1 <= robot_radius+1)
+                               &&(j <= robot_radius+1))
+                            {
+                                delta = ceiling[i+(j+1)].y-ceiling[i+(j)].y;
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(ceiling[i+j].x, ceiling[i+j].y+increment*(k)));
+                                }
+                            }
+                            // 滞后转
+                            else if((ceiling[i+(j)].y-ceiling[i+(j+1)].y>=2)
+                                    &&(j<=robot_radius+1)
+                                    &&(j+1<=robot_radius+1))
+                            {
+                                path.emplace_back(ceiling[i+(j)]);
+
+                                delta = ceiling[i+(j+1)].y-ceiling[i+(j)].y;
+
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(ceiling[i+(j+1)].x, ceiling[i+(j+1)].y+abs(delta)+increment*(k)));
+                                }
+                            }
+                            else
+                            {
+                                path.emplace_back(ceiling[i+j]);
+                            }
+
+                        }
+                    }
+
+                    reverse = !reverse;
+                }
+            }
+        }
+
+        if(corner_indicator == TOPRIGHT)
+        {
+            int x=0, y=0, y_start=0, y_end=0;
+            bool reverse = false;
+
+            for(int i = ceiling.size()-1; i >= 0; i=i-(robot_radius+1))
+            {
+                x = ceiling[i].x;
+
+                if(!reverse)
+                {
+                    y_start = ceiling[i].y;
+                    y_end   = floor[i].y;
+
+                    for(y = y_start; y <= y_end; y++)
+                    {
+                        path.emplace_back(Point2D(x, y));
+                    }
+
+                    if((i-1>=0)&&(std::abs(floor[i-1].y-floor[i].y)>=2))
+                    {
+                        delta = floor[i-1].y-floor[i].y;
+                        increment = delta/abs(delta);
+                        for(int k = 1; k <= abs(delta); k++)
+                        {
+                            path.emplace_back(Point2D(floor[i].x, floor[i].y+increment*(k)));
+                        }
+                    }
+
+                    if(robot_radius != 0)
+                    {
+                        for(int j = 1; j <= robot_radius+1; j++)
+                        {
+                            // 沿着floor从右往左
+                            if(x-j <= floor.front().x)
+                            {
+                                i = i + (robot_radius - (j - 1));
+                                break;
+                            }
+                            //提前转
+                            else if((floor[i-(j)].y-floor[i-(j+1)].y>=2)
+                               &&(j<=robot_radius+1)
+                               &&(j+1<=robot_radius+1))
+                            {
+                                delta = floor[i-(j+1)].y-floor[i-(j)].y;
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(floor[i-(j)].x, floor[i-(j)].y+increment*(k)));
+                                }
+                            }
+                            //滞后转
+                            else if((floor[i-(j+1)].y-floor[i-(j)].y>=2)
+                                    &&(j+1<=robot_radius+1)
+                                    &&(j<=robot_radius+1))
+                            {
+                                path.emplace_back(Point2D(floor[i-(j)].x, floor[i-(j)].y));
+
+                                delta = floor[i-(j+1)].y-floor[i-(j)].y;
+
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(floor[i-(j+1)].x, floor[i-(j+1)].y-abs(delta) +increment*(k)));
+                                }
+                            }
+                            else
+                            {
+                                path.emplace_back(floor[i-(j)]);
+                            }
+                        }
+                    }
+
+                    reverse = !reverse;
+                }
+                else
+                {
+                    y_start = floor[i].y;
+                    y_end   = ceiling[i].y;
+
+                    for (y = y_start; y >= y_end; y--)
+                    {
+                        path.emplace_back(Point2D(x, y));
+                    }
+
+                    if((i-1>=0)&&(std::abs(ceiling[i-1].y-ceiling[i].y)>=2))
+                    {
+                        delta = ceiling[i-1].y-ceiling[i].y;
+                        increment = delta/abs(delta);
+                        for(int k = 1; k <= abs(delta); k++)
+                        {
+                            path.emplace_back(Point2D(ceiling[i].x, ceiling[i].y+increment*(k)));
+                        }
+                    }
+
+                    if(robot_radius != 0)
+                    {
+                        for(int j = 1; j <= robot_radius+1; j++)
+                        {
+                            // 沿着ceiling从右往左
+                            if( x-j <= ceiling.front().x)
+                            {
+                                i = i + (robot_radius - (j - 1));
+                                break;
+                            }
+                            // 提前转
+                            else if((ceiling[i-(j+1)].y-ceiling[i-(j)].y>=2)
+                               &&(j+1 <= robot_radius+1)
+                               &&(j <= robot_radius+1))
+                            {
+                                delta = ceiling[i-(j+1)].y-ceiling[i-(j)].y;
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(ceiling[i-j].x, ceiling[i-j].y+increment*(k)));
+                                }
+                            }
+                            // 滞后转
+                            else if((ceiling[i-(j)].y-ceiling[i-(j+1)].y>=2)
+                                    &&(j<=robot_radius+1)
+                                    &&(j+1<=robot_radius+1))
+                            {
+                                path.emplace_back(ceiling[i-(j)]);
+
+                                delta = ceiling[i-(j+1)].y-ceiling[i-(j)].y;
+
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(ceiling[i-(j+1)].x, ceiling[i-(j+1)].y+abs(delta)+increment*(k)));
+                                }
+                            }
+                            else
+                            {
+                                path.emplace_back(ceiling[i-j]);
+                            }
+                        }
+                    }
+
+                    reverse = !reverse;
+                }
+            }
+        }
+
+        if(corner_indicator == BOTTOMLEFT)
+        {
+            int x=0, y=0, y_start=0, y_end=0;
+            bool reverse = false;
+
+            for(int i = 0; i < ceiling.size(); i=i+(robot_radius+1))
+            {
+                x = ceiling[i].x;
+
+                if(!reverse)
+                {
+                    y_start = floor[i].y;
+                    y_end   = ceiling[i].y;
+
+                    for(y = y_start; y >= y_end; y--)
+                    {
+                        path.emplace_back(Point2D(x, y));
+                    }
+
+                    if((i+1<ceiling.size())&&(std::abs(ceiling[i+1].y-ceiling[i].y)>=2))
+                    {
+                        delta = ceiling[i+1].y-ceiling[i].y;
+                        increment = delta/abs(delta);
+                        for(int k = 1; k <= abs(delta); k++)
+                        {
+                            path.emplace_back(Point2D(ceiling[i].x, ceiling[i].y+increment*(k)));
+                        }
+                    }
+
+                    if(robot_radius != 0)
+                    {
+                        for(int j = 1; j <= robot_radius+1; j++)
+                        {
+                            // 沿着ceiling从左往右
+                            if(x+j >= ceiling.back().x)
+                            {
+                                i = i - (robot_radius - (j - 1));
+                                break;
+                            }
+                            // 提前转
+                            else if((ceiling[i+(j+1)].y-ceiling[i+(j)].y>=2)
+                               &&(j+1 <= robot_radius+1)
+                               &&(j <= robot_radius+1))
+                            {
+                                delta = ceiling[i+(j+1)].y-ceiling[i+(j)].y;
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(ceiling[i+j].x, ceiling[i+j].y+increment*(k)));
+                                }
+                            }
+                                // 滞后转
+                            else if((ceiling[i+(j)].y-ceiling[i+(j+1)].y>=2)
+                                    &&(j<=robot_radius+1)
+                                    &&(j+1<=robot_radius+1))
+                            {
+                                path.emplace_back(ceiling[i+(j)]);
+
+                                delta = ceiling[i+(j+1)].y-ceiling[i+(j)].y;
+
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(ceiling[i+(j+1)].x, ceiling[i+(j+1)].y+abs(delta)+increment*(k)));
+                                }
+                            }
+                            else
+                            {
+                                path.emplace_back(ceiling[i+j]);
+                            }
+                        }
+                    }
+
+                    reverse = !reverse;
+                }
+                else
+                {
+                    y_start = ceiling[i].y;
+                    y_end   = floor[i].y;
+
+                    for (y = y_start; y <= y_end; y++)
+                    {
+                        path.emplace_back(Point2D(x, y));
+                    }
+
+                    if((i+1<floor.size())&&(std::abs(floor[i+1].y-floor[i].y)>=2))
+                    {
+                        delta = floor[i+1].y-floor[i].y;
+                        increment = delta/abs(delta);
+                        for(int k = 1; k <= abs(delta); k++)
+                        {
+                            path.emplace_back(Point2D(floor[i].x, floor[i].y+increment*(k)));
+                        }
+                    }
+
+                    if(robot_radius != 0)
+                    {
+                        for(int j = 1; j <= robot_radius+1; j++)
+                        {
+                            // 沿着floor从左往右
+                            if(x+j >= floor.back().x)
+                            {
+                                i = i - (robot_radius - (j - 1));
+                                break;
+                            }
+
+                            //提前转
+                            else if((floor[i+(j)].y-floor[i+(j+1)].y>=2)
+                               &&(j<=robot_radius+1)
+                               &&(j+1<=robot_radius+1))
+                            {
+                                delta = floor[i+(j+1)].y-floor[i+(j)].y;
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(floor[i+(j)].x, floor[i+(j)].y+increment*(k)));
+                                }
+                            }
+                                //滞后转
+                            else if((floor[i+(j+1)].y-floor[i+(j)].y>=2)
+                                    &&(j+1<=robot_radius+1)
+                                    &&(j<=robot_radius+1))
+                            {
+                                path.emplace_back(Point2D(floor[i+(j)].x, floor[i+(j)].y));
+
+                                delta = floor[i+(j+1)].y-floor[i+(j)].y;
+
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(floor[i+(j+1)].x, floor[i+(j+1)].y-abs(delta) +increment*(k)));
+                                }
+                            }
+                            else
+                            {
+                                path.emplace_back(floor[i+(j)]);
+                            }
+                        }
+                    }
+
+                    reverse = !reverse;
+                }
+            }
+        }
+
+        if(corner_indicator == BOTTOMRIGHT)
+        {
+            int x=0, y=0, y_start=0, y_end=0;
+            bool reverse = false;
+
+            for(int i = ceiling.size()-1; i >= 0; i=i-(robot_radius+1))
+            {
+                x = ceiling[i].x;
+
+                if(!reverse)
+                {
+                    y_start = floor[i].y;
+                    y_end   = ceiling[i].y;
+
+                    for(y = y_start; y >= y_end; y--)
+                    {
+                        path.emplace_back(Point2D(x, y));
+                    }
+
+                    if((i-1>=0)&&(std::abs(ceiling[i-1].y-ceiling[i].y)>=2))
+                    {
+                        delta = ceiling[i-1].y-ceiling[i].y;
+                        increment = delta/abs(delta);
+                        for(int k = 1; k <= abs(delta); k++)
+                        {
+                            path.emplace_back(Point2D(ceiling[i].x, ceiling[i].y+increment*(k)));
+                        }
+                    }
+
+                    if(robot_radius != 0)
+                    {
+                        for(int j = 1; j <= robot_radius+1; j++)
+                        {
+                            // 沿着ceiling从右往左
+                            if(x-j <= ceiling.front().x)
+                            {
+                                i = i + (robot_radius - (j - 1));
+                                break;
+                            }
+                            // 提前转
+                            else if((ceiling[i-(j+1)].y-ceiling[i-(j)].y>=2)
+                               &&(j+1 <= robot_radius+1)
+                               &&(j <= robot_radius+1))
+                            {
+                                delta = ceiling[i-(j+1)].y-ceiling[i-(j)].y;
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(ceiling[i-j].x, ceiling[i-j].y+increment*(k)));
+                                }
+                            }
+                                // 滞后转
+                            else if((ceiling[i-(j)].y-ceiling[i-(j+1)].y>=2)
+                                    &&(j<=robot_radius+1)
+                                    &&(j+1<=robot_radius+1))
+                            {
+                                path.emplace_back(ceiling[i-(j)]);
+
+                                delta = ceiling[i-(j+1)].y-ceiling[i-(j)].y;
+
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(ceiling[i-(j+1)].x, ceiling[i-(j+1)].y+abs(delta)+increment*(k)));
+                                }
+                            }
+                            else
+                            {
+                                path.emplace_back(ceiling[i-j]);
+                            }
+
+                        }
+                    }
+
+                    reverse = !reverse;
+                }
+                else
+                {
+                    y_start = ceiling[i].y;
+                    y_end   = floor[i].y;
+
+                    for (y = y_start; y <= y_end; y++)
+                    {
+                        path.emplace_back(Point2D(x, y));
+                    }
+
+                    if((i-1>=0)&&(std::abs(floor[i-1].y-floor[i].y)>=2))
+                    {
+                        delta = floor[i-1].y-floor[i].y;
+                        increment = delta/abs(delta);
+                        for(int k = 1; k <= abs(delta); k++)
+                        {
+                            path.emplace_back(Point2D(floor[i].x, floor[i].y+increment*(k)));
+                        }
+                    }
+
+                    if(robot_radius != 0)
+                    {
+                        for(int j = 1; j <= robot_radius+1; j++)
+                        {
+                            // 沿着floor从右往左
+                            if(x-j <= floor.front().x)
+                            {
+                                i = i + (robot_radius - (j - 1));
+                                break;
+                            }
+                            //提前转
+                            else if((floor[i-(j)].y-floor[i-(j+1)].y>=2)
+                               &&(j<=robot_radius+1)
+                               &&(j+1<=robot_radius+1))
+                            {
+                                delta = floor[i-(j+1)].y-floor[i-(j)].y;
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(floor[i-(j)].x, floor[i-(j)].y+increment*(k)));
+                                }
+                            }
+                                //滞后转
+                            else if((floor[i-(j+1)].y-floor[i-(j)].y>=2)
+                                    &&(j+1<=robot_radius+1)
+                                    &&(j<=robot_radius+1))
+                            {
+                                path.emplace_back(Point2D(floor[i-(j)].x, floor[i-(j)].y));
+
+                                delta = floor[i-(j+1)].y-floor[i-(j)].y;
+
+                                increment = delta/abs(delta);
+                                for(int k = 0; k <= abs(delta); k++)
+                                {
+                                    path.emplace_back(Point2D(floor[i-(j+1)].x, floor[i-(j+1)].y-abs(delta) +increment*(k)));
+                                }
+                            }
+                            else
+                            {
+                                path.emplace_back(floor[i-(j)]);
+                            }
+
+                        }
+                    }
+
+                    reverse = !reverse;
+                }
+            }
+        }
+    }
+
+}
+
+// 牛耕式路径追加到path末尾. ceiling和floor直接引用cell中的数据, 不再拷贝
+inline void GetBoustrophedonPath(const std::vector<CellNode>& cell_graph, const CellNode& cell, int corner_indicator, int robot_radius, std::deque<Point2D>& path)
+{
+    AllocationStage allocation_stage(STAGE_BOUSTROPHEDON_PATH);
+    TraceSpan trace_span("GetBoustrophedonPath", "cell", cell.cellIndex);
+    if(IsSegmentedCell(cell))
+    {
+        GetBoustrophedonPathAlongEdges(cell_graph, cell, cell.ceiling_segments, cell.floor_segments, corner_indicator, robot_radius, path);
+    }
+    else
+    {
+        GetBoustrophedonPathAlongEdges(cell_graph, cell, cell.ceiling, cell.floor, corner_indicator, robot_radius, path);
+    }
+}
+
+inline std::deque<Point2D> GetBoustrophedonPath(const std::vector<CellNode>& cell_graph, const CellNode& cell, int corner_indicator, int robot_radius)
+{
+    std::deque<Point2D> path;
+    GetBoustrophedonPath(cell_graph, cell, corner_indicator, robot_radius, path);
+    return path;
+}
+
+inline std::vector<Event> InitializeEventList(const Polygon& polygon, int polygon_index)
+{
+    std::vector<Event> event_list;
+
+    for(const auto& point : polygon)
+    {
+        event_list.emplace_back(Event(polygon_index, point.x, point.y));
+    }
+
+    return event_list;
+}
+
+/**
+ * 事件分类: 先把x相同的相邻顶点压缩成竖直段, 段内顶点为MIDDLE; 段两端的顶点由它与相邻顶点的大小关系组成签名, 查表得到类型.
+ * 签名 = ((与段外相邻顶点的x比较*4 + 与段内相邻顶点的y比较)*3 + 与段另一侧顶点的x比较)*3 + 与段另一侧顶点的y比较,
+ * 比较结果0/1/2表示小于/等于/大于; 段内只有一个顶点时段内y比较记为3, 这时只看前后两个顶点的x.
+ * 表中给出障碍物的类型, 外墙的类型依次加上IN_EX-IN.
+ **/
+enum CompareResult
+{
+    COMPARE_LESS,
+    COMPARE_EQUAL,
+    COMPARE_GREATER,
+    COMPARE_NONE
+};
+
+const int VERTEX_SIGNATURE_NUM = 3*4*3*3;
+
+inline int CompareCoordinate(int lhs, int rhs)
+{
+    return (lhs > rhs) - (lhs < rhs) + 1;
+}
+
+constexpr EventType ClassifyVertexSignature(int signature)
+{
+    int far_y = signature % 3;
+    int far_x = signature / 3 % 3;
+    int near_y = signature / 9 % 4;
+    int off_x = signature / 36;
+
+    if(near_y == COMPARE_NONE)
+    {
+        if(off_x == COMPARE_LESS && far_x == COMPARE_LESS)
+        {
+            return IN;
+        }
+        if(off_x == COMPARE_GREATER && far_x == COMPARE_GREATER)
+        {
+            return OUT;
+        }
+        return UNALLOCATED;
+    }
+
+    // 竖直段两侧的顶点都在右边是入口, 都在左边是出口; 顶点在段的上端(y较小)且比另一侧的顶点高时为TOP, 反之为BOTTOM
+    if(off_x == COMPARE_LESS && far_x == COMPARE_LESS)
+    {
+        if(near_y == COMPARE_LESS && far_y == COMPARE_LESS)
+        {
+            return IN_TOP;
+        }
+        if(near_y == COMPARE_GREATER && far_y == COMPARE_GREATER)
+        {
+            return IN_BOTTOM;
+        }
+    }
+    if(off_x == COMPARE_GREATER && far_x == COMPARE_GREATER)
+    {
+        if(near_y == COMPARE_LESS && far_y == COMPARE_LESS)
+        {
+            return OUT_TOP;
+        }
+        if(near_y == COMPARE_GREATER && far_y == COMPARE_GREATER)
+        {
+            return OUT_BOTTOM;
+        }
+    }
+    return UNALLOCATED;
+}
+
+class VertexEventTable
+{
+public:
+    constexpr VertexEventTable() : types()
+    {
+        for(int signature = 0; signature < VERTEX_SIGNATURE_NUM; signature++)
+        {
+            types[signature] = ClassifyVertexSignature(signature);
+        }
+    }
+    EventType types[VERTEX_SIGNATURE_NUM];
+};
+
+constexpr VertexEventTable vertex_event_table;
+
+static_assert(vertex_event_table.types[((COMPARE_LESS*4+COMPARE_NONE)*3+COMPARE_LESS)*3+COMPARE_EQUAL] == IN, "single vertex left of both neighbors is IN");
+static_assert(vertex_event_table.types[((COMPARE_GREATER*4+COMPARE_GREATER)*3+COMPARE_GREATER)*3+COMPARE_GREATER] == OUT_BOTTOM, "lower end of a right-most vertical run is OUT_BOTTOM");
+
+// is_wall为true时按外墙分类(外墙内为可通行区域), 否则按障碍物分类, 结果与原来的AllocateObstacleEventType/AllocateWallEventType相同
+inline void AllocateEventType(const OccupancyGrid& occupancy_grid, std::vector<Event>& event_list, bool is_wall)
+{
+    int N = event_list.size();
+    auto next_index = [N](int index){ return (index+1 == N) ? 0 : index+1; };
+    auto prev_index = [N](int index){ return (index == 0) ? N-1 : index-1; };
+
+    // 从一个竖直段的第一个顶点开始, 按段走一圈; 所有顶点x相同的多边形没有面积, 不产生事件
+    int first_run_start = 0;
+    while(first_run_start < N && event_list[first_run_start].x == event_list[prev_index(first_run_start)].x)
+    {
+        first_run_start++;
+    }
+    if(first_run_start == N)
+    {
+        return;
+    }
+
+    int type_offset = is_wall ? (IN_EX - IN) : 0;
+    std::vector<int> in_out_index_list; // 只存放各种in和out的index
+    std::vector<char> is_in_event(N, false);
+    std::vector<char> is_in_out(N, false);
+
+    auto allocate = [&](int index, int signature)
+    {
+        EventType type = vertex_event_table.types[signature];
+        if(type != UNALLOCATED)
+        {
+            event_list[index].event_type = EventType(type + type_offset);
+            is_in_out[index] = true;
+            is_in_event[index] = (type == IN || type == IN_TOP || type == IN_BOTTOM);
+        }
+    };
+
+    // determine in and out and middle
+    int run_start = first_run_start;
+    for(int visited = 0; visited < N;)
+    {
+        int run_end = run_start;
+        int run_length = 1;
+        while(event_list[next_index(run_end)].x == event_list[run_start].x)
+        {
+            run_end = next_index(run_end);
+            run_length++;
+        }
+
+        const Event& start = event_list[run_start];
+        const Event& end = event_list[run_end];
+        const Event& before = event_list[prev_index(run_start)];
+        const Event& after = event_list[next_index(run_end)];
+
+        if(run_length == 1)
+        {
+            allocate(run_start, ((CompareCoordinate(start.x, before.x)*4+COMPARE_NONE)*3+CompareCoordinate(start.x, after.x))*3+COMPARE_EQUAL);
+        }
+        else
+        {
+            allocate(run_start, ((CompareCoordinate(start.x, before.x)*4+CompareCoordinate(start.y, event_list[next_index(run_start)].y))*3
+                                 +CompareCoordinate(start.x, after.x))*3+CompareCoordinate(start.y, after.y));
+            for(int i = next_index(run_start); i != run_end; i = next_index(i))
+            {
+                event_list[i].event_type = MIDDLE;
+            }
+            allocate(run_end, ((CompareCoordinate(end.x, after.x)*4+CompareCoordinate(end.y, event_list[prev_index(run_end)].y))*3
+                               +CompareCoordinate(end.x, before.x))*3+CompareCoordinate(end.y, before.y));
+        }
+
+        visited += run_length;
+        run_start = next_index(run_end);
+    }
+
+    for(int i = 0; i < N; i++)
+    {
+        if(is_in_out[i])
+        {
+            in_out_index_list.emplace_back(i);
+        }
+    }
+    if(in_out_index_list.empty())
+    {
+        return;
+    }
+
+    // determine inner: 入口左边/出口右边的像素, 障碍物被占据时、外墙在地图内且空闲时为内部事件
+    for(auto in_out_index : in_out_index_list)
+    {
+        Event& event = event_list[in_out_index];
+        int neighbor_x = is_in_event[in_out_index] ? event.x-1 : event.x+1;
+        bool is_inner = is_wall ? (!occupancy_grid.IsOccupied(neighbor_x, event.y) && neighbor_x >= 0 && neighbor_x < occupancy_grid.cols)
+                                : occupancy_grid.IsOccupied(neighbor_x, event.y);
+        if(is_inner)
+        {
+            event.event_type = EventType(event.event_type + (INNER_IN - IN));
+        }
+    }
+
+    // determine floor and ceiling: 相邻两个in/out事件之间的顶点, 障碍物从out到in为floor, 外墙相反
+    EventType out_to_in_type = is_wall ? CEILING : FLOOR;
+    EventType in_to_out_type = is_wall ? FLOOR : CEILING;
+    std::vector<int> ceiling_floor_index_list;
+
+    for(int i = 0; i < in_out_index_list.size(); i++)
+    {
+        int from = in_out_index_list[i];
+        int to = in_out_index_list[(i+1 == in_out_index_list.size()) ? 0 : i+1];
+        if(is_in_event[from] == is_in_event[to])
+        {
+            continue;
+        }
+
+        EventType boundary_type = is_in_event[from] ? in_to_out_type : out_to_in_type;
+        for(int j = next_index(from); j != to; j = next_index(j))
+        {
+            if(event_list[j].event_type != MIDDLE)
+            {
+                event_list[j].event_type = boundary_type;
+                ceiling_floor_index_list.emplace_back(j);
+            }
+        }
+    }
+    if(ceiling_floor_index_list.empty())
+    {
+        return;
+    }
+
+    // filter ceiling and floor: x相同的相邻两个ceiling只保留y较大的, floor只保留y较小的, 最后一个与第一个也算相邻
+    for(int i = 0; i < ceiling_floor_index_list.size(); i++)
+    {
+        Event& curr_event = event_list[ceiling_floor_index_list[i]];
+        Event& next_event = event_list[ceiling_floor_index_list[(i+1 == ceiling_floor_index_list.size()) ? 0 : i+1]];
+
+        if(curr_event.event_type==CEILING && next_event.event_type==CEILING && curr_event.x==next_event.x)
+        {
+            if(curr_event.y>next_event.y)
+            {
+                next_event.event_type = MIDDLE;
+            }
+            else
+            {
+                curr_event.event_type = MIDDLE;
+            }
+        }
+        if(curr_event.event_type==FLOOR && next_event.event_type==FLOOR && curr_event.x==next_event.x)
+        {
+            if(curr_event.y<next_event.y)
+            {
+                next_event.event_type = MIDDLE;
+            }
+            else
+            {
+                curr_event.event_type = MIDDLE;
+            }
+        }
+    }
+}
+
+inline void AllocateObstacleEventType(const OccupancyGrid& occupancy_grid, std::vector<Event>& event_list)
+{
+    AllocateEventType(occupancy_grid, event_list, false);
+}
+
+inline void AllocateWallEventType(const OccupancyGrid& occupancy_grid, std::vector<Event>& event_list)
+{
+    AllocateEventType(occupancy_grid, event_list, true);
+}
+
+inline std::vector<Event> GenerateObstacleEventList(const OccupancyGrid& occupancy_grid, const PolygonList& polygons)
+{
+    AllocationStage allocation_stage(STAGE_EVENT_GENERATION);
+    TraceSpan trace_span("GenerateObstacleEventList");
+    std::vector<Event> event_list;
+    std::vector<Event> event_sublist;
+
+    for(int i = 0; i < polygons.size(); i++)
+    {
+        event_sublist = InitializeEventList(polygons[i], i);
+        AllocateObstacleEventType(occupancy_grid, event_sublist);
+        event_list.insert(event_list.end(), event_sublist.begin(), event_sublist.end());
+        event_sublist.clear();
+    }
+
+    std::sort(event_list.begin(), event_list.end());
+
+    return event_list;
+}
+
+inline std::vector<Event> GenerateWallEventList(const OccupancyGrid& occupancy_grid, const Polygon& external_contour)
+{
+    AllocationStage allocation_stage(STAGE_EVENT_GENERATION);
+    TraceSpan trace_span("GenerateWallEventList");
+    std::vector<Event> event_list;
+
+    event_list = InitializeEventList(external_contour, INT_MAX);
+    AllocateWallEventType(occupancy_grid, event_list);
+    std::sort(event_list.begin(), event_list.end());
+
+    return event_list;
+}
+
+inline std::deque<std::deque<Event>> SliceListGenerator(const std::vector<Event>& wall_event_list, const std::vector<Event>& obstacle_event_list)
+{
+    AllocationStage allocation_stage(STAGE_SLICE_LIST);
+    TraceSpan trace_span("SliceListGenerator");
+    std::vector<Event> event_list;
+    event_list.insert(event_list.end(), obstacle_event_list.begin(), obstacle_event_list.end());
+    event_list.insert(event_list.end(), wall_event_list.begin(), wall_event_list.end());
+    std::sort(event_list.begin(), event_list.end());
+
+    std::deque<std::deque<Event>> slice_list;
+    std::deque<Event> slice;
+    int x = event_list.front().x;
+
+    for(auto event : event_list)
+    {
+        if(event.x != x)
+        {
+            slice_list.emplace_back(slice);
+
+            x = event.x;
+            slice.clear();
+            slice.emplace_back(event);
+        }
+        else
+        {
+            slice.emplace_back(event);
+        }
+    }
+    slice_list.emplace_back(slice);
+
+    return slice_list;
+}
+
+inline void ExecuteOpenOperation(std::vector<CellNode>& cell_graph, int curr_cell_idx, Point2D in, Point2D c, Point2D f, bool rewrite = false)
+{
+
+    CellNode top_cell, bottom_cell;
+
+    top_cell.ceiling.emplace_back(c);
+    top_cell.floor.emplace_back(in);
+
+    bottom_cell.ceiling.emplace_back(in);
+    bottom_cell.floor.emplace_back(f);
+
+    if(!rewrite)
+    {
+        int top_cell_index = cell_graph.size();
+        int bottom_cell_index = cell_graph.size() + 1;
+
+        top_cell.cellIndex = top_cell_index;
+        bottom_cell.cellIndex = bottom_cell_index;
+        cell_graph.emplace_back(top_cell);
+        cell_graph.emplace_back(bottom_cell);
+
+
+        cell_graph[top_cell_index].neighbor_indices.emplace_back(curr_cell_idx);
+        cell_graph[bottom_cell_index].neighbor_indices.emplace_front(curr_cell_idx);
+
+        cell_graph[curr_cell_idx].neighbor_indices.emplace_front(top_cell_index);
+        cell_graph[curr_cell_idx].neighbor_indices.emplace_front(bottom_cell_index);
+    }
+    else
+    {
+        cell_graph[curr_cell_idx].ceiling.assign(top_cell.ceiling.begin(), top_cell.ceiling.end());
+        cell_graph[curr_cell_idx].floor.assign(top_cell.floor.begin(), top_cell.floor.end());
+
+        int bottom_cell_index = cell_graph.size();
+        bottom_cell.cellIndex = bottom_cell_index;
+        cell_graph.emplace_back(bottom_cell);
+
+        cell_graph[cell_graph[curr_cell_idx].neighbor_indices.back()].neighbor_indices.emplace_back(bottom_cell_index);
+        cell_graph[bottom_cell_index].neighbor_indices.emplace_back(cell_graph[curr_cell_idx].neighbor_indices.back());
+
+    }
+}
+
+inline void ExecuteCloseOperation(std::vector<CellNode>& cell_graph, int top_cell_idx, int bottom_cell_idx, Point2D c, Point2D f, bool rewrite = false)
+{
+    CellNode new_cell;
+
+    new_cell.ceiling.emplace_back(c);
+    new_cell.floor.emplace_back(f);
+
+    if(!rewrite)
+    {
+        int new_cell_idx = cell_graph.size();
+        new_cell.cellIndex = new_cell_idx;
+
+        cell_graph.emplace_back(new_cell);
+
+
+        cell_graph[new_cell_idx].neighbor_indices.emplace_back(top_cell_idx);
+        cell_graph[new_cell_idx].neighbor_indices.emplace_back(bottom_cell_idx);
+
+        cell_graph[top_cell_idx].neighbor_indices.emplace_front(new_cell_idx);
+        cell_graph[bottom_cell_idx].neighbor_indices.emplace_back(new_cell_idx);
+    }
+    else
+    {
+        cell_graph[top_cell_idx].ceiling.assign(new_cell.ceiling.begin(), new_cell.ceiling.end());
+        cell_graph[top_cell_idx].floor.assign(new_cell.floor.begin(), new_cell.floor.end());
+
+        cell_graph[top_cell_idx].neighbor_indices.emplace_back(bottom_cell_idx);
+        cell_graph[bottom_cell_idx].neighbor_indices.emplace_back(top_cell_idx);
+    }
+
+}
+
+/**
+ * 顶点级事件表: 直接由多边形顶点生成, 不再把边光栅化成逐像素的事件. 每条边按TraceLine的走法只展开首尾各两列上的像素,
+ * 中间各列上的像素都是穿过的竖直段, 不会是临界事件, 整段用闭式表示. 于是只有O(顶点数)个开/合/内开/内合等临界事件参与排序和扫描,
+ * CEILING/FLOOR组成x单调的边界链, 链由单个边界点和边的中间段组成, 扫描到第x列时沿所在的边算出y.
+ * 分类结果与对TracePolygon得到的像素轮廓调用AllocateEventType相同, 像素轮廓本身也可以当作顶点传入.
+ **/
+
+// 一条边按TraceLine光栅化后的像素(不含终点): 第j个像素沿主方向走j步, 沿副方向走floor((2*minor*j + major - 1) / (2*major))步
+class RasterEdge
+{
+public:
+    RasterEdge()
+    {
+        dx = 0;
+        dy = 0;
+        step_x = 1;
+        step_y = 1;
+        length = 0;
+    }
+    RasterEdge(const Point2D& start_point, const Point2D& end_point)
+    {
+        start = start_point;
+        dx = std::abs(end_point.x - start_point.x);
+        dy = std::abs(end_point.y - start_point.y);
+        step_x = (end_point.x < start_point.x) ? -1 : 1;
+        step_y = (end_point.y < start_point.y) ? -1 : 1;
+        length = std::max(dx, dy);
+    }
+
+    Point2D PixelAt(int j) const
+    {
+        if(dy > dx)
+        {
+            return Point2D(start.x + step_x * int((2LL*dx*j + dy - 1) / (2LL*dy)), start.y + step_y * j);
+        }
+        return Point2D(start.x + step_x * j, start.y + step_y * int((2LL*dy*j + dx - 1) / (2LL*dx)));
+    }
+
+    // 最后一个像素所在的列, 列号为相对start走过的列数
+    int LastColumn() const
+    {
+        return std::abs(PixelAt(length - 1).x - start.x);
+    }
+
+    // 第column列上的第一个像素; x为主方向时每列只有一个像素
+    int FirstPixelInColumn(int column) const
+    {
+        if(dy <= dx || column == 0)
+        {
+            return column;
+        }
+        return int((2LL*dy*column - dy + 2LL*dx) / (2LL*dx));
+    }
+
+    int LastPixelInColumn(int column) const
+    {
+        return (column == LastColumn()) ? length - 1 : FirstPixelInColumn(column + 1) - 1;
+    }
+
+    // 第column列上的边界点: 同一列的几个像素中CEILING保留y较大的, FLOOR保留y较小的, 与AllocateEventType的过滤规则一致
+    int BoundaryYInColumn(int column, EventType type) const
+    {
+        int first_y = PixelAt(FirstPixelInColumn(column)).y;
+        int last_y = PixelAt(LastPixelInColumn(column)).y;
+        return (type == CEILING) ? std::max(first_y, last_y) : std::min(first_y, last_y);
+    }
+
+    Point2D start;
+    int dx;
+    int dy;
+    int step_x;
+    int step_y;
+    int length;     // 像素数
+};
+
+// 边界链上的一段: 单个边界点, 或一条边中间连续的若干列
+class BoundaryPiece
+{
+public:
+    BoundaryPiece(int x_pos, int y_pos)
+    {
+        min_x = x_pos;
+        max_x = x_pos;
+        y = y_pos;
+    }
+    BoundaryPiece(const RasterEdge& raster_edge, int first_column, int last_column)
+    {
+        edge = raster_edge;
+        min_x = std::min(edge.start.x + edge.step_x * first_column, edge.start.x + edge.step_x * last_column);
+        max_x = std::max(edge.start.x + edge.step_x * first_column, edge.start.x + edge.step_x * last_column);
+        y = INT_MAX;
+    }
+
+    int YAt(int x, EventType type) const
+    {
+        return (edge.length == 0) ? y : edge.BoundaryYInColumn(std::abs(x - edge.start.x), type);
+    }
+
+    int min_x;
+    int max_x;
+    int y;              // 单个边界点的y
+    RasterEdge edge;    // 边的中间段所在的边, 单个边界点时为空
+};
+
+class BoundaryChain
+{
+public:
+    BoundaryChain(int obstacle_idx, EventType type)
+    {
+        obstacle_index = obstacle_idx;
+        event_type = type;
+        min_x = INT_MAX;
+        max_x = INT_MIN;
+    }
+
+    void AddPiece(const BoundaryPiece& piece)
+    {
+        pieces.emplace_back(piece);
+        min_x = std::min(min_x, piece.min_x);
+        max_x = std::max(max_x, piece.max_x);
+    }
+
+    // 链在第x列的y, min_x <= x <= max_x
+    int YAt(int x) const
+    {
+        auto piece = std::upper_bound(pieces.begin(), pieces.end(), x, [](int x_pos, const BoundaryPiece& boundary_piece){ return x_pos < boundary_piece.min_x; });
+        return (piece - 1)->YAt(x, event_type);
+    }
+
+    int obstacle_index;
+    EventType event_type;   // CEILING或FLOOR
+    int min_x;
+    int max_x;
+    std::vector<BoundaryPiece> pieces;  // 按x递增, 相邻两段只差一列
+};
+
+class VertexEventList
+{
+public:
+    VertexEventList()
+    {
+        pixel_event_num = 0;
+    }
+
+    std::vector<Event> critical_events;     // 按(x, y, obstacle_index)排序
+    std::vector<BoundaryChain> chains;      // 按min_x排序
+    int pixel_event_num;                    // 逐像素生成时的事件数(轮廓像素数), 用于对比
+};
+
+// 沿x递减方向生成的链翻转成按x递增存放
+inline void FinishBoundaryChain(VertexEventList& vertex_event_list, int chain_index, int direction)
+{
+    if(chain_index != INT_MAX && direction < 0)
+    {
+        std::reverse(vertex_event_list.chains[chain_index].pieces.begin(), vertex_event_list.chains[chain_index].pieces.end());
+    }
+}
+
+// 多边形上x相同的一段连续像素; 边中间的各列合成一个is_span的段, 每列各是一段穿过的竖直段
+class PixelRun
+{
+public:
+    PixelRun(int edge_index, int first, int last, int x_pos)
+    {
+        is_span = false;
+        first_edge = edge_index;
+        first_pixel = first;
+        last_edge = edge_index;
+        last_pixel = last;
+        length = last - first + 1;
+        x = x_pos;
+        first_column = 0;
+        last_column = 0;
+        start_type = UNALLOCATED;
+        end_type = UNALLOCATED;
+        is_start_in = false;
+        is_end_in = false;
+    }
+
+    bool is_span;
+    int first_edge;         // 段的第一个像素是第first_edge条边上的第first_pixel个像素
+    int first_pixel;
+    int last_edge;
+    int last_pixel;
+    int length;
+    int x;
+    int first_column;       // is_span时为第first_edge条边上的列范围
+    int last_column;
+    EventType start_type;   // is_span时为整段的类型
+    EventType end_type;     // length为1时不用
+    bool is_start_in;
+    bool is_end_in;
+};
+
+inline bool IsInOutEvent(EventType type)
+{
+    return type != UNALLOCATED && type != MIDDLE && type != CEILING && type != FLOOR;
+}
+
+// 一个多边形的顶点级事件, 分类规则与AllocateEventType逐条对应, 只是在段而不是像素上进行
+inline void GeneratePolygonVertexEvents(const OccupancyGrid& occupancy_grid, const std::vector<Point2D>& vertices, int polygon_index, bool is_wall, VertexEventList& vertex_event_list)
+{
+    std::vector<RasterEdge> edges;
+    bool has_area = false;
+    for(int i = 0; i < vertices.size(); i++)
+    {
+        const Point2D& end = vertices[(i + 1) % vertices.size()];
+        if(vertices[i].x != end.x || vertices[i].y != end.y)
+        {
+            edges.emplace_back(RasterEdge(vertices[i], end));
+            vertex_event_list.pixel_event_num += edges.back().length;
+            has_area = has_area || vertices[i].x != end.x;
+        }
+    }
+    // 所有顶点x相同的多边形没有面积, 不产生事件
+    if(!has_area)
+    {
+        return;
+    }
+
+    int E = edges.size();
+    auto next_pixel = [&](int& edge_index, int& pixel)
+    {
+        if(++pixel == edges[edge_index].length)
+        {
+            edge_index = (edge_index + 1 == E) ? 0 : edge_index + 1;
+            pixel = 0;
+        }
+    };
+    auto prev_pixel = [&](int& edge_index, int& pixel)
+    {
+        if(pixel-- == 0)
+        {
+            edge_index = (edge_index == 0) ? E - 1 : edge_index - 1;
+            pixel = edges[edge_index].length - 1;
+        }
+    };
+
+    // 每条边拆成首末各两列和中间各列, x相同的相邻段合并, 最后一段与第一段也算相邻;
+    // 中间各列前后都是同一条边上单独成段的列, 过滤CEILING/FLOOR时不会与别的段端相邻
+    std::vector<PixelRun> runs;
+    auto add_run = [&](int edge_index, int first, int last)
+    {
+        int x = edges[edge_index].PixelAt(first).x;
+        if(!runs.empty() && !runs.back().is_span && runs.back().x == x)
+        {
+            runs.back().last_edge = edge_index;
+            runs.back().last_pixel = last;
+            runs.back().length += last - first + 1;
+            return;
+        }
+        runs.emplace_back(PixelRun(edge_index, first, last, x));
+    };
+    for(int i = 0; i < E; i++)
+    {
+        int last_column = edges[i].LastColumn();
+        add_run(i, 0, edges[i].LastPixelInColumn(0));
+        if(last_column >= 2)
+        {
+            add_run(i, edges[i].FirstPixelInColumn(1), edges[i].LastPixelInColumn(1));
+        }
+        if(last_column >= 4)
+        {
+            PixelRun span(i, edges[i].FirstPixelInColumn(2), edges[i].LastPixelInColumn(last_column - 2), INT_MAX);
+            span.is_span = true;
+            span.first_column = 2;
+            span.last_column = last_column - 2;
+            runs.emplace_back(span);
+        }
+        if(last_column >= 3)
+        {
+            add_run(i, edges[i].FirstPixelInColumn(last_column - 1), edges[i].LastPixelInColumn(last_column - 1));
+        }
+        if(last_column >= 1)
+        {
+            add_run(i, edges[i].FirstPixelInColumn(last_column), edges[i].length - 1);
+        }
+    }
+    if(!runs.front().is_span && !runs.back().is_span && runs.front().x == runs.back().x)
+    {
+        runs.front().first_edge = runs.back().first_edge;
+        runs.front().first_pixel = runs.back().first_pixel;
+        runs.front().length += runs.back().length;
+        runs.pop_back();
+    }
+
+    // determine in and out: 只有首末列上的段可能是临界事件, 中间各列两侧的像素分居左右, 查表总是UNALLOCATED
+    int type_offset = is_wall ? (IN_EX - IN) : 0;
+    auto allocate = [&](int signature, EventType& event_type, bool& is_in)
+    {
+        EventType type = vertex_event_table.types[signature];
+        if(type != UNALLOCATED)
+        {
+            event_type = EventType(type + type_offset);
+            is_in = (type == IN || type == IN_TOP || type == IN_BOTTOM);
+        }
+    };
+    bool has_in_out = false;
+    for(auto& run : runs)
+    {
+        if(run.is_span)
+        {
+            continue;
+        }
+
+        int edge_index = run.first_edge;
+        int pixel = run.first_pixel;
+        Point2D start = edges[edge_index].PixelAt(pixel);
+        prev_pixel(edge_index, pixel);
+        Point2D before = edges[edge_index].PixelAt(pixel);
+        next_pixel(edge_index, pixel);
+        next_pixel(edge_index, pixel);
+        Point2D second = edges[edge_index].PixelAt(pixel);
+
+        edge_index = run.last_edge;
+        pixel = run.last_pixel;
+        Point2D end = edges[edge_index].PixelAt(pixel);
+        next_pixel(edge_index, pixel);
+        Point2D after = edges[edge_index].PixelAt(pixel);
+        prev_pixel(edge_index, pixel);
+        prev_pixel(edge_index, pixel);
+        Point2D penult = edges[edge_index].PixelAt(pixel);
+
+        if(run.length == 1)
+        {
+            allocate(((CompareCoordinate(start.x, before.x)*4+COMPARE_NONE)*3+CompareCoordinate(start.x, after.x))*3+COMPARE_EQUAL, run.start_type, run.is_start_in);
+        }
+        else
+        {
+            allocate(((CompareCoordinate(start.x, before.x)*4+CompareCoordinate(start.y, second.y))*3
+                      +CompareCoordinate(start.x, after.x))*3+CompareCoordinate(start.y, after.y), run.start_type, run.is_start_in);
+            allocate(((CompareCoordinate(end.x, after.x)*4+CompareCoordinate(end.y, penult.y))*3
+                      +CompareCoordinate(end.x, before.x))*3+CompareCoordinate(end.y, before.y), run.end_type, run.is_end_in);
+        }
+
+        // determine inner
+        auto allocate_inner = [&](const Point2D& point, EventType& event_type, bool is_in)
+        {
+            if(event_type == UNALLOCATED)
+            {
+                return;
+            }
+            has_in_out = true;
+            int neighbor_x = is_in ? point.x-1 : point.x+1;
+            bool is_inner = is_wall ? (!occupancy_grid.IsOccupied(neighbor_x, point.y) && neighbor_x >= 0 && neighbor_x < occupancy_grid.cols)
+                                    : occupancy_grid.IsOccupied(neighbor_x, point.y);
+            if(is_inner)
+            {
+                event_type = EventType(event_type + (INNER_IN - IN));
+            }
+        };
+        allocate_inner(start, run.start_type, run.is_start_in);
+        if(run.length > 1)
+        {
+            allocate_inner(end, run.end_type, run.is_end_in);
+        }
+    }
+    if(!has_in_out)
+    {
+        return;
+    }
+
+    // determine floor and ceiling: 段的两端按多边形顺序排成一圈(中间各列算一个), 相邻两个in/out事件之间的段端, 障碍物从out到in为floor, 外墙相反
+    EventType out_to_in_type = is_wall ? CEILING : FLOOR;
+    EventType in_to_out_type = is_wall ? FLOOR : CEILING;
+    std::vector<std::pair<int, bool>> run_ends;     // (段, 是否为段的末端)
+    for(int i = 0; i < runs.size(); i++)
+    {
+        run_ends.emplace_back(i, false);
+        if(!runs[i].is_span && runs[i].length > 1)
+        {
+            run_ends.emplace_back(i, true);
+        }
+    }
+    auto end_type = [&](const std::pair<int, bool>& run_end) -> EventType& { return run_end.second ? runs[run_end.first].end_type : runs[run_end.first].start_type; };
+    auto is_end_in = [&](const std::pair<int, bool>& run_end){ return run_end.second ? runs[run_end.first].is_end_in : runs[run_end.first].is_start_in; };
+
+    int first_in_out = 0;
+    while(!IsInOutEvent(end_type(run_ends[first_in_out])))
+    {
+        first_in_out++;
+    }
+    int from = first_in_out;
+    std::vector<std::pair<int, bool>> boundary_ends;    // 按逐像素时ceiling_floor_index_list的顺序
+    for(int i = 1, pending_begin = 1; i <= run_ends.size(); i++)
+    {
+        int to = (first_in_out + i) % run_ends.size();
+        if(!IsInOutEvent(end_type(run_ends[to])))
+        {
+            continue;
+        }
+        if(is_end_in(run_ends[from]) != is_end_in(run_ends[to]))
+        {
+            EventType boundary_type = is_end_in(run_ends[from]) ? in_to_out_type : out_to_in_type;
+            for(int j = pending_begin; j < i; j++)
+            {
+                const std::pair<int, bool>& run_end = run_ends[(first_in_out + j) % run_ends.size()];
+                end_type(run_end) = boundary_type;
+                boundary_ends.emplace_back(run_end);
+            }
+        }
+        from = to;
+        pending_begin = i + 1;
+    }
+
+    // filter ceiling and floor: x相同的相邻两个ceiling只保留y较大的, floor只保留y较小的, 最后一个与第一个也算相邻;
+    // 中间各列只与同一列的另一端x相同, 每列按同样的规则取y, 不参与这里的比较
+    auto end_point = [&](const std::pair<int, bool>& run_end)
+    {
+        const PixelRun& run = runs[run_end.first];
+        return run_end.second ? edges[run.last_edge].PixelAt(run.last_pixel) : edges[run.first_edge].PixelAt(run.first_pixel);
+    };
+    for(int i = 0; i < boundary_ends.size(); i++)
+    {
+        const std::pair<int, bool>& curr_end = boundary_ends[i];
+        const std::pair<int, bool>& next_end = boundary_ends[(i+1 == boundary_ends.size()) ? 0 : i+1];
+        if(runs[curr_end.first].is_span || runs[next_end.first].is_span)
+        {
+            continue;
+        }
+
+        EventType& curr_type = end_type(curr_end);
+        EventType& next_type = end_type(next_end);
+        Point2D curr_point = end_point(curr_end);
+        Point2D next_point = end_point(next_end);
+        if(curr_type == next_type && (curr_type == CEILING || curr_type == FLOOR) && curr_point.x == next_point.x)
+        {
+            bool keep_curr = (curr_type == CEILING) ? (curr_point.y > next_point.y) : (curr_point.y < next_point.y);
+            (keep_curr ? next_type : curr_type) = MIDDLE;
+        }
+    }
+
+    // 按多边形顺序把临界事件和边界链分开; 链只在x单调、每步一列、类型不变时延续, 被拆断的链只会多出临界列, 不影响结果
+    int chain_index = INT_MAX;
+    int direction = 0;
+    int last_x = INT_MAX;
+    auto add_boundary = [&](EventType type, const BoundaryPiece& piece, int first_x, int end_x, int piece_direction)
+    {
+        if(chain_index != INT_MAX)
+        {
+            BoundaryChain& chain = vertex_event_list.chains[chain_index];
+            int step = first_x - last_x;
+            if(chain.event_type == type && (step == 1 || step == -1) && (direction == 0 || direction == step) && (piece_direction == 0 || piece_direction == step))
+            {
+                chain.AddPiece(piece);
+                direction = step;
+                last_x = end_x;
+                return;
+            }
+            FinishBoundaryChain(vertex_event_list, chain_index, direction);
+        }
+
+        chain_index = int(vertex_event_list.chains.size());
+        vertex_event_list.chains.emplace_back(BoundaryChain(polygon_index, type));
+        vertex_event_list.chains.back().AddPiece(piece);
+        direction = piece_direction;
+        last_x = end_x;
+    };
+    auto add_event = [&](const Point2D& point, EventType type)
+    {
+        if(type == CEILING || type == FLOOR)
+        {
+            add_boundary(type, BoundaryPiece(point.x, point.y), point.x, point.x, 0);
+        }
+        else if(IsInOutEvent(type))
+        {
+            vertex_event_list.critical_events.emplace_back(Event(polygon_index, point.x, point.y, type));
+            FinishBoundaryChain(vertex_event_list, chain_index, direction);
+            chain_index = INT_MAX;
+        }
+    };
+
+    for(const auto& run : runs)
+    {
+        if(run.is_span)
+        {
+            if(run.start_type == CEILING || run.start_type == FLOOR)
+            {
+                const RasterEdge& edge = edges[run.first_edge];
+                add_boundary(run.start_type, BoundaryPiece(edge, run.first_column, run.last_column),
+                             edge.start.x + edge.step_x * run.first_column, edge.start.x + edge.step_x * run.last_column,
+                             (run.last_column > run.first_column) ? edge.step_x : 0);
+            }
+            continue;
+        }
+        add_event(edges[run.first_edge].PixelAt(run.first_pixel), run.start_type);
+        if(run.length > 1)
+        {
+            add_event(edges[run.last_edge].PixelAt(run.last_pixel), run.end_type);
+        }
+    }
+    FinishBoundaryChain(vertex_event_list, chain_index, direction);
+}
+
+inline bool IsChainStartedBefore(const BoundaryChain& chain1, const BoundaryChain& chain2)
+{
+    return chain1.min_x < chain2.min_x;
+}
+
+// wall_vertices和obstacle_vertices为多边形的顶点(首尾相连), 按TracePolygon的走法光栅化
+inline VertexEventList GenerateVertexEventList(const OccupancyGrid& occupancy_grid, const std::vector<Point2D>& wall_vertices, const std::vector<std::vector<Point2D>>& obstacle_vertices)
+{
+    AllocationStage allocation_stage(STAGE_EVENT_GENERATION);
+    TraceSpan trace_span("GenerateVertexEventList");
+    VertexEventList vertex_event_list;
+
+    for(int i = 0; i < obstacle_vertices.size(); i++)
+    {
+        GeneratePolygonVertexEvents(occupancy_grid, obstacle_vertices[i], i, false, vertex_event_list);
+    }
+    GeneratePolygonVertexEvents(occupancy_grid, wall_vertices, INT_MAX, true, vertex_event_list);
+
+    std::sort(vertex_event_list.critical_events.begin(), vertex_event_list.critical_events.end());
+    std::stable_sort(vertex_event_list.chains.begin(), vertex_event_list.chains.end(), IsChainStartedBefore);
+
+    return vertex_event_list;
+}
+
+// 开/合操作按最近距离挑选边界点, 遇到轮廓上一个像素的凹凸时可能在同一列先接了别处的点; 按计数分配的ceiling/floor事件更可靠, 直接覆盖
+inline void ExecuteCeilOperation(std::vector<CellNode>& cell_graph, int curr_cell_idx, const Point2D& ceil_point)
+{
+    Edge& ceiling = cell_graph[curr_cell_idx].ceiling;
+    if(!ceiling.empty() && ceiling.back().x == ceil_point.x)
+    {
+        ceiling.back() = ceil_point;
+        return;
+    }
+    ceiling.emplace_back(ceil_point);
+}
+
+inline void ExecuteFloorOperation(std::vector<CellNode>& cell_graph, int curr_cell_idx, const Point2D& floor_point)
+{
+    Edge& floor = cell_graph[curr_cell_idx].floor;
+    if(!floor.empty() && floor.back().x == floor_point.x)
+    {
+        floor.back() = floor_point;
+        return;
+    }
+    floor.emplace_back(floor_point);
+}
+
+inline void ExecuteOpenOperation(std::vector<CellNode>& cell_graph, int curr_cell_idx, Point2D in_top, Point2D in_bottom, Point2D c, Point2D f, bool rewrite = false)
+{
+
+    CellNode top_cell, bottom_cell;
+
+    top_cell.ceiling.emplace_back(c);
+    top_cell.floor.emplace_back(in_top);
+
+    bottom_cell.ceiling.emplace_back(in_bottom);
+    bottom_cell.floor.emplace_back(f);
+
+
+    if(!rewrite)
+    {
+        int top_cell_index = cell_graph.size();
+        int bottom_cell_index = cell_graph.size() + 1;
+
+        top_cell.cellIndex = top_cell_index;
+        bottom_cell.cellIndex = bottom_cell_index;
+        cell_graph.emplace_back(top_cell);
+        cell_graph.emplace_back(bottom_cell);
+
+
+        cell_graph[top_cell_index].neighbor_indices.emplace_back(curr_cell_idx);
+        cell_graph[bottom_cell_index].neighbor_indices.emplace_front(curr_cell_idx);
+
+        cell_graph[curr_cell_idx].neighbor_indices.emplace_front(top_cell_index);
+        cell_graph[curr_cell_idx].neighbor_indices.emplace_front(bottom_cell_index);
+    }
+    else
+    {
+        cell_graph[curr_cell_idx].ceiling.assign(top_cell.ceiling.begin(), top_cell.ceiling.end());
+        cell_graph[curr_cell_idx].floor.assign(top_cell.floor.begin(), top_cell.floor.end());
+
+        int bottom_cell_index = cell_graph.size();
+        bottom_cell.cellIndex = bottom_cell_index;
+        cell_graph.emplace_back(bottom_cell);
+
+        cell_graph[cell_graph[curr_cell_idx].neighbor_indices.back()].neighbor_indices.emplace_back(bottom_cell_index);
+        cell_graph[bottom_cell_index].neighbor_indices.emplace_back(cell_graph[curr_cell_idx].neighbor_indices.back());
+    }
+
+}
+
+inline void ExecuteInnerOpenOperation(std::vector<CellNode>& cell_graph, Point2D inner_in)
+{
+    CellNode new_cell;
+
+    new_cell.ceiling.emplace_back(inner_in);
+    new_cell.floor.emplace_back(inner_in);
+
+    int new_cell_index = cell_graph.size();
+
+    new_cell.cellIndex = new_cell_index;
+    cell_graph.emplace_back(new_cell);
+}
+
+inline void ExecuteInnerOpenOperation(std::vector<CellNode>& cell_graph, Point2D inner_in_top, Point2D inner_in_bottom)
+{
+    CellNode new_cell;
+
+    new_cell.ceiling.emplace_back(inner_in_top);
+    new_cell.floor.emplace_back(inner_in_bottom);
+
+    int new_cell_index = cell_graph.size();
+
+    new_cell.cellIndex = new_cell_index;
+    cell_graph.emplace_back(new_cell);
+}
+
+inline void ExecuteInnerCloseOperation(std::vector<CellNode>& cell_graph, int curr_cell_idx, Point2D inner_out)
+{
+    cell_graph[curr_cell_idx].ceiling.emplace_back(inner_out);
+    cell_graph[curr_cell_idx].floor.emplace_back(inner_out);
+}
+
+inline void ExecuteInnerCloseOperation(std::vector<CellNode>& cell_graph, int curr_cell_idx, Point2D inner_out_top, Point2D inner_out_bottom)
+{
+    cell_graph[curr_cell_idx].ceiling.emplace_back(inner_out_top);
+    cell_graph[curr_cell_idx].floor.emplace_back(inner_out_bottom);
+}
+
+inline int CountCells(const std::deque<Event>& slice, int curr_idx)
+{
+    int cell_num = 0;
+    for(int i = 0; i < curr_idx; i++)
+    {
+        if(
+              (slice[i].event_type==IN)
+           || (slice[i].event_type==IN_TOP)
+           || (slice[i].event_type==INNER_IN)
+           || (slice[i].event_type==INNER_IN_BOTTOM)
+           || (slice[i].event_type==FLOOR)
+           || (slice[i].event_type==IN_BOTTOM_EX)
+           || (slice[i].event_type==INNER_IN_EX)
+           || (slice[i].event_type==INNER_IN_TOP_EX)
+          )
+        {
+            cell_num++;
+        }
+    }
+    return cell_num;
+}
+
+// 找出切片中与y最近、可作为cell上/下边界的事件: 求ceiling时跳过FLOOR事件, 求floor时跳过CEILING事件,
+// 否则障碍物在该列的上下边界相距很近时, 会把相邻cell的边界接到当前cell上
+inline int FindNearestSliceEvent(const std::deque<Event>& slice, int y, EventType boundary_type)
+{
+    EventType opposite_type = (boundary_type == CEILING) ? FLOOR : CEILING;
+    int nearest_index = INT_MAX, fallback_index = INT_MAX;
+    int min_dist = INT_MAX, fallback_min_dist = INT_MAX;
+
+    for(int i = 0; i < slice.size(); i++)
+    {
+        int dist = abs(slice[i].y - y);
+        if(slice[i].event_type != opposite_type && dist < min_dist)
+        {
+            min_dist = dist;
+            nearest_index = i;
+        }
+        if(dist < fallback_min_dist)
+        {
+            fallback_min_dist = dist;
+            fallback_index = i;
+        }
+    }
+    return nearest_index != INT_MAX ? nearest_index : fallback_index;
+}
+
+inline std::deque<Event> FilterSlice(const std::deque<Event>& slice)
+{
+    std::deque<Event> filtered_slice;
+
+    for(auto event : slice)
+    {
+        if(event.event_type!=MIDDLE && event.event_type!=UNALLOCATED)
+        {
+            filtered_slice.emplace_back(event);
+        }
+    }
+    return filtered_slice;
+}
+
+// 对单个slice(已滤除MIDDLE/UNALLOCATED)执行开/合/内开/内合以及ceiling/floor延伸
+inline void ExecuteSliceDecomposition(std::vector<CellNode>& cell_graph, std::vector<int>& cell_index_slice, std::vector<int>& original_cell_index_slice, std::deque<Event>& curr_slice)
+{
+    int curr_cell_idx = INT_MAX;
+    int top_cell_idx = INT_MAX;
+    int bottom_cell_idx = INT_MAX;
+
+    Point2D c, f;
+    int c_index = INT_MAX, f_index = INT_MAX;
+
+    int event_y = INT_MAX;
+
+    bool rewrite = false;
+
+    std::vector<int> sub_cell_index_slices;
+
+    int cell_counter = 0;
+
+    original_cell_index_slice.assign(cell_index_slice.begin(), cell_index_slice.end());
+
+    for(int j = 0; j < curr_slice.size(); j++)
+    {
+        if(curr_slice[j].event_type == INNER_IN_EX)
+        {
+            event_y = curr_slice[j].y;
+            for(int k = 0; k < cell_index_slice.size(); k++)
+            {
+                if(event_y > cell_graph[cell_index_slice[k]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
+                {
+                    rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k])==original_cell_index_slice.end(); // 若为true，则覆盖
+
+                    c_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k]].ceiling.back().y, CEILING);
+                    c = Point2D(curr_slice[c_index].x, curr_slice[c_index].y);
+                    curr_slice[c_index].isUsed = true;
+
+                    f_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k]].floor.back().y, FLOOR);
+                    f = Point2D(curr_slice[f_index].x, curr_slice[f_index].y);
+                    curr_slice[f_index].isUsed = true;
+
+                    curr_cell_idx = cell_index_slice[k];
+                    ExecuteOpenOperation(cell_graph, curr_cell_idx,
+                                                      Point2D(curr_slice[j].x, curr_slice[j].y),
+                                                      c,
+                                                      f,
+                                                      rewrite);
+
+                    if(!rewrite)
+                    {
+                        cell_index_slice.erase(cell_index_slice.begin()+k);
+                        sub_cell_index_slices.clear();
+                        sub_cell_index_slices = {int(cell_graph.size()-2), int(cell_graph.size()-1)};
+                        cell_index_slice.insert(cell_index_slice.begin()+k, sub_cell_index_slices.begin(), sub_cell_index_slices.end());
+                    }
+                    else
+                    {
+                        cell_index_slice.insert(cell_index_slice.begin()+k+1, int(cell_graph.size()-1));
+                    }
+
+                    curr_slice[j].isUsed = true;
+
+                    break;
+                }
+            }
+        }
+        if(curr_slice[j].event_type == INNER_OUT_EX)
+        {
+            event_y = curr_slice[j].y;
+            for(int k = 1; k < cell_index_slice.size(); k++)
+            {
+                if(event_y > cell_graph[cell_index_slice[k-1]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
+                {
+                    rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k-1]) == original_cell_index_slice.end();
+
+                    c_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k-1]].ceiling.back().y, CEILING);
+                    c = Point2D(curr_slice[c_index].x, curr_slice[c_index].y);
+                    curr_slice[c_index].isUsed = true;
+
+                    f_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k]].floor.back().y, FLOOR);
+                    f = Point2D(curr_slice[f_index].x, curr_slice[f_index].y);
+                    curr_slice[f_index].isUsed = true;
+
+                    top_cell_idx = cell_index_slice[k-1];
+                    bottom_cell_idx = cell_index_slice[k];
+
+                    ExecuteCloseOperation(cell_graph, top_cell_idx, bottom_cell_idx,
+                                                       c,
+                                                       f,
+                                                       rewrite);
+
+                    if(!rewrite)
+                    {
+                        cell_index_slice.erase(cell_index_slice.begin() + k - 1);
+                        cell_index_slice.erase(cell_index_slice.begin() + k - 1);
+                        cell_index_slice.insert(cell_index_slice.begin() + k - 1, int(cell_graph.size() - 1));
+                    }
+                    else
+                    {
+                        cell_index_slice.erase(cell_index_slice.begin() + k);
+                    }
+
+
+                    curr_slice[j].isUsed = true;
+
+                    break;
+                }
+            }
+        }
+
+        if(curr_slice[j].event_type == INNER_IN_BOTTOM_EX)
+        {
+            event_y = curr_slice[j].y;
+            for(int k = 0; k < cell_index_slice.size(); k++)
+            {
+                if(event_y > cell_graph[cell_index_slice[k]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
+                {
+                    rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k])==original_cell_index_slice.end();
+
+                    c_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k]].ceiling.back().y, CEILING);
+                    c = Point2D(curr_slice[c_index].x, curr_slice[c_index].y);
+                    curr_slice[c_index].isUsed = true;
+
+                    f_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k]].floor.back().y, FLOOR);
+                    f = Point2D(curr_slice[f_index].x, curr_slice[f_index].y);
+                    curr_slice[f_index].isUsed = true;
+
+                    curr_cell_idx = cell_index_slice[k];
+                    ExecuteOpenOperation(cell_graph, curr_cell_idx,
+                                                      Point2D(curr_slice[j-1].x, curr_slice[j-1].y),  // in top
+                                                      Point2D(curr_slice[j].x, curr_slice[j].y),      // in bottom
+                                                      c,
+                                                      f,
+                                                      rewrite);
+
+
+                    if(!rewrite)
+                    {
+                        cell_index_slice.erase(cell_index_slice.begin() + k);
+                        sub_cell_index_slices.clear();
+                        sub_cell_index_slices = {int(cell_graph.size() - 2), int(cell_graph.size() - 1)};
+                        cell_index_slice.insert(cell_index_slice.begin() + k, sub_cell_index_slices.begin(),
+                                                sub_cell_index_slices.end());
+                    }
+                    else
+                    {
+                        cell_index_slice.insert(cell_index_slice.begin()+k+1, int(cell_graph.size()-1));
+                    }
+
+                    curr_slice[j-1].isUsed = true;
+                    curr_slice[j].isUsed = true;
+
+                    break;
+                }
+            }
+        }
+
+
+        if(curr_slice[j].event_type == INNER_OUT_BOTTOM_EX)
+        {
+            event_y = curr_slice[j].y;
+            for(int k = 1; k < cell_index_slice.size(); k++)
+            {
+                if(event_y > cell_graph[cell_index_slice[k-1]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
+                {
+                    rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k-1]) == original_cell_index_slice.end();
+
+                    c_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k-1]].ceiling.back().y, CEILING);
+                    c = Point2D(curr_slice[c_index].x, curr_slice[c_index].y);
+                    curr_slice[c_index].isUsed = true;
+
+                    f_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k]].floor.back().y, FLOOR);
+                    f = Point2D(curr_slice[f_index].x, curr_slice[f_index].y);
+                    curr_slice[f_index].isUsed = true;
+
+                    top_cell_idx = cell_index_slice[k-1];
+                    bottom_cell_idx = cell_index_slice[k];
+                    ExecuteCloseOperation(cell_graph, top_cell_idx, bottom_cell_idx,
+                                                       c,
+                                                       f,
+                                                       rewrite);
+
+                    if(!rewrite)
+                    {
+                        cell_index_slice.erase(cell_index_slice.begin()+k-1);
+                        cell_index_slice.erase(cell_index_slice.begin()+k-1);
+                        cell_index_slice.insert(cell_index_slice.begin()+k-1, int(cell_graph.size()-1));
+                    }
+                    else
+                    {
+                        cell_index_slice.erase(cell_index_slice.begin() + k);
+                    }
+
+                    curr_slice[j-1].isUsed = true;
+                    curr_slice[j].isUsed = true;
+
+                    break;
+                }
+            }
+        }
+
+
+        if(curr_slice[j].event_type == IN_EX)
+        {
+            event_y = curr_slice[j].y;
+
+            if(!cell_index_slice.empty())
+            {
+                for(int k = 1; k < cell_index_slice.size(); k++)
+                {
+                    if(event_y >= cell_graph[cell_index_slice[k-1]].floor.back().y && event_y <= cell_graph[cell_index_slice[k]].ceiling.back().y)
+                    {
+                        ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_in
+                        cell_index_slice.insert(cell_index_slice.begin()+k, int(cell_graph.size()-1));
+                        curr_slice[j].isUsed = true;
+                        break;
+                    }
+                }
+                if(event_y <= cell_graph[cell_index_slice.front()].ceiling.back().y)
+                {
+                    ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_in
+                    cell_index_slice.insert(cell_index_slice.begin(), int(cell_graph.size()-1));
+                    curr_slice[j].isUsed = true;
+                }
+                if(event_y >= cell_graph[cell_index_slice.back()].floor.back().y)
+                {
+                    ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_in
+                    cell_index_slice.insert(cell_index_slice.end(), int(cell_graph.size()-1));
+                    curr_slice[j].isUsed = true;
+                }
+
+            }
+            else
+            {
+                ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_in
+                cell_index_slice.emplace_back(int(cell_graph.size()-1));
+                curr_slice[j].isUsed = true;
+            }
+
+        }
+
+        if(curr_slice[j].event_type == IN_BOTTOM_EX)
+        {
+            event_y = curr_slice[j].y;
+
+            if(!cell_index_slice.empty())
+            {
+                for(int k = 1; k < cell_index_slice.size(); k++)
+                {
+                    if(event_y >= cell_graph[cell_index_slice[k-1]].floor.back().y && event_y <= cell_graph[cell_index_slice[k]].ceiling.back().y)
+                    {
+
+                        ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), // inner_in_top,
+                                                     Point2D(curr_slice[j].x, curr_slice[j].y));    // inner_in_bottom
+
+                        cell_index_slice.insert(cell_index_slice.begin()+k, int(cell_graph.size()-1));
+
+                        curr_slice[j-1].isUsed = true;
+                        curr_slice[j].isUsed = true;
+
+                        break;
+                    }
+                }
+                if(event_y <= cell_graph[cell_index_slice.front()].ceiling.back().y)
+                {
+
+                    ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), // inner_in_top,
+                                                 Point2D(curr_slice[j].x, curr_slice[j].y));    // inner_in_bottom
+
+                    cell_index_slice.insert(cell_index_slice.begin(), int(cell_graph.size()-1));
+
+                    curr_slice[j-1].isUsed = true;
+                    curr_slice[j].isUsed = true;
+                }
+                if(event_y >= cell_graph[cell_index_slice.back()].floor.back().y)
+                {
+
+                    ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), // inner_in_top,
+                                                 Point2D(curr_slice[j].x, curr_slice[j].y));    // inner_in_bottom
+
+                    cell_index_slice.insert(cell_index_slice.end(), int(cell_graph.size()-1));
+
+                    curr_slice[j-1].isUsed = true;
+                    curr_slice[j].isUsed = true;
+                }
+            }
+            else
+            {
+                ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), // inner_in_top,
+                                             Point2D(curr_slice[j].x, curr_slice[j].y));    // inner_in_bottom
+
+                cell_index_slice.emplace_back(int(cell_graph.size()-1));
+
+                curr_slice[j-1].isUsed = true;
+                curr_slice[j].isUsed = true;
+            }
+
+        }
+
+
+        if(curr_slice[j].event_type == OUT_EX)
+        {
+            event_y = curr_slice[j].y;
+
+            for(int k = 0; k < cell_index_slice.size(); k++)
+            {
+                if(event_y >= cell_graph[cell_index_slice[k]].ceiling.back().y && event_y <= cell_graph[cell_index_slice[k]].floor.back().y)
+                {
+                    curr_cell_idx = cell_index_slice[k];
+                    ExecuteInnerCloseOperation(cell_graph, curr_cell_idx, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_out
+                    cell_index_slice.erase(cell_index_slice.begin()+k);
+                    curr_slice[j].isUsed = true;
+                    break;
+                }
+            }
+        }
+
+        if(curr_slice[j].event_type == OUT_BOTTOM_EX)
+        {
+            event_y = curr_slice[j].y;
+
+            for(int k = 0; k < cell_index_slice.size(); k++)
+            {
+                if(event_y >= cell_graph[cell_index_slice[k]].ceiling.back().y && event_y <= cell_graph[cell_index_slice[k]].floor.back().y)
+                {
+                    curr_cell_idx = cell_index_slice[k];
+                    ExecuteInnerCloseOperation(cell_graph, curr_cell_idx, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_out_top, inner_out_bottom
+                    cell_index_slice.erase(cell_index_slice.begin()+k);
+                    curr_slice[j-1].isUsed = true;
+                    curr_slice[j].isUsed = true;
+                    break;
+                }
+            }
+        }
+
+    }
+
+
+    for(int j = 0; j < curr_slice.size(); j++)
+    {
+        if(curr_slice[j].event_type == IN)
+        {
+            event_y = curr_slice[j].y;
+            for(int k = 0; k < cell_index_slice.size(); k++)
+            {
+                if(event_y > cell_graph[cell_index_slice[k]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
+                {
+                    rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k])==original_cell_index_slice.end(); // 若为true，则覆盖
+
+                    c_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k]].ceiling.back().y, CEILING);
+                    c = Point2D(curr_slice[c_index].x, curr_slice[c_index].y);
+                    curr_slice[c_index].isUsed = true;
+
+                    f_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k]].floor.back().y, FLOOR);
+                    f = Point2D(curr_slice[f_index].x, curr_slice[f_index].y);
+                    curr_slice[f_index].isUsed = true;
+
+                    curr_cell_idx = cell_index_slice[k];
+                    ExecuteOpenOperation(cell_graph, curr_cell_idx,
+                                         Point2D(curr_slice[j].x, curr_slice[j].y),
+                                         c,
+                                         f,
+                                         rewrite);
+
+                    if(!rewrite)
+                    {
+                        cell_index_slice.erase(cell_index_slice.begin()+k);
+                        sub_cell_index_slices.clear();
+                        sub_cell_index_slices = {int(cell_graph.size()-2), int(cell_graph.size()-1)};
+                        cell_index_slice.insert(cell_index_slice.begin()+k, sub_cell_index_slices.begin(), sub_cell_index_slices.end());
+                    }
+                    else
+                    {
+                        cell_index_slice.insert(cell_index_slice.begin()+k+1, int(cell_graph.size()-1));
+                    }
+
+                    curr_slice[j].isUsed = true;
+
+                    break;
+                }
+            }
+        }
+        if(curr_slice[j].event_type == OUT)
+        {
+            event_y = curr_slice[j].y;
+            for(int k = 1; k < cell_index_slice.size(); k++)
+            {
+                if(event_y > cell_graph[cell_index_slice[k-1]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
+                {
+                    rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k-1]) == original_cell_index_slice.end();
+
+                    c_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k-1]].ceiling.back().y, CEILING);
+                    c = Point2D(curr_slice[c_index].x, curr_slice[c_index].y);
+                    curr_slice[c_index].isUsed = true;
+
+                    f_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k]].floor.back().y, FLOOR);
+                    f = Point2D(curr_slice[f_index].x, curr_slice[f_index].y);
+                    curr_slice[f_index].isUsed = true;
+
+                    top_cell_idx = cell_index_slice[k-1];
+                    bottom_cell_idx = cell_index_slice[k];
+
+                    ExecuteCloseOperation(cell_graph, top_cell_idx, bottom_cell_idx,
+                                          c,
+                                          f,
+                                          rewrite);
+
+                    if(!rewrite)
+                    {
+                        cell_index_slice.erase(cell_index_slice.begin() + k - 1);
+                        cell_index_slice.erase(cell_index_slice.begin() + k - 1);
+                        cell_index_slice.insert(cell_index_slice.begin() + k - 1, int(cell_graph.size() - 1));
+                    }
+                    else
+                    {
+                        cell_index_slice.erase(cell_index_slice.begin() + k);
+                    }
+
+
+                    curr_slice[j].isUsed = true;
+
+                    break;
+                }
+            }
+        }
+
+        if(curr_slice[j].event_type == IN_BOTTOM)
+        {
+            event_y = curr_slice[j].y;
+            for(int k = 0; k < cell_index_slice.size(); k++)
+            {
+                if(event_y > cell_graph[cell_index_slice[k]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
+                {
+                    rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k])==original_cell_index_slice.end();
+
+                    c_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k]].ceiling.back().y, CEILING);
+                    c = Point2D(curr_slice[c_index].x, curr_slice[c_index].y);
+                    curr_slice[c_index].isUsed = true;
+
+                    f_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k]].floor.back().y, FLOOR);
+                    f = Point2D(curr_slice[f_index].x, curr_slice[f_index].y);
+                    curr_slice[f_index].isUsed = true;
+
+                    curr_cell_idx = cell_index_slice[k];
+                    ExecuteOpenOperation(cell_graph, curr_cell_idx,
+                                         Point2D(curr_slice[j-1].x, curr_slice[j-1].y),  // in top
+                                         Point2D(curr_slice[j].x, curr_slice[j].y),      // in bottom
+                                         c,
+                                         f,
+                                         rewrite);
+
+
+                    if(!rewrite)
+                    {
+                        cell_index_slice.erase(cell_index_slice.begin() + k);
+                        sub_cell_index_slices.clear();
+                        sub_cell_index_slices = {int(cell_graph.size() - 2), int(cell_graph.size() - 1)};
+                        cell_index_slice.insert(cell_index_slice.begin() + k, sub_cell_index_slices.begin(),
+                                                sub_cell_index_slices.end());
+                    }
+                    else
+                    {
+                        cell_index_slice.insert(cell_index_slice.begin()+k+1, int(cell_graph.size()-1));
+                    }
+
+                    curr_slice[j-1].isUsed = true;
+                    curr_slice[j].isUsed = true;
+
+                    break;
+                }
+            }
+        }
+
+
+        if(curr_slice[j].event_type == OUT_BOTTOM)
+        {
+            event_y = curr_slice[j].y;
+            for(int k = 1; k < cell_index_slice.size(); k++)
+            {
+                if(event_y > cell_graph[cell_index_slice[k-1]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
+                {
+                    rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k-1]) == original_cell_index_slice.end();
+
+                    c_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k-1]].ceiling.back().y, CEILING);
+                    c = Point2D(curr_slice[c_index].x, curr_slice[c_index].y);
+                    curr_slice[c_index].isUsed = true;
+
+                    f_index = FindNearestSliceEvent(curr_slice, cell_graph[cell_index_slice[k]].floor.back().y, FLOOR);
+                    f = Point2D(curr_slice[f_index].x, curr_slice[f_index].y);
+                    curr_slice[f_index].isUsed = true;
+
+                    top_cell_idx = cell_index_slice[k-1];
+                    bottom_cell_idx = cell_index_slice[k];
+                    ExecuteCloseOperation(cell_graph, top_cell_idx, bottom_cell_idx,
+                                          c,
+                                          f,
+                                          rewrite);
+
+                    if(!rewrite)
+                    {
+                        cell_index_slice.erase(cell_index_slice.begin()+k-1);
+                        cell_index_slice.erase(cell_index_slice.begin()+k-1);
+                        cell_index_slice.insert(cell_index_slice.begin()+k-1, int(cell_graph.size()-1));
+                    }
+                    else
+                    {
+                        cell_index_slice.erase(cell_index_slice.begin() + k);
+                    }
+
+                    curr_slice[j-1].isUsed = true;
+                    curr_slice[j].isUsed = true;
+
+                    break;
+                }
+            }
+        }
+
+
+        if(curr_slice[j].event_type == INNER_IN)
+        {
+            event_y = curr_slice[j].y;
+            for(int k = 1; k < cell_index_slice.size(); k++)
+            {
+                if(event_y >= cell_graph[cell_index_slice[k-1]].floor.back().y && event_y <= cell_graph[cell_index_slice[k]].ceiling.back().y)
+                {
+                    ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_in
+                    cell_index_slice.insert(cell_index_slice.begin()+k, int(cell_graph.size()-1));
+                    curr_slice[j].isUsed = true;
+                    break;
+                }
+            }
+        }
+
+        if(curr_slice[j].event_type == INNER_IN_BOTTOM)
+        {
+            event_y = curr_slice[j].y;
+            for(int k = 1; k < cell_index_slice.size(); k++)
+            {
+                if(event_y >= cell_graph[cell_index_slice[k-1]].floor.back().y && event_y <= cell_graph[cell_index_slice[k]].ceiling.back().y)
+                {
+
+                    ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), // inner_in_top,
+                                              Point2D(curr_slice[j].x, curr_slice[j].y));    // inner_in_bottom
+
+                    cell_index_slice.insert(cell_index_slice.begin()+k, int(cell_graph.size()-1));
+
+                    curr_slice[j-1].isUsed = true;
+                    curr_slice[j].isUsed = true;
+
+                    break;
+                }
+            }
+        }
+
+
+        if(curr_slice[j].event_type == INNER_OUT)
+        {
+            event_y = curr_slice[j].y;
+            for(int k = 0; k < cell_index_slice.size(); k++)
+            {
+                if(event_y >= cell_graph[cell_index_slice[k]].ceiling.back().y && event_y <= cell_graph[cell_index_slice[k]].floor.back().y)
+                {
+                    curr_cell_idx = cell_index_slice[k];
+                    ExecuteInnerCloseOperation(cell_graph, curr_cell_idx, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_out
+                    cell_index_slice.erase(cell_index_slice.begin()+k);
+                    curr_slice[j].isUsed = true;
+                    break;
+                }
+            }
+        }
+
+        if(curr_slice[j].event_type == INNER_OUT_BOTTOM)
+        {
+            event_y = curr_slice[j].y;
+            for(int k = 0; k < cell_index_slice.size(); k++)
+            {
+                if(event_y >= cell_graph[cell_index_slice[k]].ceiling.back().y && event_y <= cell_graph[cell_index_slice[k]].floor.back().y)
+                {
+                    curr_cell_idx = cell_index_slice[k];
+                    ExecuteInnerCloseOperation(cell_graph, curr_cell_idx, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_out_top, inner_out_bottom
+                    cell_index_slice.erase(cell_index_slice.begin()+k);
+                    curr_slice[j-1].isUsed = true;
+                    curr_slice[j].isUsed = true;
+                    break;
+                }
+            }
+        }
+
+    }
+
+    for(int j = 0; j < curr_slice.size(); j++)
+    {
+        if(curr_slice[j].event_type == CEILING)
+        {
+            cell_counter = CountCells(curr_slice,j);
+            if(!curr_slice[j].isUsed && cell_counter < cell_index_slice.size())
+            {
+                curr_cell_idx = cell_index_slice[cell_counter];
+                ExecuteCeilOperation(cell_graph, curr_cell_idx, Point2D(curr_slice[j].x, curr_slice[j].y));
+            }
+        }
+        if(curr_slice[j].event_type == FLOOR)
+        {
+            cell_counter = CountCells(curr_slice,j);
+            if(!curr_slice[j].isUsed && cell_counter < cell_index_slice.size())
+            {
+                curr_cell_idx = cell_index_slice[cell_counter];
+                ExecuteFloorOperation(cell_graph, curr_cell_idx, Point2D(curr_slice[j].x, curr_slice[j].y));
+            }
+        }
+    }
+
+    // 只在开/合改变了当前列的cell数时记录
+    if(cell_index_slice.size() != original_cell_index_slice.size())
+    {
+        TraceCounter("active cells", (long long)cell_index_slice.size());
+    }
+}
+
+inline void ExecuteCellDecomposition(std::vector<CellNode>& cell_graph, std::vector<int>& cell_index_slice, std::vector<int>& original_cell_index_slice, const std::deque<std::deque<Event>>& slice_list)
+{
+    AllocationStage allocation_stage(STAGE_CELL_DECOMPOSITION);
+    TraceSpan trace_span("ExecuteCellDecomposition");
+    std::deque<Event> curr_slice;
+
+    for(const auto& raw_slice : slice_list)
+    {
+        curr_slice = FilterSlice(raw_slice);
+        ExecuteSliceDecomposition(cell_graph, cell_index_slice, original_cell_index_slice, curr_slice);
+    }
+}
+
+/**
+ * 顶点级扫描: 只在临界列(有临界事件或有边界链起止的列)上还原出完整的slice, 交给ExecuteSliceDecomposition处理;
+ * 其余列上只有边界链, 按(y, obstacle_index)排好序后, 每个ceiling/floor延伸到它上方FLOOR个数所对应的cell, 与CountCells的计数规则一致.
+ * 得到的cell与逐像素的ExecuteCellDecomposition相同.
+ **/
+inline void ExecuteVertexCellDecomposition(std::vector<CellNode>& cell_graph, std::vector<int>& cell_index_slice, std::vector<int>& original_cell_index_slice, const VertexEventList& vertex_event_list)
+{
+    AllocationStage allocation_stage(STAGE_CELL_DECOMPOSITION);
+    TraceSpan trace_span("ExecuteVertexCellDecomposition");
+    const std::vector<Event>& critical_events = vertex_event_list.critical_events;
+    const std::vector<BoundaryChain>& chains = vertex_event_list.chains;
+
+    if(critical_events.empty() && chains.empty())
+    {
+        return;
+    }
+
+    std::vector<int> active_chains;     // 上一列按(y, obstacle_index)排好的顺序, 相邻列之间基本不变
+    std::vector<Event> column_events;
+    std::deque<Event> curr_slice;
+
+    int event_index = 0;
+    int chain_index = 0;
+    int next_end_x = INT_MAX;           // 活动链中最早结束的列
+
+    int x = INT_MAX;
+    if(!critical_events.empty())
+    {
+        x = critical_events.front().x;
+    }
+    if(!chains.empty())
+    {
+        x = std::min(x, chains.front().min_x);
+    }
+
+    auto chain_event = [&](int index)
+    {
+        const BoundaryChain& chain = chains[index];
+        return Event(chain.obstacle_index, x, chain.YAt(x), chain.event_type);
+    };
+
+    while(true)
+    {
+        bool is_critical = (next_end_x == x) || (event_index < critical_events.size() && critical_events[event_index].x == x);
+
+        while(chain_index < chains.size() && chains[chain_index].min_x == x)
+        {
+            active_chains.emplace_back(chain_index);
+            next_end_x = std::min(next_end_x, chains[chain_index].max_x);
+            chain_index++;
+            is_critical = true;
+        }
+
+        if(is_critical)
+        {
+            curr_slice.clear();
+            while(event_index < critical_events.size() && critical_events[event_index].x == x)
+            {
+                curr_slice.emplace_back(critical_events[event_index]);
+                event_index++;
+            }
+            for(int index : active_chains)
+            {
+                curr_slice.emplace_back(chain_event(index));
+            }
+            std::sort(curr_slice.begin(), curr_slice.end());
+
+            ExecuteSliceDecomposition(cell_graph, cell_index_slice, original_cell_index_slice, curr_slice);
+
+            if(next_end_x == x)
+            {
+                next_end_x = INT_MAX;
+                int active_num = 0;
+                for(int index : active_chains)
+                {
+                    if(chains[index].max_x != x)
+                    {
+                        active_chains[active_num++] = index;
+                        next_end_x = std::min(next_end_x, chains[index].max_x);
+                    }
+                }
+                active_chains.resize(active_num);
+            }
+        }
+        else
+        {
+            column_events.clear();
+            for(int index : active_chains)
+            {
+                column_events.emplace_back(chain_event(index));
+            }
+            if(!std::is_sorted(column_events.begin(), column_events.end()))
+            {
+                std::sort(active_chains.begin(), active_chains.end(), [&](int index1, int index2){ return chain_event(index1) < chain_event(index2); });
+                std::sort(column_events.begin(), column_events.end());
+            }
+
+            int floor_num = 0;
+            for(const auto& event : column_events)
+            {
+                if(floor_num < cell_index_slice.size())
+                {
+                    if(event.event_type == CEILING)
+                    {
+                        ExecuteCeilOperation(cell_graph, cell_index_slice[floor_num], Point2D(event.x, event.y));
+                    }
+                    else
+                    {
+                        ExecuteFloorOperation(cell_graph, cell_index_slice[floor_num], Point2D(event.x, event.y));
+                    }
+                }
+                if(event.event_type == FLOOR)
+                {
+                    floor_num++;
+                }
+            }
+        }
+
+        if(!active_chains.empty())
+        {
+            x++;
+        }
+        else if(event_index < critical_events.size() || chain_index < chains.size())
+        {
+            x = INT_MAX;
+            if(event_index < critical_events.size())
+            {
+                x = critical_events[event_index].x;
+            }
+            if(chain_index < chains.size())
+            {
+                x = std::min(x, chains[chain_index].min_x);
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+inline Point2D FindNextEntrance(const Point2D& curr_point, const CellNode& next_cell, int& corner_indicator)
+{
+    Point2D next_entrance;
+
+    std::vector<Point2D> corner_points = ComputeCellCornerPoints(next_cell);
+
+    int front_x = corner_points[TOPLEFT].x;
+    int back_x = corner_points[TOPRIGHT].x;
+
+    if(abs(curr_point.x - front_x) < abs(curr_point.x - back_x))
+    {
+        if(abs(curr_point.y - corner_points[TOPLEFT].y)<abs(curr_point.y - corner_points[BOTTOMLEFT].y))
+        {
+            next_entrance = corner_points[TOPLEFT];
+            corner_indicator = TOPLEFT;
+        }
+        else
+        {
+            next_entrance = corner_points[BOTTOMLEFT];
+            corner_indicator = BOTTOMLEFT;
+        }
+    }
+    else
+    {
+        if(abs(curr_point.y - corner_points[TOPRIGHT].y)<abs(curr_point.y - corner_points[BOTTOMRIGHT].y))
+        {
+            next_entrance = corner_points[TOPRIGHT];
+            corner_indicator = TOPRIGHT;
+        }
+        else
+        {
+            next_entrance = corner_points[BOTTOMRIGHT];
+            corner_indicator = BOTTOMRIGHT;
+        }
+    }
+
+    return next_entrance;
+}
+
+template<typename EdgeType>
+void WalkInsideCellAlongEdges(const EdgeType& ceiling, const EdgeType& floor, const Point2D& start, const Point2D& end, std::deque<Point2D>& inner_path)
+{
+    inner_path.emplace_back(start);
+
+    int start_ceiling_index_offset = start.x - ceiling.front().x;
+    int first_ceiling_delta_y = ceiling[start_ceiling_index_offset].y - start.y;
+    int end_ceiling_index_offset = end.x - ceiling.front().x;
+    int second_ceiling_delta_y = end.y - ceiling[end_ceiling_index_offset].y;
+
+    int start_floor_index_offset = start.x - floor.front().x;
+    int first_floor_delta_y = floor[start_floor_index_offset].y - start.y;
+    int end_floor_index_offset = end.x - floor.front().x;
+    int second_floor_delta_y = end.y - floor[end_floor_index_offset].y;
+
+    if((abs(first_ceiling_delta_y)+abs(second_ceiling_delta_y)) < (abs(first_floor_delta_y)+abs(second_floor_delta_y))) //to ceiling
+    {
+        int first_increment_y = 0;
+        if(first_ceiling_delta_y != 0)
+        {
+            first_increment_y = first_ceiling_delta_y / abs(first_ceiling_delta_y);
+
+            for(int i = 1; i <= abs(first_ceiling_delta_y); i++)
+            {
+                inner_path.emplace_back(Point2D(start.x, start.y+(first_increment_y*i)));
+            }
+        }
+
+        int delta_x = ceiling[end_ceiling_index_offset].x - ceiling[start_ceiling_index_offset].x;
+        int increment_x = 0;
+        if(delta_x != 0)
+        {
+            increment_x = delta_x / abs(delta_x);
+        }
+        for(int i = 0; i < abs(delta_x); i++)
+        {
+            // 提前转
+            if((ceiling[start_ceiling_index_offset+increment_x*(i+1)].y-ceiling[start_ceiling_index_offset+increment_x*(i)].y>=2)
+               &&(i+1 <= abs(delta_x))
+               &&(i <= abs(delta_x)))
+            {
+                int delta = ceiling[start_ceiling_index_offset+increment_x*(i+1)].y-ceiling[start_ceiling_index_offset+increment_x*(i)].y;
+                int increment = delta/abs(delta);
+                for(int j = 0; j <= abs(delta); j++)
+                {
+                    inner_path.emplace_back(Point2D(ceiling[start_ceiling_index_offset+increment_x*i].x, ceiling[start_ceiling_index_offset+increment_x*i].y+increment*(j)));
+                }
+            }
+            // 滞后转
+            else if((ceiling[start_ceiling_index_offset+increment_x*(i)].y-ceiling[start_ceiling_index_offset+increment_x*(i+1)].y>=2)
+                     &&(i<=abs(delta_x))
+                     &&(i+1<=abs(delta_x)))
+            {
+                inner_path.emplace_back(ceiling[start_ceiling_index_offset+increment_x*(i)]);
+
+                int delta = ceiling[start_ceiling_index_offset+increment_x*(i+1)].y-ceiling[start_ceiling_index_offset+increment_x*(i)].y;
+
+                int increment = delta/abs(delta);
+                for(int k = 0; k <= abs(delta); k++)
+                {
+                    inner_path.emplace_back(Point2D(ceiling[start_ceiling_index_offset+increment_x*(i+1)].x, ceiling[start_ceiling_index_offset+increment_x*(i+1)].y+abs(delta)+increment*(k)));
+                }
+            }
+            else
+            {
+                inner_path.emplace_back(ceiling[start_ceiling_index_offset+(increment_x*i)]);
+            }
+        }
+
+        int second_increment_y = 0;
+        if(second_ceiling_delta_y!=0)
+        {
+            second_increment_y = second_ceiling_delta_y/abs(second_ceiling_delta_y);
+
+            for(int i = 1; i <= abs(second_ceiling_delta_y); i++)
+            {
+                inner_path.emplace_back(Point2D(ceiling[end_ceiling_index_offset].x, ceiling[end_ceiling_index_offset].y+(second_increment_y*i)));
+            }
+        }
+
+    }
+    else // to floor
+    {
+        int first_increment_y = 0;
+        if(first_floor_delta_y != 0)
+        {
+            first_increment_y = first_floor_delta_y / abs(first_floor_delta_y);
+
+            for(int i = 1; i <= abs(first_floor_delta_y); i++)
+            {
+                inner_path.emplace_back(Point2D(start.x, start.y+(first_increment_y*i)));
+            }
+        }
+
+        int delta_x = floor[end_floor_index_offset].x - floor[start_floor_index_offset].x;
+        int increment_x = 0;
+        if(delta_x != 0)
+        {
+            increment_x = delta_x / abs(delta_x);
+        }
+        for(int i = 0; i < abs(delta_x); i++)
+        {
+            //提前转
+            if((floor[start_floor_index_offset+increment_x*(i)].y-floor[start_floor_index_offset+increment_x*(i+1)].y>=2)
+               &&(i<=abs(delta_x))
+               &&(i+1<=abs(delta_x)))
+            {
+                int delta = floor[start_floor_index_offset+increment_x*(i+1)].y-floor[start_floor_index_offset+increment_x*(i)].y;
+                int increment = delta/abs(delta);
+                for(int j = 0; j <= abs(delta); j++)
+                {
+                    inner_path.emplace_back(Point2D(floor[start_floor_index_offset+increment_x*(i)].x, floor[start_floor_index_offset+increment_x*(i)].y+increment*(j)));
+                }
+            }
+            //滞后转
+            else if((floor[start_floor_index_offset+increment_x*(i+1)].y-floor[start_floor_index_offset+increment_x*(i)].y>=2)
+                    &&(i+1<=abs(delta_x))
+                    &&(i<=abs(delta_x)))
+            {
+                inner_path.emplace_back(Point2D(floor[start_floor_index_offset+increment_x*(i)].x, floor[start_floor_index_offset+increment_x*(i)].y));
+
+                int delta = floor[start_floor_index_offset+increment_x*(i+1)].y-floor[start_floor_index_offset+increment_x*(i)].y;
+
+                int increment = delta/abs(delta);
+                for(int k = 0; k <= abs(delta); k++)
+                {
+                    inner_path.emplace_back(Point2D(floor[start_floor_index_offset+increment_x*(i+1)].x, floor[start_floor_index_offset+increment_x*(i+1)].y-abs(delta) +increment*(k)));
+                }
+            }
+            else
+            {
+                inner_path.emplace_back(floor[start_floor_index_offset+(increment_x*i)]);
+            }
+
+        }
+
+        int second_increment_y = 0;
+        if(second_floor_delta_y!=0)
+        {
+            second_increment_y = second_floor_delta_y/abs(second_floor_delta_y);
+
+            for(int i = 1; i <= abs(second_floor_delta_y); i++)
+            {
+                inner_path.emplace_back(Point2D(floor[end_floor_index_offset].x, floor[end_floor_index_offset].y+(second_increment_y*i)));
+            }
+        }
+    }
+}
+
+// cell内从start到end的路径追加到inner_path末尾
+inline void WalkInsideCell(const CellNode& cell, const Point2D& start, const Point2D& end, std::deque<Point2D>& inner_path)
+{
+    if(IsSegmentedCell(cell))
+    {
+        WalkInsideCellAlongEdges(cell.ceiling_segments, cell.floor_segments, start, end, inner_path);
+    }
+    else
+    {
+        WalkInsideCellAlongEdges(cell.ceiling, cell.floor, start, end, inner_path);
+    }
+}
+
+inline std::deque<Point2D> WalkInsideCell(const CellNode& cell, const Point2D& start, const Point2D& end)
+{
+    std::deque<Point2D> inner_path;
+    WalkInsideCell(cell, start, end, inner_path);
+    return inner_path;
+}
+
+// 两段连接路径分别追加到path_in_curr_cell和path_in_next_cell末尾. 后一段总在前一段写完之后才写, 两者可以是同一个缓冲区
+inline void FindLinkingPath(const Point2D& curr_exit, Point2D& next_entrance, int& corner_indicator, const CellNode& curr_cell, const CellNode& next_cell,
+                     std::deque<Point2D>& path_in_curr_cell, std::deque<Point2D>& path_in_next_cell)
+{
+    AllocationStage allocation_stage(STAGE_LINKING);
+    TraceSpan trace_span("FindLinkingPath");
+    int exit_corner_indicator = INT_MAX;
+    Point2D exit = FindNextEntrance(next_entrance, curr_cell, exit_corner_indicator);
+    WalkInsideCell(curr_cell, curr_exit, exit, path_in_curr_cell);
+
+    next_entrance = FindNextEntrance(exit, next_cell, corner_indicator);
+
+    int delta_x = next_entrance.x - exit.x;
+    int delta_y = next_entrance.y - exit.y;
+
+    int increment_x = 0;
+    int increment_y = 0;
+
+    if (delta_x != 0) {
+        increment_x = delta_x / std::abs(delta_x);
+    }
+    if (delta_y != 0) {
+        increment_y = delta_y / std::abs(delta_y);
+    }
+
+    int upper_bound = INT_MIN;
+    int lower_bound = INT_MAX;
+
+    std::vector<Point2D> corner_points = ComputeCellCornerPoints(curr_cell);
+
+    if (exit.x >= corner_points[TOPRIGHT].x)
+    {
+        upper_bound = corner_points[TOPRIGHT].y;
+        lower_bound = corner_points[BOTTOMRIGHT].y;
+    }
+    if (exit.x <= corner_points[TOPLEFT].x)
+    {
+        upper_bound = corner_points[TOPLEFT].y;
+        lower_bound = corner_points[BOTTOMLEFT].y;
+    }
+
+    if ((next_entrance.y >= upper_bound) && (next_entrance.y <= lower_bound))
+    {
+        for (int y = exit.y; y != next_entrance.y; y += increment_y) {
+            path_in_curr_cell.emplace_back(Point2D(exit.x, y));
+        }
+        for (int x = exit.x; x != next_entrance.x; x += increment_x) {
+            path_in_curr_cell.emplace_back(Point2D(x, next_entrance.y));
+        }
+    }
+    else
+    {
+        for (int x = exit.x; x != next_entrance.x; x += increment_x) {
+            path_in_curr_cell.emplace_back(Point2D(x, exit.y));
+        }
+        for (int y = exit.y; y != next_entrance.y; y += increment_y) {
+            path_in_next_cell.emplace_back(Point2D(next_entrance.x, y));
+        }
+    }
+
+}
+
+inline std::deque<std::deque<Point2D>> FindLinkingPath(const Point2D& curr_exit, Point2D& next_entrance, int& corner_indicator, const CellNode& curr_cell, const CellNode& next_cell)
+{
+    std::deque<std::deque<Point2D>> path(2);
+    FindLinkingPath(curr_exit, next_entrance, corner_indicator, curr_cell, next_cell, path.front(), path.back());
+    return path;
+}
+
+// 沿cell_path穿过各cell的路径追加到overall_path末尾. 只读cell_graph, 不再拷贝整张图
+inline void WalkCrossCells(const std::vector<CellNode>& cell_graph, const std::deque<int>& cell_path, const Point2D& start, const Point2D& end, int robot_radius, std::deque<Point2D>& overall_path)
+{
+    Point2D curr_exit, next_entrance;
+    int curr_corner_indicator, next_corner_indicator;
+
+    next_entrance = FindNextEntrance(start, cell_graph[cell_path[1]], next_corner_indicator);
+    curr_exit = FindNextEntrance(next_entrance, cell_graph[cell_path[0]], curr_corner_indicator);
+    WalkInsideCell(cell_graph[cell_path[0]], start, curr_exit, overall_path);
+
+    FindLinkingPath(curr_exit, next_entrance, next_corner_indicator, cell_graph[cell_path[0]], cell_graph[cell_path[1]], overall_path, overall_path);
+
+    curr_corner_indicator = next_corner_indicator;
+
+
+    for(int i = 1; i < cell_path.size()-1; i++)
+    {
+        GetBoustrophedonPath(cell_graph, cell_graph[cell_path[i]], curr_corner_indicator, robot_radius, overall_path);
+
+        curr_exit = overall_path.back();
+        next_entrance = FindNextEntrance(curr_exit, cell_graph[cell_path[i+1]], next_corner_indicator);
+
+        FindLinkingPath(curr_exit, next_entrance, next_corner_indicator, cell_graph[cell_path[i]], cell_graph[cell_path[i+1]], overall_path, overall_path);
+
+        curr_corner_indicator = next_corner_indicator;
+    }
+
+    WalkInsideCell(cell_graph[cell_path.back()], next_entrance, end, overall_path);
+}
+
+inline std::deque<Point2D> WalkCrossCells(const std::vector<CellNode>& cell_graph, const std::deque<int>& cell_path, const Point2D& start, const Point2D& end, int robot_radius)
+{
+    std::deque<Point2D> overall_path;
+    WalkCrossCells(cell_graph, cell_path, start, end, robot_radius, overall_path);
+    return overall_path;
+}
+
+/** 广度优先搜索 **/
+inline std::deque<int> FindShortestPath(const std::vector<CellNode>& cell_graph, const Point2D& start, const Point2D& end)
+{
+    int start_cell_index = DetermineCellIndex(cell_graph, start).front();
+    int end_cell_index = DetermineCellIndex(cell_graph, end).front();
+
+    std::deque<int> cell_path = {end_cell_index};
+
+    if(start_cell_index == end_cell_index)
+    {
+        return cell_path;
+    }
+
+    if(start_cell_index == end_cell_index)
+    {
+        cell_path.emplace_back(start_cell_index);
+        return cell_path;
+    }
+
+    // 访问标记和父节点单独存放, 不再为了重置它们拷贝整张图
+    std::vector<char> is_visited(cell_graph.size(), false);
+    std::vector<int> parent_indices(cell_graph.size(), INT_MAX);
+
+    std::deque<int> search_queue = {start_cell_index};
+
+    while(!search_queue.empty())
+    {
+        const CellNode& curr_cell = cell_graph[search_queue.front()];
+
+        is_visited[search_queue.front()] = true;
+        search_queue.pop_front();
+
+        for(int i = 0; i < curr_cell.neighbor_indices.size(); i++)
+        {
+            int neighbor_index = curr_cell.neighbor_indices[i];
+            if(neighbor_index == end_cell_index)
+            {
+                parent_indices[neighbor_index] = curr_cell.cellIndex;
+                search_queue.clear();
+                break;
+            }
+            else if(!is_visited[neighbor_index])
+            {
+                is_visited[neighbor_index] = true;
+                parent_indices[neighbor_index] = curr_cell.cellIndex;
+                search_queue.emplace_back(neighbor_index);
+            }
+        }
+
+    }
+
+    int curr_cell_index = end_cell_index;
+
+    while(parent_indices[curr_cell_index] != INT_MAX)
+    {
+        curr_cell_index = parent_indices[curr_cell_index];
+        cell_path.emplace_front(curr_cell_index);
+    }
+
+    return cell_path;
+}
+
+// wall_vertices和obstacle_vertices为多边形的顶点, 事件数只与顶点数有关; 传入TracePolygon得到的像素轮廓结果相同
+inline std::vector<CellNode> ConstructCellGraph(const OccupancyGrid& occupancy_grid, const std::vector<Point2D>& wall_vertices, const std::vector<std::vector<Point2D>>& obstacle_vertices)
+{
+    TraceSpan trace_span("ConstructCellGraph");
+    VertexEventList vertex_event_list = GenerateVertexEventList(occupancy_grid, wall_vertices, obstacle_vertices);
+
+    std::vector<CellNode> cell_graph;
+    std::vector<int> cell_index_slice;
+    std::vector<int> original_cell_index_slice;
+    ExecuteVertexCellDecomposition(cell_graph, cell_index_slice, original_cell_index_slice, vertex_event_list);
+
+    return cell_graph;
+}
+
+// 车道数只取决于cell宽度和车道间距: 每隔robot_radius+1列一条, 最后一列总会补一条
+inline int ComputeBoustrophedonLaneNum(const CellNode& cell, int robot_radius)
+{
+    int column_num = CellColumnNum(cell);
+    return (column_num - 1 + robot_radius) / (robot_radius + 1) + 1;
+}
+
+// 与GetBoustrophedonPath的走法一致: 车道数为奇数时在对角结束, 为偶数时在同一条边(ceiling或floor)的另一端结束
+inline int ComputeBoustrophedonExitCorner(const CellNode& cell, int entry_corner, bool is_cleaned, int robot_radius)
+{
+    if(is_cleaned)
+    {
+        return entry_corner;
+    }
+
+    bool odd_lanes = ComputeBoustrophedonLaneNum(cell, robot_radius) % 2 == 1;
+
+    switch(entry_corner)
+    {
+        case TOPLEFT:
+            return odd_lanes ? BOTTOMRIGHT : TOPRIGHT;
+        case TOPRIGHT:
+            return odd_lanes ? BOTTOMLEFT : TOPLEFT;
+        case BOTTOMLEFT:
+            return odd_lanes ? TOPRIGHT : BOTTOMRIGHT;
+        case BOTTOMRIGHT:
+            return odd_lanes ? TOPLEFT : BOTTOMLEFT;
+        default:
+            return entry_corner;
+    }
+}
+
+class CellSweepPlan
+{
+public:
+    int cell_index;
+    bool is_cleaned;         // 按访问顺序走到这里时cell是否已经清扫过
+    int entry_corner;
+    Point2D entrance;
+    Point2D exit;
+    Point2D next_entrance;   // FindNextEntrance给出的下一个cell入口, 作为FindLinkingPath的输入
+    int next_corner;         // 同上, FindLinkingPath会在此基础上修正
+};
+
+// 沿访问顺序推出每次访问的入口角点、出口和下一个cell的入口, 不生成路径
+inline std::vector<CellSweepPlan> AssignSweepCorners(const std::vector<CellNode>& cell_graph, const std::deque<CellNode>& cell_path, int robot_radius, int start_corner=TOPLEFT)
+{
+    std::vector<CellSweepPlan> sweep_plans(cell_path.size());
+    std::vector<bool> cleaned(cell_graph.size(), false);
+    for(int i = 0; i < cell_graph.size(); i++)
+    {
+        cleaned[i] = cell_graph[i].isCleaned;
+    }
+
+    int corner_indicator = start_corner;
+    for(int i = 0; i < cell_path.size(); i++)
+    {
+        CellSweepPlan& plan = sweep_plans[i];
+        plan.cell_index = cell_path[i].cellIndex;
+        plan.is_cleaned = cleaned[plan.cell_index];
+        plan.entry_corner = corner_indicator;
+        std::vector<Point2D> corner_points = ComputeCellCornerPoints(cell_path[i]);
+        plan.entrance = corner_points[corner_indicator];
+        plan.exit = corner_points[ComputeBoustrophedonExitCorner(cell_path[i], corner_indicator, plan.is_cleaned, robot_radius)];
+        cleaned[plan.cell_index] = true;
+
+        if(i < (cell_path.size()-1))
+        {
+            plan.next_entrance = FindNextEntrance(plan.exit, cell_path[i+1], corner_indicator);
+            plan.next_corner = corner_indicator;
+
+            // 与FindLinkingPath中一样, 从当前cell离下一个入口最近的角点出发重新确定入口
+            int exit_corner_indicator = INT_MAX;
+            Point2D exit = FindNextEntrance(plan.next_entrance, cell_path[i], exit_corner_indicator);
+            FindNextEntrance(exit, cell_path[i+1], corner_indicator);
+        }
+    }
+
+    return sweep_plans;
+}
+
+/**
+ * 两阶段的StaticPathPlanning, 结果与StaticPathPlanning(不可视化时)一致.
+ * 第一阶段沿访问顺序直接由入口角点、cell宽度和车道间距推出每个cell的出口角点和下一个cell的入口;
+ * 第二阶段各cell互不依赖, 在多个线程中分别调用GetBoustrophedonPath和FindLinkingPath, 最后按顺序拼接.
+ **/
+inline std::deque<std::deque<Point2D>> StaticPathPlanningParallel(std::vector<CellNode>& cell_graph, const Point2D& start_point, int robot_radius, int thread_num)
+{
+    TraceSpan trace_span("StaticPathPlanningParallel", "threads", thread_num);
+    int start_cell_index = DetermineCellIndex(cell_graph, start_point).front();
+    std::deque<Point2D> init_path = WalkInsideCell(cell_graph[start_cell_index], start_point, ComputeCellCornerPoints(cell_graph[start_cell_index])[TOPLEFT]);
+
+    std::deque<CellNode> cell_path = GetVisittingPath(cell_graph, start_cell_index);
+
+    // 第一阶段
+    std::vector<CellSweepPlan> sweep_plans = AssignSweepCorners(cell_graph, cell_path, robot_radius);
+
+    // 第二阶段
+    // 每个cell的牛耕路径和连接路径在当前cell内的一段直接写进同一个缓冲区, 连接路径在下一个cell内的一段单独存放
+    std::vector<std::deque<Point2D>> inner_paths(cell_path.size());
+    std::vector<std::deque<Point2D>> next_cell_paths(cell_path.size());
+    std::atomic<int> next_plan(0);
+
+    std::vector<std::thread> workers;
+    for(int i = 0; i < std::max(thread_num, 1); i++)
+    {
+        workers.emplace_back([&]()
+        {
+            for(int plan_index = next_plan++; plan_index < int(sweep_plans.size()); plan_index = next_plan++)
+            {
+                const CellSweepPlan& plan = sweep_plans[plan_index];
+                if(plan.is_cleaned)
+                {
+                    inner_paths[plan_index].emplace_back(ComputeCellCornerPoints(cell_path[plan_index])[plan.entry_corner]);
+                }
+                else
+                {
+                    GetBoustrophedonPath(cell_graph, cell_path[plan_index], plan.entry_corner, robot_radius, inner_paths[plan_index]);
+                }
+
+                if(plan_index < int(sweep_plans.size())-1)
+                {
+                    Point2D next_entrance = plan.next_entrance;
+                    int next_corner = plan.next_corner;
+                    FindLinkingPath(plan.exit, next_entrance, next_corner, cell_path[plan_index], cell_path[plan_index+1], inner_paths[plan_index], next_cell_paths[plan_index]);
+                }
+            }
+        });
+    }
+    for(auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    std::deque<std::deque<Point2D>> global_path;
+    std::deque<Point2D> local_path = std::move(init_path);
+    for(int i = 0; i < cell_path.size(); i++)
+    {
+        local_path.insert(local_path.end(), inner_paths[i].begin(), inner_paths[i].end());
+        cell_graph[sweep_plans[i].cell_index].isCleaned = true;
+
+        if(i < (cell_path.size()-1))
+        {
+            global_path.emplace_back(std::move(local_path));
+            local_path = std::move(next_cell_paths[i]);
+        }
+    }
+    global_path.emplace_back(std::move(local_path));
+
+    return global_path;
+}
+
+/**
+ * 按需生成的覆盖路径, 供机器人控制器边走边取: 构造时只确定起点所在cell和cell的访问顺序(下标),
+ * 每次NextSegment才规划访问顺序中的下一个cell, 依次取出的各段与StaticPathPlanning返回的global_path逐段相同.
+ * 缓存的只有连接路径落在下一个cell内的一段, 内存与当前cell的路径长度同阶, 不随地图大小增长.
+ **/
+class CoveragePathGenerator
+{
+public:
+    CoveragePathGenerator(std::vector<CellNode>& cell_graph_, const Point2D& start_point, int robot_radius_)
+        : cell_graph(cell_graph_), robot_radius(robot_radius_)
+    {
+        int start_cell_index = DetermineCellIndex(cell_graph, start_point).front();
+        pending_path = WalkInsideCell(cell_graph[start_cell_index], start_point, ComputeCellCornerPoints(cell_graph[start_cell_index])[TOPLEFT]);
+        cell_order = GetVisittingOrder(cell_graph, start_cell_index);
+    }
+
+    // 取下一段路径(进入当前cell的连接路径、牛耕路径和离开时在当前cell内的连接路径), 已经取完时返回false
+    bool NextSegment(std::deque<Point2D>& segment)
+    {
+        if(IsFinished())
+        {
+            return false;
+        }
+
+        segment.swap(pending_path);
+        pending_path.clear();
+
+        const CellNode& curr_cell = cell_graph[cell_order[visit_index]];
+        GetBoustrophedonPath(cell_graph, curr_cell, corner_indicator, robot_radius, segment);
+        cell_graph[curr_cell.cellIndex].isCleaned = true;
+
+        if(visit_index + 1 < cell_order.size())
+        {
+            const CellNode& next_cell = cell_graph[cell_order[visit_index+1]];
+            Point2D curr_exit = segment.back();
+            Point2D next_entrance = FindNextEntrance(curr_exit, next_cell, corner_indicator);
+            FindLinkingPath(curr_exit, next_entrance, corner_indicator, curr_cell, next_cell, segment, pending_path);
+        }
+
+        visit_index++;
+        return true;
+    }
+
+    // 逐点取路径, 当前段取完时才规划下一个cell
+    bool NextPoint(Point2D& point)
+    {
+        while(point_index >= curr_segment.size())
+        {
+            if(!NextSegment(curr_segment))
+            {
+                return false;
+            }
+            point_index = 0;
+        }
+        point = curr_segment[point_index++];
+        return true;
+    }
+
+    bool IsFinished() const
+    {
+        return visit_index >= cell_order.size();
+    }
+
+    // 已规划的访问次数/总访问次数, 回溯经过的cell会重复计数
+    size_t PlannedVisitNum() const
+    {
+        return visit_index;
+    }
+    size_t VisitNum() const
+    {
+        return cell_order.size();
+    }
+
+    // 当前缓存的路径点数(逐点取时尚未取出的部分加上下一个cell内的连接路径)
+    size_t BufferedPointNum() const
+    {
+        return curr_segment.size() - std::min(point_index, curr_segment.size()) + pending_path.size();
+    }
+
+    std::vector<CellNode>& cell_graph;
+    int robot_radius;
+    std::deque<int> cell_order;
+    size_t visit_index = 0;
+    int corner_indicator = TOPLEFT;
+    std::deque<Point2D> pending_path;
+    std::deque<Point2D> curr_segment;
+    size_t point_index = 0;
+};
+
+inline std::deque<Point2D> FilterTrajectory(const std::deque<std::deque<Point2D>>& raw_trajectory)
+{
+    AllocationStage allocation_stage(STAGE_FILTER_TRAJECTORY);
+    TraceSpan trace_span("FilterTrajectory");
+    std::deque<Point2D> trajectory;
+
+    for(const auto& sub_trajectory : raw_trajectory)
+    {
+        for(const auto& position : sub_trajectory)
+        {
+            if(!trajectory.empty())
+            {
+                if(position != trajectory.back())
+                {
+                    trajectory.emplace_back(position);
+                }
+            }
+            else
+            {
+                trajectory.emplace_back(position);
+            }
+        }
+    }
+
+    return trajectory;
+}
+
+/**
+ * 结构数组形式的路径: x和y分别连续存放, 每个坐标16位(地图长宽不超过65536像素).
+ * 每个点4字节, 是std::deque<Point2D>的一半, 逐点处理的循环在两个连续数组上进行, 便于编译器向量化.
+ **/
+class PathBuffer
+{
+public:
+    void Reserve(size_t point_num)
+    {
+        xs.reserve(point_num);
+        ys.reserve(point_num);
+    }
+    void Append(const Point2D& point)
+    {
+        xs.emplace_back(uint16_t(point.x));
+        ys.emplace_back(uint16_t(point.y));
+    }
+    Point2D At(size_t index) const
+    {
+        return Point2D(xs[index], ys[index]);
+    }
+    size_t Size() const
+    {
+        return xs.size();
+    }
+    bool Empty() const
+    {
+        return xs.empty();
+    }
+    std::deque<Point2D> ToDeque() const
+    {
+        std::deque<Point2D> path;
+        for(size_t i = 0; i < xs.size(); i++)
+        {
+            path.emplace_back(At(i));
+        }
+        return path;
+    }
+    size_t MemoryBytes() const
+    {
+        return (xs.capacity() + ys.capacity()) * sizeof(uint16_t);
+    }
+    std::vector<uint16_t> xs;
+    std::vector<uint16_t> ys;
+};
+
+/**
+ * 与FilterTrajectory结果相同, 写成PathBuffer: 先把各段路径依次拷入两个数组, 再一遍去掉与前一点重合的点.
+ * 与前一个保留点比较等价于与前一个原始点比较, 所以判断只依赖相邻两个元素, 写回位置用无分支的计数推进.
+ **/
+inline PathBuffer FilterTrajectoryCompact(const std::deque<std::deque<Point2D>>& raw_trajectory)
+{
+    AllocationStage allocation_stage(STAGE_FILTER_TRAJECTORY);
+    TraceSpan trace_span("FilterTrajectoryCompact");
+    size_t point_num = 0;
+    for(const auto& sub_trajectory : raw_trajectory)
+    {
+        point_num += sub_trajectory.size();
+    }
+
+    PathBuffer trajectory;
+    trajectory.Reserve(point_num);
+    for(const auto& sub_trajectory : raw_trajectory)
+    {
+        for(const auto& position : sub_trajectory)
+        {
+            trajectory.Append(position);
+        }
+    }
+
+    uint16_t* xs = trajectory.xs.data();
+    uint16_t* ys = trajectory.ys.data();
+    size_t kept_num = std::min<size_t>(point_num, 1);
+    for(size_t i = 1; i < point_num; i++)
+    {
+        size_t is_new = size_t((xs[i] != xs[i-1]) | (ys[i] != ys[i-1]));
+        xs[kept_num] = xs[i];
+        ys[kept_num] = ys[i];
+        kept_num += is_new;
+    }
+    trajectory.xs.resize(kept_num);
+    trajectory.ys.resize(kept_num);
+
+    return trajectory;
+}
+
+// 路径总长(像素), 只用到相邻两点的坐标差
+inline double ComputePathLength(const PathBuffer& path)
+{
+    const uint16_t* xs = path.xs.data();
+    const uint16_t* ys = path.ys.data();
+    double length = 0;
+    for(size_t i = 1; i < path.Size(); i++)
+    {
+        double dx = double(int(xs[i]) - int(xs[i-1]));
+        double dy = double(int(ys[i]) - int(ys[i-1]));
+        length += std::sqrt(dx * dx + dy * dy);
+    }
+    return length;
+}
+
+#endif //BCD_PLANNER_BCD_CORE_HPP
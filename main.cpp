@@ -3,6 +3,28 @@
 #include <deque>
 #include <map>
 #include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <sstream>
+#include <set>
+#include <cstring>
+#include <fstream>
+#include <cerrno>
+#include <cstdio>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
@@ -10,5174 +32,6598 @@
 
 #include <Eigen/Core>
 
+#include "bcd_core.hpp"
 
-/** 地图默认是空闲区域为白色，障碍物为黑色 **/
 
-enum EventType
-{
-    IN,
-    IN_TOP,
-    IN_BOTTOM,
-    OUT,
-    OUT_TOP,
-    OUT_BOTTOM,
-    INNER_IN,
-    INNER_IN_TOP,
-    INNER_IN_BOTTOM,
-    INNER_OUT,
-    INNER_OUT_TOP,
-    INNER_OUT_BOTTOM,
-
-    IN_EX,
-    IN_TOP_EX,
-    IN_BOTTOM_EX,
-    OUT_EX,
-    OUT_TOP_EX,
-    OUT_BOTTOM_EX,
-    INNER_IN_EX,
-    INNER_IN_TOP_EX,
-    INNER_IN_BOTTOM_EX,
-    INNER_OUT_EX,
-    INNER_OUT_TOP_EX,
-    INNER_OUT_BOTTOM_EX,
-
-    MIDDLE,
-    CEILING,
-    FLOOR,
-    UNALLOCATED
-};
+/** 地图默认是空闲区域为白色，障碍物为黑色 **/
 
 enum VisualizationMode{PATH_MODE, ROBOT_MODE};
 
-const int TOPLEFT = 0;
-const int BOTTOMLEFT = 1;
-const int BOTTOMRIGHT = 2;
-const int TOPRIGHT = 3;
-
 const int palette_colors = 1530;
 
-class Point2D
+/** 把地图矩形区域[x_min, x_max]x[y_min, y_max]内颜色为occupied_color的像素写成占据, 其余写成空闲; 单通道地图只比较第一个分量 **/
+void UpdateOccupancyGrid(const cv::Mat& map, OccupancyGrid& occupancy_grid, const cv::Vec3b& occupied_color, int x_min, int y_min, int x_max, int y_max)
 {
-public:
-    Point2D()
+    x_min = std::max(x_min, 0);
+    y_min = std::max(y_min, 0);
+    x_max = std::min(x_max, occupancy_grid.cols-1);
+    y_max = std::min(y_max, occupancy_grid.rows-1);
+
+    for(int y = y_min; y <= y_max; y++)
+    {
+        uint64_t* row = occupancy_grid.Row(y);
+        if(map.channels() == 1)
+        {
+            const uchar* pixels = map.ptr<uchar>(y);
+            for(int x = x_min; x <= x_max; x++)
+            {
+                uint64_t bit = uint64_t(1) << (x & 63);
+                row[x >> 6] = (pixels[x] == occupied_color[0]) ? (row[x >> 6] | bit) : (row[x >> 6] & ~bit);
+            }
+        }
+        else
+        {
+            const cv::Vec3b* pixels = map.ptr<cv::Vec3b>(y);
+            for(int x = x_min; x <= x_max; x++)
+            {
+                uint64_t bit = uint64_t(1) << (x & 63);
+                row[x >> 6] = (pixels[x] == occupied_color) ? (row[x >> 6] | bit) : (row[x >> 6] & ~bit);
+            }
+        }
+    }
+}
+
+OccupancyGrid ConstructOccupancyGrid(const cv::Mat& map, const cv::Vec3b& occupied_color)
+{
+    OccupancyGrid occupancy_grid(map.rows, map.cols);
+    UpdateOccupancyGrid(map, occupancy_grid, occupied_color, 0, 0, map.cols-1, map.rows-1);
+    return occupancy_grid;
+}
+
+/** 膨胀后的可通行区域: 外墙以外和障碍物内部(含边界)为占据. 多边形仍由fillPoly在单通道画布上光栅化, 再打包成位栅格 **/
+OccupancyGrid ConstructOccupancyGrid(const cv::Size& map_size, const std::vector<std::vector<cv::Point>>& wall_contours, const std::vector<std::vector<cv::Point>>& obstacle_contours)
+{
+    TraceSpan trace_span("ConstructOccupancyGrid");
+    cv::Mat1b canvas = cv::Mat1b(map_size, CV_8U);
+    canvas.setTo(0);
+
+    cv::fillPoly(canvas, wall_contours, 255);
+    cv::fillPoly(canvas, obstacle_contours, 0);
+
+    return ConstructOccupancyGrid(canvas, cv::Vec3b(0, 0, 0));
+}
+
+/** 膨胀后的可通行区域, 供轨迹简化检查捷径 **/
+OccupancyGrid ConstructFreeSpaceMap(const cv::Mat& original_map, const std::vector<std::vector<cv::Point>>& wall_contours, const std::vector<std::vector<cv::Point>>& obstacle_contours)
+{
+    return ConstructOccupancyGrid(original_map.size(), wall_contours, obstacle_contours);
+}
+
+void DrawCells(cv::Mat& map, const CellNode& cell, cv::Scalar color=cv::Scalar(100, 100, 100))
+{
+    if(IsSegmentedCell(cell))
     {
-        x = INT_MAX;
-        y = INT_MAX;
+        CellNode expanded_cell = cell;
+        ExpandCellBoundary(expanded_cell);
+        DrawCells(map, expanded_cell, color);
+        return;
     }
-    Point2D(int x_pos, int y_pos)
+
+    std::cout<<"cell "<<cell.cellIndex<<": "<<std::endl;
+    std::cout<<"cell's ceiling points: "<<cell.ceiling.size()<<std::endl;
+    std::cout<<"cell's floor points: "<<cell.floor.size()<<std::endl;
+
+    for(const auto& ceiling_point : cell.ceiling)
     {
-        x = x_pos;
-        y = y_pos;
+        map.at<cv::Vec3b>(ceiling_point.y, ceiling_point.x) = cv::Vec3b(uchar(color[0]), uchar(color[1]), uchar(color[2]));
     }
-    Point2D(const Point2D& point)
+
+    for(const auto& floor_point : cell.floor)
     {
-        x = point.x;
-        y = point.y;
+        map.at<cv::Vec3b>(floor_point.y, floor_point.x) = cv::Vec3b(uchar(color[0]), uchar(color[1]), uchar(color[2]));
     }
-    int x;
-    int y;
-};
 
-/** 多边形顶点按照逆时针旋转排序 **/
-typedef std::vector<Point2D> Polygon;
-typedef std::vector<Polygon> PolygonList;
-typedef std::deque<Point2D> Edge;
+    cv::line(map, cv::Point(cell.ceiling.front().x,cell.ceiling.front().y), cv::Point(cell.floor.front().x,cell.floor.front().y), color);
+    cv::line(map, cv::Point(cell.ceiling.back().x,cell.ceiling.back().y), cv::Point(cell.floor.back().x,cell.floor.back().y), color);
+}
 
-class Event
+void InitializeColorMap(std::deque<cv::Scalar>& JetColorMap, int repeat_times)
 {
-public:
-    Event(int obstacle_idx, int x_pos, int y_pos, EventType type=UNALLOCATED)
+    for(int i = 0; i <= 255; i++)
     {
-        obstacle_index = obstacle_idx;
-        x = x_pos;
-        y = y_pos;
-        event_type = type;
-        original_index_in_slice = INT_MAX;
-        isUsed = false;
+        for(int j = 0; j < repeat_times; j++)
+        {
+            JetColorMap.emplace_back(cv::Scalar(0, i, 255));
+        }
     }
 
-    int x;
-    int y;
-    int original_index_in_slice;
-    int obstacle_index;
-    EventType event_type;
+    for(int i = 254; i >= 0; i--)
+    {
+        for(int j = 0; j < repeat_times; j++)
+        {
+            JetColorMap.emplace_back(cv::Scalar(0, 255, i));
+        }
+    }
 
-    bool isUsed;
-};
+    for(int i = 1; i <= 255; i++)
+    {
+        for(int j = 0; j < repeat_times; j++)
+        {
+            JetColorMap.emplace_back(cv::Scalar(i, 255, 0));
+        }
+    }
 
-class CellNode
-{
-public:
-    CellNode()
+    for(int i = 254; i >= 0; i--)
     {
-        isVisited = false;
-        isCleaned = false;
-        parentIndex = INT_MAX;
-        cellIndex = INT_MAX;
+        for(int j = 0; j < repeat_times; j++)
+        {
+            JetColorMap.emplace_back(cv::Scalar(255, i, 0));
+        }
     }
-    bool isVisited;
-    bool isCleaned;
-    Edge ceiling;
-    Edge floor;
 
-    int parentIndex;
-    std::deque<int> neighbor_indices;
+    for(int i = 1; i <= 255; i++)
+    {
+        for(int j = 0; j < repeat_times; j++)
+        {
+            JetColorMap.emplace_back(cv::Scalar(255, 0, i));
+        }
+    }
 
-    int cellIndex;
-};
+    for(int i = 254; i >= 1; i--)
+    {
+        for(int j = 0; j < repeat_times; j++)
+        {
+            JetColorMap.emplace_back(cv::Scalar(i, 0, 255));
+        }
+    }
+}
 
-bool operator<(const Point2D& p1, const Point2D& p2)
+void UpdateColorMap(std::deque<cv::Scalar>& JetColorMap)
 {
-    return (p1.x < p2.x || (p1.x == p2.x && p1.y < p2.y));
+    cv::Scalar color = JetColorMap.front();
+    JetColorMap.pop_front();
+    JetColorMap.emplace_back(color);
 }
 
-bool operator<(const Event& e1, const Event& e2)
+
+
+
+/** 静态路径规划流程 **/
+
+
+int ComputeRobotRadius(const double& meters_per_pix, const double& robot_size_in_meters)
 {
-    return (e1.x < e2.x || (e1.x == e2.x && e1.y < e2.y) || (e1.x == e2.x && e1.y == e2.y && e1.obstacle_index < e2.obstacle_index));
+    int robot_radius = int(robot_size_in_meters / meters_per_pix);
+    return robot_radius;
 }
 
-bool operator==(const Point2D& p1, const Point2D& p2)
+cv::Mat1b ReadMap(const std::string& map_file_path)
 {
-    return (p1.x==p2.x && p1.y==p2.y);
+    cv::Mat1b original_map = cv::imread(map_file_path, CV_8U);
+    return original_map;
 }
 
-bool operator!=(const Point2D& p1, const Point2D& p2)
+cv::Mat1b PreprocessMap(const cv::Mat1b& original_map)
 {
-    return !(p1==p2);
+    cv::Mat1b map = original_map.clone();
+    cv::threshold(map, map, 128, 255, cv::THRESH_BINARY);
+    return map;
 }
 
+// 原来的做法: 两次findContours, 中间用整张图大小的mask和base挑出外墙内的障碍物. 只在ContourTracingBenchmark中用作对照
+void ExtractRawContoursTwoPass(const cv::Mat& original_map, std::vector<std::vector<cv::Point>>& raw_wall_contours, std::vector<std::vector<cv::Point>>& raw_obstacle_contours)
+{
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(original_map.clone(), contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
 
+    std::vector<int> wall_cnt_indices(contours.size());
+    std::iota(wall_cnt_indices.begin(), wall_cnt_indices.end(), 0);
 
+//    std::sort(wall_cnt_indices.begin(), wall_cnt_indices.end(), [&contours](int lhs, int rhs){return contours[lhs].size() > contours[rhs].size();});
+    std::sort(wall_cnt_indices.begin(), wall_cnt_indices.end(), [&contours](int lhs, int rhs){return cv::contourArea(contours[lhs]) > cv::contourArea(contours[rhs]);});
 
-/** 路径规划功能函数 **/
+    std::vector<cv::Point> raw_wall_contour = contours[wall_cnt_indices.front()];
+    raw_wall_contours = {raw_wall_contour};
 
+    cv::Mat mask = cv::Mat(original_map.size(), original_map.type(), 255);
+    cv::fillPoly(mask, raw_wall_contours, 0);
 
-int WrappedIndex(int index, int list_length)
-{
-    int wrapped_index = (index%list_length+list_length)%list_length;
-    return wrapped_index;
+    cv::Mat base = original_map.clone();
+    base += mask;
+    cv::threshold(base, base, 128, 255, cv::THRESH_BINARY_INV);
+
+    cv::findContours(base, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
+
+    raw_obstacle_contours = contours;
 }
 
-/** 深度优先搜索遍历邻接图 **/
-void WalkThroughGraph(std::vector<CellNode>& cell_graph, int cell_index, int& unvisited_counter, std::deque<CellNode>& path)
+std::vector<cv::Point> ToCvContour(const Polygon& polygon)
 {
-    if(!cell_graph[cell_index].isVisited)
+    std::vector<cv::Point> contour;
+    contour.reserve(polygon.size());
+    for(const auto& point : polygon)
     {
-        cell_graph[cell_index].isVisited = true;
-        unvisited_counter--;
+        contour.emplace_back(cv::Point(point.x, point.y));
     }
-    path.emplace_front(cell_graph[cell_index]);
+    return contour;
+}
 
-//    for debugging
-//    std::cout<< "cell: " <<cell_graph[cell_index].cellIndex<<std::endl;
-//
+// 地图上没有可通行像素时返回false, 两个输出都为空
+bool ExtractRawContours(const cv::Mat& original_map, std::vector<std::vector<cv::Point>>& raw_wall_contours, std::vector<std::vector<cv::Point>>& raw_obstacle_contours, int thread_num=1)
+{
+    AllocationStage allocation_stage(STAGE_CONTOUR_EXTRACTION);
+    raw_wall_contours.clear();
+    raw_obstacle_contours.clear();
 
-    CellNode neighbor;
-    int neighbor_idx = INT_MAX;
+    BinaryMapContours contours;
+    if(!TraceBinaryMapContours(original_map.ptr<uchar>(0), original_map.rows, original_map.cols, size_t(original_map.step), contours, thread_num))
+    {
+        return false;
+    }
 
-    for(int i = 0; i < cell_graph[cell_index].neighbor_indices.size(); i++)
+    raw_wall_contours = {ToCvContour(contours.wall)};
+
+    for(const auto& obstacle : contours.obstacles)
     {
-        neighbor = cell_graph[cell_graph[cell_index].neighbor_indices[i]];
-        neighbor_idx = cell_graph[cell_index].neighbor_indices[i];
-        if(!neighbor.isVisited)
-        {
-            break;
-        }
+        raw_obstacle_contours.emplace_back(ToCvContour(obstacle));
     }
+    return true;
+}
 
-    if(!neighbor.isVisited) // unvisited neighbor found
+// 原地图或按robot_radius膨胀后没有可通行区域时返回false
+bool ExtractContours(const cv::Mat& original_map, std::vector<std::vector<cv::Point>>& wall_contours, std::vector<std::vector<cv::Point>>& obstacle_contours, int robot_radius=0)
+{
+    AllocationStage allocation_stage(STAGE_CONTOUR_EXTRACTION);
+    TraceSpan trace_span("ExtractContours");
+    if(!ExtractRawContours(original_map, wall_contours, obstacle_contours))
     {
-        cell_graph[neighbor_idx].parentIndex = cell_graph[cell_index].cellIndex;
-        WalkThroughGraph(cell_graph, neighbor_idx, unvisited_counter, path);
+        return false;
     }
-    else  // unvisited neighbor not found
+
+    if(robot_radius != 0)
     {
+        // 单通道画布上直接画出膨胀后的可通行区域(白色), 不再经过三通道画布和反色
+        cv::Mat1b canvas_ = cv::Mat1b(original_map.size(), CV_8U);
+        canvas_.setTo(0);
 
-        if (cell_graph[cell_index].parentIndex == INT_MAX) // cannot go on back-tracking
+        cv::fillPoly(canvas_, wall_contours, 255);
+        for(const auto& point:wall_contours.front())
         {
-            return;
+            cv::circle(canvas_, point, robot_radius, 0, -1);
         }
-        else if(unvisited_counter == 0)
+
+        cv::fillPoly(canvas_, obstacle_contours, 0);
+        for(const auto& obstacle_contour:obstacle_contours)
         {
-            return;
+            for(const auto& point:obstacle_contour)
+            {
+                cv::circle(canvas_, point, robot_radius, 0, -1);
+            }
         }
-        else
+
+        cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(robot_radius,robot_radius), cv::Point(-1,-1));
+        cv::morphologyEx(canvas_, canvas_, cv::MORPH_OPEN, kernel);
+
+        if(!ExtractRawContours(canvas_, wall_contours, obstacle_contours))
         {
-            WalkThroughGraph(cell_graph, cell_graph[cell_index].parentIndex, unvisited_counter, path);
+            return false;
+        }
+
+        std::vector<cv::Point> processed_wall_contour;
+        cv::approxPolyDP(cv::Mat(wall_contours.front()), processed_wall_contour, 1, true);
+
+        std::vector<std::vector<cv::Point>> processed_obstacle_contours(obstacle_contours.size());
+        for(int i = 0; i < obstacle_contours.size(); i++)
+        {
+            cv::approxPolyDP(cv::Mat(obstacle_contours[i]), processed_obstacle_contours[i], 1, true);
         }
+
+        wall_contours = {processed_wall_contour};
+        obstacle_contours = processed_obstacle_contours;
     }
+    return true;
 }
 
-std::deque<CellNode> GetVisittingPath(std::vector<CellNode>& cell_graph, int first_cell_index)
+std::vector<Point2D> ConstructVertices(const std::vector<cv::Point>& contour)
 {
-    std::deque<CellNode> visitting_path;
-
-    if(cell_graph.size()==1)
+    std::vector<Point2D> vertices;
+    vertices.reserve(contour.size());
+    for(const auto& point : contour)
     {
-        visitting_path.emplace_back(cell_graph.front());
+        vertices.emplace_back(Point2D(point.x, point.y));
     }
-    else
+    return vertices;
+}
+
+PolygonList ConstructObstacles(const std::vector<std::vector<cv::Point>>& obstacle_contours)
+{
+    AllocationStage allocation_stage(STAGE_CONSTRUCT_OBSTACLES);
+    TraceSpan trace_span("ConstructObstacles");
+    PolygonList obstacles;
+
+    for(const auto& obstacle_contour : obstacle_contours)
     {
-        int unvisited_counter = cell_graph.size();
-        WalkThroughGraph(cell_graph, first_cell_index, unvisited_counter, visitting_path);
-        std::reverse(visitting_path.begin(), visitting_path.end());
+        obstacles.emplace_back(TracePolygon(ConstructVertices(obstacle_contour)));
     }
 
-    return visitting_path;
+    return obstacles;
 }
 
-std::vector<Point2D> ComputeCellCornerPoints(const CellNode& cell)
+Polygon ConstructDefaultWall(const cv::Mat& original_map)
 {
+    std::vector<cv::Point> default_wall_contour = {cv::Point(0, 0), cv::Point(0, original_map.rows-1), cv::Point(original_map.cols-1, original_map.rows-1), cv::Point(original_map.cols-1, 0)};
+    std::vector<std::vector<cv::Point>>default_wall_contours = {default_wall_contour};
 
-    Point2D topleft = cell.ceiling.front();
-    Point2D bottomleft = cell.floor.front();
-    Point2D bottomright = cell.floor.back();
-    Point2D topright = cell.ceiling.back();
-
-    // 按照TOPLEFT、BOTTOMLEFT、BOTTOMRIGHT、TOPRIGHT的顺序储存corner points（逆时针）
-    std::vector<Point2D> corner_points = {topleft, bottomleft, bottomright, topright};
+    Polygon default_wall = ConstructObstacles(default_wall_contours).front();
 
-    return corner_points;
+    return default_wall;
 }
 
-std::vector<int> DetermineCellIndex(std::vector<CellNode>& cell_graph, const Point2D& point)
+Polygon ConstructWall(const cv::Mat& original_map, std::vector<cv::Point>& wall_contour)
 {
-    std::vector<int> cell_index;
+    Polygon wall;
 
-    for(int i = 0; i < cell_graph.size(); i++)
+    if(!wall_contour.empty())
     {
-        for(int j = 0; j < cell_graph[i].ceiling.size(); j++)
+        wall = TracePolygon(ConstructVertices(wall_contour));
+
+        return wall;
+    }
+    else
+    {
+        wall = ConstructDefaultWall(original_map);
+
+        for(const auto& point : wall)
         {
-            if(point.x ==  cell_graph[i].ceiling[j].x && point.y >= cell_graph[i].ceiling[j].y && point.y <= cell_graph[i].floor[j].y)
-            {
-                cell_index.emplace_back(int(i));
-            }
+            wall_contour.emplace_back(cv::Point(point.x, point.y));
         }
 
+        return wall;
     }
-    return cell_index;
 }
 
-std::deque<Point2D> GetBoustrophedonPath(std::vector<CellNode>& cell_graph, CellNode cell, int corner_indicator, int robot_radius)
+// 轮廓的顶点直接交给顶点级分解, 不再光栅化成像素轮廓; 没有外墙轮廓时与ConstructWall一样以地图边框为外墙
+std::vector<CellNode> ConstructCellGraph(const cv::Mat& original_map, const std::vector<std::vector<cv::Point>>& wall_contours, const std::vector<std::vector<cv::Point>>& obstacle_contours)
 {
-    int delta, increment;
-
-    std::deque<Point2D> path;
+    if(wall_contours.empty() || wall_contours.front().empty())
+    {
+        std::vector<std::vector<cv::Point>> default_wall_contours(1);
+        ConstructWall(original_map, default_wall_contours.front());
+        return ConstructCellGraph(original_map, default_wall_contours, obstacle_contours);
+    }
 
-    std::vector<Point2D> corner_points = ComputeCellCornerPoints(cell);
+    OccupancyGrid occupancy_grid = ConstructOccupancyGrid(original_map.size(), wall_contours, obstacle_contours);
 
-    std::vector<Point2D> ceiling, floor;
-    ceiling.assign(cell.ceiling.begin(), cell.ceiling.end());
-    floor.assign(cell.floor.begin(), cell.floor.end());
+    std::vector<std::vector<Point2D>> obstacle_vertices;
+    for(const auto& obstacle_contour : obstacle_contours)
+    {
+        obstacle_vertices.emplace_back(ConstructVertices(obstacle_contour));
+    }
+    return ConstructCellGraph(occupancy_grid, ConstructVertices(wall_contours.front()), obstacle_vertices);
+}
 
-    if(cell_graph[cell.cellIndex].isCleaned)
+std::deque<std::deque<Point2D>> StaticPathPlanning(const cv::Mat& map, std::vector<CellNode>& cell_graph, const Point2D& start_point, int robot_radius, bool visualize_cells, bool visualize_path, int color_repeats=10)
+{
+    TraceSpan trace_span("StaticPathPlanning");
+    cv::Mat3b vis_map;
+    if(map.channels() == 1)
     {
-        if(corner_indicator == TOPLEFT)
-        {
-            path.emplace_back(corner_points[TOPLEFT]);
-        }
-        if(corner_indicator == TOPRIGHT)
-        {
-            path.emplace_back(corner_points[TOPRIGHT]);
-        }
-        if(corner_indicator == BOTTOMLEFT)
-        {
-            path.emplace_back(corner_points[BOTTOMLEFT]);
-        }
-        if(corner_indicator == BOTTOMRIGHT)
-        {
-            path.emplace_back(corner_points[BOTTOMRIGHT]);
-        }
+        cv::cvtColor(map, vis_map, cv::COLOR_GRAY2BGR);
     }
     else
     {
-        if(corner_indicator == TOPLEFT)
-        {
-            int x, y, y_start, y_end;
-            bool reverse = false;
-
-            for(int i = 0; i < ceiling.size(); i = i + (robot_radius+1))
-            {
-                x = ceiling[i].x;
-
-                if(!reverse)
-                {
-                    y_start = ceiling[i].y;
-                    y_end   = floor[i].y;
+        vis_map = map.clone(); // 动态规划中局部重规划传入的是三通道地图
+    }
 
-                    for(y = y_start; y <= y_end; y++)
-                    {
-                        path.emplace_back(Point2D(x, y));
-                    }
+    std::deque<std::deque<Point2D>> global_path;
+    std::deque<Point2D> local_path;
+    int corner_indicator = TOPLEFT;
 
-                    if((std::abs(floor[i+1].y-floor[i].y)>=2)&&(i+1<floor.size()))
-                    {
-                        delta = floor[i+1].y-floor[i].y;
-                        increment = delta/abs(delta);
-                        for(int k = 1; k <= abs(delta); k++)
-                        {
-                            path.emplace_back(Point2D(floor[i].x, floor[i].y + increment * (k)));
-                        }
-                    }
+    int start_cell_index = DetermineCellIndex(cell_graph, start_point).front();
 
-                    if(robot_radius != 0)
-                    {
-                        for(int j = 1; j <= robot_radius+1; j++)
-                        {
-                            // 沿着floor从左往右
-                            if( x+j >= floor.back().x)
-                            {
-                                i = i - (robot_radius - (j - 1));
-                                break;
-                            }
-
-                            //提前转
-                            else if((floor[i+(j)].y-floor[i+(j+1)].y>=2)
-                               &&(j<=robot_radius+1)
-                               &&(j+1<=robot_radius+1))
-                            {
-                                delta = floor[i+(j+1)].y-floor[i+(j)].y;
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(floor[i+(j)].x, floor[i+(j)].y+increment*(k)));
-                                }
-                            }
-                            //滞后转
-                            else if((floor[i+(j+1)].y-floor[i+(j)].y>=2)
-                                    &&(j+1<=robot_radius+1)
-                                    &&(j<=robot_radius+1))
-                            {
-                                path.emplace_back(Point2D(floor[i+(j)].x, floor[i+(j)].y));
-
-                                delta = floor[i+(j+1)].y-floor[i+(j)].y;
-
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(floor[i+(j+1)].x, cell.floor[i+(j+1)].y-abs(delta) +increment*(k)));
-                                }
-                            }
-                            else
-                            {
-                                path.emplace_back(floor[i+(j)]);
-                            }
+    std::deque<Point2D> init_path = WalkInsideCell(cell_graph[start_cell_index], start_point, ComputeCellCornerPoints(cell_graph[start_cell_index])[TOPLEFT]);
+    local_path.assign(init_path.begin(), init_path.end());
 
-                        }
-                    }
+    std::deque<CellNode> cell_path = GetVisittingPath(cell_graph, start_cell_index);
 
-                    reverse = !reverse;
-                }
-                else
-                {
-                    y_start = floor[i].y;
-                    y_end   = ceiling[i].y;
+    if(visualize_cells||visualize_path)
+    {
+        cv::namedWindow("map", cv::WINDOW_NORMAL);
+        cv::imshow("map", vis_map);
+    }
 
-                    for (y = y_start; y >= y_end; y--)
-                    {
-                        path.emplace_back(Point2D(x, y));
-                    }
-
-                    if((std::abs(ceiling[i+1].y-ceiling[i].y)>=2)&&(i+1<ceiling.size()))
-                    {
-                        delta = ceiling[i+1].y-ceiling[i].y;
-                        increment = delta/abs(delta);
-                        for(int k = 1; k <= abs(delta); k++)
-                        {
-                            path.emplace_back(Point2D(ceiling[i].x, ceiling[i].y+increment*(k)));
-                        }
-                    }
-
-                    if(robot_radius != 0)
-                    {
-                        for(int j = 1; j <= robot_radius+1; j++)
-                        {
-                            // 沿着ceiling从左往右
-                            if(x+j >= ceiling.back().x)
-                            {
-                                i = i - (robot_radius - (j - 1));
-                                break;
-                            }
-
-                            // 提前转
-                            else if((ceiling[i+(j+1)].y-ceiling[i+(j)].y>=2)
-                               &&(j+1 <= robot_radius+1)
-                               &&(j <= robot_radius+1))
-                            {
-                                delta = ceiling[i+(j+1)].y-ceiling[i+(j)].y;
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(ceiling[i+j].x, ceiling[i+j].y+increment*(k)));
-                                }
-                            }
-                            // 滞后转
-                            else if((ceiling[i+(j)].y-ceiling[i+(j+1)].y>=2)
-                                    &&(j<=robot_radius+1)
-                                    &&(j+1<=robot_radius+1))
-                            {
-                                path.emplace_back(ceiling[i+(j)]);
-
-                                delta = ceiling[i+(j+1)].y-ceiling[i+(j)].y;
-
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(ceiling[i+(j+1)].x, ceiling[i+(j+1)].y+abs(delta)+increment*(k)));
-                                }
-                            }
-                            else
-                            {
-                                path.emplace_back(ceiling[i+j]);
-                            }
-
-                        }
-                    }
-
-                    reverse = !reverse;
-                }
-            }
-        }
-
-        if(corner_indicator == TOPRIGHT)
+    if(visualize_cells)
+    {
+        std::cout<<"cell graph has "<<cell_graph.size()<<" cells."<<std::endl;
+        for(int i = 0; i < cell_graph.size(); i++)
         {
-            int x=0, y=0, y_start=0, y_end=0;
-            bool reverse = false;
-
-            for(int i = ceiling.size()-1; i >= 0; i=i-(robot_radius+1))
+            for(int j = 0; j < cell_graph[i].neighbor_indices.size(); j++)
             {
-                x = ceiling[i].x;
-
-                if(!reverse)
-                {
-                    y_start = ceiling[i].y;
-                    y_end   = floor[i].y;
-
-                    for(y = y_start; y <= y_end; y++)
-                    {
-                        path.emplace_back(Point2D(x, y));
-                    }
-
-                    if((std::abs(floor[i-1].y-floor[i].y)>=2)&&(i-1>=0))
-                    {
-                        delta = floor[i-1].y-floor[i].y;
-                        increment = delta/abs(delta);
-                        for(int k = 1; k <= abs(delta); k++)
-                        {
-                            path.emplace_back(Point2D(floor[i].x, floor[i].y+increment*(k)));
-                        }
-                    }
-
-                    if(robot_radius != 0)
-                    {
-                        for(int j = 1; j <= robot_radius+1; j++)
-                        {
-                            // 沿着floor从右往左
-                            if(x-j <= floor.front().x)
-                            {
-                                i = i + (robot_radius - (j - 1));
-                                break;
-                            }
-                            //提前转
-                            else if((floor[i-(j)].y-floor[i-(j+1)].y>=2)
-                               &&(j<=robot_radius+1)
-                               &&(j+1<=robot_radius+1))
-                            {
-                                delta = floor[i-(j+1)].y-floor[i-(j)].y;
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(floor[i-(j)].x, floor[i-(j)].y+increment*(k)));
-                                }
-                            }
-                            //滞后转
-                            else if((floor[i-(j+1)].y-floor[i-(j)].y>=2)
-                                    &&(j+1<=robot_radius+1)
-                                    &&(j<=robot_radius+1))
-                            {
-                                path.emplace_back(Point2D(floor[i-(j)].x, floor[i-(j)].y));
-
-                                delta = floor[i-(j+1)].y-floor[i-(j)].y;
-
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(floor[i-(j+1)].x, cell.floor[i-(j+1)].y-abs(delta) +increment*(k)));
-                                }
-                            }
-                            else
-                            {
-                                path.emplace_back(floor[i-(j)]);
-                            }
-                        }
-                    }
-
-                    reverse = !reverse;
-                }
-                else
-                {
-                    y_start = floor[i].y;
-                    y_end   = ceiling[i].y;
-
-                    for (y = y_start; y >= y_end; y--)
-                    {
-                        path.emplace_back(Point2D(x, y));
-                    }
-
-                    if((std::abs(ceiling[i-1].y-ceiling[i].y)>=2)&&(i-1>=0))
-                    {
-                        delta = ceiling[i-1].y-ceiling[i].y;
-                        increment = delta/abs(delta);
-                        for(int k = 1; k <= abs(delta); k++)
-                        {
-                            path.emplace_back(Point2D(ceiling[i].x, ceiling[i].y+increment*(k)));
-                        }
-                    }
-
-                    if(robot_radius != 0)
-                    {
-                        for(int j = 1; j <= robot_radius+1; j++)
-                        {
-                            // 沿着ceiling从右往左
-                            if( x-j <= ceiling.front().x)
-                            {
-                                i = i + (robot_radius - (j - 1));
-                                break;
-                            }
-                            // 提前转
-                            else if((ceiling[i-(j+1)].y-ceiling[i-(j)].y>=2)
-                               &&(j+1 <= robot_radius+1)
-                               &&(j <= robot_radius+1))
-                            {
-                                delta = ceiling[i-(j+1)].y-ceiling[i-(j)].y;
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(ceiling[i-j].x, ceiling[i-j].y+increment*(k)));
-                                }
-                            }
-                            // 滞后转
-                            else if((ceiling[i-(j)].y-ceiling[i-(j+1)].y>=2)
-                                    &&(j<=robot_radius+1)
-                                    &&(j+1<=robot_radius+1))
-                            {
-                                path.emplace_back(ceiling[i-(j)]);
-
-                                delta = ceiling[i-(j+1)].y-ceiling[i-(j)].y;
-
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(ceiling[i-(j+1)].x, ceiling[i-(j+1)].y+abs(delta)+increment*(k)));
-                                }
-                            }
-                            else
-                            {
-                                path.emplace_back(ceiling[i-j]);
-                            }
-                        }
-                    }
-
-                    reverse = !reverse;
-                }
+                std::cout<<"cell "<< i << "'s neighbor: cell "<<cell_graph[cell_graph[i].neighbor_indices[j]].cellIndex<<std::endl;
             }
         }
 
-        if(corner_indicator == BOTTOMLEFT)
+        for(const auto& cell : cell_graph)
         {
-            int x=0, y=0, y_start=0, y_end=0;
-            bool reverse = false;
-
-            for(int i = 0; i < ceiling.size(); i=i+(robot_radius+1))
-            {
-                x = ceiling[i].x;
-
-                if(!reverse)
-                {
-                    y_start = floor[i].y;
-                    y_end   = ceiling[i].y;
-
-                    for(y = y_start; y >= y_end; y--)
-                    {
-                        path.emplace_back(Point2D(x, y));
-                    }
-
-                    if((std::abs(ceiling[i+1].y-ceiling[i].y)>=2)&&(i+1<ceiling.size()))
-                    {
-                        delta = ceiling[i+1].y-ceiling[i].y;
-                        increment = delta/abs(delta);
-                        for(int k = 1; k <= abs(delta); k++)
-                        {
-                            path.emplace_back(Point2D(ceiling[i].x, ceiling[i].y+increment*(k)));
-                        }
-                    }
-
-                    if(robot_radius != 0)
-                    {
-                        for(int j = 1; j <= robot_radius+1; j++)
-                        {
-                            // 沿着ceiling从左往右
-                            if(x+j >= ceiling.back().x)
-                            {
-                                i = i - (robot_radius - (j - 1));
-                                break;
-                            }
-                            // 提前转
-                            else if((ceiling[i+(j+1)].y-ceiling[i+(j)].y>=2)
-                               &&(j+1 <= robot_radius+1)
-                               &&(j <= robot_radius+1))
-                            {
-                                delta = ceiling[i+(j+1)].y-ceiling[i+(j)].y;
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(ceiling[i+j].x, ceiling[i+j].y+increment*(k)));
-                                }
-                            }
-                                // 滞后转
-                            else if((ceiling[i+(j)].y-ceiling[i+(j+1)].y>=2)
-                                    &&(j<=robot_radius+1)
-                                    &&(j+1<=robot_radius+1))
-                            {
-                                path.emplace_back(ceiling[i+(j)]);
-
-                                delta = ceiling[i+(j+1)].y-ceiling[i+(j)].y;
-
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(ceiling[i+(j+1)].x, ceiling[i+(j+1)].y+abs(delta)+increment*(k)));
-                                }
-                            }
-                            else
-                            {
-                                path.emplace_back(ceiling[i+j]);
-                            }
-                        }
-                    }
+            DrawCells(vis_map, cell);
+            cv::imshow("map", vis_map);
+            cv::waitKey(500);
+        }
+    }
 
-                    reverse = !reverse;
-                }
-                else
-                {
-                    y_start = ceiling[i].y;
-                    y_end   = floor[i].y;
+    std::deque<cv::Scalar> JetColorMap;
+    InitializeColorMap(JetColorMap, color_repeats);
 
-                    for (y = y_start; y <= y_end; y++)
-                    {
-                        path.emplace_back(Point2D(x, y));
-                    }
+    if(visualize_path)
+    {
+        cv::circle(vis_map, cv::Point(start_point.x, start_point.y), 1, cv::Scalar(0, 0, 255), -1);
+        for(const auto& point : init_path)
+        {
+            vis_map.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
+            UpdateColorMap(JetColorMap);
+            cv::imshow("map", vis_map);
+            cv::waitKey(1);
+        }
+    }
 
-                    if((std::abs(floor[i+1].y-floor[i].y)>=2)&&(i+1<floor.size()))
-                    {
-                        delta = floor[i+1].y-floor[i].y;
-                        increment = delta/abs(delta);
-                        for(int k = 1; k <= abs(delta); k++)
-                        {
-                            path.emplace_back(Point2D(floor[i].x, floor[i].y+increment*(k)));
-                        }
-                    }
+    // 牛耕路径和连接路径在当前cell内的一段直接追加到local_path, 连接路径在下一个cell内的一段写进next_cell_path
+    std::deque<Point2D> next_cell_path;
+    Point2D curr_exit;
+    Point2D next_entrance;
 
-                    if(robot_radius != 0)
-                    {
-                        for(int j = 1; j <= robot_radius+1; j++)
-                        {
-                            // 沿着floor从左往右
-                            if(x+j >= floor.back().x)
-                            {
-                                i = i - (robot_radius - (j - 1));
-                                break;
-                            }
-
-                            //提前转
-                            else if((floor[i+(j)].y-floor[i+(j+1)].y>=2)
-                               &&(j<=robot_radius+1)
-                               &&(j+1<=robot_radius+1))
-                            {
-                                delta = floor[i+(j+1)].y-floor[i+(j)].y;
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(floor[i+(j)].x, floor[i+(j)].y+increment*(k)));
-                                }
-                            }
-                                //滞后转
-                            else if((floor[i+(j+1)].y-floor[i+(j)].y>=2)
-                                    &&(j+1<=robot_radius+1)
-                                    &&(j<=robot_radius+1))
-                            {
-                                path.emplace_back(Point2D(floor[i+(j)].x, floor[i+(j)].y));
-
-                                delta = floor[i+(j+1)].y-floor[i+(j)].y;
-
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(floor[i+(j+1)].x, cell.floor[i+(j+1)].y-abs(delta) +increment*(k)));
-                                }
-                            }
-                            else
-                            {
-                                path.emplace_back(floor[i+(j)]);
-                            }
-                        }
-                    }
+    std::deque<int> return_cell_path;
+    std::deque<Point2D> return_path;
 
-                    reverse = !reverse;
-                }
-            }
+    auto draw_path = [&](std::deque<Point2D>::const_iterator begin, std::deque<Point2D>::const_iterator end)
+    {
+        for(auto point = begin; point != end; point++)
+        {
+            vis_map.at<cv::Vec3b>(point->y, point->x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
+            UpdateColorMap(JetColorMap);
+            cv::imshow("map", vis_map);
+            cv::waitKey(1);
         }
+    };
 
-        if(corner_indicator == BOTTOMRIGHT)
+    for(int i = 0; i < cell_path.size(); i++)
+    {
+        size_t inner_begin = local_path.size();
+        GetBoustrophedonPath(cell_graph, cell_path[i], corner_indicator, robot_radius, local_path);
+        if(visualize_path)
         {
-            int x=0, y=0, y_start=0, y_end=0;
-            bool reverse = false;
-
-            for(int i = ceiling.size()-1; i >= 0; i=i-(robot_radius+1))
-            {
-                x = ceiling[i].x;
-
-                if(!reverse)
-                {
-                    y_start = floor[i].y;
-                    y_end   = ceiling[i].y;
+            draw_path(local_path.begin()+inner_begin, local_path.end());
+        }
 
-                    for(y = y_start; y >= y_end; y--)
-                    {
-                        path.emplace_back(Point2D(x, y));
-                    }
+        cell_graph[cell_path[i].cellIndex].isCleaned = true;
 
-                    if((std::abs(ceiling[i-1].y-ceiling[i].y)>=2)&&(i-1>=0))
-                    {
-                        delta = ceiling[i-1].y-ceiling[i].y;
-                        increment = delta/abs(delta);
-                        for(int k = 1; k <= abs(delta); k++)
-                        {
-                            path.emplace_back(Point2D(ceiling[i].x, ceiling[i].y+increment*(k)));
-                        }
-                    }
+        if(i < (cell_path.size()-1))
+        {
+            curr_exit = local_path.back();
+            next_entrance = FindNextEntrance(curr_exit, cell_path[i+1], corner_indicator);
 
-                    if(robot_radius != 0)
-                    {
-                        for(int j = 1; j <= robot_radius+1; j++)
-                        {
-                            // 沿着ceiling从右往左
-                            if(x-j <= ceiling.front().x)
-                            {
-                                i = i + (robot_radius - (j - 1));
-                                break;
-                            }
-                            // 提前转
-                            else if((ceiling[i-(j+1)].y-ceiling[i-(j)].y>=2)
-                               &&(j+1 <= robot_radius+1)
-                               &&(j <= robot_radius+1))
-                            {
-                                delta = ceiling[i-(j+1)].y-ceiling[i-(j)].y;
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(ceiling[i-j].x, ceiling[i-j].y+increment*(k)));
-                                }
-                            }
-                                // 滞后转
-                            else if((ceiling[i-(j)].y-ceiling[i-(j+1)].y>=2)
-                                    &&(j<=robot_radius+1)
-                                    &&(j+1<=robot_radius+1))
-                            {
-                                path.emplace_back(ceiling[i-(j)]);
-
-                                delta = ceiling[i-(j+1)].y-ceiling[i-(j)].y;
-
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(ceiling[i-(j+1)].x, ceiling[i-(j+1)].y+abs(delta)+increment*(k)));
-                                }
-                            }
-                            else
-                            {
-                                path.emplace_back(ceiling[i-j]);
-                            }
+            size_t link_begin = local_path.size();
+            next_cell_path.clear();
+            FindLinkingPath(curr_exit, next_entrance, corner_indicator, cell_path[i], cell_path[i+1], local_path, next_cell_path);
 
-                        }
-                    }
+            if(visualize_path)
+            {
+                draw_path(local_path.begin()+link_begin, local_path.end());
+                draw_path(next_cell_path.begin(), next_cell_path.end());
+            }
 
-                    reverse = !reverse;
-                }
-                else
-                {
-                    y_start = ceiling[i].y;
-                    y_end   = floor[i].y;
+            global_path.emplace_back(std::move(local_path));
+            local_path = std::move(next_cell_path);
+        }
+    }
+    global_path.emplace_back(std::move(local_path));
 
-                    for (y = y_start; y <= y_end; y++)
-                    {
-                        path.emplace_back(Point2D(x, y));
-                    }
+    if(visualize_cells||visualize_path)
+    {
+        cv::waitKey(0);
+    }
 
-                    if((std::abs(floor[i-1].y-floor[i].y)>=2)&&(i-1>=0))
-                    {
-                        delta = floor[i-1].y-floor[i].y;
-                        increment = delta/abs(delta);
-                        for(int k = 1; k <= abs(delta); k++)
-                        {
-                            path.emplace_back(Point2D(floor[i].x, floor[i].y+increment*(k)));
-                        }
-                    }
+    return global_path;
+}
 
-                    if(robot_radius != 0)
-                    {
-                        for(int j = 1; j <= robot_radius+1; j++)
-                        {
-                            // 沿着floor从右往左
-                            if(x-j <= floor.front().x)
-                            {
-                                i = i + (robot_radius - (j - 1));
-                                break;
-                            }
-                            //提前转
-                            else if((floor[i-(j)].y-floor[i-(j+1)].y>=2)
-                               &&(j<=robot_radius+1)
-                               &&(j+1<=robot_radius+1))
-                            {
-                                delta = floor[i-(j+1)].y-floor[i-(j)].y;
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(floor[i-(j)].x, floor[i-(j)].y+increment*(k)));
-                                }
-                            }
-                                //滞后转
-                            else if((floor[i-(j+1)].y-floor[i-(j)].y>=2)
-                                    &&(j+1<=robot_radius+1)
-                                    &&(j<=robot_radius+1))
-                            {
-                                path.emplace_back(Point2D(floor[i-(j)].x, floor[i-(j)].y));
-
-                                delta = floor[i-(j+1)].y-floor[i-(j)].y;
-
-                                increment = delta/abs(delta);
-                                for(int k = 0; k <= abs(delta); k++)
-                                {
-                                    path.emplace_back(Point2D(floor[i-(j+1)].x, cell.floor[i-(j+1)].y-abs(delta) +increment*(k)));
-                                }
-                            }
-                            else
-                            {
-                                path.emplace_back(floor[i-(j)]);
-                            }
+std::deque<Point2D> ReturningPathPlanning(cv::Mat& map, std::vector<CellNode>& cell_graph, const Point2D& curr_pos, const Point2D& original_pos, int robot_radius, bool visualize_path)
+{
+    std::deque<int> return_cell_path = FindShortestPath(cell_graph, curr_pos, original_pos);
+    std::deque<Point2D> returning_path;
 
-                        }
-                    }
+    if(return_cell_path.size() == 1)
+    {
+        returning_path = WalkInsideCell(cell_graph[return_cell_path.front()], curr_pos, original_pos);
+    }
+    else
+    {
+        returning_path = WalkCrossCells(cell_graph, return_cell_path, curr_pos, original_pos, robot_radius);
+    }
 
-                    reverse = !reverse;
-                }
-            }
+    if(visualize_path)
+    {
+        cv::namedWindow("map", cv::WINDOW_NORMAL);
+        for(const auto& point : returning_path)
+        {
+            map.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(250, 250, 250);
+            cv::imshow("map", map);
+            cv::waitKey(1);
         }
+        cv::waitKey(0);
     }
 
-    return path;
+    return returning_path;
 }
 
-std::vector<Event> InitializeEventList(const Polygon& polygon, int polygon_index)
+double ComputePointToSegmentDistance(const Point2D& point, const Point2D& start, const Point2D& end)
 {
-    std::vector<Event> event_list;
+    double dx = end.x - start.x;
+    double dy = end.y - start.y;
+    double length = std::sqrt(dx*dx + dy*dy);
 
-    for(const auto& point : polygon)
+    if(length == 0.0) // 首尾重合(往返路径)时退化为点到点的距离
     {
-        event_list.emplace_back(Event(polygon_index, point.x, point.y));
+        return std::sqrt(std::pow(point.x-start.x, 2) + std::pow(point.y-start.y, 2));
     }
 
-    return event_list;
+    return std::abs(dx*(point.y-start.y) - dy*(point.x-start.x)) / length;
 }
 
-void AllocateObstacleEventType(const cv::Mat& map, std::vector<Event>& event_list)
+/**
+ * Douglas-Peucker抽稀, 在FilterTrajectory之后、GetNavigationMessage之前调用, 消除斜线连接段上的像素台阶.
+ * tolerance为允许偏离原轨迹的像素数; 捷径还必须完全落在可通行区域或原轨迹上, 否则继续细分.
+ * 输出只保留折线的顶点, 相邻点不再是8邻域.
+ **/
+std::deque<Point2D> SimplifyTrajectory(const OccupancyGrid& occupancy_grid, const std::deque<Point2D>& trajectory, double tolerance=1.5)
 {
-    int index_offset;
-    std::deque<int> in_out_index_list; // 只存放各种in和out的index
-
-    int N = event_list.size();
+    if(trajectory.size() < 3)
+    {
+        return trajectory;
+    }
 
-    // determine in and out and middle
-    for(int i = 0; i < N; i++)
+    // 原轨迹上的点本身已被规划接受(如紧贴障碍物边界的ceiling/floor), 也视为可通行
+    OccupancyGrid clearance_grid = occupancy_grid;
+    for(const auto& position : trajectory)
     {
-        if(event_list[i].x < event_list[((i-1)%N+N)%N].x && event_list[i].x < event_list[((i+1)%N+N)%N].x)
-        {
-            event_list[i].event_type = IN;
-            in_out_index_list.emplace_back(i);
-        }
-        if(event_list[i].x < event_list[((i-1)%N+N)%N].x && event_list[i].x == event_list[((i+1)%N+N)%N].x && event_list[i].y < event_list[((i+1)%N+N)%N].y)
-        {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i+index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x < event_list[((i+index_offset)%N+N)%N].x && event_list[i].y < event_list[((i+index_offset)%N+N)%N].y)
-            {
-                event_list[i].event_type = IN_TOP;
-                in_out_index_list.emplace_back(i);
-            }
-        }
+        clearance_grid.SetFree(position.x, position.y);
+    }
 
-        if(event_list[i].x == event_list[((i-1)%N+N)%N].x && event_list[i].x < event_list[((i+1)%N+N)%N].x && event_list[i].y < event_list[((i-1)%N+N)%N].y)
-        {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i-index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x < event_list[((i-index_offset)%N+N)%N].x && event_list[i].y < event_list[((i-index_offset)%N+N)%N].y)
-            {
-                event_list[i].event_type = IN_TOP;
-                in_out_index_list.emplace_back(i);
-            }
-        }
+    std::vector<bool> keep(trajectory.size(), false);
+    keep.front() = true;
+    keep.back() = true;
+
+    std::vector<std::pair<int, int>> ranges = {{0, int(trajectory.size())-1}};
+
+    while(!ranges.empty())
+    {
+        int first = ranges.back().first;
+        int last = ranges.back().second;
+        ranges.pop_back();
 
-        if(event_list[i].x < event_list[((i-1)%N+N)%N].x && event_list[i].x == event_list[((i+1)%N+N)%N].x && event_list[i].y > event_list[((i+1)%N+N)%N].y)
+        if(last - first < 2)
         {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i+index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x < event_list[((i+index_offset)%N+N)%N].x && event_list[i].y > event_list[((i+index_offset)%N+N)%N].y)
-            {
-                event_list[i].event_type = IN_BOTTOM;
-                in_out_index_list.emplace_back(i);
-            }
+            continue;
         }
 
-        if(event_list[i].x == event_list[((i-1)%N+N)%N].x && event_list[i].x < event_list[((i+1)%N+N)%N].x && event_list[i].y > event_list[((i-1)%N+N)%N].y)
+        double max_distance = -1.0;
+        int split_index = (first + last) / 2;
+        for(int i = first + 1; i < last; i++)
         {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i-index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x < event_list[((i-index_offset)%N+N)%N].x && event_list[i].y > event_list[((i-index_offset)%N+N)%N].y)
+            double distance = ComputePointToSegmentDistance(trajectory[i], trajectory[first], trajectory[last]);
+            if(distance > max_distance)
             {
-                event_list[i].event_type = IN_BOTTOM;
-                in_out_index_list.emplace_back(i);
+                max_distance = distance;
+                split_index = i;
             }
         }
 
-        if(event_list[i].x == event_list[((i-1)%N+N)%N].x && event_list[i].x == event_list[((i+1)%N+N)%N].x)
+        if(max_distance <= tolerance && IsSegmentClear(clearance_grid, trajectory[first], trajectory[last]))
         {
-            event_list[i].event_type = MIDDLE;
+            continue;
         }
 
+        keep[split_index] = true;
+        ranges.emplace_back(first, split_index);
+        ranges.emplace_back(split_index, last);
+    }
 
-        if(event_list[i].x > event_list[((i-1)%N+N)%N].x && event_list[i].x > event_list[((i+1)%N+N)%N].x)
+    std::deque<Point2D> simplified_trajectory;
+    for(int i = 0; i < trajectory.size(); i++)
+    {
+        if(keep[i])
         {
-            event_list[i].event_type = OUT;
-            in_out_index_list.emplace_back(i);
+            simplified_trajectory.emplace_back(trajectory[i]);
         }
+    }
 
+    return simplified_trajectory;
+}
 
-        if(event_list[i].x == event_list[((i-1)%N+N)%N].x && event_list[i].x > event_list[((i+1)%N+N)%N].x && event_list[i].y < event_list[((i-1)%N+N)%N].y)
-        {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i-index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x > event_list[((i-index_offset)%N+N)%N].x && event_list[i].y < event_list[((i-index_offset)%N+N)%N].y)
-            {
-                event_list[i].event_type = OUT_TOP;
-                in_out_index_list.emplace_back(i);
-            }
-        }
+void VisualizeTrajectory(const cv::Mat& original_map, const std::deque<Point2D>& path, int robot_radius, int vis_mode, int time_interval=10, int colors=palette_colors)
+{
+    cv::Mat3b vis_map;
+    cv::cvtColor(original_map, vis_map, cv::COLOR_GRAY2BGR);
 
-        if(event_list[i].x > event_list[((i-1)%N+N)%N].x && event_list[i].x == event_list[((i+1)%N+N)%N].x && event_list[i].y < event_list[((i+1)%N+N)%N].y)
-        {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i+index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x > event_list[((i+index_offset)%N+N)%N].x && event_list[i].y < event_list[((i+index_offset)%N+N)%N].y)
-            {
-                event_list[i].event_type = OUT_TOP;
-                in_out_index_list.emplace_back(i);
-            }
-        }
+    cv::namedWindow("map", cv::WINDOW_NORMAL);
 
-        if(event_list[i].x == event_list[((i-1)%N+N)%N].x && event_list[i].x > event_list[((i+1)%N+N)%N].x && event_list[i].y > event_list[((i-1)%N+N)%N].y)
-        {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i-index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x > event_list[((i-index_offset)%N+N)%N].x && event_list[i].y > event_list[((i-index_offset)%N+N)%N].y)
-            {
-                event_list[i].event_type = OUT_BOTTOM;
-                in_out_index_list.emplace_back(i);
-            }
-        }
+    std::deque<cv::Scalar> JetColorMap;
+    int color_repeated_times = path.size()/colors + 1;
+    InitializeColorMap(JetColorMap, color_repeated_times);
 
+    switch (vis_mode)
+    {
+        case PATH_MODE:
+            vis_map.at<cv::Vec3b>(path.front().y, path.front().x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
+            cv::imshow("map", vis_map);
+            cv::waitKey(0);
 
-        if(event_list[i].x > event_list[((i-1)%N+N)%N].x && event_list[i].x == event_list[((i+1)%N+N)%N].x && event_list[i].y > event_list[((i+1)%N+N)%N].y)
-        {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i+index_offset)%N+N)%N].x)
+            for(const auto& position:path)
             {
-                index_offset++;
-            }
-            if(event_list[i].x > event_list[((i+index_offset)%N+N)%N].x && event_list[i].y > event_list[((i+index_offset)%N+N)%N].y)
+                vis_map.at<cv::Vec3b>(position.y, position.x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
+                UpdateColorMap(JetColorMap);
+                cv::imshow("map", vis_map);
+                cv::waitKey(time_interval);
+            }
+            break;
+        case ROBOT_MODE:
+            cv::circle(vis_map, cv::Point(path.front().x, path.front().y), robot_radius, cv::Scalar(255, 204, 153), -1);
+            cv::imshow("map", vis_map);
+            cv::waitKey(0);
+
+            for(const auto& position:path)
             {
-                event_list[i].event_type = OUT_BOTTOM;
-                in_out_index_list.emplace_back(i);
+                cv::circle(vis_map, cv::Point(position.x, position.y), robot_radius, cv::Scalar(255, 204, 153), -1);
+                cv::imshow("map", vis_map);
+                cv::waitKey(time_interval);
+
+                cv::circle(vis_map, cv::Point(position.x, position.y), robot_radius, cv::Scalar(255, 229, 204), -1);
             }
-        }
+            break;
+        default:
+            break;
     }
 
-    // determine inner
-    Point2D neighbor_point;
-    int temp_index;
+    cv::waitKey(0);
+}
 
-    for(auto in_out_index : in_out_index_list)
-    {
-        if(event_list[in_out_index].event_type == OUT)
-        {
-            neighbor_point = Point2D(event_list[in_out_index].x+1, event_list[in_out_index].y);
-            if(map.at<cv::Vec3b>(neighbor_point.y, neighbor_point.x) == cv::Vec3b(0,0,0))
-            {
-                event_list[in_out_index].event_type = INNER_OUT;
-            }
-        }
 
-        if(event_list[in_out_index].event_type == OUT_TOP)
-        {
-            neighbor_point = Point2D(event_list[in_out_index].x+1, event_list[in_out_index].y);
-            if(map.at<cv::Vec3b>(neighbor_point.y, neighbor_point.x) == cv::Vec3b(0,0,0))
-            {
-                event_list[in_out_index].event_type = INNER_OUT_TOP;
-            }
-        }
 
-        if(event_list[in_out_index].event_type == OUT_BOTTOM)
-        {
-            neighbor_point = Point2D(event_list[in_out_index].x+1, event_list[in_out_index].y);
-            if(map.at<cv::Vec3b>(neighbor_point.y, neighbor_point.x) == cv::Vec3b(0,0,0))
-            {
-                event_list[in_out_index].event_type = INNER_OUT_BOTTOM;
-            }
 
-        }
 
-        if(event_list[in_out_index].event_type == IN)
-        {
-            neighbor_point = Point2D(event_list[in_out_index].x-1, event_list[in_out_index].y);
-            if(map.at<cv::Vec3b>(neighbor_point.y, neighbor_point.x) == cv::Vec3b(0,0,0))
-            {
-                event_list[in_out_index].event_type = INNER_IN;
-            }
-        }
+/** 生成运动指令 **/
 
 
-        if(event_list[in_out_index].event_type == IN_TOP)
-        {
-            neighbor_point = Point2D(event_list[in_out_index].x-1, event_list[in_out_index].y);
-            if(map.at<cv::Vec3b>(neighbor_point.y, neighbor_point.x) == cv::Vec3b(0,0,0))
-            {
-                event_list[in_out_index].event_type = INNER_IN_TOP;
-            }
-        }
+/** 两个输入参数都需要是单位向量, 输出的偏航角为正，则是顺时针旋转，为负则是逆时针旋转 **/
+double ComputeYaw(Eigen::Vector2d curr_direction, Eigen::Vector2d base_direction)
+{
+    double yaw = std::atan2(curr_direction[1], curr_direction[0]) - std::atan2(base_direction[1], base_direction[0]);
 
-        if(event_list[in_out_index].event_type == IN_BOTTOM)
-        {
-            neighbor_point = Point2D(event_list[in_out_index].x-1, event_list[in_out_index].y);
-            if(map.at<cv::Vec3b>(neighbor_point.y, neighbor_point.x) == cv::Vec3b(0,0,0))
-            {
-                event_list[in_out_index].event_type = INNER_IN_BOTTOM;
-            }
-        }
+    if(yaw > M_PI)
+    {
+        yaw -= 2*M_PI;
     }
+    if(yaw < (-M_PI))
+    {
+        yaw += 2*M_PI;
+    }
+
+    yaw = yaw / M_PI * 180.0;
+
+    return yaw;
+}
 
-    // determine floor and ceiling
-    std::deque<int> ceiling_floor_index_list;
+/** 单位为米 **/
+double ComputeDistance(const Point2D& start, const Point2D& end, double meters_per_pix)
+{
+    double dist = std::sqrt(std::pow((end.x-start.x),2)+std::pow((end.y-start.y),2));
+    dist = dist * meters_per_pix;
+    return dist;
+}
 
-    for(int i = 0; i < in_out_index_list.size(); i++)
+class NavigationMessage
+{
+public:
+    NavigationMessage()
     {
-        if(
-                (event_list[in_out_index_list[0]].event_type==OUT
-                 ||event_list[in_out_index_list[0]].event_type==OUT_TOP
-                 ||event_list[in_out_index_list[0]].event_type==OUT_BOTTOM
-                 ||event_list[in_out_index_list[0]].event_type==INNER_OUT
-                 ||event_list[in_out_index_list[0]].event_type==INNER_OUT_TOP
-                 ||event_list[in_out_index_list[0]].event_type==INNER_OUT_BOTTOM)
-                &&
-                (event_list[in_out_index_list[1]].event_type==IN
-                 ||event_list[in_out_index_list[1]].event_type==IN_TOP
-                 ||event_list[in_out_index_list[1]].event_type==IN_BOTTOM
-                 ||event_list[in_out_index_list[1]].event_type==INNER_IN
-                 ||event_list[in_out_index_list[1]].event_type==INNER_IN_TOP
-                 ||event_list[in_out_index_list[1]].event_type==INNER_IN_BOTTOM)
-                )
-        {
-            if(in_out_index_list[0] < in_out_index_list[1])
-            {
-                for(int j = in_out_index_list[0]+1; j < in_out_index_list[1]; j++)
-                {
-                    if(event_list[j].event_type != MIDDLE)
-                    {
-                        event_list[j].event_type = FLOOR;
-                        ceiling_floor_index_list.emplace_back(j);
-                    }
-                }
-            }
-            else
-            {
-                for(int j = in_out_index_list[0]+1; j < event_list.size(); j++)
-                {
-                    if(event_list[j].event_type != MIDDLE)
-                    {
-                        event_list[j].event_type = FLOOR;
-                        ceiling_floor_index_list.emplace_back(j);
-                    }
-                }
-                for(int k = 0; k < in_out_index_list[1]; k++)
-                {
-                    if(event_list[k].event_type != MIDDLE)
-                    {
-                        event_list[k].event_type = FLOOR;
-                        ceiling_floor_index_list.emplace_back(k);
-                    }
-                }
-            }
-        }
+        foward_distance = 0.0;
+        global_yaw_angle = 0.0;
+        local_yaw_angle = 0.0;
+    }
+    void SetDistance(double dist)
+    {
+        foward_distance = dist;
+    }
+    void SetGlobalYaw(double global_yaw)
+    {
+        global_yaw_angle = global_yaw;
+    }
+    void SetLocalYaw(double local_yaw)
+    {
+        local_yaw_angle = local_yaw;
+    }
 
-        if(
-                (event_list[in_out_index_list[0]].event_type==IN
-                 ||event_list[in_out_index_list[0]].event_type==IN_TOP
-                 ||event_list[in_out_index_list[0]].event_type==IN_BOTTOM
-                 ||event_list[in_out_index_list[0]].event_type==INNER_IN
-                 ||event_list[in_out_index_list[0]].event_type==INNER_IN_TOP
-                 ||event_list[in_out_index_list[0]].event_type==INNER_IN_BOTTOM)
-                &&
-                (event_list[in_out_index_list[1]].event_type==OUT
-                 ||event_list[in_out_index_list[1]].event_type==OUT_TOP
-                 ||event_list[in_out_index_list[1]].event_type==OUT_BOTTOM
-                 ||event_list[in_out_index_list[1]].event_type==INNER_OUT
-                 ||event_list[in_out_index_list[1]].event_type==INNER_OUT_TOP
-                 ||event_list[in_out_index_list[1]].event_type==INNER_OUT_BOTTOM)
-                )
-        {
-            if(in_out_index_list[0] < in_out_index_list[1])
-            {
-                for(int j = in_out_index_list[0]+1; j < in_out_index_list[1]; j++)
-                {
-                    if(event_list[j].event_type != MIDDLE)
-                    {
-                        event_list[j].event_type = CEILING;
-                        ceiling_floor_index_list.emplace_back(j);
-                    }
-                }
-            }
-            else
-            {
-                for(int j = in_out_index_list[0]+1; j < event_list.size(); j++)
-                {
-                    if(event_list[j].event_type != MIDDLE)
-                    {
-                        event_list[j].event_type = CEILING;
-                        ceiling_floor_index_list.emplace_back(j);
-                    }
-                }
-                for(int k = 0; k < in_out_index_list[1]; k++)
-                {
-                    if(event_list[k].event_type != MIDDLE)
-                    {
-                        event_list[k].event_type = CEILING;
-                        ceiling_floor_index_list.emplace_back(k);
-                    }
-                }
-            }
-        }
+    double GetDistance()
+    {
+        return foward_distance;
+    }
 
-        temp_index = in_out_index_list.front();
-        in_out_index_list.pop_front();
-        in_out_index_list.emplace_back(temp_index);
+    double GetGlobalYaw()
+    {
+        return global_yaw_angle;
     }
 
+    double GetLocalYaw()
+    {
+        return local_yaw_angle;
+    }
 
-    // filter ceiling and floor
-    for(int i = 0; i < ceiling_floor_index_list.size()-1; i++)
+    void GetMotion(double& dist, double& global_yaw, double& local_yaw)
     {
-        if(event_list[ceiling_floor_index_list[i]].event_type==CEILING
-           && event_list[ceiling_floor_index_list[i+1]].event_type==CEILING
-           && event_list[ceiling_floor_index_list[i]].x==event_list[ceiling_floor_index_list[i+1]].x)
-        {
-            if(event_list[ceiling_floor_index_list[i]].y>event_list[ceiling_floor_index_list[i+1]].y)
-            {
-                event_list[ceiling_floor_index_list[i+1]].event_type = MIDDLE;
-            }
-            else
-            {
-                event_list[ceiling_floor_index_list[i]].event_type = MIDDLE;
-            }
-        }
-        if(event_list[ceiling_floor_index_list[i]].event_type==FLOOR
-           && event_list[ceiling_floor_index_list[i+1]].event_type==FLOOR
-           && event_list[ceiling_floor_index_list[i]].x==event_list[ceiling_floor_index_list[i+1]].x)
+        dist = foward_distance;
+        global_yaw = global_yaw_angle;
+        local_yaw = local_yaw_angle;
+    }
+    void Reset()
+    {
+        foward_distance = 0.0;
+        global_yaw_angle = 0.0;
+        local_yaw_angle = 0.0;
+    }
+
+private:
+    double foward_distance;
+    // 欧拉角表示，逆时针为正，顺时针为负
+    double global_yaw_angle;
+    double local_yaw_angle;
+};
+
+/** 8邻域单步运动的查找表, 方向编码与map_directions一致(0为向上, 顺时针递增), 用3位即可表示 **/
+class StepDirectionTable
+{
+public:
+    StepDirectionTable(double meters_per_pix)
+    {
+        const int step_offsets[8][2] = {{0,-1}, {1,-1}, {1,0}, {1,1}, {0,1}, {-1,1}, {-1,0}, {-1,-1}}; // {dx, dy}
+        Eigen::Vector2d global_base_direction = {0, -1};
+
+        for(int i = 0; i < 3; i++)
         {
-            if(event_list[ceiling_floor_index_list[i]].y<event_list[ceiling_floor_index_list[i+1]].y)
-            {
-                event_list[ceiling_floor_index_list[i+1]].event_type = MIDDLE;
-            }
-            else
+            for(int j = 0; j < 3; j++)
             {
-                event_list[ceiling_floor_index_list[i]].event_type = MIDDLE;
+                direction_codes[i][j] = -1;
             }
         }
-    }
-    if(event_list[ceiling_floor_index_list.back()].event_type==CEILING
-       && event_list[ceiling_floor_index_list.front()].event_type==CEILING
-       && event_list[ceiling_floor_index_list.back()].x==event_list[ceiling_floor_index_list.front()].x)
-    {
-        if(event_list[ceiling_floor_index_list.back()].y>event_list[ceiling_floor_index_list.front()].y)
+
+        for(int code = 0; code < 8; code++)
         {
-            event_list[ceiling_floor_index_list.front()].event_type = MIDDLE;
+            direction_codes[step_offsets[code][0]+1][step_offsets[code][1]+1] = code;
+
+            unit_directions[code] = {step_offsets[code][0], step_offsets[code][1]};
+            unit_directions[code].normalize();
+
+            global_yaws[code] = ComputeYaw(unit_directions[code], global_base_direction);
+            step_distances[code] = ComputeDistance(Point2D(step_offsets[code][0], step_offsets[code][1]), Point2D(0, 0), meters_per_pix);
         }
-        else
+
+        for(int code = 0; code < 8; code++)
         {
-            event_list[ceiling_floor_index_list.back()].event_type = MIDDLE;
+            for(int base_code = 0; base_code < 8; base_code++)
+            {
+                local_yaws[code][base_code] = ComputeYaw(unit_directions[code], unit_directions[base_code]);
+            }
         }
     }
-    if(event_list[ceiling_floor_index_list.back()].event_type==FLOOR
-       && event_list[ceiling_floor_index_list.front()].event_type==FLOOR
-       && event_list[ceiling_floor_index_list.back()].x==event_list[ceiling_floor_index_list.front()].x)
+
+    /** 返回相邻两点的方向编码, 非8邻域单步(跳跃或原地不动)返回-1 **/
+    int Encode(const Point2D& curr_pos, const Point2D& next_pos) const
     {
-        if(event_list[ceiling_floor_index_list.back()].y<event_list[ceiling_floor_index_list.front()].y)
-        {
-            event_list[ceiling_floor_index_list.front()].event_type = MIDDLE;
-        }
-        else
+        int delta_x = next_pos.x - curr_pos.x;
+        int delta_y = next_pos.y - curr_pos.y;
+
+        if(delta_x < -1 || delta_x > 1 || delta_y < -1 || delta_y > 1)
         {
-            event_list[ceiling_floor_index_list.back()].event_type = MIDDLE;
+            return -1;
         }
+        return direction_codes[delta_x+1][delta_y+1];
     }
-}
 
-void AllocateWallEventType(const cv::Mat& map, std::vector<Event>& event_list)
+    int direction_codes[3][3];  // [dx+1][dy+1]
+    Eigen::Vector2d unit_directions[8];
+    double global_yaws[8];
+    double local_yaws[8][8];    // [当前方向][上一步方向]
+    double step_distances[8];
+};
+
+/** 路径按方向编码分段, 同一段内偏航角不变, 只累加查表得到的步长; 非单步的跳跃点退回到atan2计算 **/
+std::vector<NavigationMessage> GetNavigationMessage(const Eigen::Vector2d& curr_direction, const std::deque<Point2D>& pos_path, double meters_per_pix)
 {
-    int index_offset;
-    std::deque<int> in_out_index_list; // 只存放各种in和out的index
+    // initialization
+    Eigen::Vector2d global_base_direction = {0, -1}; // {x, y}
+    Eigen::Vector2d local_base_direction = curr_direction;
+    int local_base_code = -1;
+
+    const StepDirectionTable table(meters_per_pix);
+
+    Eigen::Vector2d curr_local_direction;
+
+    NavigationMessage message;
+    std::vector<NavigationMessage> message_queue;
+
+    double distance = 0.0;
+    double step_distance = 0.0;
+
+    double prev_global_yaw = ComputeYaw(curr_direction, global_base_direction);
 
-    int N = event_list.size();
+    double curr_global_yaw = 0.0;
+    double curr_local_yaw = 0.0;
+
+    message.SetGlobalYaw(DBL_MAX);
+    message.SetLocalYaw(DBL_MAX);
 
-    // determine in and out and middle
-    for(int i = 0; i < N; i++)
+    size_t i = 0;
+    while(i + 1 < pos_path.size())
     {
-        if(event_list[i].x < event_list[((i-1)%N+N)%N].x && event_list[i].x < event_list[((i+1)%N+N)%N].x)
+        if(pos_path[i+1]==pos_path[i])
         {
-            event_list[i].event_type = IN_EX;
-            in_out_index_list.emplace_back(i);
+            i++;
+            continue;
         }
-        if(event_list[i].x < event_list[((i-1)%N+N)%N].x && event_list[i].x == event_list[((i+1)%N+N)%N].x && event_list[i].y < event_list[((i+1)%N+N)%N].y)
+
+        int code = table.Encode(pos_path[i], pos_path[i+1]);
+
+        if(code >= 0)
         {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i+index_offset)%N+N)%N].x)
+            curr_local_direction = table.unit_directions[code];
+            curr_global_yaw = table.global_yaws[code];
+            if(local_base_code >= 0)
             {
-                index_offset++;
+                curr_local_yaw = table.local_yaws[code][local_base_code];
             }
-            if(event_list[i].x < event_list[((i+index_offset)%N+N)%N].x && event_list[i].y < event_list[((i+index_offset)%N+N)%N].y)
+            else
             {
-                event_list[i].event_type = IN_TOP_EX;
-                in_out_index_list.emplace_back(i);
+                curr_local_yaw = ComputeYaw(curr_local_direction, local_base_direction);
             }
+            step_distance = table.step_distances[code];
         }
-
-        if(event_list[i].x == event_list[((i-1)%N+N)%N].x && event_list[i].x < event_list[((i+1)%N+N)%N].x && event_list[i].y < event_list[((i-1)%N+N)%N].y)
+        else
         {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i-index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x < event_list[((i-index_offset)%N+N)%N].x && event_list[i].y < event_list[((i-index_offset)%N+N)%N].y)
-            {
-                event_list[i].event_type = IN_TOP_EX;
-                in_out_index_list.emplace_back(i);
-            }
+            curr_local_direction = {pos_path[i+1].x-pos_path[i].x, pos_path[i+1].y-pos_path[i].y};
+            curr_local_direction.normalize();
+
+            curr_global_yaw = ComputeYaw(curr_local_direction, global_base_direction);
+            curr_local_yaw = ComputeYaw(curr_local_direction, local_base_direction);
+            step_distance = ComputeDistance(pos_path[i+1], pos_path[i], meters_per_pix);
         }
 
-        if(event_list[i].x < event_list[((i-1)%N+N)%N].x && event_list[i].x == event_list[((i+1)%N+N)%N].x && event_list[i].y > event_list[((i+1)%N+N)%N].y)
+        if(message.GetGlobalYaw()==DBL_MAX) // initialization
         {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i+index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x < event_list[((i+index_offset)%N+N)%N].x && event_list[i].y > event_list[((i+index_offset)%N+N)%N].y)
-            {
-                event_list[i].event_type = IN_BOTTOM_EX;
-                in_out_index_list.emplace_back(i);
-            }
+            message.SetGlobalYaw(curr_global_yaw);
         }
 
-        if(event_list[i].x == event_list[((i-1)%N+N)%N].x && event_list[i].x < event_list[((i+1)%N+N)%N].x && event_list[i].y > event_list[((i-1)%N+N)%N].y)
+        if(message.GetLocalYaw()==DBL_MAX) // initialization
         {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i-index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x < event_list[((i-index_offset)%N+N)%N].x && event_list[i].y > event_list[((i-index_offset)%N+N)%N].y)
-            {
-                event_list[i].event_type = IN_BOTTOM_EX;
-                in_out_index_list.emplace_back(i);
-            }
+            message.SetLocalYaw(curr_local_yaw);
         }
 
-        if(event_list[i].x == event_list[((i-1)%N+N)%N].x && event_list[i].x == event_list[((i+1)%N+N)%N].x)
+        if(curr_global_yaw == prev_global_yaw)
         {
-            event_list[i].event_type = MIDDLE;
+            distance += step_distance;
         }
+        else
+        {
+            message.SetDistance(distance);
+            message_queue.emplace_back(message);
 
+            message.Reset();
+            message.SetGlobalYaw(curr_global_yaw);
+            message.SetLocalYaw(curr_local_yaw);
 
-        if(event_list[i].x > event_list[((i-1)%N+N)%N].x && event_list[i].x > event_list[((i+1)%N+N)%N].x)
-        {
-            event_list[i].event_type = OUT_EX;
-            in_out_index_list.emplace_back(i);
+            distance = 0.0;
+            distance += step_distance;
         }
+        prev_global_yaw = curr_global_yaw;
 
+        local_base_direction = curr_local_direction;
+        local_base_code = code;
+        i++;
 
-        if(event_list[i].x == event_list[((i-1)%N+N)%N].x && event_list[i].x > event_list[((i+1)%N+N)%N].x && event_list[i].y < event_list[((i-1)%N+N)%N].y)
+        if(code < 0)
         {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i-index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x > event_list[((i-index_offset)%N+N)%N].x && event_list[i].y < event_list[((i-index_offset)%N+N)%N].y)
-            {
-                event_list[i].event_type = OUT_TOP_EX;
-                in_out_index_list.emplace_back(i);
-            }
+            continue;
         }
 
-        if(event_list[i].x > event_list[((i-1)%N+N)%N].x && event_list[i].x == event_list[((i+1)%N+N)%N].x && event_list[i].y < event_list[((i+1)%N+N)%N].y)
+        // 同方向的后续单步只累加距离(原地不动的重复点直接跳过)
+        while(i + 1 < pos_path.size())
         {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i+index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x > event_list[((i+index_offset)%N+N)%N].x && event_list[i].y < event_list[((i+index_offset)%N+N)%N].y)
+            if(!(pos_path[i+1]==pos_path[i]))
             {
-                event_list[i].event_type = OUT_TOP_EX;
-                in_out_index_list.emplace_back(i);
+                if(table.Encode(pos_path[i], pos_path[i+1]) != code)
+                {
+                    break;
+                }
+                distance += step_distance;
             }
+            i++;
         }
+    }
 
-        if(event_list[i].x == event_list[((i-1)%N+N)%N].x && event_list[i].x > event_list[((i+1)%N+N)%N].x && event_list[i].y > event_list[((i-1)%N+N)%N].y)
-        {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i-index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x > event_list[((i-index_offset)%N+N)%N].x && event_list[i].y > event_list[((i-index_offset)%N+N)%N].y)
-            {
-                event_list[i].event_type = OUT_BOTTOM_EX;
-                in_out_index_list.emplace_back(i);
-            }
-        }
+    message.SetDistance(distance);
+    message_queue.emplace_back(message);
 
+    return message_queue;
+}
 
-        if(event_list[i].x > event_list[((i-1)%N+N)%N].x && event_list[i].x == event_list[((i+1)%N+N)%N].x && event_list[i].y > event_list[((i+1)%N+N)%N].y)
-        {
-            index_offset = 2;
-            while(event_list[i].x == event_list[((i+index_offset)%N+N)%N].x)
-            {
-                index_offset++;
-            }
-            if(event_list[i].x > event_list[((i+index_offset)%N+N)%N].x && event_list[i].y > event_list[((i+index_offset)%N+N)%N].y)
-            {
-                event_list[i].event_type = OUT_BOTTOM_EX;
-                in_out_index_list.emplace_back(i);
-            }
-        }
-    }
-
-    // determine inner
-    Point2D neighbor_point;
-    int temp_index;
-    for(auto in_out_index : in_out_index_list)
-    {
-        if(event_list[in_out_index].event_type == OUT_EX)
-        {
-            neighbor_point = Point2D(event_list[in_out_index].x+1, event_list[in_out_index].y);
-            if(map.at<cv::Vec3b>(neighbor_point.y, neighbor_point.x) == cv::Vec3b(255,255,255) && neighbor_point.x < map.cols)
-            {
-                event_list[in_out_index].event_type = INNER_OUT_EX;
-            }
-        }
-
-        if(event_list[in_out_index].event_type == OUT_TOP_EX)
-        {
-            neighbor_point = Point2D(event_list[in_out_index].x+1, event_list[in_out_index].y);
-            if(map.at<cv::Vec3b>(neighbor_point.y, neighbor_point.x) == cv::Vec3b(255,255,255) && neighbor_point.x < map.cols)
-            {
-                event_list[in_out_index].event_type = INNER_OUT_TOP_EX;
-            }
-        }
-
-        if(event_list[in_out_index].event_type == OUT_BOTTOM_EX)
-        {
-            neighbor_point = Point2D(event_list[in_out_index].x+1, event_list[in_out_index].y);
-            if(map.at<cv::Vec3b>(neighbor_point.y, neighbor_point.x) == cv::Vec3b(255,255,255) && neighbor_point.x < map.cols)
-            {
-                event_list[in_out_index].event_type = INNER_OUT_BOTTOM_EX;
-            }
 
-        }
 
-        if(event_list[in_out_index].event_type == IN_EX)
-        {
-            neighbor_point = Point2D(event_list[in_out_index].x-1, event_list[in_out_index].y);
-            if(map.at<cv::Vec3b>(neighbor_point.y, neighbor_point.x) == cv::Vec3b(255,255,255) && neighbor_point.x>=0)
-            {
-                event_list[in_out_index].event_type = INNER_IN_EX;
-            }
-        }
+/** 路径代价模型: 直接由cell几何和车道参数估计路径长度、转弯次数、重复走过的长度和执行时间, 不生成像素路径 **/
 
+// 直线段按梯形速度曲线(匀加速、匀速、匀减速)计时, 转弯按原地匀速转向计时
+class KinematicModel
+{
+public:
+    KinematicModel(double max_speed_=0.3, double acceleration_=0.5, double turning_speed_=90.0)
+    {
+        max_speed = max_speed_;
+        acceleration = acceleration_;
+        turning_speed = turning_speed_;
+    }
 
-        if(event_list[in_out_index].event_type == IN_TOP_EX)
+    double StraightTime(double distance) const
+    {
+        if(distance <= 0.0)
         {
-            neighbor_point = Point2D(event_list[in_out_index].x-1, event_list[in_out_index].y);
-            if(map.at<cv::Vec3b>(neighbor_point.y, neighbor_point.x) == cv::Vec3b(255,255,255) && neighbor_point.x>=0)
-            {
-                event_list[in_out_index].event_type = INNER_IN_TOP_EX;
-            }
+            return 0.0;
         }
 
-        if(event_list[in_out_index].event_type == IN_BOTTOM_EX)
+        // 从静止加速到max_speed再减速到静止共需max_speed^2/acceleration的距离, 更短的直线段达不到最高速度
+        double ramp_distance = max_speed * max_speed / acceleration;
+        if(distance >= ramp_distance)
         {
-            neighbor_point = Point2D(event_list[in_out_index].x-1, event_list[in_out_index].y);
-            if(map.at<cv::Vec3b>(neighbor_point.y, neighbor_point.x) == cv::Vec3b(255,255,255) && neighbor_point.x>=0)
-            {
-                event_list[in_out_index].event_type = INNER_IN_BOTTOM_EX;
-            }
+            return distance / max_speed + max_speed / acceleration;
         }
+        return 2.0 * std::sqrt(distance / acceleration);
     }
 
-    // determine floor and ceiling
-    std::deque<int> ceiling_floor_index_list;
-
-    for(int i = 0; i < in_out_index_list.size(); i++)
+    double TurningTime(double angle) const
     {
-        if(
-                (event_list[in_out_index_list[0]].event_type==OUT_EX
-                 ||event_list[in_out_index_list[0]].event_type==OUT_TOP_EX
-                 ||event_list[in_out_index_list[0]].event_type==OUT_BOTTOM_EX
-                 ||event_list[in_out_index_list[0]].event_type==INNER_OUT_EX
-                 ||event_list[in_out_index_list[0]].event_type==INNER_OUT_TOP_EX
-                 ||event_list[in_out_index_list[0]].event_type==INNER_OUT_BOTTOM_EX)
-                &&
-                (event_list[in_out_index_list[1]].event_type==IN_EX
-                 ||event_list[in_out_index_list[1]].event_type==IN_TOP_EX
-                 ||event_list[in_out_index_list[1]].event_type==IN_BOTTOM_EX
-                 ||event_list[in_out_index_list[1]].event_type==INNER_IN_EX
-                 ||event_list[in_out_index_list[1]].event_type==INNER_IN_TOP_EX
-                 ||event_list[in_out_index_list[1]].event_type==INNER_IN_BOTTOM_EX)
-                )
-        {
-            if(in_out_index_list[0] < in_out_index_list[1])
-            {
-                for(int j = in_out_index_list[0]+1; j < in_out_index_list[1]; j++)
-                {
-                    if(event_list[j].event_type != MIDDLE)
-                    {
-                        event_list[j].event_type = CEILING;
-                        ceiling_floor_index_list.emplace_back(j);
-                    }
-                }
-            }
-            else
-            {
-                for(int j = in_out_index_list[0]+1; j < event_list.size(); j++)
-                {
-                    if(event_list[j].event_type != MIDDLE)
-                    {
-                        event_list[j].event_type = CEILING;
-                        ceiling_floor_index_list.emplace_back(j);
-                    }
-                }
-                for(int k = 0; k < in_out_index_list[1]; k++)
-                {
-                    if(event_list[k].event_type != MIDDLE)
-                    {
-                        event_list[k].event_type = CEILING;
-                        ceiling_floor_index_list.emplace_back(k);
-                    }
-                }
-            }
-        }
-
-        if(
-                (event_list[in_out_index_list[0]].event_type==IN_EX
-                 ||event_list[in_out_index_list[0]].event_type==IN_TOP_EX
-                 ||event_list[in_out_index_list[0]].event_type==IN_BOTTOM_EX
-                 ||event_list[in_out_index_list[0]].event_type==INNER_IN_EX
-                 ||event_list[in_out_index_list[0]].event_type==INNER_IN_TOP_EX
-                 ||event_list[in_out_index_list[0]].event_type==INNER_IN_BOTTOM_EX)
-                &&
-                (event_list[in_out_index_list[1]].event_type==OUT_EX
-                 ||event_list[in_out_index_list[1]].event_type==OUT_TOP_EX
-                 ||event_list[in_out_index_list[1]].event_type==OUT_BOTTOM_EX
-                 ||event_list[in_out_index_list[1]].event_type==INNER_OUT_EX
-                 ||event_list[in_out_index_list[1]].event_type==INNER_OUT_TOP_EX
-                 ||event_list[in_out_index_list[1]].event_type==INNER_OUT_BOTTOM_EX)
-                )
-        {
-            if(in_out_index_list[0] < in_out_index_list[1])
-            {
-                for(int j = in_out_index_list[0]+1; j < in_out_index_list[1]; j++)
-                {
-                    if(event_list[j].event_type != MIDDLE)
-                    {
-                        event_list[j].event_type = FLOOR;
-                        ceiling_floor_index_list.emplace_back(j);
-                    }
-                }
-            }
-            else
-            {
-                for(int j = in_out_index_list[0]+1; j < event_list.size(); j++)
-                {
-                    if(event_list[j].event_type != MIDDLE)
-                    {
-                        event_list[j].event_type = FLOOR;
-                        ceiling_floor_index_list.emplace_back(j);
-                    }
-                }
-                for(int k = 0; k < in_out_index_list[1]; k++)
-                {
-                    if(event_list[k].event_type != MIDDLE)
-                    {
-                        event_list[k].event_type = FLOOR;
-                        ceiling_floor_index_list.emplace_back(k);
-                    }
-                }
-            }
-        }
-
-        temp_index = in_out_index_list.front();
-        in_out_index_list.pop_front();
-        in_out_index_list.emplace_back(temp_index);
+        return std::abs(angle) / turning_speed;
     }
 
+    double max_speed;      // 米每秒
+    double acceleration;   // 米每二次方秒
+    double turning_speed;  // 度每秒
+};
 
-    // filter ceiling and floor
-    for(int i = 0; i < ceiling_floor_index_list.size()-1; i++)
-    {
-        if(event_list[ceiling_floor_index_list[i]].event_type==CEILING
-           && event_list[ceiling_floor_index_list[i+1]].event_type==CEILING
-           && event_list[ceiling_floor_index_list[i]].x==event_list[ceiling_floor_index_list[i+1]].x)
-        {
-            if(event_list[ceiling_floor_index_list[i]].y>event_list[ceiling_floor_index_list[i+1]].y)
-            {
-                event_list[ceiling_floor_index_list[i+1]].event_type = MIDDLE;
-            }
-            else
-            {
-                event_list[ceiling_floor_index_list[i]].event_type = MIDDLE;
-            }
-        }
-        if(event_list[ceiling_floor_index_list[i]].event_type==FLOOR
-           && event_list[ceiling_floor_index_list[i+1]].event_type==FLOOR
-           && event_list[ceiling_floor_index_list[i]].x==event_list[ceiling_floor_index_list[i+1]].x)
-        {
-            if(event_list[ceiling_floor_index_list[i]].y<event_list[ceiling_floor_index_list[i+1]].y)
-            {
-                event_list[ceiling_floor_index_list[i+1]].event_type = MIDDLE;
-            }
-            else
-            {
-                event_list[ceiling_floor_index_list[i]].event_type = MIDDLE;
-            }
-        }
-    }
-    if(event_list[ceiling_floor_index_list.back()].event_type==CEILING
-       && event_list[ceiling_floor_index_list.front()].event_type==CEILING
-       && event_list[ceiling_floor_index_list.back()].x==event_list[ceiling_floor_index_list.front()].x)
-    {
-        if(event_list[ceiling_floor_index_list.back()].y>event_list[ceiling_floor_index_list.front()].y)
-        {
-            event_list[ceiling_floor_index_list.front()].event_type = MIDDLE;
-        }
-        else
-        {
-            event_list[ceiling_floor_index_list.back()].event_type = MIDDLE;
-        }
-    }
-    if(event_list[ceiling_floor_index_list.back()].event_type==FLOOR
-       && event_list[ceiling_floor_index_list.front()].event_type==FLOOR
-       && event_list[ceiling_floor_index_list.back()].x==event_list[ceiling_floor_index_list.front()].x)
+class PathCost
+{
+public:
+    PathCost()
     {
-        if(event_list[ceiling_floor_index_list.back()].y<event_list[ceiling_floor_index_list.front()].y)
-        {
-            event_list[ceiling_floor_index_list.front()].event_type = MIDDLE;
-        }
-        else
-        {
-            event_list[ceiling_floor_index_list.back()].event_type = MIDDLE;
-        }
+        length = 0.0;
+        turn_num = 0;
+        overlap_length = 0.0;
+        time = 0.0;
     }
-}
 
-std::vector<Event> GenerateObstacleEventList(const cv::Mat& map, const PolygonList& polygons)
-{
-    std::vector<Event> event_list;
-    std::vector<Event> event_sublist;
+    double length;           // 米
+    int turn_num;
+    double overlap_length;   // 在已经走过的区域上重复行驶的长度, 米
+    double time;             // 秒
+};
 
-    for(int i = 0; i < polygons.size(); i++)
+// 两点之间先水平后竖直地走, 每段直线各转一次90度
+PathCost EstimateLinkCost(const Point2D& start, const Point2D& end, double meters_per_pix, const KinematicModel& model)
+{
+    PathCost cost;
+    int delta_x = std::abs(end.x - start.x);
+    int delta_y = std::abs(end.y - start.y);
+    if(delta_x == 0 && delta_y == 0)
     {
-        event_sublist = InitializeEventList(polygons[i], i);
-        AllocateObstacleEventType(map, event_sublist);
-        event_list.insert(event_list.end(), event_sublist.begin(), event_sublist.end());
-        event_sublist.clear();
+        return cost;
     }
 
-    std::sort(event_list.begin(), event_list.end());
-
-    return event_list;
+    cost.length = (delta_x + delta_y) * meters_per_pix;
+    cost.turn_num = (delta_x != 0 && delta_y != 0) ? 2 : 1;
+    cost.time = model.StraightTime(delta_x * meters_per_pix) + model.StraightTime(delta_y * meters_per_pix) + cost.turn_num * model.TurningTime(90.0);
+    return cost;
 }
 
-std::vector<Event> GenerateWallEventList(const cv::Mat& map, const Polygon& external_contour)
+/**
+ * 由访问顺序和AssignSweepCorners的结果估计代价, 每个cell只看车道所在的列, 复杂度与车道数成正比.
+ * 车道之间沿ceiling或floor平移(两次90度转弯), cell之间的连接按曼哈顿距离计入重复行驶的长度.
+ * 不包括从起点走到第一个cell入口的一段.
+ **/
+PathCost EstimatePathCost(const std::deque<CellNode>& cell_path, const std::vector<CellSweepPlan>& sweep_plans, int robot_radius, double meters_per_pix, const KinematicModel& model)
 {
-    std::vector<Event> event_list;
+    PathCost cost;
+    double turning_time_per_turn = model.TurningTime(90.0);
 
-    event_list = InitializeEventList(external_contour, INT_MAX);
-    AllocateWallEventType(map, event_list);
-    std::sort(event_list.begin(), event_list.end());
+    for(int i = 0; i < cell_path.size(); i++)
+    {
+        const CellNode& cell = cell_path[i];
+        const CellSweepPlan& plan = sweep_plans[i];
 
-    return event_list;
-}
+        if(!plan.is_cleaned)
+        {
+            // 压缩过的cell按下标从分段边界上取点, 不展开
+            bool is_segmented = IsSegmentedCell(cell);
+            auto ceiling_y = [&](int column){ return is_segmented ? cell.ceiling_segments[column].y : cell.ceiling[column].y; };
+            auto floor_y = [&](int column){ return is_segmented ? cell.floor_segments[column].y : cell.floor[column].y; };
 
-std::deque<std::deque<Event>> SliceListGenerator(const std::vector<Event>& wall_event_list, const std::vector<Event>& obstacle_event_list)
-{
-    std::vector<Event> event_list;
-    event_list.insert(event_list.end(), obstacle_event_list.begin(), obstacle_event_list.end());
-    event_list.insert(event_list.end(), wall_event_list.begin(), wall_event_list.end());
-    std::sort(event_list.begin(), event_list.end());
+            int column_num = CellColumnNum(cell);
+            int lane_num = ComputeBoustrophedonLaneNum(cell, robot_radius);
+            bool from_left = (plan.entry_corner == TOPLEFT || plan.entry_corner == BOTTOMLEFT);
+            bool downwards = (plan.entry_corner == TOPLEFT || plan.entry_corner == TOPRIGHT);
 
-    std::deque<std::deque<Event>> slice_list;
-    std::deque<Event> slice;
-    int x = event_list.front().x;
+            int prev_column = -1;
+            for(int lane = 0; lane < lane_num; lane++)
+            {
+                int offset = std::min(lane * (robot_radius + 1), column_num - 1);
+                int column = from_left ? offset : column_num - 1 - offset;
 
-    for(auto event : event_list)
-    {
-        if(event.x != x)
-        {
-            slice_list.emplace_back(slice);
+                if(prev_column >= 0)
+                {
+                    // 上一条车道向下走则停在floor上, 否则停在ceiling上
+                    auto edge_y = [&](int edge_column){ return downwards ? ceiling_y(edge_column) : floor_y(edge_column); };
+                    double shift_length = (std::abs(column - prev_column) + std::abs(edge_y(column) - edge_y(prev_column))) * meters_per_pix;
+                    cost.length += shift_length;
+                    cost.time += model.StraightTime(shift_length) + 2 * turning_time_per_turn;
+                    cost.turn_num += 2;
+                }
+
+                double lane_length = (floor_y(column) - ceiling_y(column)) * meters_per_pix;
+                cost.length += lane_length;
+                cost.time += model.StraightTime(lane_length);
 
-            x = event.x;
-            slice.clear();
-            slice.emplace_back(event);
+                prev_column = column;
+                downwards = !downwards;
+            }
         }
-        else
+
+        if(i < int(cell_path.size()) - 1)
         {
-            slice.emplace_back(event);
+            PathCost link_cost = EstimateLinkCost(plan.exit, sweep_plans[i+1].entrance, meters_per_pix, model);
+            cost.length += link_cost.length;
+            cost.overlap_length += link_cost.length;
+            cost.time += link_cost.time;
+            cost.turn_num += link_cost.turn_num;
         }
     }
-    slice_list.emplace_back(slice);
 
-    return slice_list;
+    return cost;
 }
 
-void ExecuteOpenOperation(std::vector<CellNode>& cell_graph, int curr_cell_idx, Point2D in, Point2D c, Point2D f, bool rewrite = false)
+// 按同一个运动学模型统计已生成路径的实际代价, 用于和EstimatePathCost对照
+PathCost MeasurePathCost(const std::deque<Point2D>& path, double meters_per_pix, const KinematicModel& model)
 {
+    PathCost cost;
 
-    CellNode top_cell, bottom_cell;
-
-    top_cell.ceiling.emplace_back(c);
-    top_cell.floor.emplace_back(in);
-
-    bottom_cell.ceiling.emplace_back(in);
-    bottom_cell.floor.emplace_back(f);
-
-    if(!rewrite)
+    Eigen::Vector2d curr_direction = {0, -1};
+    std::vector<NavigationMessage> messages = GetNavigationMessage(curr_direction, path, meters_per_pix);
+    for(int i = 0; i < messages.size(); i++)
     {
-        int top_cell_index = cell_graph.size();
-        int bottom_cell_index = cell_graph.size() + 1;
-
-        top_cell.cellIndex = top_cell_index;
-        bottom_cell.cellIndex = bottom_cell_index;
-        cell_graph.emplace_back(top_cell);
-        cell_graph.emplace_back(bottom_cell);
-
-
-        cell_graph[top_cell_index].neighbor_indices.emplace_back(curr_cell_idx);
-        cell_graph[bottom_cell_index].neighbor_indices.emplace_front(curr_cell_idx);
-
-        cell_graph[curr_cell_idx].neighbor_indices.emplace_front(top_cell_index);
-        cell_graph[curr_cell_idx].neighbor_indices.emplace_front(bottom_cell_index);
+        cost.length += messages[i].GetDistance();
+        cost.time += model.StraightTime(messages[i].GetDistance());
+        if(i > 0 && messages[i].GetLocalYaw() != 0.0)
+        {
+            cost.turn_num++;
+            cost.time += model.TurningTime(messages[i].GetLocalYaw());
+        }
     }
-    else
+
+    // 连续两点之间的线段只要再次经过已经走过的像素就计入重复行驶的长度
+    std::map<std::pair<int, int>, bool> visited;
+    for(int i = 0; i < path.size(); i++)
     {
-        cell_graph[curr_cell_idx].ceiling.assign(top_cell.ceiling.begin(), top_cell.ceiling.end());
-        cell_graph[curr_cell_idx].floor.assign(top_cell.floor.begin(), top_cell.floor.end());
+        std::pair<int, int> key(path[i].x, path[i].y);
+        if(visited[key] && i > 0 && !(path[i] == path[i-1]))
+        {
+            cost.overlap_length += ComputeDistance(path[i], path[i-1], meters_per_pix);
+        }
+        visited[key] = true;
+    }
 
-        int bottom_cell_index = cell_graph.size();
-        bottom_cell.cellIndex = bottom_cell_index;
-        cell_graph.emplace_back(bottom_cell);
+    return cost;
+}
 
-        cell_graph[cell_graph[curr_cell_idx].neighbor_indices.back()].neighbor_indices.emplace_back(bottom_cell_index);
-        cell_graph[bottom_cell_index].neighbor_indices.emplace_back(cell_graph[curr_cell_idx].neighbor_indices.back());
 
-    }
-}
+/** 多角度扫描: 把地图旋转若干角度后分别分解和规划, 取预计执行时间最短的方案, 再把路径旋转回原图坐标 **/
 
-void ExecuteCloseOperation(std::vector<CellNode>& cell_graph, int top_cell_idx, int bottom_cell_idx, Point2D c, Point2D f, bool rewrite = false)
+// 绕图像中心旋转angle度(图像坐标系下顺时针为正), from_size和to_size分别是旋转前后的图像大小
+Point2D RotatePoint(const Point2D& point, double angle, const cv::Size& from_size, const cv::Size& to_size)
 {
-    CellNode new_cell;
+    double radian = angle / 180.0 * M_PI;
+    double cos_angle = std::cos(radian);
+    double sin_angle = std::sin(radian);
 
-    new_cell.ceiling.emplace_back(c);
-    new_cell.floor.emplace_back(f);
+    double dx = (point.x + 0.5) - from_size.width / 2.0;
+    double dy = (point.y + 0.5) - from_size.height / 2.0;
 
-    if(!rewrite)
-    {
-        int new_cell_idx = cell_graph.size();
-        new_cell.cellIndex = new_cell_idx;
+    double x = cos_angle * dx - sin_angle * dy + to_size.width / 2.0;
+    double y = sin_angle * dx + cos_angle * dy + to_size.height / 2.0;
 
-        cell_graph.emplace_back(new_cell);
+    return Point2D(int(std::floor(x)), int(std::floor(y)));
+}
 
+// 旋转后的图像能完整装下原图, 原图以外的区域视为障碍物
+cv::Mat1b RotateMap(const cv::Mat1b& map, double angle)
+{
+    double radian = angle / 180.0 * M_PI;
+    double abs_cos = std::abs(std::cos(radian));
+    double abs_sin = std::abs(std::sin(radian));
 
-        cell_graph[new_cell_idx].neighbor_indices.emplace_back(top_cell_idx);
-        cell_graph[new_cell_idx].neighbor_indices.emplace_back(bottom_cell_idx);
+    cv::Size rotated_size(int(std::ceil(map.cols * abs_cos + map.rows * abs_sin)), int(std::ceil(map.cols * abs_sin + map.rows * abs_cos)));
+    cv::Mat1b rotated_map = cv::Mat1b(rotated_size.height, rotated_size.width);
 
-        cell_graph[top_cell_idx].neighbor_indices.emplace_front(new_cell_idx);
-        cell_graph[bottom_cell_idx].neighbor_indices.emplace_back(new_cell_idx);
-    }
-    else
+    for(int y = 0; y < rotated_map.rows; y++)
     {
-        cell_graph[top_cell_idx].ceiling.assign(new_cell.ceiling.begin(), new_cell.ceiling.end());
-        cell_graph[top_cell_idx].floor.assign(new_cell.floor.begin(), new_cell.floor.end());
-
-        cell_graph[top_cell_idx].neighbor_indices.emplace_back(bottom_cell_idx);
-        cell_graph[bottom_cell_idx].neighbor_indices.emplace_back(top_cell_idx);
+        for(int x = 0; x < rotated_map.cols; x++)
+        {
+            Point2D original_point = RotatePoint(Point2D(x, y), -angle, rotated_size, map.size());
+            if(original_point.x >= 0 && original_point.x < map.cols && original_point.y >= 0 && original_point.y < map.rows)
+            {
+                rotated_map(y, x) = map(original_point.y, original_point.x);
+            }
+            else
+            {
+                rotated_map(y, x) = 0;
+            }
+        }
     }
 
+    return rotated_map;
 }
 
-void ExecuteCeilOperation(std::vector<CellNode>& cell_graph, int curr_cell_idx, const Point2D& ceil_point)
+// 长度、转弯次数和执行时间由EstimatePathCost按KinematicModel估计, 只有选中的方案生成路径
+class SweepPlan
 {
-    cell_graph[curr_cell_idx].ceiling.emplace_back(ceil_point);
-}
+public:
+    SweepPlan()
+    {
+        angle = 0.0;
+        cell_num = 0;
+        lane_num = 0;
+        turn_num = 0;
+        length = 0.0;
+        estimated_time = DBL_MAX;
+        is_start_snapped = false;
+        blocked_point_num = 0;
+        is_path_generated = false;
+    }
+
+    double angle;
+    std::deque<Point2D> path; // 原图坐标, 只有is_path_generated时才有
+    int cell_num;
+    int lane_num;
+    int turn_num;
+    double length;            // 单位为米
+    double estimated_time;    // 单位为秒
+    bool is_start_snapped;    // 起点旋转后不在任何cell中, 改从最近的cell内的点出发, 即path.front()
+    int blocked_point_num;    // 旋转回原图后(含补齐的直线)离障碍物过近的点数, 不为0的方案不会被选中
+    bool is_path_generated;
+};
 
-void ExecuteFloorOperation(std::vector<CellNode>& cell_graph, int curr_cell_idx, const Point2D& floor_point)
+/**
+ * 旋转地图和把路径旋转回原图各做一次取整, 每次最多偏差约0.7个像素, 因此只要求半径robot_radius-2以内没有障碍物像素.
+ * 原图以外视为障碍物.
+ **/
+bool IsFootprintClear(const cv::Mat1b& map, const Point2D& center, int robot_radius)
 {
-    cell_graph[curr_cell_idx].floor.emplace_back(floor_point);
+    int radius = std::max(robot_radius - 2, 0);
+    for(int dy = -radius; dy <= radius; dy++)
+    {
+        for(int dx = -radius; dx <= radius; dx++)
+        {
+            if(dx*dx + dy*dy > radius*radius)
+            {
+                continue;
+            }
+            int x = center.x + dx, y = center.y + dy;
+            if(x < 0 || x >= map.cols || y < 0 || y >= map.rows || map(y, x) == 0)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
-void ExecuteOpenOperation(std::vector<CellNode>& cell_graph, int curr_cell_idx, Point2D in_top, Point2D in_bottom, Point2D c, Point2D f, bool rewrite = false)
+// 一个角度的分解结果, 估计代价后留给GenerateSweepPath使用, 不必为选中的角度重新分解
+class SweepDecomposition
 {
+public:
+    cv::Size rotated_size;
+    std::vector<CellNode> cell_graph;
+    Point2D rotated_start;
+};
 
-    CellNode top_cell, bottom_cell;
-
-    top_cell.ceiling.emplace_back(c);
-    top_cell.floor.emplace_back(in_top);
-
-    bottom_cell.ceiling.emplace_back(in_bottom);
-    bottom_cell.floor.emplace_back(f);
+// 只分解和估计代价, 不生成路径
+SweepPlan PlanSweepAtAngle(const cv::Mat1b& map, const Point2D& start, double angle, int robot_radius, double meters_per_pix,
+                           const KinematicModel& model, SweepDecomposition& decomposition)
+{
+    SweepPlan plan;
+    plan.angle = angle;
 
+    cv::Mat1b rotated_map = RotateMap(map, angle);
+    decomposition.rotated_size = rotated_map.size();
 
-    if(!rewrite)
+    std::vector<std::vector<cv::Point>> wall_contours;
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    ExtractContours(rotated_map, wall_contours, obstacle_contours, robot_radius);
+    if(wall_contours.empty())
     {
-        int top_cell_index = cell_graph.size();
-        int bottom_cell_index = cell_graph.size() + 1;
-
-        top_cell.cellIndex = top_cell_index;
-        bottom_cell.cellIndex = bottom_cell_index;
-        cell_graph.emplace_back(top_cell);
-        cell_graph.emplace_back(bottom_cell);
-
-
-        cell_graph[top_cell_index].neighbor_indices.emplace_back(curr_cell_idx);
-        cell_graph[bottom_cell_index].neighbor_indices.emplace_front(curr_cell_idx);
-
-        cell_graph[curr_cell_idx].neighbor_indices.emplace_front(top_cell_index);
-        cell_graph[curr_cell_idx].neighbor_indices.emplace_front(bottom_cell_index);
+        return plan;
     }
-    else
-    {
-        cell_graph[curr_cell_idx].ceiling.assign(top_cell.ceiling.begin(), top_cell.ceiling.end());
-        cell_graph[curr_cell_idx].floor.assign(top_cell.floor.begin(), top_cell.floor.end());
 
-        int bottom_cell_index = cell_graph.size();
-        bottom_cell.cellIndex = bottom_cell_index;
-        cell_graph.emplace_back(bottom_cell);
 
-        cell_graph[cell_graph[curr_cell_idx].neighbor_indices.back()].neighbor_indices.emplace_back(bottom_cell_index);
-        cell_graph[bottom_cell_index].neighbor_indices.emplace_back(cell_graph[curr_cell_idx].neighbor_indices.back());
+    decomposition.cell_graph = ConstructCellGraph(rotated_map, wall_contours, obstacle_contours);
+    const std::vector<CellNode>& cell_graph = decomposition.cell_graph;
+    if(cell_graph.empty())
+    {
+        return plan;
     }
 
-}
+    // 起点旋转后可能落在膨胀区域里, 此时从最近的cell内的点出发
+    Point2D& rotated_start = decomposition.rotated_start;
+    rotated_start = RotatePoint(start, angle, map.size(), rotated_map.size());
+    if(DetermineCellIndex(cell_graph, rotated_start).empty())
+    {
+        rotated_start = FindNearestCellPoint(cell_graph, rotated_start);
+        plan.is_start_snapped = true;
+    }
 
-void ExecuteInnerOpenOperation(std::vector<CellNode>& cell_graph, Point2D inner_in)
-{
-    CellNode new_cell;
+    plan.cell_num = int(cell_graph.size());
+    for(const auto& cell : cell_graph)
+    {
+        plan.lane_num += ComputeBoustrophedonLaneNum(cell, robot_radius);
+    }
 
-    new_cell.ceiling.emplace_back(inner_in);
-    new_cell.floor.emplace_back(inner_in);
+    // 与StaticPathPlanningParallel相同的访问顺序和角点分配, 加上从起点走到第一个cell左上角的一段; 长度和转弯不受旋转影响
+    int start_cell_index = DetermineCellIndex(cell_graph, rotated_start).front();
+    std::vector<CellNode> visitting_cell_graph = cell_graph;
+    std::deque<CellNode> cell_path = GetVisittingPath(visitting_cell_graph, start_cell_index);
+    std::vector<CellSweepPlan> sweep_plans = AssignSweepCorners(cell_graph, cell_path, robot_radius);
+    PathCost cost = EstimatePathCost(cell_path, sweep_plans, robot_radius, meters_per_pix, model);
+    PathCost init_cost = EstimateLinkCost(rotated_start, sweep_plans.front().entrance, meters_per_pix, model);
 
-    int new_cell_index = cell_graph.size();
+    plan.length = cost.length + init_cost.length;
+    plan.turn_num = cost.turn_num + init_cost.turn_num;
+    plan.estimated_time = cost.time + init_cost.time;
 
-    new_cell.cellIndex = new_cell_index;
-    cell_graph.emplace_back(new_cell);
+    return plan;
 }
 
-void ExecuteInnerOpenOperation(std::vector<CellNode>& cell_graph, Point2D inner_in_top, Point2D inner_in_bottom)
+// 由PlanSweepAtAngle的分解结果生成旋转回原图的路径, 并统计离障碍物过近的点数
+void GenerateSweepPath(const cv::Mat1b& map, const SweepDecomposition& decomposition, int robot_radius, SweepPlan& plan)
 {
-    CellNode new_cell;
+    std::vector<CellNode> cell_graph = decomposition.cell_graph;
+    std::deque<Point2D> rotated_path = FilterTrajectory(StaticPathPlanningParallel(cell_graph, decomposition.rotated_start, robot_radius, 1));
+    plan.is_path_generated = true;
+    double angle = plan.angle;
+    cv::Size rotated_size = decomposition.rotated_size;
 
-    new_cell.ceiling.emplace_back(inner_in_top);
-    new_cell.floor.emplace_back(inner_in_bottom);
-
-    int new_cell_index = cell_graph.size();
-
-    new_cell.cellIndex = new_cell_index;
-    cell_graph.emplace_back(new_cell);
-}
+    // 旋转回原图后相邻点可能不再相邻, 用直线补齐
+    for(const auto& point : rotated_path)
+    {
+        Point2D original_point = RotatePoint(point, -angle, rotated_size, map.size());
+        original_point.x = std::min(std::max(original_point.x, 0), map.cols-1);
+        original_point.y = std::min(std::max(original_point.y, 0), map.rows-1);
 
-void ExecuteInnerCloseOperation(std::vector<CellNode>& cell_graph, int curr_cell_idx, Point2D inner_out)
-{
-    cell_graph[curr_cell_idx].ceiling.emplace_back(inner_out);
-    cell_graph[curr_cell_idx].floor.emplace_back(inner_out);
-}
+        if(plan.path.empty())
+        {
+            plan.path.emplace_back(original_point);
+            plan.blocked_point_num += IsFootprintClear(map, original_point, robot_radius) ? 0 : 1;
+            continue;
+        }
+        if(original_point == plan.path.back())
+        {
+            continue;
+        }
 
-void ExecuteInnerCloseOperation(std::vector<CellNode>& cell_graph, int curr_cell_idx, Point2D inner_out_top, Point2D inner_out_bottom)
-{
-    cell_graph[curr_cell_idx].ceiling.emplace_back(inner_out_top);
-    cell_graph[curr_cell_idx].floor.emplace_back(inner_out_bottom);
+        cv::LineIterator line(map, cv::Point(plan.path.back().x, plan.path.back().y), cv::Point(original_point.x, original_point.y), 8);
+        line++;
+        for(int i = 1; i < line.count; i++, line++)
+        {
+            plan.path.emplace_back(Point2D(line.pos().x, line.pos().y));
+            plan.blocked_point_num += IsFootprintClear(map, plan.path.back(), robot_radius) ? 0 : 1;
+        }
+    }
 }
 
-void DrawCells(cv::Mat& map, const CellNode& cell, cv::Scalar color=cv::Scalar(100, 100, 100))
+/**
+ * 对每个候选角度在线程中独立地旋转地图、分解, 用EstimatePathCost估计执行时间, 不生成路径.
+ * 然后按估计时间从小到大只为排在前面的角度生成路径, 返回第一个旋转回原图后无碰撞的方案; 全部有碰撞时返回空方案.
+ * candidates不为空时输出所有候选方案的估计值, 其中生成过路径的方案带有路径和碰撞点数.
+ **/
+SweepPlan PlanBestSweepAngle(const cv::Mat1b& map, const Point2D& start, int robot_radius, double meters_per_pix, const std::vector<double>& angles, int thread_num,
+                             const KinematicModel& model=KinematicModel(), std::vector<SweepPlan>* candidates=nullptr)
 {
-    std::cout<<"cell "<<cell.cellIndex<<": "<<std::endl;
-    std::cout<<"cell's ceiling points: "<<cell.ceiling.size()<<std::endl;
-    std::cout<<"cell's floor points: "<<cell.floor.size()<<std::endl;
+    std::vector<SweepPlan> plans(angles.size());
+    std::vector<SweepDecomposition> decompositions(angles.size());
+    std::atomic<int> next_angle(0);
 
-    for(const auto& ceiling_point : cell.ceiling)
+    std::vector<std::thread> workers;
+    for(int i = 0; i < std::max(thread_num, 1); i++)
     {
-        map.at<cv::Vec3b>(ceiling_point.y, ceiling_point.x) = cv::Vec3b(uchar(color[0]), uchar(color[1]), uchar(color[2]));
+        workers.emplace_back([&]()
+        {
+            for(int angle_index = next_angle++; angle_index < int(angles.size()); angle_index = next_angle++)
+            {
+                plans[angle_index] = PlanSweepAtAngle(map, start, angles[angle_index], robot_radius, meters_per_pix, model, decompositions[angle_index]);
+            }
+        });
     }
-
-    for(const auto& floor_point : cell.floor)
+    for(auto& worker : workers)
     {
-        map.at<cv::Vec3b>(floor_point.y, floor_point.x) = cv::Vec3b(uchar(color[0]), uchar(color[1]), uchar(color[2]));
+        worker.join();
     }
 
-    cv::line(map, cv::Point(cell.ceiling.front().x,cell.ceiling.front().y), cv::Point(cell.floor.front().x,cell.floor.front().y), color);
-    cv::line(map, cv::Point(cell.ceiling.back().x,cell.ceiling.back().y), cv::Point(cell.floor.back().x,cell.floor.back().y), color);
-}
+    std::vector<int> plan_order(plans.size());
+    for(int i = 0; i < plan_order.size(); i++)
+    {
+        plan_order[i] = i;
+    }
+    std::stable_sort(plan_order.begin(), plan_order.end(), [&](int lhs, int rhs){ return plans[lhs].estimated_time < plans[rhs].estimated_time; });
 
-int CountCells(const std::deque<Event>& slice, int curr_idx)
-{
-    int cell_num = 0;
-    for(int i = 0; i < curr_idx; i++)
+    SweepPlan best_plan;
+    for(int plan_index : plan_order)
     {
-        if(
-              (slice[i].event_type==IN)
-           || (slice[i].event_type==IN_TOP)
-           || (slice[i].event_type==INNER_IN)
-           || (slice[i].event_type==INNER_IN_BOTTOM)
-           || (slice[i].event_type==FLOOR)
-           || (slice[i].event_type==IN_BOTTOM_EX)
-           || (slice[i].event_type==INNER_IN_EX)
-           || (slice[i].event_type==INNER_IN_TOP_EX)
-          )
+        if(plans[plan_index].estimated_time == DBL_MAX)
+        {
+            break;
+        }
+        GenerateSweepPath(map, decompositions[plan_index], robot_radius, plans[plan_index]);
+        if(plans[plan_index].blocked_point_num == 0)
         {
-            cell_num++;
+            best_plan = plans[plan_index];
+            break;
         }
     }
-    return cell_num;
-}
-
-std::deque<Event> FilterSlice(const std::deque<Event>& slice)
-{
-    std::deque<Event> filtered_slice;
 
-    for(auto event : slice)
+    if(candidates != nullptr)
     {
-        if(event.event_type!=MIDDLE && event.event_type!=UNALLOCATED)
-        {
-            filtered_slice.emplace_back(event);
-        }
+        *candidates = plans;
     }
-    return filtered_slice;
-}
 
-void ExecuteCellDecomposition(std::vector<CellNode>& cell_graph, std::vector<int>& cell_index_slice, std::vector<int>& original_cell_index_slice, const std::deque<std::deque<Event>>& slice_list)
-{
-    int curr_cell_idx = INT_MAX;
-    int top_cell_idx = INT_MAX;
-    int bottom_cell_idx = INT_MAX;
+    return best_plan;
+}
 
-    Point2D c, f;
-    int c_index = INT_MAX, f_index = INT_MAX;
-    int min_dist = INT_MAX;
 
-    int event_y = INT_MAX;
 
-    bool rewrite = false;
 
-    std::vector<int> sub_cell_index_slices;
-    std::deque<Event> curr_slice;
+/** 动态路径规划（未完成） **/
 
-    int cell_counter = 0;
 
-    for(const auto& raw_slice : slice_list)
-    {
-        curr_slice = FilterSlice(raw_slice);
+// 待重写
+const int UP = 0, UPRIGHT = 1, RIGHT = 2, DOWNRIGHT = 3, DOWN = 4, DOWNLEFT = 5, LEFT = 6, UPLEFT = 7, CENTER = 8;
+const std::vector<int> map_directions = {UP, UPRIGHT, RIGHT, DOWNRIGHT, DOWN, DOWNLEFT, LEFT, UPLEFT};
 
-        original_cell_index_slice.assign(cell_index_slice.begin(), cell_index_slice.end());
+int GetFrontDirection(const Point2D& curr_pos, const Point2D& next_pos)
+{
+    int delta_x = next_pos.x - curr_pos.x;
+    int delta_y = next_pos.y - curr_pos.y;
 
-        for(int j = 0; j < curr_slice.size(); j++)
+    if(delta_y < 0)
+    {
+        if(delta_x == 0)
         {
-            if(curr_slice[j].event_type == INNER_IN_EX)
-            {
-                event_y = curr_slice[j].y;
-                for(int k = 0; k < cell_index_slice.size(); k++)
-                {
-                    if(event_y > cell_graph[cell_index_slice[k]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
+            return UP;
+        }
+        if(delta_x < 0)
+        {
+            return UPLEFT;
+        }
+        if(delta_x > 0)
+        {
+            return UPRIGHT;
+        }
+    }
+
+    if(delta_y > 0)
+    {
+        if(delta_x == 0)
+        {
+            return DOWN;
+        }
+        if(delta_x < 0)
+        {
+            return DOWNLEFT;
+        }
+        if(delta_x > 0)
+        {
+            return DOWNRIGHT;
+        }
+    }
+
+    if(delta_y == 0)
+    {
+        if(delta_x == 0)
+        {
+            return CENTER;
+        }
+        if(delta_x < 0)
+        {
+            return LEFT;
+        }
+        if(delta_x > 0)
+        {
+            return RIGHT;
+        }
+    }
+}
+
+int GetBackDirection(int front_direction)
+{
+    if(front_direction + 4 >= map_directions.size())
+    {
+        int index_offset = front_direction + 4 - map_directions.size();
+        return map_directions[index_offset];
+    }
+    else
+    {
+        return map_directions[front_direction+4];
+    }
+}
+
+int GetLeftDirection(int front_direction)
+{
+    if(front_direction - 2 < 0)
+    {
+        int index_offset = 2 - front_direction;
+        return map_directions[map_directions.size()-index_offset];
+    }
+    else
+    {
+        return map_directions[front_direction-2];
+    }
+}
+
+int GetRightDirection(int front_direction)
+{
+    if(front_direction + 2 >= map_directions.size())
+    {
+        int index_offset = front_direction + 2 - map_directions.size();
+        return map_directions[index_offset];
+    }
+    else
+    {
+        return map_directions[front_direction+2];
+    }
+}
+
+// 模拟机器人尝试旋转, 旋转方向都是顺时针排列
+std::vector<int> GetFrontDirectionCandidates(int front_direction)
+{
+    std::vector<int> front_directions;
+
+    if(front_direction - 2 < 0)
+    {
+        int index_offset = 2 - front_direction;
+        front_directions.emplace_back(map_directions[map_directions.size()-index_offset]);
+    }
+    else
+    {
+        front_directions.emplace_back(map_directions[front_direction-2]);
+    }
+
+    if(front_direction - 1 < 0)
+    {
+        int index_offset = 1 - front_direction;
+        front_directions.emplace_back(map_directions[map_directions.size()-index_offset]);
+    }
+    else
+    {
+        front_directions.emplace_back(map_directions[front_direction-1]);
+    }
+
+    front_directions.emplace_back(map_directions[front_direction]);
+
+
+    if(front_direction + 1 >= map_directions.size())
+    {
+        int index_offset = front_direction + 1 - map_directions.size();
+        front_directions.emplace_back(map_directions[index_offset]);
+    }
+    else
+    {
+        front_directions.emplace_back(map_directions[front_direction+1]);
+    }
+
+    if(front_direction + 2 >= map_directions.size())
+    {
+        int index_offset = front_direction + 2 - map_directions.size();
+        front_directions.emplace_back(map_directions[index_offset]);
+    }
+    else
+    {
+        front_directions.emplace_back(map_directions[front_direction+2]);
+    }
+
+    return front_directions;
+}
+
+std::vector<int> GetBackDirectionCandidates(int front_direction)
+{
+    std::vector<int> back_directions;
+    int first_direction = GetRightDirection(front_direction);
+
+    for(int i = 0; i <= 4; i++)
+    {
+        if(first_direction + i >= map_directions.size())
+        {
+            int index_offset = first_direction + i - map_directions.size();
+            back_directions.emplace_back(map_directions[index_offset]);
+        }
+        else
+        {
+            back_directions.emplace_back(map_directions[first_direction + i]);
+        }
+    }
+
+    return back_directions;
+}
+
+std::vector<int> GetLeftDirectionCandidates(int front_direction)
+{
+    std::vector<int> left_directions;
+
+    for(int i = 4; i >= 0; i--)
+    {
+        if(front_direction - i < 0)
+        {
+            int index_offset = i - front_direction;
+            left_directions.emplace_back(map_directions[map_directions.size()-index_offset]);
+        }
+        else
+        {
+            left_directions.emplace_back(map_directions[front_direction-i]);
+        }
+    }
+
+    return left_directions;
+}
+
+std::vector<int> GetRightDirectionCandidates(int front_direction)
+{
+    std::vector<int> right_directions;
+
+    for(int i = 0; i <= 4; i++)
+    {
+        if(front_direction + i >= map_directions.size())
+        {
+            int index_offset = front_direction + i - map_directions.size();
+            right_directions.emplace_back(map_directions[index_offset]);
+        }
+        else
+        {
+            right_directions.emplace_back(map_directions[front_direction + i]);
+        }
+    }
+
+    return right_directions;
+}
+
+Point2D GetNextPosition(const Point2D& curr_pos, int direction, int steps)
+{
+    Point2D next_position;
+
+    switch (direction)
+    {
+        case UP:
+            next_position.x = int(curr_pos.x);
+            next_position.y = int(curr_pos.y - steps);
+            return next_position;
+        case UPRIGHT:
+            next_position.x = int(curr_pos.x + steps);
+            next_position.y = int(curr_pos.y - steps);
+            return next_position;
+        case RIGHT:
+            next_position.x = int(curr_pos.x + steps);
+            next_position.y = int(curr_pos.y);
+            return next_position;
+        case DOWNRIGHT:
+            next_position.x = int(curr_pos.x + steps);
+            next_position.y = int(curr_pos.y + steps);
+            return next_position;
+        case DOWN:
+            next_position.x = int(curr_pos.x);
+            next_position.y = int(curr_pos.y + steps);
+            return next_position;
+        case DOWNLEFT:
+            next_position.x = int(curr_pos.x - steps);
+            next_position.y = int(curr_pos.y + steps);
+            return next_position;
+        case LEFT:
+            next_position.x = int(curr_pos.x - steps);
+            next_position.y = int(curr_pos.y);
+            return next_position;
+        case UPLEFT:
+            next_position.x = int(curr_pos.x - steps);
+            next_position.y = int(curr_pos.y - steps);
+            return next_position;
+        case CENTER:
+            next_position.x = int(curr_pos.x);
+            next_position.y = int(curr_pos.y);
+            return next_position;
+        default:
+            return next_position;
+    }
+}
+
+// 模拟碰撞传感器信号
+bool CollisionOccurs(const cv::Mat& map, const Point2D& curr_pos, int detect_direction, int robot_radius)
+{
+    int obstacle_dist = INT_MAX;
+    Point2D ray_pos;
+
+    for(int i = 1; i <= (robot_radius+1); i++)
+    {
+        ray_pos = GetNextPosition(curr_pos, detect_direction, i);
+
+        if(ray_pos.x < 0 || ray_pos.y < 0 || ray_pos.x >= map.cols || ray_pos.y >= map.rows)
+        {
+            break;
+        }
+
+        if(map.at<cv::Vec3b>(ray_pos.y, ray_pos.x) == cv::Vec3b(255,255,255))
+        {
+            obstacle_dist = i;
+            break;
+        }
+    }
+
+    return (obstacle_dist == (robot_radius+1));
+}
+
+// 与map_directions顺序一致的单步偏移{dx, dy}
+const int direction_offsets[8][2] = {{0,-1}, {1,-1}, {1,0}, {1,1}, {0,1}, {-1,1}, {-1,0}, {-1,-1}};
+
+/** 方向距离表: 记录每个像素沿8个方向走到第一个障碍物(白色)像素所需的步数, 超过max_steps或先出界的记为max_steps **/
+class ClearanceMap
+{
+public:
+    ClearanceMap()
+    {
+        rows = 0;
+        cols = 0;
+        max_steps = 0;
+    }
+    int rows;
+    int cols;
+    int max_steps;
+    std::vector<std::vector<uchar>> clearance; // clearance[direction][y*cols+x]
+    OccupancyGrid occupancy_grid; // 地图中白色(障碍物)像素
+};
+
+// 按照依赖顺序(先算p+d再算p)重算矩形区域[x_min, x_max]x[y_min, y_max]内的距离
+void UpdateClearanceRegion(ClearanceMap& clearance_map, int x_min, int y_min, int x_max, int y_max)
+{
+    x_min = std::max(x_min, 0);
+    y_min = std::max(y_min, 0);
+    x_max = std::min(x_max, clearance_map.cols-1);
+    y_max = std::min(y_max, clearance_map.rows-1);
+
+    for(auto direction : map_directions)
+    {
+        int dx = direction_offsets[direction][0];
+        int dy = direction_offsets[direction][1];
+        std::vector<uchar>& clearance = clearance_map.clearance[direction];
+
+        int y_begin = (dy > 0) ? y_max : y_min;
+        int y_step = (dy > 0) ? -1 : 1;
+        int x_begin = (dx > 0) ? x_max : x_min;
+        int x_step = (dx > 0) ? -1 : 1;
+
+        for(int y = y_begin; y >= y_min && y <= y_max; y += y_step)
+        {
+            for(int x = x_begin; x >= x_min && x <= x_max; x += x_step)
+            {
+                int next_x = x + dx;
+                int next_y = y + dy;
+
+                if(next_x < 0 || next_y < 0 || next_x >= clearance_map.cols || next_y >= clearance_map.rows)
+                {
+                    clearance[y*clearance_map.cols+x] = uchar(clearance_map.max_steps);
+                }
+                else if(clearance_map.occupancy_grid.IsOccupied(next_x, next_y))
+                {
+                    clearance[y*clearance_map.cols+x] = 1;
+                }
+                else
+                {
+                    clearance[y*clearance_map.cols+x] = uchar(std::min(int(clearance[next_y*clearance_map.cols+next_x])+1, clearance_map.max_steps));
+                }
+            }
+        }
+    }
+}
+
+void BuildClearanceMap(const cv::Mat& map, ClearanceMap& clearance_map, int robot_radius)
+{
+    clearance_map.rows = map.rows;
+    clearance_map.cols = map.cols;
+    // 只需要判断是否恰好等于robot_radius+1, 因此距离截断到robot_radius+2即可
+    clearance_map.max_steps = std::min(robot_radius+2, 255);
+    clearance_map.clearance.assign(map_directions.size(), std::vector<uchar>(map.rows*map.cols, uchar(clearance_map.max_steps)));
+    clearance_map.occupancy_grid = ConstructOccupancyGrid(map, cv::Vec3b(255, 255, 255));
+
+    UpdateClearanceRegion(clearance_map, 0, 0, map.cols-1, map.rows-1);
+}
+
+// 地图中contours区域被改写后调用, 只有距离该区域不超过max_steps的像素需要重算
+void UpdateClearanceMap(const cv::Mat& map, ClearanceMap& clearance_map, const std::vector<std::vector<cv::Point>>& changed_contours)
+{
+    for(const auto& contour : changed_contours)
+    {
+        if(contour.empty())
+        {
+            continue;
+        }
+        cv::Rect bounding_box = cv::boundingRect(contour);
+        UpdateOccupancyGrid(map, clearance_map.occupancy_grid, cv::Vec3b(255, 255, 255),
+                            bounding_box.x, bounding_box.y, bounding_box.x + bounding_box.width - 1, bounding_box.y + bounding_box.height - 1);
+        UpdateClearanceRegion(clearance_map,
+                              bounding_box.x - clearance_map.max_steps,
+                              bounding_box.y - clearance_map.max_steps,
+                              bounding_box.x + bounding_box.width - 1 + clearance_map.max_steps,
+                              bounding_box.y + bounding_box.height - 1 + clearance_map.max_steps);
+    }
+}
+
+// 查表版本, 与上面逐像素射线检测的结果一致
+bool CollisionOccurs(const ClearanceMap& clearance_map, const Point2D& curr_pos, int detect_direction, int robot_radius)
+{
+    // 路径中的重复点会得到CENTER方向, 原地不动不会发生碰撞
+    if(detect_direction == CENTER)
+    {
+        return false;
+    }
+    return (clearance_map.clearance[detect_direction][curr_pos.y*clearance_map.cols+curr_pos.x] == (robot_radius+1));
+}
+
+/** 沿障碍物绕行时记录contouring_path中除最后一个点以外的所有位置, 用于O(1)判断是否回到了走过的位置 **/
+class VisitedMap
+{
+public:
+    VisitedMap(int map_rows, int map_cols)
+    {
+        rows = map_rows;
+        cols = map_cols;
+        visited.assign(map_rows*map_cols, false);
+    }
+    bool Contains(const Point2D& pos) const
+    {
+        if(pos.x < 0 || pos.y < 0 || pos.x >= cols || pos.y >= rows)
+        {
+            return false;
+        }
+        return visited[pos.y*cols+pos.x];
+    }
+    void Insert(const Point2D& pos)
+    {
+        if(pos.x < 0 || pos.y < 0 || pos.x >= cols || pos.y >= rows)
+        {
+            return;
+        }
+        visited[pos.y*cols+pos.x] = true;
+    }
+    int rows;
+    int cols;
+    std::vector<bool> visited;
+};
+
+// 新点加入后, 原来的最后一个点才算作"走过"
+void AppendContouringPosition(VisitedMap& visited_map, std::deque<Point2D>& contouring_path, const Point2D& pos)
+{
+    if(!contouring_path.empty())
+    {
+        visited_map.Insert(contouring_path.back());
+    }
+    contouring_path.emplace_back(pos);
+}
+
+// 等价于 std::find(contouring_path.begin(), contouring_path.end()-1, pos) != contouring_path.end()-1
+bool IsVisitedBefore(const VisitedMap& visited_map, const std::deque<Point2D>& contouring_path, const Point2D& pos)
+{
+    return !contouring_path.empty() && visited_map.Contains(pos);
+}
+
+// 结束返回false, 继续则返回true
+bool WalkAlongObstacle(const ClearanceMap& clearance_map, const Point2D& obstacle_origin,               const Point2D& contouring_origin,
+                       int detecting_direction,            const std::vector<int>& direction_candidates,
+                       Point2D& curr_pos,                  int first_turning_direction,                  int second_turning_direction,
+                       Polygon& obstacle,                  Polygon& new_obstacle,                        bool& isObstacleCompleted,
+                       std::deque<Point2D>& contouring_path,                                             int robot_radius,
+                       VisitedMap& visited_map)
+{
+    bool turning = false;
+    Point2D last_curr_pos = curr_pos;
+    Point2D next_pos;
+    Point2D obstacle_point;
+
+    while(!turning)
+    {
+        for (auto direction: direction_candidates)
+        {
+            next_pos = GetNextPosition(curr_pos, direction, 1);
+            if(next_pos.x < 0 || next_pos.y < 0 || next_pos.x >= clearance_map.cols || next_pos.y >= clearance_map.rows)
+            {
+                continue;
+            }
+
+            if (CollisionOccurs(clearance_map, next_pos, detecting_direction, robot_radius))
+            {
+                AppendContouringPosition(visited_map, contouring_path, next_pos);
+                curr_pos = next_pos;
+                obstacle_point = GetNextPosition(next_pos, detecting_direction, robot_radius+1);
+                if(obstacle_point.x==obstacle_origin.x && obstacle_point.y == obstacle_origin.y)
+                {
+                    if(!isObstacleCompleted)
                     {
-                        rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k])==original_cell_index_slice.end(); // 若为true，则覆盖
+                        obstacle.assign(new_obstacle.begin(), new_obstacle.end());
+                        isObstacleCompleted = true;
+                    }
+                }
+                new_obstacle.emplace_back(obstacle_point);
+                break;
+            }
+        }
+        if(curr_pos.x==last_curr_pos.x&&curr_pos.y==last_curr_pos.y)
+        {
+            turning = true;
+        }
+        else
+        {
+            last_curr_pos = curr_pos;
+        }
+
+        if(IsVisitedBefore(visited_map, contouring_path, next_pos)
+        &&contouring_path.size()>1
+        &&isObstacleCompleted)
+        {
+            return false;
+        }
+    }
+    for(int i = 1; i <= (robot_radius+1); i++)
+    {
+        next_pos = GetNextPosition(curr_pos, first_turning_direction, 1);
+        AppendContouringPosition(visited_map, contouring_path, next_pos);
+        curr_pos = next_pos;
+
+        if(IsVisitedBefore(visited_map, contouring_path, next_pos)
+        &&contouring_path.size()>1
+        &&isObstacleCompleted)
+        {
+            return false;
+        }
+    }
+    for(int i = 1; i <= (robot_radius+1); i++)
+    {
+        next_pos = GetNextPosition(curr_pos, second_turning_direction, 1);
+        AppendContouringPosition(visited_map, contouring_path, next_pos);
+        curr_pos = next_pos;
+
+        if(IsVisitedBefore(visited_map, contouring_path, next_pos)
+        &&contouring_path.size()>1
+        &&isObstacleCompleted)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+Polygon GetNewObstacle(const ClearanceMap& clearance_map, Point2D origin, int front_direction, std::deque<Point2D>& contouring_path, int robot_radius)
+{
+    TraceSpan trace_span("GetNewObstacle");
+    VisitedMap visited_map(clearance_map.rows, clearance_map.cols);
+    for(const auto& pos : contouring_path)
+    {
+        visited_map.Insert(pos);
+    }
+    AppendContouringPosition(visited_map, contouring_path, origin);
+
+    Point2D curr_pos = origin;
+
+    Point2D obstacle_point;
+    Polygon new_obstacle;
+    Polygon obstacle;
+
+    bool isObstacleCompleted = false;
+
+    int left_direction = GetLeftDirection(front_direction);
+    int right_direction = GetRightDirection(front_direction);
+    int back_direction = GetBackDirection(front_direction);
+
+    std::deque<int> direcition_list = {right_direction, front_direction, left_direction, back_direction};
+
+    std::vector<int> right_direction_candidates = GetRightDirectionCandidates(front_direction);
+    std::vector<int> front_direction_candidates = GetFrontDirectionCandidates(front_direction);
+    std::vector<int> left_direction_candidates = GetLeftDirectionCandidates(front_direction);
+    std::vector<int> back_direction_candidates = GetBackDirectionCandidates(front_direction);
+
+    std::deque<std::vector<int>> direction_candidates_list = {right_direction_candidates, front_direction_candidates, left_direction_candidates, back_direction_candidates};
+
+    obstacle_point = GetNextPosition(origin, front_direction, robot_radius+1);
+    new_obstacle.emplace_back(obstacle_point);
+
+    Point2D obstacle_origin = new_obstacle.front();
+
+    int detecting_direction;
+    int first_turning_direction;
+    int second_turning_direction;
+    int temp_direction;
 
-                        min_dist = INT_MAX;
-                        for(int m = 0; m < curr_slice.size(); m++)
-                        {
-                            if(abs(curr_slice[m].y-cell_graph[cell_index_slice[k]].ceiling.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[m].y-cell_graph[cell_index_slice[k]].ceiling.back().y);
-                                c_index = m;
-                                c = Point2D(curr_slice[m].x, curr_slice[m].y);
-                            }
-                        }
-                        curr_slice[c_index].isUsed = true;
+    bool keepContouring = true;
+    std::vector<int> direction_candidates;
+    std::vector<int> temp_direction_candidates;
 
-                        min_dist = INT_MAX;
-                        for(int n = 0; n < curr_slice.size(); n++)
-                        {
-                            if(abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y);
-                                f_index = n;
-                                f = Point2D(curr_slice[n].x, curr_slice[n].y);
-                            }
-                        }
-                        curr_slice[f_index].isUsed = true;
 
-                        curr_cell_idx = cell_index_slice[k];
-                        ExecuteOpenOperation(cell_graph, curr_cell_idx,
-                                                          Point2D(curr_slice[j].x, curr_slice[j].y),
-                                                          c,
-                                                          f,
-                                                          rewrite);
+    while(keepContouring)
+    {
+        direction_candidates = direction_candidates_list[0];
+        first_turning_direction = direcition_list[0];
+        second_turning_direction = direcition_list[1];
+        detecting_direction = direcition_list[1];
 
-                        if(!rewrite)
-                        {
-                            cell_index_slice.erase(cell_index_slice.begin()+k);
-                            sub_cell_index_slices.clear();
-                            sub_cell_index_slices = {int(cell_graph.size()-2), int(cell_graph.size()-1)};
-                            cell_index_slice.insert(cell_index_slice.begin()+k, sub_cell_index_slices.begin(), sub_cell_index_slices.end());
-                        }
-                        else
-                        {
-                            cell_index_slice.insert(cell_index_slice.begin()+k+1, int(cell_graph.size()-1));
-                        }
+        keepContouring = WalkAlongObstacle(clearance_map, obstacle_origin, origin, detecting_direction, direction_candidates, curr_pos, first_turning_direction, second_turning_direction
+                , obstacle, new_obstacle, isObstacleCompleted, contouring_path, robot_radius, visited_map);
 
-                        curr_slice[j].isUsed = true;
+        temp_direction = direcition_list.front();
+        direcition_list.pop_front();
+        direcition_list.emplace_back(temp_direction);
 
-                        break;
-                    }
-                }
-            }
-            if(curr_slice[j].event_type == INNER_OUT_EX)
-            {
-                event_y = curr_slice[j].y;
-                for(int k = 1; k < cell_index_slice.size(); k++)
-                {
-                    if(event_y > cell_graph[cell_index_slice[k-1]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
-                    {
-                        rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k-1]) == original_cell_index_slice.end();
+        temp_direction_candidates = direction_candidates_list.front();
+        direction_candidates_list.pop_front();
+        direction_candidates_list.emplace_back(temp_direction_candidates);
+    }
 
-                        min_dist = INT_MAX;
-                        for(int m = 0; m < curr_slice.size(); m++)
-                        {
-                            if(abs(curr_slice[m].y - cell_graph[cell_index_slice[k-1]].ceiling.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[m].y - cell_graph[cell_index_slice[k-1]].ceiling.back().y);
-                                c_index = m;
-                                c = Point2D(curr_slice[m].x, curr_slice[m].y);
-                            }
-                        }
-                        curr_slice[c_index].isUsed = true;
+    contouring_path.pop_front();
 
-                        min_dist = INT_MAX;
-                        for(int n = 0; n < curr_slice.size(); n++)
-                        {
-                            if(abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y);
-                                f_index = n;
-                                f = Point2D(curr_slice[n].x, curr_slice[n].y);
-                            }
-                        }
-                        curr_slice[f_index].isUsed = true;
+    return obstacle;
 
-                        top_cell_idx = cell_index_slice[k-1];
-                        bottom_cell_idx = cell_index_slice[k];
+} //考虑使用contouring path当障碍物
 
-                        ExecuteCloseOperation(cell_graph, top_cell_idx, bottom_cell_idx,
-                                                           c,
-                                                           f,
-                                                           rewrite);
+int GetCleaningDirection(const CellNode& cell, Point2D exit)
+{
+    std::vector<Point2D> corner_points = ComputeCellCornerPoints(cell);
 
-                        if(!rewrite)
-                        {
-                            cell_index_slice.erase(cell_index_slice.begin() + k - 1);
-                            cell_index_slice.erase(cell_index_slice.begin() + k - 1);
-                            cell_index_slice.insert(cell_index_slice.begin() + k - 1, int(cell_graph.size() - 1));
-                        }
-                        else
-                        {
-                            cell_index_slice.erase(cell_index_slice.begin() + k);
-                        }
+//    if(exit.x == corner_points[TOPLEFT].x && exit.y == corner_points[TOPLEFT].y)
+//    {
+//        return LEFT;
+//    }
+//    if(exit.x == corner_points[BOTTOMLEFT].x && exit.y == corner_points[BOTTOMLEFT].y)
+//    {
+//        return LEFT;
+//    }
+//    if(exit.x == corner_points[TOPRIGHT].x && exit.y == corner_points[TOPRIGHT].y)
+//    {
+//        return RIGHT;
+//    }
+//    if(exit.x == corner_points[BOTTOMRIGHT].x && exit.y == corner_points[BOTTOMRIGHT].y)
+//    {
+//        return RIGHT;
+//    }
+
+    double dist_to_left = std::abs(exit.x - corner_points[TOPLEFT].x);
+    double dist_to_right = std::abs(exit.x = corner_points[TOPRIGHT].x);
 
+    if(dist_to_left >= dist_to_right)
+    {
+        return RIGHT;
+    }
+    else
+    {
+        return LEFT;
+    }
 
-                        curr_slice[j].isUsed = true;
+}
 
-                        break;
-                    }
-                }
-            }
+// 清扫方向只分向左和向右
+std::deque<std::deque<Point2D>> LocalReplanning(cv::Mat& map, CellNode outer_cell, const PolygonList& obstacles, const Point2D& curr_pos, std::vector<CellNode>& curr_cell_graph, int cleaning_direction, int robot_radius, bool visualize_cells=false, bool visualize_path=false)
+{
+    TraceSpan trace_span("LocalReplanning");
+    ExpandCellBoundary(outer_cell);
+    //TODO: 边界判断
+    int start_x = INT_MAX;
+    int end_x = INT_MAX;
 
-            if(curr_slice[j].event_type == INNER_IN_BOTTOM_EX)
-            {
-                event_y = curr_slice[j].y;
-                for(int k = 0; k < cell_index_slice.size(); k++)
-                {
-                    if(event_y > cell_graph[cell_index_slice[k]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
-                    {
-                        rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k])==original_cell_index_slice.end();
+    if(cleaning_direction == LEFT)
+    {
+        start_x = outer_cell.ceiling.front().x;
 
-                        min_dist = INT_MAX;
-                        for(int m = 0; m < curr_slice.size(); m++)
-                        {
-                            if(abs(curr_slice[m].y - cell_graph[cell_index_slice[k]].ceiling.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[m].y - cell_graph[cell_index_slice[k]].ceiling.back().y);
-                                c_index = m;
-                                c = Point2D(curr_slice[m].x, curr_slice[m].y);
-                            }
-                        }
-                        curr_slice[c_index].isUsed = true;
+        if(curr_pos.x + 2*(robot_radius + 1) <= outer_cell.ceiling.back().x)
+        {
+            end_x =  curr_pos.x + 2*(robot_radius + 1);
+        }
+        else
+        {
+            end_x = outer_cell.ceiling.back().x;
+        }
+    }
+    if(cleaning_direction == RIGHT)
+    {
+        end_x = outer_cell.ceiling.back().x;
 
-                        min_dist = INT_MAX;
-                        for(int n = 0; n < curr_slice.size(); n++)
-                        {
-                            if(abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y);
-                                f_index = n;
-                                f = Point2D(curr_slice[n].x, curr_slice[n].y);
-                            }
-                        }
-                        curr_slice[f_index].isUsed = true;
+        if(curr_pos.x - 2*(robot_radius + 1) >= outer_cell.ceiling.front().x)
+        {
+            start_x = curr_pos.x - 2*(robot_radius + 1);
+        }
+        else
+        {
+            start_x = outer_cell.ceiling.front().x;
+        }
+    }
+    int outer_cell_start_index_offset = start_x - outer_cell.ceiling.front().x;
+    int outer_cell_end_index_offset = end_x - outer_cell.ceiling.front().x;
 
-                        curr_cell_idx = cell_index_slice[k];
-                        ExecuteOpenOperation(cell_graph, curr_cell_idx,
-                                                          Point2D(curr_slice[j-1].x, curr_slice[j-1].y),  // in top
-                                                          Point2D(curr_slice[j].x, curr_slice[j].y),      // in bottom
-                                                          c,
-                                                          f,
-                                                          rewrite);
+    CellNode inner_cell;
+    for(int i = outer_cell_start_index_offset; i <= outer_cell_end_index_offset; i++)
+    {
+        inner_cell.ceiling.emplace_back(outer_cell.ceiling[i]);
+        inner_cell.floor.emplace_back(outer_cell.floor[i]);
+    }
 
+//    curr_cell_graph = GenerateCells(map, inner_cell, obstacles);   // 这里需要改
+    std::deque<std::deque<Point2D>> replanning_path = StaticPathPlanning(map, curr_cell_graph, curr_pos, robot_radius, visualize_cells, visualize_path);
 
-                        if(!rewrite)
-                        {
-                            cell_index_slice.erase(cell_index_slice.begin() + k);
-                            sub_cell_index_slices.clear();
-                            sub_cell_index_slices = {int(cell_graph.size() - 2), int(cell_graph.size() - 1)};
-                            cell_index_slice.insert(cell_index_slice.begin() + k, sub_cell_index_slices.begin(),
-                                                    sub_cell_index_slices.end());
-                        }
-                        else
-                        {
-                            cell_index_slice.insert(cell_index_slice.begin()+k+1, int(cell_graph.size()-1));
-                        }
+    return replanning_path;
+} //回退区域需要几个r+1
 
-                        curr_slice[j-1].isUsed = true;
-                        curr_slice[j].isUsed = true;
+class ReplanningStatistics
+{
+public:
+    ReplanningStatistics()
+    {
+        replans = 0;
+        replanning_time_ms = 0.0;
+        diverged_replans = 0;
+    }
+    int replans;
+    double replanning_time_ms; // 绕障(GetNewObstacle)、局部重规划和地图更新的总耗时
+    int diverged_replans;      // 回放时与记录不一致的重规划次数: 碰撞位置或重规划结果不同, 或记录中的碰撞没有发生
+};
 
-                        break;
-                    }
-                }
-            }
+/**
+ * DynamicPathPlanning一次运行的输入和重规划结果. 碰撞点和绕障得到的障碍物轮廓取决于仿真地图,
+ * 记录下来后回放时不再需要仿真地图和ClearanceMap, 只重新执行重规划, 便于反复测量重规划耗时和比较不同版本的结果.
+ **/
+class DynamicReplanRecord
+{
+public:
+    DynamicReplanRecord()
+    {
+        path_index = 0;
+        front_direction = INT_MAX;
+    }
+    size_t path_index;                                  // 碰撞时dynamic_path中已有的点数, 回放时据此触发重规划
+    Point2D collision_point;
+    int front_direction;
+    Polygon new_obstacle;                               // GetNewObstacle绕出的障碍物轮廓
+    std::deque<Point2D> contouring_path;
+    std::deque<std::deque<Point2D>> replanning_path;    // LocalReplanning的结果
+};
 
+class DynamicPlanningLog
+{
+public:
+    DynamicPlanningLog()
+    {
+        rows = 0;
+        cols = 0;
+        robot_radius = 0;
+        returning_home = false;
+    }
+    int rows;
+    int cols;
+    int robot_radius;
+    bool returning_home;
+    std::vector<CellNode> global_cell_graph;
+    std::deque<std::deque<Point2D>> global_path;
+    std::vector<DynamicReplanRecord> replans;
+    std::deque<Point2D> dynamic_path;                   // 整次运行的输出, 回放后用来比较
+};
 
-            if(curr_slice[j].event_type == INNER_OUT_BOTTOM_EX)
-            {
-                event_y = curr_slice[j].y;
-                for(int k = 1; k < cell_index_slice.size(); k++)
-                {
-                    if(event_y > cell_graph[cell_index_slice[k-1]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
-                    {
-                        rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k-1]) == original_cell_index_slice.end();
+// 每一段都是在一个cell中的路径. recording非空时记录本次运行; replay非空时不做碰撞检测和绕障, 按记录的碰撞和障碍物轮廓重规划
+std::deque<Point2D> DynamicPathPlanning(cv::Mat& map, const std::vector<CellNode>& global_cell_graph, std::deque<std::deque<Point2D>> global_path, int robot_radius, bool returning_home, bool visualize_path, int color_repeats=10, ReplanningStatistics* statistics=nullptr,
+                                        DynamicPlanningLog* recording=nullptr, const DynamicPlanningLog* replay=nullptr)
+{
+    TraceSpan trace_span("DynamicPathPlanning");
+    std::deque<Point2D> dynamic_path;
 
-                        min_dist = INT_MAX;
-                        for(int m = 0; m < curr_slice.size(); m++)
-                        {
-                            if(abs(curr_slice[m].y - cell_graph[cell_index_slice[k-1]].ceiling.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[m].y - cell_graph[cell_index_slice[k-1]].ceiling.back().y);
-                                c_index = m;
-                                c = Point2D(curr_slice[m].x, curr_slice[m].y);
-                            }
-                        }
-                        curr_slice[c_index].isUsed = true;
+    std::deque<std::deque<Point2D>> curr_path;
+    std::deque<Point2D> curr_sub_path;
+    std::deque<Point2D> contouring_path;
 
-                        min_dist = INT_MAX;
-                        for(int n = 0; n < curr_slice.size(); n++)
-                        {
-                            if(abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y);
-                                f_index = n;
-                                f = Point2D(curr_slice[n].x, curr_slice[n].y);
-                            }
-                        }
-                        curr_slice[f_index].isUsed = true;
+    std::deque<std::deque<Point2D>> replanning_path;
+    std::deque<std::deque<Point2D>> remaining_curr_path;
 
-                        top_cell_idx = cell_index_slice[k-1];
-                        bottom_cell_idx = cell_index_slice[k];
-                        ExecuteCloseOperation(cell_graph, top_cell_idx, bottom_cell_idx,
-                                                           c,
-                                                           f,
-                                                           rewrite);
+    std::deque<Point2D> linking_path;
 
-                        if(!rewrite)
-                        {
-                            cell_index_slice.erase(cell_index_slice.begin()+k-1);
-                            cell_index_slice.erase(cell_index_slice.begin()+k-1);
-                            cell_index_slice.insert(cell_index_slice.begin()+k-1, int(cell_graph.size()-1));
-                        }
-                        else
-                        {
-                            cell_index_slice.erase(cell_index_slice.begin() + k);
-                        }
+    Point2D curr_pos;
+    Point2D next_pos;
+    Point2D curr_exit;
+
+    int front_direction;
+    int cleaning_direction;
 
-                        curr_slice[j-1].isUsed = true;
-                        curr_slice[j].isUsed = true;
+    Polygon new_obstacle;
+//    Polygon temp_new_obstacle;
 
-                        break;
-                    }
+    int curr_cell_index;
+    CellNode curr_cell;
+
+    std::vector<CellNode> curr_cell_graph;
+
+    PolygonList overall_obstacles;
+    PolygonList curr_obstacles;
+    std::vector<cv::Point> visited_obstacle_contour;
+    std::vector<std::vector<cv::Point>> visited_obstacle_contours;
+
+    std::vector<std::deque<std::deque<Point2D>>> unvisited_paths = {global_path};
+    // 局部重规划按列切分cell, 压缩过的cell先还原成逐列的边界
+    std::vector<std::vector<CellNode>> cell_graph_list = {global_cell_graph};
+    ExpandCellGraph(cell_graph_list.front());
+    std::vector<Point2D> exit_list = {global_path.back().back()};
+
+    ClearanceMap clearance_map;
+    if(replay == nullptr)
+    {
+        BuildClearanceMap(map, clearance_map, robot_radius);
+    }
+    size_t replay_index = 0;
+    const DynamicReplanRecord* replayed_record = nullptr;
+
+    if(recording != nullptr)
+    {
+        recording->rows = map.rows;
+        recording->cols = map.cols;
+        recording->robot_radius = robot_radius;
+        recording->returning_home = returning_home;
+        recording->global_cell_graph = global_cell_graph;
+        recording->global_path = global_path;
+        recording->replans.clear();
+    }
+
+    cv::Mat vismap = map.clone();
+    std::deque<cv::Scalar> JetColorMap;
+    InitializeColorMap(JetColorMap, color_repeats);
+    if(visualize_path)
+    {
+        cv::namedWindow("map", cv::WINDOW_NORMAL);
+        cv::imshow("map", vismap);
+    }
+
+
+    while(!unvisited_paths.empty() && !cell_graph_list.empty())
+    {
+        curr_path = unvisited_paths.back();
+        curr_cell_graph = cell_graph_list.back();
+
+        for(int i = 0; i < curr_path.size(); i++)
+        {
+            curr_sub_path.assign(curr_path[i].begin(), curr_path[i].end());
+
+            for(int j = 0; j < curr_sub_path.size()-1; j++)
+            {
+                curr_pos = curr_sub_path[j];
+                next_pos = curr_sub_path[j+1];
+                dynamic_path.emplace_back(curr_pos);
+
+                if(visualize_path)
+                {
+                    vismap.at<cv::Vec3b>(curr_pos.y, curr_pos.x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
+                    UpdateColorMap(JetColorMap);
+                    cv::imshow("map", vismap);
+                    cv::waitKey(1);
                 }
-            }
 
+                front_direction = GetFrontDirection(curr_pos, next_pos);
+                bool collides = (replay != nullptr)
+                                ? (replay_index < replay->replans.size() && replay->replans[replay_index].path_index == dynamic_path.size())
+                                : CollisionOccurs(clearance_map, curr_pos, front_direction, robot_radius);
+                if(collides)
+                {
+                    std::chrono::steady_clock::time_point replanning_start = std::chrono::steady_clock::now();
+                    TraceSpan replanning_span("replan", "obstacles", (long long)overall_obstacles.size());
+
+                    if(replay != nullptr)
+                    {
+                        replayed_record = &replay->replans[replay_index++];
+                        new_obstacle = replayed_record->new_obstacle;
+                        contouring_path = replayed_record->contouring_path;
+                    }
+                    else
+                    {
+                        new_obstacle = GetNewObstacle(clearance_map, curr_pos, front_direction, contouring_path, robot_radius);
+                    }
+//                    new_obstacle = GetSingleContouringArea(map, temp_new_obstacle, robot_radius);
+                    overall_obstacles.emplace_back(new_obstacle);
+
+                    if(recording != nullptr)
+                    {
+                        DynamicReplanRecord record;
+                        record.path_index = dynamic_path.size();
+                        record.collision_point = curr_pos;
+                        record.front_direction = front_direction;
+                        record.new_obstacle = new_obstacle;
+                        record.contouring_path = contouring_path;
+                        recording->replans.emplace_back(record);
+                    }
+
+                    // for debugging
+//                    for(int i = 0; i < new_obstacle.size(); i++)
+//                    {
+//                        std::cout<<"x:"<< new_obstacle[i].x <<", y:"<< new_obstacle[i].y <<std::endl;
+//                    }
+//
+//                    for(int i = 0; i < new_obstacle.size(); i++)
+//                    {
+//                        vismap.at<cv::Vec3b>(new_obstacle[i].y, new_obstacle[i].x)=cv::Vec3b(0, 255, 0);
+//                    }
+//                    for(int i = 0; i < contouring_path.size(); i++)
+//                    {
+//                        vismap.at<cv::Vec3b>(contouring_path[i].y, contouring_path[i].x)=cv::Vec3b(255, 0, 0);
+//                    }
+//                    cv::circle(map, cv::Point(contouring_path.front().x, contouring_path.front().y), 2, cv::Scalar(0, 255, 255), -1);
+//                    cv::circle(map, cv::Point(contouring_path.back().x, contouring_path.back().y), 2, cv::Scalar(255, 0, 255), -1);
+//                    PointTypeTest(map, new_obstacle);
+//                    cv::imshow("map", vismap);
+//                    cv::waitKey(0);
 
-            if(curr_slice[j].event_type == IN_EX)
-            {
-                event_y = curr_slice[j].y;
+                    dynamic_path.insert(dynamic_path.end(), contouring_path.begin(), contouring_path.end());
 
-                if(!cell_index_slice.empty())
-                {
-                    for(int k = 1; k < cell_index_slice.size(); k++)
+                    if(visualize_path)
                     {
-                        if(event_y >= cell_graph[cell_index_slice[k-1]].floor.back().y && event_y <= cell_graph[cell_index_slice[k]].ceiling.back().y)
+                        for(const auto& point : contouring_path)
                         {
-                            ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_in
-                            cell_index_slice.insert(cell_index_slice.begin()+k, int(cell_graph.size()-1));
-                            curr_slice[j].isUsed = true;
-                            break;
+                            vismap.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
+                            UpdateColorMap(JetColorMap);
+                            cv::imshow("map", vismap);
+                            cv::waitKey(1);
                         }
                     }
-                    if(event_y <= cell_graph[cell_index_slice.front()].ceiling.back().y)
-                    {
-                        ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_in
-                        cell_index_slice.insert(cell_index_slice.begin(), int(cell_graph.size()-1));
-                        curr_slice[j].isUsed = true;
-                    }
-                    if(event_y >= cell_graph[cell_index_slice.back()].floor.back().y)
-                    {
-                        ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_in
-                        cell_index_slice.insert(cell_index_slice.end(), int(cell_graph.size()-1));
-                        curr_slice[j].isUsed = true;
-                    }
-
-                }
-                else
-                {
-                    ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_in
-                    cell_index_slice.emplace_back(int(cell_graph.size()-1));
-                    curr_slice[j].isUsed = true;
-                }
 
-            }
+                    contouring_path.clear();
 
-            if(curr_slice[j].event_type == IN_BOTTOM_EX)
-            {
-                event_y = curr_slice[j].y;
+                    visited_obstacle_contour.clear();
+                    visited_obstacle_contours.clear();
 
-                if(!cell_index_slice.empty())
-                {
-                    for(int k = 1; k < cell_index_slice.size(); k++)
+                    for(const auto& point: new_obstacle)
                     {
-                        if(event_y >= cell_graph[cell_index_slice[k-1]].floor.back().y && event_y <= cell_graph[cell_index_slice[k]].ceiling.back().y)
-                        {
-
-                            ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), // inner_in_top,
-                                                         Point2D(curr_slice[j].x, curr_slice[j].y));    // inner_in_bottom
+                        visited_obstacle_contour.emplace_back(cv::Point(point.x,point.y));
+                    }
 
-                            cell_index_slice.insert(cell_index_slice.begin()+k, int(cell_graph.size()-1));
+                    visited_obstacle_contours.emplace_back(visited_obstacle_contour);
 
-                            curr_slice[j-1].isUsed = true;
-                            curr_slice[j].isUsed = true;
+                    curr_cell_index = DetermineCellIndex(curr_cell_graph, curr_pos).front();
+                    curr_cell = curr_cell_graph[curr_cell_index];
+                    curr_obstacles={new_obstacle};
+                    curr_exit = curr_sub_path.back();
 
-                            break;
-                        }
-                    }
-                    if(event_y <= cell_graph[cell_index_slice.front()].ceiling.back().y)
-                    {
+                    // for debugging
+//                    DrawCells(map, curr_cell, cv::Scalar(255, 0, 255));
+//                    vismap.at<cv::Vec3b>(curr_exit.y, curr_exit.x)=cv::Vec3b(0,255,255);
+//                    cv::imshow("map", vismap);
+//                    cv::waitKey(0);
 
-                        ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), // inner_in_top,
-                                                     Point2D(curr_slice[j].x, curr_slice[j].y));    // inner_in_bottom
+                    cleaning_direction = GetCleaningDirection(curr_cell, curr_exit);
 
-                        cell_index_slice.insert(cell_index_slice.begin(), int(cell_graph.size()-1));
+                    replanning_path = LocalReplanning(map, curr_cell, curr_obstacles, dynamic_path.back(), curr_cell_graph, cleaning_direction, robot_radius, false, false); // 此处会更新curr_cell_graph
+                    cv::fillPoly(map, visited_obstacle_contours, cv::Scalar(50, 50, 50));
+                    if(replay == nullptr)
+                    {
+                        UpdateClearanceMap(map, clearance_map, visited_obstacle_contours);
+                    }
+                    cv::fillPoly(vismap, visited_obstacle_contours, cv::Scalar(50, 50, 50));
 
-                        curr_slice[j-1].isUsed = true;
-                        curr_slice[j].isUsed = true;
+                    if(recording != nullptr)
+                    {
+                        recording->replans.back().replanning_path = replanning_path;
                     }
-                    if(event_y >= cell_graph[cell_index_slice.back()].floor.back().y)
+                    if(replay != nullptr && statistics != nullptr
+                       && (replayed_record->collision_point != curr_pos || replayed_record->front_direction != front_direction
+                           || replayed_record->replanning_path != replanning_path))
                     {
+                        statistics->diverged_replans++;
+                    }
 
-                        ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), // inner_in_top,
-                                                     Point2D(curr_slice[j].x, curr_slice[j].y));    // inner_in_bottom
-
-                        cell_index_slice.insert(cell_index_slice.end(), int(cell_graph.size()-1));
+                    remaining_curr_path.assign(curr_path.begin()+i+1, curr_path.end());
 
-                        curr_slice[j-1].isUsed = true;
-                        curr_slice[j].isUsed = true;
+                    if(statistics != nullptr)
+                    {
+                        statistics->replans++;
+                        statistics->replanning_time_ms += ElapsedMilliseconds(replanning_start);
                     }
-                }
-                else
-                {
-                    ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), // inner_in_top,
-                                                 Point2D(curr_slice[j].x, curr_slice[j].y));    // inner_in_bottom
 
-                    cell_index_slice.emplace_back(int(cell_graph.size()-1));
-
-                    curr_slice[j-1].isUsed = true;
-                    curr_slice[j].isUsed = true;
+                    goto UPDATING_REMAINING_PATHS;
                 }
-
             }
+        }
 
+        if(dynamic_path.back().x != exit_list.back().x && dynamic_path.back().y != exit_list.back().y)
+        {
+            linking_path = ReturningPathPlanning(map, cell_graph_list.back(), dynamic_path.back(), exit_list.back(), robot_radius, false);
+            dynamic_path.insert(dynamic_path.end(), linking_path.begin(), linking_path.end());
 
-            if(curr_slice[j].event_type == OUT_EX)
+            if(visualize_path)
             {
-                event_y = curr_slice[j].y;
-
-                for(int k = 0; k < cell_index_slice.size(); k++)
+                for(const auto& point : linking_path)
                 {
-                    if(event_y >= cell_graph[cell_index_slice[k]].ceiling.back().y && event_y <= cell_graph[cell_index_slice[k]].floor.back().y)
-                    {
-                        curr_cell_idx = cell_index_slice[k];
-                        ExecuteInnerCloseOperation(cell_graph, curr_cell_idx, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_out
-                        cell_index_slice.erase(cell_index_slice.begin()+k);
-                        curr_slice[j].isUsed = true;
-                        break;
-                    }
+                    vismap.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
+                    UpdateColorMap(JetColorMap);
+                    cv::imshow("map", vismap);
+                    cv::waitKey(1);
                 }
             }
+        }
 
-            if(curr_slice[j].event_type == OUT_BOTTOM_EX)
-            {
-                event_y = curr_slice[j].y;
-
-                for(int k = 0; k < cell_index_slice.size(); k++)
-                {
-                    if(event_y >= cell_graph[cell_index_slice[k]].ceiling.back().y && event_y <= cell_graph[cell_index_slice[k]].floor.back().y)
-                    {
-                        curr_cell_idx = cell_index_slice[k];
-                        ExecuteInnerCloseOperation(cell_graph, curr_cell_idx, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_out_top, inner_out_bottom
-                        cell_index_slice.erase(cell_index_slice.begin()+k);
-                        curr_slice[j-1].isUsed = true;
-                        curr_slice[j].isUsed = true;
-                        break;
-                    }
-                }
-            }
+        exit_list.pop_back();
+        unvisited_paths.pop_back();
+        cell_graph_list.pop_back();
+        continue;
 
-        }
+        UPDATING_REMAINING_PATHS:
+        exit_list.emplace_back(curr_exit);
+        unvisited_paths.pop_back();
+        unvisited_paths.emplace_back(remaining_curr_path);
+        unvisited_paths.emplace_back(replanning_path);
+        cell_graph_list.emplace_back(curr_cell_graph);
+    }
 
+    if(returning_home)
+    {
+        cv::Mat3b returning_map = cv::Mat3b(map.size(), CV_8U);
+        returning_map.setTo(cv::Scalar(0, 0, 0));
+        std::vector<cv::Point> returning_obstacle_contour;
+        std::vector<std::vector<cv::Point>> returning_obstacle_contours;
 
-        for(int j = 0; j < curr_slice.size(); j++)
+        for(const auto& obstacle: overall_obstacles)
         {
-            if(curr_slice[j].event_type == IN)
+            for(const auto& point : obstacle)
             {
-                event_y = curr_slice[j].y;
-                for(int k = 0; k < cell_index_slice.size(); k++)
-                {
-                    if(event_y > cell_graph[cell_index_slice[k]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
-                    {
-                        rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k])==original_cell_index_slice.end(); // 若为true，则覆盖
-
-                        min_dist = INT_MAX;
-                        for(int m = 0; m < curr_slice.size(); m++)
-                        {
-                            if(abs(curr_slice[m].y-cell_graph[cell_index_slice[k]].ceiling.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[m].y-cell_graph[cell_index_slice[k]].ceiling.back().y);
-                                c_index = m;
-                                c = Point2D(curr_slice[m].x, curr_slice[m].y);
-                            }
-                        }
-                        curr_slice[c_index].isUsed = true;
-
-                        min_dist = INT_MAX;
-                        for(int n = 0; n < curr_slice.size(); n++)
-                        {
-                            if(abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y);
-                                f_index = n;
-                                f = Point2D(curr_slice[n].x, curr_slice[n].y);
-                            }
-                        }
-                        curr_slice[f_index].isUsed = true;
-
-                        curr_cell_idx = cell_index_slice[k];
-                        ExecuteOpenOperation(cell_graph, curr_cell_idx,
-                                             Point2D(curr_slice[j].x, curr_slice[j].y),
-                                             c,
-                                             f,
-                                             rewrite);
-
-                        if(!rewrite)
-                        {
-                            cell_index_slice.erase(cell_index_slice.begin()+k);
-                            sub_cell_index_slices.clear();
-                            sub_cell_index_slices = {int(cell_graph.size()-2), int(cell_graph.size()-1)};
-                            cell_index_slice.insert(cell_index_slice.begin()+k, sub_cell_index_slices.begin(), sub_cell_index_slices.end());
-                        }
-                        else
-                        {
-                            cell_index_slice.insert(cell_index_slice.begin()+k+1, int(cell_graph.size()-1));
-                        }
-
-                        curr_slice[j].isUsed = true;
-
-                        break;
-                    }
-                }
+                returning_obstacle_contour.emplace_back(cv::Point(point.x,point.y));
             }
-            if(curr_slice[j].event_type == OUT)
-            {
-                event_y = curr_slice[j].y;
-                for(int k = 1; k < cell_index_slice.size(); k++)
-                {
-                    if(event_y > cell_graph[cell_index_slice[k-1]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
-                    {
-                        rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k-1]) == original_cell_index_slice.end();
-
-                        min_dist = INT_MAX;
-                        for(int m = 0; m < curr_slice.size(); m++)
-                        {
-                            if(abs(curr_slice[m].y - cell_graph[cell_index_slice[k-1]].ceiling.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[m].y - cell_graph[cell_index_slice[k-1]].ceiling.back().y);
-                                c_index = m;
-                                c = Point2D(curr_slice[m].x, curr_slice[m].y);
-                            }
-                        }
-                        curr_slice[c_index].isUsed = true;
-
-                        min_dist = INT_MAX;
-                        for(int n = 0; n < curr_slice.size(); n++)
-                        {
-                            if(abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y);
-                                f_index = n;
-                                f = Point2D(curr_slice[n].x, curr_slice[n].y);
-                            }
-                        }
-                        curr_slice[f_index].isUsed = true;
-
-                        top_cell_idx = cell_index_slice[k-1];
-                        bottom_cell_idx = cell_index_slice[k];
+            returning_obstacle_contours.emplace_back(returning_obstacle_contour);
+            returning_obstacle_contour.clear();
+        }
 
-                        ExecuteCloseOperation(cell_graph, top_cell_idx, bottom_cell_idx,
-                                              c,
-                                              f,
-                                              rewrite);
+        cv::fillPoly(returning_map, returning_obstacle_contours, cv::Scalar(255, 255, 255));
 
-                        if(!rewrite)
-                        {
-                            cell_index_slice.erase(cell_index_slice.begin() + k - 1);
-                            cell_index_slice.erase(cell_index_slice.begin() + k - 1);
-                            cell_index_slice.insert(cell_index_slice.begin() + k - 1, int(cell_graph.size() - 1));
-                        }
-                        else
-                        {
-                            cell_index_slice.erase(cell_index_slice.begin() + k);
-                        }
+        Polygon returning_map_border = ConstructDefaultWall(returning_map);
+//        std::vector<CellNode> returning_cell_graph = GenerateCells(returning_map, returning_map_border, overall_obstacles);//这里需要改
+        std::vector<CellNode> returning_cell_graph; //这里需要改
 
+        // for debugging
+//        for(auto cell:returning_cell_graph)
+//        {
+//            DrawCells(vismap, cell, cv::Scalar(0, 255, 255));
+//            cv::imshow("map", vismap);
+//            cv::waitKey(0);
+//        }
+        //
 
-                        curr_slice[j].isUsed = true;
+        for(auto cell : returning_cell_graph)
+        {
+            cell.isCleaned = true;
+        }
 
-                        break;
-                    }
-                }
-            }
+        std::deque<Point2D> returning_path = ReturningPathPlanning(returning_map, returning_cell_graph, dynamic_path.back(), dynamic_path.front(), robot_radius, false);
 
-            if(curr_slice[j].event_type == IN_BOTTOM)
+        if(visualize_path)
+        {
+            for(const auto& point : returning_path)
             {
-                event_y = curr_slice[j].y;
-                for(int k = 0; k < cell_index_slice.size(); k++)
-                {
-                    if(event_y > cell_graph[cell_index_slice[k]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
-                    {
-                        rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k])==original_cell_index_slice.end();
-
-                        min_dist = INT_MAX;
-                        for(int m = 0; m < curr_slice.size(); m++)
-                        {
-                            if(abs(curr_slice[m].y - cell_graph[cell_index_slice[k]].ceiling.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[m].y - cell_graph[cell_index_slice[k]].ceiling.back().y);
-                                c_index = m;
-                                c = Point2D(curr_slice[m].x, curr_slice[m].y);
-                            }
-                        }
-                        curr_slice[c_index].isUsed = true;
+                vismap.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(250,250,250);
+                cv::imshow("map", vismap);
+                cv::waitKey(1);
+            }
+        }
 
-                        min_dist = INT_MAX;
-                        for(int n = 0; n < curr_slice.size(); n++)
-                        {
-                            if(abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y);
-                                f_index = n;
-                                f = Point2D(curr_slice[n].x, curr_slice[n].y);
-                            }
-                        }
-                        curr_slice[f_index].isUsed = true;
+        dynamic_path.insert(dynamic_path.end(), returning_path.begin(), returning_path.end());
+    }
 
-                        curr_cell_idx = cell_index_slice[k];
-                        ExecuteOpenOperation(cell_graph, curr_cell_idx,
-                                             Point2D(curr_slice[j-1].x, curr_slice[j-1].y),  // in top
-                                             Point2D(curr_slice[j].x, curr_slice[j].y),      // in bottom
-                                             c,
-                                             f,
-                                             rewrite);
+    if(visualize_path)
+    {
+        cv::waitKey(5000);
+    }
 
+    if(recording != nullptr)
+    {
+        recording->dynamic_path = dynamic_path;
+    }
+    if(replay != nullptr && statistics != nullptr)
+    {
+        statistics->diverged_replans += int(replay->replans.size() - replay_index);
+    }
 
-                        if(!rewrite)
-                        {
-                            cell_index_slice.erase(cell_index_slice.begin() + k);
-                            sub_cell_index_slices.clear();
-                            sub_cell_index_slices = {int(cell_graph.size() - 2), int(cell_graph.size() - 1)};
-                            cell_index_slice.insert(cell_index_slice.begin() + k, sub_cell_index_slices.begin(),
-                                                    sub_cell_index_slices.end());
-                        }
-                        else
-                        {
-                            cell_index_slice.insert(cell_index_slice.begin()+k+1, int(cell_graph.size()-1));
-                        }
+    return dynamic_path;
+}
 
-                        curr_slice[j-1].isUsed = true;
-                        curr_slice[j].isUsed = true;
+/**
+ * 记录文件为文本, 按空白分隔: 每条点序列写成"点数 起点x 起点y 段数 (dx dy 重复次数)...",
+ * 相邻点的位移相同则合并成一段, 牛耕路径和逐列的cell边界大多只有很少几段.
+ **/
+template<typename PointSequence>
+void WriteRunLengthPoints(std::ostream& output, const PointSequence& points)
+{
+    output<<points.size();
+    if(points.empty())
+    {
+        output<<"\n";
+        return;
+    }
 
-                        break;
-                    }
-                }
-            }
+    std::vector<int> runs;  // 每段三个数: dx dy count
+    for(size_t i = 1; i < points.size(); i++)
+    {
+        int dx = points[i].x - points[i-1].x;
+        int dy = points[i].y - points[i-1].y;
+        if(!runs.empty() && runs[runs.size()-3] == dx && runs[runs.size()-2] == dy)
+        {
+            runs.back()++;
+        }
+        else
+        {
+            runs.insert(runs.end(), {dx, dy, 1});
+        }
+    }
 
+    output<<" "<<points.front().x<<" "<<points.front().y<<" "<<runs.size()/3;
+    for(int value : runs)
+    {
+        output<<" "<<value;
+    }
+    output<<"\n";
+}
 
-            if(curr_slice[j].event_type == OUT_BOTTOM)
-            {
-                event_y = curr_slice[j].y;
-                for(int k = 1; k < cell_index_slice.size(); k++)
-                {
-                    if(event_y > cell_graph[cell_index_slice[k-1]].ceiling.back().y && event_y < cell_graph[cell_index_slice[k]].floor.back().y)
-                    {
-                        rewrite = std::find(original_cell_index_slice.begin(), original_cell_index_slice.end(), cell_index_slice[k-1]) == original_cell_index_slice.end();
+// 点数超过max_point_num时返回false, 损坏的日志不会按文件里的数目分配内存
+template<typename PointSequence>
+bool ReadRunLengthPoints(std::istream& input, PointSequence& points, size_t max_point_num)
+{
+    points.clear();
+    size_t point_num = 0;
+    if(!(input>>point_num) || point_num > max_point_num)
+    {
+        return false;
+    }
+    if(point_num == 0)
+    {
+        return true;
+    }
 
-                        min_dist = INT_MAX;
-                        for(int m = 0; m < curr_slice.size(); m++)
-                        {
-                            if(abs(curr_slice[m].y - cell_graph[cell_index_slice[k-1]].ceiling.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[m].y - cell_graph[cell_index_slice[k-1]].ceiling.back().y);
-                                c_index = m;
-                                c = Point2D(curr_slice[m].x, curr_slice[m].y);
-                            }
-                        }
-                        curr_slice[c_index].isUsed = true;
+    Point2D point;
+    size_t run_num = 0;
+    if(!(input>>point.x>>point.y>>run_num) || run_num >= point_num)
+    {
+        return false;
+    }
+    points.emplace_back(point);
+    for(size_t i = 0; i < run_num; i++)
+    {
+        int dx, dy, count;
+        if(!(input>>dx>>dy>>count) || count <= 0 || points.size() + count > point_num)
+        {
+            return false;
+        }
+        for(int k = 0; k < count; k++)
+        {
+            point.x += dx;
+            point.y += dy;
+            points.emplace_back(point);
+        }
+    }
+    return points.size() == point_num;
+}
 
-                        min_dist = INT_MAX;
-                        for(int n = 0; n < curr_slice.size(); n++)
-                        {
-                            if(abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y)<min_dist)
-                            {
-                                min_dist = abs(curr_slice[n].y - cell_graph[cell_index_slice[k]].floor.back().y);
-                                f_index = n;
-                                f = Point2D(curr_slice[n].x, curr_slice[n].y);
-                            }
-                        }
-                        curr_slice[f_index].isUsed = true;
+void WritePathSegments(std::ostream& output, const std::deque<std::deque<Point2D>>& path)
+{
+    output<<path.size()<<"\n";
+    for(const auto& segment : path)
+    {
+        WriteRunLengthPoints(output, segment);
+    }
+}
 
-                        top_cell_idx = cell_index_slice[k-1];
-                        bottom_cell_idx = cell_index_slice[k];
-                        ExecuteCloseOperation(cell_graph, top_cell_idx, bottom_cell_idx,
-                                              c,
-                                              f,
-                                              rewrite);
+bool ReadPathSegments(std::istream& input, std::deque<std::deque<Point2D>>& path, size_t max_point_num)
+{
+    path.clear();
+    size_t segment_num = 0;
+    if(!(input>>segment_num) || segment_num > max_point_num)
+    {
+        return false;
+    }
+    for(size_t i = 0; i < segment_num; i++)
+    {
+        path.emplace_back();
+        if(!ReadRunLengthPoints(input, path.back(), max_point_num))
+        {
+            return false;
+        }
+    }
+    return true;
+}
 
-                        if(!rewrite)
-                        {
-                            cell_index_slice.erase(cell_index_slice.begin()+k-1);
-                            cell_index_slice.erase(cell_index_slice.begin()+k-1);
-                            cell_index_slice.insert(cell_index_slice.begin()+k-1, int(cell_graph.size()-1));
-                        }
-                        else
-                        {
-                            cell_index_slice.erase(cell_index_slice.begin() + k);
-                        }
+// 读写时都先核对关键字, 文件被截断或版本不对时ReadDynamicPlanningLog返回false
+const int max_log_map_size = 1<<16;
 
-                        curr_slice[j-1].isUsed = true;
-                        curr_slice[j].isUsed = true;
+bool ExpectLogKeyword(std::istream& input, const std::string& keyword)
+{
+    std::string word;
+    return bool(input>>word) && word == keyword;
+}
 
-                        break;
-                    }
-                }
-            }
+bool WriteDynamicPlanningLog(const std::string& log_file, const DynamicPlanningLog& log)
+{
+    std::ofstream output(log_file);
+    if(!output.is_open())
+    {
+        return false;
+    }
 
+    output<<"bcd_dynamic_planning_log 1\n";
+    output<<"map "<<log.rows<<" "<<log.cols<<" "<<log.robot_radius<<" "<<int(log.returning_home)<<"\n";
 
-            if(curr_slice[j].event_type == INNER_IN)
-            {
-                event_y = curr_slice[j].y;
-                for(int k = 1; k < cell_index_slice.size(); k++)
-                {
-                    if(event_y >= cell_graph[cell_index_slice[k-1]].floor.back().y && event_y <= cell_graph[cell_index_slice[k]].ceiling.back().y)
-                    {
-                        ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_in
-                        cell_index_slice.insert(cell_index_slice.begin()+k, int(cell_graph.size()-1));
-                        curr_slice[j].isUsed = true;
-                        break;
-                    }
-                }
-            }
+    output<<"cells "<<log.global_cell_graph.size()<<"\n";
+    for(const auto& cell : log.global_cell_graph)
+    {
+        output<<cell.cellIndex<<" "<<int(cell.isVisited)<<" "<<int(cell.isCleaned)<<" "<<cell.parentIndex<<" "<<cell.neighbor_indices.size();
+        for(int neighbor_index : cell.neighbor_indices)
+        {
+            output<<" "<<neighbor_index;
+        }
+        output<<"\n";
+        // 日志中总是逐列的边界, 压缩过的cell写出时展开
+        if(IsSegmentedCell(cell))
+        {
+            WriteRunLengthPoints(output, ExpandSegmentEdge(cell.ceiling_segments));
+            WriteRunLengthPoints(output, ExpandSegmentEdge(cell.floor_segments));
+        }
+        else
+        {
+            WriteRunLengthPoints(output, cell.ceiling);
+            WriteRunLengthPoints(output, cell.floor);
+        }
+    }
 
-            if(curr_slice[j].event_type == INNER_IN_BOTTOM)
-            {
-                event_y = curr_slice[j].y;
-                for(int k = 1; k < cell_index_slice.size(); k++)
-                {
-                    if(event_y >= cell_graph[cell_index_slice[k-1]].floor.back().y && event_y <= cell_graph[cell_index_slice[k]].ceiling.back().y)
-                    {
+    output<<"global_path ";
+    WritePathSegments(output, log.global_path);
 
-                        ExecuteInnerOpenOperation(cell_graph, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), // inner_in_top,
-                                                  Point2D(curr_slice[j].x, curr_slice[j].y));    // inner_in_bottom
+    output<<"replans "<<log.replans.size()<<"\n";
+    for(const auto& record : log.replans)
+    {
+        output<<record.path_index<<" "<<record.collision_point.x<<" "<<record.collision_point.y<<" "<<record.front_direction<<"\n";
+        WriteRunLengthPoints(output, record.new_obstacle);
+        WriteRunLengthPoints(output, record.contouring_path);
+        WritePathSegments(output, record.replanning_path);
+    }
 
-                        cell_index_slice.insert(cell_index_slice.begin()+k, int(cell_graph.size()-1));
+    output<<"dynamic_path ";
+    WriteRunLengthPoints(output, log.dynamic_path);
 
-                        curr_slice[j-1].isUsed = true;
-                        curr_slice[j].isUsed = true;
+    return bool(output);
+}
 
-                        break;
-                    }
-                }
-            }
+bool ReadDynamicPlanningLog(const std::string& log_file, DynamicPlanningLog& log)
+{
+    std::ifstream input(log_file);
+    int version = 0;
+    if(!input.is_open() || !ExpectLogKeyword(input, "bcd_dynamic_planning_log") || !(input>>version) || version != 1)
+    {
+        return false;
+    }
 
+    // 所有数目都以地图像素数为上限, 超出说明日志已损坏
+    int returning_home = 0;
+    if(!ExpectLogKeyword(input, "map") || !(input>>log.rows>>log.cols>>log.robot_radius>>returning_home)
+       || log.rows <= 0 || log.cols <= 0 || log.rows > max_log_map_size || log.cols > max_log_map_size
+       || log.robot_radius < 0 || log.robot_radius > std::max(log.rows, log.cols))
+    {
+        return false;
+    }
+    log.returning_home = returning_home != 0;
+    size_t max_point_num = size_t(log.rows)*size_t(log.cols);
 
-            if(curr_slice[j].event_type == INNER_OUT)
+    // 按实际读到的内容逐个追加, 不按文件里的数目预先分配
+    size_t cell_num = 0;
+    if(!ExpectLogKeyword(input, "cells") || !(input>>cell_num) || cell_num > max_point_num)
+    {
+        return false;
+    }
+    log.global_cell_graph.clear();
+    for(size_t i = 0; i < cell_num; i++)
+    {
+        log.global_cell_graph.emplace_back();
+        CellNode& cell = log.global_cell_graph.back();
+        int is_visited = 0, is_cleaned = 0;
+        size_t neighbor_num = 0;
+        if(!(input>>cell.cellIndex>>is_visited>>is_cleaned>>cell.parentIndex>>neighbor_num) || neighbor_num > cell_num)
+        {
+            return false;
+        }
+        cell.isVisited = is_visited != 0;
+        cell.isCleaned = is_cleaned != 0;
+        for(size_t j = 0; j < neighbor_num; j++)
+        {
+            int neighbor_index = 0;
+            if(!(input>>neighbor_index) || neighbor_index < 0 || neighbor_index >= int(cell_num))
             {
-                event_y = curr_slice[j].y;
-                for(int k = 0; k < cell_index_slice.size(); k++)
-                {
-                    if(event_y >= cell_graph[cell_index_slice[k]].ceiling.back().y && event_y <= cell_graph[cell_index_slice[k]].floor.back().y)
-                    {
-                        curr_cell_idx = cell_index_slice[k];
-                        ExecuteInnerCloseOperation(cell_graph, curr_cell_idx, Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_out
-                        cell_index_slice.erase(cell_index_slice.begin()+k);
-                        curr_slice[j].isUsed = true;
-                        break;
-                    }
-                }
+                return false;
             }
+            cell.neighbor_indices.emplace_back(neighbor_index);
+        }
+        // 上下边界逐列记录, 点数不超过地图列数
+        if(!ReadRunLengthPoints(input, cell.ceiling, log.cols) || !ReadRunLengthPoints(input, cell.floor, log.cols))
+        {
+            return false;
+        }
+    }
 
-            if(curr_slice[j].event_type == INNER_OUT_BOTTOM)
-            {
-                event_y = curr_slice[j].y;
-                for(int k = 0; k < cell_index_slice.size(); k++)
-                {
-                    if(event_y >= cell_graph[cell_index_slice[k]].ceiling.back().y && event_y <= cell_graph[cell_index_slice[k]].floor.back().y)
-                    {
-                        curr_cell_idx = cell_index_slice[k];
-                        ExecuteInnerCloseOperation(cell_graph, curr_cell_idx, Point2D(curr_slice[j-1].x, curr_slice[j-1].y), Point2D(curr_slice[j].x, curr_slice[j].y));  // inner_out_top, inner_out_bottom
-                        cell_index_slice.erase(cell_index_slice.begin()+k);
-                        curr_slice[j-1].isUsed = true;
-                        curr_slice[j].isUsed = true;
-                        break;
-                    }
-                }
-            }
+    if(!ExpectLogKeyword(input, "global_path") || !ReadPathSegments(input, log.global_path, max_point_num))
+    {
+        return false;
+    }
 
+    size_t replan_num = 0;
+    if(!ExpectLogKeyword(input, "replans") || !(input>>replan_num) || replan_num > max_point_num)
+    {
+        return false;
+    }
+    log.replans.clear();
+    for(size_t i = 0; i < replan_num; i++)
+    {
+        log.replans.emplace_back();
+        DynamicReplanRecord& record = log.replans.back();
+        if(!(input>>record.path_index>>record.collision_point.x>>record.collision_point.y>>record.front_direction)
+           || !ReadRunLengthPoints(input, record.new_obstacle, max_point_num)
+           || !ReadRunLengthPoints(input, record.contouring_path, max_point_num)
+           || !ReadPathSegments(input, record.replanning_path, max_point_num))
+        {
+            return false;
         }
+    }
+
+    return ExpectLogKeyword(input, "dynamic_path") && ReadRunLengthPoints(input, log.dynamic_path, max_point_num);
+}
+
+// 按记录重新执行一次动态规划: 地图只用于可视化和局部重规划内部的拷贝, 回放时用同样大小的空白地图代替仿真地图
+std::deque<Point2D> ReplayDynamicPlanning(const DynamicPlanningLog& log, ReplanningStatistics* statistics=nullptr)
+{
+    cv::Mat map = cv::Mat(log.rows, log.cols, CV_8UC3, cv::Scalar(255, 255, 255));
+    return DynamicPathPlanning(map, log.global_cell_graph, log.global_path, log.robot_radius, log.returning_home, false, 10, statistics, nullptr, &log);
+}
 
-        for(int j = 0; j < curr_slice.size(); j++)
+// 回放repeat_num次, 打印每次的耗时和重规划耗时, 并与记录的重规划结果和整条路径比较; 全部一致时返回0
+int RunDynamicPlanningReplay(const std::string& log_file, int repeat_num)
+{
+    DynamicPlanningLog log;
+    if(!ReadDynamicPlanningLog(log_file, log))
+    {
+        std::cout<<"failed to read dynamic planning log "<<log_file<<std::endl;
+        return 1;
+    }
+
+    int diverged_runs = 0;
+    double total_ms = 0.0, total_replanning_ms = 0.0;
+    for(int i = 0; i < std::max(repeat_num, 1); i++)
+    {
+        ReplanningStatistics statistics;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::deque<Point2D> dynamic_path = ReplayDynamicPlanning(log, &statistics);
+        total_ms += ElapsedMilliseconds(start);
+        total_replanning_ms += statistics.replanning_time_ms;
+
+        if(statistics.diverged_replans > 0 || dynamic_path != log.dynamic_path)
         {
-            if(curr_slice[j].event_type == CEILING)
-            {
-                cell_counter = CountCells(curr_slice,j);
-                curr_cell_idx = cell_index_slice[cell_counter];
-                if(!curr_slice[j].isUsed)
-                {
-                    ExecuteCeilOperation(cell_graph, curr_cell_idx, Point2D(curr_slice[j].x, curr_slice[j].y));
-                }
-            }
-            if(curr_slice[j].event_type == FLOOR)
-            {
-                cell_counter = CountCells(curr_slice,j);
-                curr_cell_idx = cell_index_slice[cell_counter];
-                if(!curr_slice[j].isUsed)
-                {
-                    ExecuteFloorOperation(cell_graph, curr_cell_idx, Point2D(curr_slice[j].x, curr_slice[j].y));
-                }
-            }
+            diverged_runs++;
         }
     }
+
+    repeat_num = std::max(repeat_num, 1);
+    std::cout<<"replay "<<log_file<<": "<<log.global_cell_graph.size()<<" cells, "<<log.replans.size()<<" replans, "
+             <<total_ms/repeat_num<<" ms per run, "<<(log.replans.empty() ? 0.0 : total_replanning_ms/repeat_num/log.replans.size())<<" ms per replan, "
+             <<diverged_runs<<"/"<<repeat_num<<" runs diverged from the recording"<<std::endl;
+    return diverged_runs == 0 ? 0 : 1;
 }
 
-Point2D FindNextEntrance(const Point2D& curr_point, const CellNode& next_cell, int& corner_indicator)
+void MoveAsPathPlannedTest(cv::Mat& map, double meters_per_pix, const Point2D& start, const std::vector<NavigationMessage>& motion_commands)
 {
-    Point2D next_entrance;
-
-    int front_x = next_cell.ceiling.front().x;
-    int back_x = next_cell.ceiling.back().x;
+    int pixs;
+    Point2D begin = start, end;
 
-    std::vector<Point2D> corner_points = ComputeCellCornerPoints(next_cell);
+    cv::namedWindow("original_map", cv::WINDOW_NORMAL);
 
-    if(abs(curr_point.x - front_x) < abs(curr_point.x - back_x))
+    for(auto command:motion_commands)
     {
-        if(abs(curr_point.y - next_cell.ceiling.front().y)<abs(curr_point.y - next_cell.floor.front().y))
+        pixs = int(command.GetDistance()/meters_per_pix);
+        if(command.GetGlobalYaw()==0.0)
         {
-            next_entrance = corner_points[TOPLEFT];
-            corner_indicator = TOPLEFT;
+            end = Point2D(begin.x, begin.y-pixs);
+            cv::line(map, cv::Point(begin.x, begin.y), cv::Point(end.x, end.y), cv::Scalar(0, 0, 255));
+            cv::imshow("original_map", map);
+            cv::waitKey(100);
         }
-        else
+        if(command.GetGlobalYaw()==180.0)
         {
-            next_entrance = corner_points[BOTTOMLEFT];
-            corner_indicator = BOTTOMLEFT;
+            end = Point2D(begin.x, begin.y+pixs);
+            cv::line(map, cv::Point(begin.x, begin.y), cv::Point(end.x, end.y), cv::Scalar(255, 0, 0));
+            cv::imshow("original_map", map);
+            cv::waitKey(100);
         }
-    }
-    else
-    {
-        if(abs(curr_point.y - next_cell.ceiling.back().y)<abs(curr_point.y - next_cell.floor.back().y))
+        if(command.GetGlobalYaw()==90.0)
         {
-            next_entrance = corner_points[TOPRIGHT];
-            corner_indicator = TOPRIGHT;
+            end = Point2D(begin.x+pixs, begin.y);
+            cv::line(map, cv::Point(begin.x, begin.y), cv::Point(end.x, end.y), cv::Scalar(0, 255, 0));
+            cv::imshow("original_map", map);
+            cv::waitKey(100);
         }
-        else
+        if(command.GetGlobalYaw()==-90.0)
         {
-            next_entrance = corner_points[BOTTOMRIGHT];
-            corner_indicator = BOTTOMRIGHT;
+            end = Point2D(begin.x-pixs, begin.y);
+            cv::line(map, cv::Point(begin.x, begin.y), cv::Point(end.x, end.y), cv::Scalar(0, 255, 255));
+            cv::imshow("original_map", map);
+            cv::waitKey(100);
         }
+        begin = end;
     }
-
-    return next_entrance;
+    cv::waitKey(0);
 }
 
-std::deque<Point2D> WalkInsideCell(CellNode cell, const Point2D& start, const Point2D& end)
+
+
+/** 覆盖率评估: 沿路径扫过机器人的圆形足迹, 按行合并区间统计覆盖和遗漏的可通行面积 **/
+
+// 第y行上[x_begin, x_end]内的像素
+class RowInterval
 {
-    std::deque<Point2D> inner_path = {start};
+public:
+    RowInterval(int y_=0, int x_begin_=0, int x_end_=0)
+    {
+        y = y_;
+        x_begin = x_begin_;
+        x_end = x_end_;
+    }
 
-    int start_ceiling_index_offset = start.x - cell.ceiling.front().x;
-    int first_ceiling_delta_y = cell.ceiling[start_ceiling_index_offset].y - start.y;
-    int end_ceiling_index_offset = end.x - cell.ceiling.front().x;
-    int second_ceiling_delta_y = end.y - cell.ceiling[end_ceiling_index_offset].y;
+    int y;
+    int x_begin;
+    int x_end;
+};
 
-    int start_floor_index_offset = start.x - cell.floor.front().x;
-    int first_floor_delta_y = cell.floor[start_floor_index_offset].y - start.y;
-    int end_floor_index_offset = end.x - cell.floor.front().x;
-    int second_floor_delta_y = end.y - cell.floor[end_floor_index_offset].y;
+/**
+ * 路径按水平或竖直的连续单步拆成直线段, 每段的足迹(两端为半圆的长条)每行只产生一个区间,
+ * 其余的点(斜向或跳跃)单独按圆形处理. 区间裁剪到地图范围内, 未排序, 可能重叠.
+ **/
+std::vector<RowInterval> SweepFootprint(const std::deque<Point2D>& path, int robot_radius, const cv::Size& map_size)
+{
+    std::vector<int> half_widths(robot_radius+1);
+    for(int dy = 0; dy <= robot_radius; dy++)
+    {
+        half_widths[dy] = int(std::floor(std::sqrt(double(robot_radius*robot_radius - dy*dy))));
+    }
 
-    if((abs(first_ceiling_delta_y)+abs(second_ceiling_delta_y)) < (abs(first_floor_delta_y)+abs(second_floor_delta_y))) //to ceiling
+    std::vector<RowInterval> intervals;
+    auto add_interval = [&](int y, int x_begin, int x_end)
     {
-        int first_increment_y = 0;
-        if(first_ceiling_delta_y != 0)
+        if(y < 0 || y >= map_size.height)
         {
-            first_increment_y = first_ceiling_delta_y / abs(first_ceiling_delta_y);
-
-            for(int i = 1; i <= abs(first_ceiling_delta_y); i++)
-            {
-                inner_path.emplace_back(Point2D(start.x, start.y+(first_increment_y*i)));
-            }
+            return;
         }
-
-        int delta_x = cell.ceiling[end_ceiling_index_offset].x - cell.ceiling[start_ceiling_index_offset].x;
-        int increment_x = 0;
-        if(delta_x != 0)
+        x_begin = std::max(x_begin, 0);
+        x_end = std::min(x_end, map_size.width-1);
+        if(x_begin <= x_end)
         {
-            increment_x = delta_x / abs(delta_x);
+            intervals.emplace_back(RowInterval(y, x_begin, x_end));
         }
-        for(int i = 0; i < abs(delta_x); i++)
+    };
+
+    int i = 0;
+    while(i < int(path.size()))
+    {
+        int j = i;
+        if(i + 1 < int(path.size()))
         {
-            // 提前转
-            if((cell.ceiling[start_ceiling_index_offset+increment_x*(i+1)].y-cell.ceiling[start_ceiling_index_offset+increment_x*(i)].y>=2)
-               &&(i+1 <= abs(delta_x))
-               &&(i <= abs(delta_x)))
+            int step_x = path[i+1].x - path[i].x;
+            int step_y = path[i+1].y - path[i].y;
+            if(std::abs(step_x) + std::abs(step_y) == 1)
             {
-                int delta = cell.ceiling[start_ceiling_index_offset+increment_x*(i+1)].y-cell.ceiling[start_ceiling_index_offset+increment_x*(i)].y;
-                int increment = delta/abs(delta);
-                for(int j = 0; j <= abs(delta); j++)
+                while(j + 1 < int(path.size()) && path[j+1].x - path[j].x == step_x && path[j+1].y - path[j].y == step_y)
                 {
-                    inner_path.emplace_back(Point2D(cell.ceiling[start_ceiling_index_offset+increment_x*i].x, cell.ceiling[start_ceiling_index_offset+increment_x*i].y+increment*(j)));
+                    j++;
                 }
             }
-            // 滞后转
-            else if((cell.ceiling[start_ceiling_index_offset+increment_x*(i)].y-cell.ceiling[start_ceiling_index_offset+increment_x*(i+1)].y>=2)
-                     &&(i<=abs(delta_x))
-                     &&(i+1<=abs(delta_x)))
-            {
-                inner_path.emplace_back(cell.ceiling[start_ceiling_index_offset+increment_x*(i)]);
+        }
 
-                int delta = cell.ceiling[start_ceiling_index_offset+increment_x*(i+1)].y-cell.ceiling[start_ceiling_index_offset+increment_x*(i)].y;
+        int x_min = std::min(path[i].x, path[j].x), x_max = std::max(path[i].x, path[j].x);
+        int y_min = std::min(path[i].y, path[j].y), y_max = std::max(path[i].y, path[j].y);
 
-                int increment = delta/abs(delta);
-                for(int k = 0; k <= abs(delta); k++)
-                {
-                    inner_path.emplace_back(Point2D(cell.ceiling[start_ceiling_index_offset+increment_x*(i+1)].x, cell.ceiling[start_ceiling_index_offset+increment_x*(i+1)].y+abs(delta)+increment*(k)));
-                }
-            }
-            else
+        if(x_min == x_max)
+        {
+            // 竖直段(或单点): 段内的行取满宽度, 两端按到端点的距离收窄
+            for(int y = y_min - robot_radius; y <= y_max + robot_radius; y++)
             {
-                inner_path.emplace_back(cell.ceiling[start_ceiling_index_offset+(increment_x*i)]);
+                int distance = (y < y_min) ? (y_min - y) : ((y > y_max) ? (y - y_max) : 0);
+                add_interval(y, x_min - half_widths[distance], x_max + half_widths[distance]);
             }
         }
-
-        int second_increment_y = 0;
-        if(second_ceiling_delta_y!=0)
+        else
         {
-            second_increment_y = second_ceiling_delta_y/abs(second_ceiling_delta_y);
-
-            for(int i = 1; i <= abs(second_ceiling_delta_y); i++)
+            for(int dy = -robot_radius; dy <= robot_radius; dy++)
             {
-                inner_path.emplace_back(Point2D(cell.ceiling[end_ceiling_index_offset].x, cell.ceiling[end_ceiling_index_offset].y+(second_increment_y*i)));
+                add_interval(y_min + dy, x_min - half_widths[std::abs(dy)], x_max + half_widths[std::abs(dy)]);
             }
         }
 
+        // 相邻两段共用端点, 下一段从当前段的终点开始
+        i = (j == i || j + 1 == int(path.size())) ? j + 1 : j;
+    }
+
+    return intervals;
+}
+
+class CoverageReport
+{
+public:
+    CoverageReport()
+    {
+        free_pixels = 0;
+        covered_pixels = 0;
+        missed_pixels = 0;
+        coverage_rate = 0.0;
     }
-    else // to floor
+
+    int free_pixels;
+    int covered_pixels;
+    int missed_pixels;
+    double coverage_rate;
+    cv::Mat1b heatmap;    // 每个heatmap_block*heatmap_block块中未覆盖的可通行像素比例(0~255), 只在需要时计算
+};
+
+/**
+ * free_space中255为可通行区域. 只统计时不逐像素画足迹: 每行的区间排序合并后只扫描被覆盖的像素,
+ * 加上对整张地图的一次计数. heatmap_block大于0时额外输出未覆盖区域的热力图.
+ **/
+CoverageReport EvaluateCoverage(const cv::Mat1b& free_space, const std::deque<Point2D>& path, int robot_radius, int heatmap_block=0)
+{
+    CoverageReport report;
+
+    std::vector<RowInterval> intervals = SweepFootprint(path, robot_radius, free_space.size());
+    std::sort(intervals.begin(), intervals.end(), [](const RowInterval& a, const RowInterval& b){ return (a.y < b.y) || (a.y == b.y && a.x_begin < b.x_begin); });
+
+    cv::Mat1b covered_space;
+    if(heatmap_block > 0)
     {
-        int first_increment_y = 0;
-        if(first_floor_delta_y != 0)
-        {
-            first_increment_y = first_floor_delta_y / abs(first_floor_delta_y);
+        covered_space = cv::Mat1b(free_space.size(), CV_8U);
+        covered_space.setTo(0);
+    }
 
-            for(int i = 1; i <= abs(first_floor_delta_y); i++)
-            {
-                inner_path.emplace_back(Point2D(start.x, start.y+(first_increment_y*i)));
-            }
+    for(int i = 0; i < intervals.size();)
+    {
+        int y = intervals[i].y;
+        int x_begin = intervals[i].x_begin;
+        int x_end = intervals[i].x_end;
+        for(i++; i < intervals.size() && intervals[i].y == y && intervals[i].x_begin <= x_end + 1; i++)
+        {
+            x_end = std::max(x_end, intervals[i].x_end);
         }
 
-        int delta_x = cell.floor[end_floor_index_offset].x - cell.floor[start_floor_index_offset].x;
-        int increment_x = 0;
-        if(delta_x != 0)
+        const uchar* row = free_space.ptr<uchar>(y);
+        for(int x = x_begin; x <= x_end; x++)
+        {
+            report.covered_pixels += (row[x] == 255);
+        }
+        if(heatmap_block > 0)
         {
-            increment_x = delta_x / abs(delta_x);
+            std::fill(covered_space.ptr<uchar>(y) + x_begin, covered_space.ptr<uchar>(y) + x_end + 1, 255);
         }
-        for(int i = 0; i < abs(delta_x); i++)
+    }
+
+    for(int y = 0; y < free_space.rows; y++)
+    {
+        const uchar* row = free_space.ptr<uchar>(y);
+        report.free_pixels += int(std::count(row, row + free_space.cols, 255));
+    }
+    report.missed_pixels = report.free_pixels - report.covered_pixels;
+    report.coverage_rate = (report.free_pixels == 0) ? 0.0 : double(report.covered_pixels)/double(report.free_pixels);
+
+    if(heatmap_block > 0)
+    {
+        report.heatmap = cv::Mat1b(free_space.size(), CV_8U);
+        for(int block_y = 0; block_y < free_space.rows; block_y += heatmap_block)
         {
-            //提前转
-            if((cell.floor[start_floor_index_offset+increment_x*(i)].y-cell.floor[start_floor_index_offset+increment_x*(i+1)].y>=2)
-               &&(i<=abs(delta_x))
-               &&(i+1<=abs(delta_x)))
+            for(int block_x = 0; block_x < free_space.cols; block_x += heatmap_block)
             {
-                int delta = cell.floor[start_floor_index_offset+increment_x*(i+1)].y-cell.floor[start_floor_index_offset+increment_x*(i)].y;
-                int increment = delta/abs(delta);
-                for(int j = 0; j <= abs(delta); j++)
+                int y_end = std::min(block_y + heatmap_block, free_space.rows);
+                int x_end = std::min(block_x + heatmap_block, free_space.cols);
+
+                int missed_pixels = 0;
+                for(int y = block_y; y < y_end; y++)
                 {
-                    inner_path.emplace_back(Point2D(cell.floor[start_floor_index_offset+increment_x*(i)].x, cell.floor[start_floor_index_offset+increment_x*(i)].y+increment*(j)));
+                    for(int x = block_x; x < x_end; x++)
+                    {
+                        missed_pixels += (free_space(y, x) == 255 && covered_space(y, x) == 0);
+                    }
                 }
-            }
-            //滞后转
-            else if((cell.floor[start_floor_index_offset+increment_x*(i+1)].y-cell.floor[start_floor_index_offset+increment_x*(i)].y>=2)
-                    &&(i+1<=abs(delta_x))
-                    &&(i<=abs(delta_x)))
-            {
-                inner_path.emplace_back(Point2D(cell.floor[start_floor_index_offset+increment_x*(i)].x, cell.floor[start_floor_index_offset+increment_x*(i)].y));
-
-                int delta = cell.floor[start_floor_index_offset+increment_x*(i+1)].y-cell.floor[start_floor_index_offset+increment_x*(i)].y;
 
-                int increment = delta/abs(delta);
-                for(int k = 0; k <= abs(delta); k++)
+                uchar heat = uchar(255 * missed_pixels / ((y_end - block_y) * (x_end - block_x)));
+                for(int y = block_y; y < y_end; y++)
                 {
-                    inner_path.emplace_back(Point2D(cell.floor[start_floor_index_offset+increment_x*(i+1)].x, cell.floor[start_floor_index_offset+increment_x*(i+1)].y-abs(delta) +increment*(k)));
+                    std::fill(report.heatmap.ptr<uchar>(y) + block_x, report.heatmap.ptr<uchar>(y) + x_end, heat);
                 }
             }
-            else
-            {
-                inner_path.emplace_back(cell.floor[start_floor_index_offset+(increment_x*i)]);
-            }
-
-        }
-
-        int second_increment_y = 0;
-        if(second_floor_delta_y!=0)
-        {
-            second_increment_y = second_floor_delta_y/abs(second_floor_delta_y);
-
-            for(int i = 1; i <= abs(second_floor_delta_y); i++)
-            {
-                inner_path.emplace_back(Point2D(cell.floor[end_floor_index_offset].x, cell.floor[end_floor_index_offset].y+(second_increment_y*i)));
-            }
         }
     }
-    return inner_path;
+
+    return report;
 }
 
-std::deque<std::deque<Point2D>> FindLinkingPath(const Point2D& curr_exit, Point2D& next_entrance, int& corner_indicator, CellNode curr_cell, const CellNode& next_cell)
-{
-    std::deque<std::deque<Point2D>> path;
-    std::deque<Point2D> path_in_curr_cell;
-    std::deque<Point2D> path_in_next_cell;
 
-    int exit_corner_indicator = INT_MAX;
-    Point2D exit = FindNextEntrance(next_entrance, curr_cell, exit_corner_indicator);
-    path_in_curr_cell = WalkInsideCell(curr_cell, curr_exit, exit);
 
-    next_entrance = FindNextEntrance(exit, next_cell, corner_indicator);
+/** 动态路径规划仿真 **/
 
-    int delta_x = next_entrance.x - exit.x;
-    int delta_y = next_entrance.y - exit.y;
 
-    int increment_x = 0;
-    int increment_y = 0;
+// 规划使用已知地图(白色为空闲区域), 碰撞检测使用另一张只画未知障碍物的真值地图(白色为障碍物)
+class SimulationResult
+{
+public:
+    SimulationResult()
+    {
+        hidden_obstacles = 0;
+        replans = 0;
+        planning_time_ms = 0.0;
+        replanning_time_ms = 0.0;
+        coverage_rate = 0.0;
+        path_length = 0;
+    }
+    int hidden_obstacles;
+    int replans;
+    double planning_time_ms;   // DynamicPathPlanning整体耗时
+    double replanning_time_ms; // 其中花在重规划上的耗时
+    double coverage_rate;
+    int path_length;
+};
 
-    if (delta_x != 0) {
-        increment_x = delta_x / std::abs(delta_x);
-    }
-    if (delta_y != 0) {
-        increment_y = delta_y / std::abs(delta_y);
-    }
+// 在已知地图的空闲区域内随机放置互不重叠的未知障碍物(矩形或八边形), 障碍物四周留出绕行所需的空间
+std::vector<std::vector<cv::Point>> GenerateHiddenObstacles(const cv::Mat1b& known_map, int obstacle_num, int min_size, int max_size, int robot_radius, unsigned int seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> size_distribution(min_size, max_size);
+    std::uniform_int_distribution<int> x_distribution(0, known_map.cols-1);
+    std::uniform_int_distribution<int> y_distribution(0, known_map.rows-1);
+    std::uniform_int_distribution<int> shape_distribution(0, 1);
 
-    int upper_bound = INT_MIN;
-    int lower_bound = INT_MAX;
+    int margin = 3*(robot_radius+1);
 
-    if (exit.x >= curr_cell.ceiling.back().x)
-    {
-        upper_bound = curr_cell.ceiling.back().y;
-        lower_bound = curr_cell.floor.back().y;
-    }
-    if (exit.x <= curr_cell.ceiling.front().x)
-    {
-        upper_bound = curr_cell.ceiling.front().y;
-        lower_bound = curr_cell.floor.front().y;
-    }
+    cv::Mat1b occupied = cv::Mat1b(known_map.size(), CV_8U);
+    occupied.setTo(0);
 
-    if ((next_entrance.y >= upper_bound) && (next_entrance.y <= lower_bound))
+    std::vector<std::vector<cv::Point>> hidden_obstacles;
+
+    for(int attempt = 0; attempt < obstacle_num*50 && hidden_obstacles.size() < obstacle_num; attempt++)
     {
-        for (int y = exit.y; y != next_entrance.y; y += increment_y) {
-            path_in_curr_cell.emplace_back(Point2D(exit.x, y));
+        int half_size = size_distribution(generator);
+        int x = x_distribution(generator);
+        int y = y_distribution(generator);
+
+        int x_min = x - half_size - margin;
+        int y_min = y - half_size - margin;
+        int x_max = x + half_size + margin;
+        int y_max = y + half_size + margin;
+
+        if(x_min < 0 || y_min < 0 || x_max >= known_map.cols || y_max >= known_map.rows)
+        {
+            continue;
+        }
+
+        bool isFree = true;
+        for(int i = y_min; i <= y_max && isFree; i++)
+        {
+            for(int j = x_min; j <= x_max; j++)
+            {
+                if(known_map(i, j) != 255 || occupied(i, j) != 0)
+                {
+                    isFree = false;
+                    break;
+                }
+            }
         }
-        for (int x = exit.x; x != next_entrance.x; x += increment_x) {
-            path_in_curr_cell.emplace_back(Point2D(x, next_entrance.y));
+        if(!isFree)
+        {
+            continue;
         }
-    }
-    else
-    {
-        for (int x = exit.x; x != next_entrance.x; x += increment_x) {
-            path_in_curr_cell.emplace_back(Point2D(x, exit.y));
+
+        std::vector<cv::Point> obstacle;
+        if(shape_distribution(generator) == 0)
+        {
+            obstacle = {cv::Point(x-half_size, y-half_size), cv::Point(x-half_size, y+half_size),
+                        cv::Point(x+half_size, y+half_size), cv::Point(x+half_size, y-half_size)};
         }
-        for (int y = exit.y; y != next_entrance.y; y += increment_y) {
-            path_in_next_cell.emplace_back(Point2D(next_entrance.x, y));
+        else
+        {
+            int corner = half_size/2;
+            obstacle = {cv::Point(x-corner, y-half_size),    cv::Point(x-half_size, y-corner),
+                        cv::Point(x-half_size, y+corner),    cv::Point(x-corner, y+half_size),
+                        cv::Point(x+corner, y+half_size),    cv::Point(x+half_size, y+corner),
+                        cv::Point(x+half_size, y-corner),    cv::Point(x+corner, y-half_size)};
         }
+        hidden_obstacles.emplace_back(obstacle);
+
+        cv::rectangle(occupied, cv::Point(x_min, y_min), cv::Point(x_max, y_max), cv::Scalar(255), -1);
     }
 
-    path = {path_in_curr_cell, path_in_next_cell};
+    return hidden_obstacles;
+}
+
+cv::Mat3b ConstructGroundTruthMap(const cv::Size& map_size, const std::vector<std::vector<cv::Point>>& hidden_obstacles)
+{
+    cv::Mat3b ground_truth_map = cv::Mat3b(map_size, CV_8U);
+    ground_truth_map.setTo(cv::Scalar(0, 0, 0));
+    cv::fillPoly(ground_truth_map, hidden_obstacles, cv::Scalar(255, 255, 255));
+    return ground_truth_map;
+}
+
+// 覆盖率 = 机器人扫过的空闲像素 / 全部空闲像素(已知地图的空闲区域去掉未知障碍物)
+double ComputeCoverageRate(const cv::Mat1b& known_map, const std::vector<std::vector<cv::Point>>& hidden_obstacles, const std::deque<Point2D>& path, int robot_radius)
+{
+    cv::Mat1b free_space = known_map.clone();
+    cv::fillPoly(free_space, hidden_obstacles, 0);
 
-    return path;
+    return EvaluateCoverage(free_space, path, robot_radius).coverage_rate;
 }
 
-std::deque<Point2D> WalkCrossCells(std::vector<CellNode>& cell_graph, std::deque<int> cell_path, const Point2D& start, const Point2D& end, int robot_radius)
+// global_cell_graph和global_path为已知地图上静态规划的结果, 每次仿真都在各自的拷贝上运行; recording非空时记录本次仿真供回放
+SimulationResult RunDynamicSimulation(const cv::Mat1b& known_map, const std::vector<CellNode>& global_cell_graph, const std::deque<std::deque<Point2D>>& global_path,
+                                      const std::vector<std::vector<cv::Point>>& hidden_obstacles, int robot_radius, DynamicPlanningLog* recording=nullptr)
 {
-    std::deque<Point2D> overall_path;
-    std::deque<Point2D> sub_path;
+    SimulationResult result;
+    result.hidden_obstacles = hidden_obstacles.size();
 
-    std::deque<std::deque<Point2D>> link_path;
+    cv::Mat ground_truth_map = ConstructGroundTruthMap(known_map.size(), hidden_obstacles);
+    ReplanningStatistics statistics;
 
-    std::vector<CellNode> cells;
-    cells.assign(cell_graph.begin(), cell_graph.end());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::deque<Point2D> dynamic_path = DynamicPathPlanning(ground_truth_map, global_cell_graph, global_path, robot_radius, false, false, 10, &statistics, recording);
+    result.planning_time_ms = ElapsedMilliseconds(start);
 
-    for(auto cell : cells)
-    {
-        cell.isCleaned = true;
-    }
+    result.replans = statistics.replans;
+    result.replanning_time_ms = statistics.replanning_time_ms;
+    result.path_length = dynamic_path.size();
+    result.coverage_rate = ComputeCoverageRate(known_map, hidden_obstacles, dynamic_path, robot_radius);
+
+    return result;
+}
 
-    Point2D curr_exit, next_entrance;
-    int curr_corner_indicator, next_corner_indicator;
+// 多线程并行仿真layout_num种随机未知障碍物布局, 第k种布局使用随机种子seed+k
+std::vector<SimulationResult> RunDynamicSimulationBatch(const cv::Mat1b& known_map, const Point2D& start, int robot_radius, int layout_num, int obstacle_num, int thread_num, unsigned int seed)
+{
+    std::vector<std::vector<cv::Point>> wall_contours;
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    ExtractContours(known_map, wall_contours, obstacle_contours, robot_radius);
 
-    next_entrance = FindNextEntrance(start, cells[cell_path[1]], next_corner_indicator);
-    curr_exit = FindNextEntrance(next_entrance, cells[cell_path[0]], curr_corner_indicator);
-    sub_path = WalkInsideCell(cells[cell_path[0]], start, curr_exit);
-    overall_path.insert(overall_path.end(), sub_path.begin(), sub_path.end());
-    sub_path.clear();
 
-    link_path = FindLinkingPath(curr_exit, next_entrance, next_corner_indicator, cells[cell_path[0]], cells[cell_path[1]]);
-    sub_path.insert(sub_path.end(), link_path.front().begin(), link_path.front().end());
-    sub_path.insert(sub_path.end(), link_path.back().begin(), link_path.back().end());
+    std::vector<CellNode> cell_graph = ConstructCellGraph(known_map, wall_contours, obstacle_contours);
+    std::deque<std::deque<Point2D>> global_path = StaticPathPlanning(known_map, cell_graph, start, robot_radius, false, false);
 
+    std::vector<SimulationResult> results(layout_num);
+    std::atomic<int> next_layout(0);
 
-    overall_path.insert(overall_path.end(), sub_path.begin(), sub_path.end());
-    sub_path.clear();
+    std::chrono::steady_clock::time_point batch_start = std::chrono::steady_clock::now();
 
-    curr_corner_indicator = next_corner_indicator;
+    std::vector<std::thread> workers;
+    for(int i = 0; i < thread_num; i++)
+    {
+        workers.emplace_back([&]()
+        {
+            for(int layout = next_layout++; layout < layout_num; layout = next_layout++)
+            {
+                std::vector<std::vector<cv::Point>> hidden_obstacles = GenerateHiddenObstacles(known_map, obstacle_num, 2*(robot_radius+1), 4*(robot_radius+1), robot_radius, seed+layout);
+                results[layout] = RunDynamicSimulation(known_map, cell_graph, global_path, hidden_obstacles, robot_radius);
+            }
+        });
+    }
+    for(auto& worker : workers)
+    {
+        worker.join();
+    }
 
+    double batch_time_ms = ElapsedMilliseconds(batch_start);
 
-    for(int i = 1; i < cell_path.size()-1; i++)
+    int total_replans = 0;
+    double total_replanning_time_ms = 0.0;
+    double total_coverage_rate = 0.0;
+    for(const auto& result : results)
     {
-        sub_path = GetBoustrophedonPath(cell_graph, cells[cell_path[i]], curr_corner_indicator, robot_radius);
-        overall_path.insert(overall_path.end(), sub_path.begin(), sub_path.end());
-        sub_path.clear();
+        total_replans += result.replans;
+        total_replanning_time_ms += result.replanning_time_ms;
+        total_coverage_rate += result.coverage_rate;
+    }
+
+    std::cout<<"dynamic simulation: "<<layout_num<<" layouts on "<<thread_num<<" threads in "<<batch_time_ms<<" ms"<<std::endl;
+    std::cout<<"plans per second: "<<(batch_time_ms > 0.0 ? layout_num/(batch_time_ms/1000.0) : 0.0)<<std::endl;
+    std::cout<<"replans per run: "<<(layout_num > 0 ? double(total_replans)/layout_num : 0.0)<<std::endl;
+    std::cout<<"time per replan: "<<(total_replans > 0 ? total_replanning_time_ms/total_replans : 0.0)<<" ms"<<std::endl;
+    std::cout<<"coverage: "<<(layout_num > 0 ? 100.0*total_coverage_rate/layout_num : 0.0)<<"%"<<std::endl;
+
+    return results;
+}
+
+
+
 
-        curr_exit = overall_path.back();
-        next_entrance = FindNextEntrance(curr_exit, cells[cell_path[i+1]], next_corner_indicator);
+/** 规划服务: 常驻进程在本地UNIX socket上监听, 缓存分解好的地图, 用线程池处理并发的请求 **/
 
-        link_path = FindLinkingPath(curr_exit, next_entrance, next_corner_indicator, cells[cell_path[i]], cells[cell_path[i+1]]);
-        sub_path.insert(sub_path.end(), link_path.front().begin(), link_path.front().end());
-        sub_path.insert(sub_path.end(), link_path.back().begin(), link_path.back().end());
+/**
+ * 协议为一行一个请求, 一行一个回复. 成功以OK开头, 失败以ERROR开头, 路径按"点数 x y x y ..."输出.
+ *   LOAD <name> <map_path> <robot_radius>        读图、膨胀、分解后以name缓存, 同名的旧地图被替换
+ *   STATIC <name> <x> <y>                        从(x, y)出发的全覆盖路径
+ *   RETURN <name> <x> <y> <home_x> <home_y>       从(x, y)回到(home_x, home_y)的路径
+ *   REPLAN <name> <x> <y> <n> <x1> <y1> ... <xn> <yn>
+ *                                                把新发现的多边形障碍物加入地图后, 从(x, y)出发重新规划全覆盖路径, 不改动缓存
+ *   STATS                                        各类请求的数量和延迟分位数(毫秒)
+ *   SHUTDOWN                                     停止服务
+ **/
 
+// 缓存的地图只读, 各请求在cell图的拷贝上规划
+class PlanningMap
+{
+public:
+    cv::Mat1b map;
+    int robot_radius;
+    std::vector<std::vector<cv::Point>> wall_contours;
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    std::vector<CellNode> cell_graph;
+};
 
-        overall_path.insert(overall_path.end(), sub_path.begin(), sub_path.end());
-        sub_path.clear();
+std::shared_ptr<const PlanningMap> BuildPlanningMap(const cv::Mat1b& map, int robot_radius)
+{
+    std::shared_ptr<PlanningMap> planning_map = std::make_shared<PlanningMap>();
+    planning_map->map = map;
+    planning_map->robot_radius = robot_radius;
 
-        curr_corner_indicator = next_corner_indicator;
+    // 全黑的地图或膨胀后外墙面积为0时不能分解, 否则ConstructWall会退回到整张图的外框
+    if(!ExtractContours(map, planning_map->wall_contours, planning_map->obstacle_contours, robot_radius)
+       || cv::contourArea(planning_map->wall_contours.front()) < 1)
+    {
+        return nullptr;
     }
 
-    sub_path = WalkInsideCell(cells[cell_path.back()], next_entrance, end);
-    overall_path.insert(overall_path.end(), sub_path.begin(), sub_path.end());
-    sub_path.clear();
+    planning_map->cell_graph = ConstructCellGraph(map, planning_map->wall_contours, planning_map->obstacle_contours);
+    if(planning_map->cell_graph.empty())
+    {
+        return nullptr;
+    }
 
-    return overall_path;
+    return planning_map;
 }
 
-/** 广度优先搜索 **/
-std::deque<int> FindShortestPath(std::vector<CellNode>& cell_graph, const Point2D& start, const Point2D& end)
+std::string FormatPath(const std::deque<Point2D>& path)
 {
-    int start_cell_index = DetermineCellIndex(cell_graph, start).front();
-    int end_cell_index = DetermineCellIndex(cell_graph, end).front();
+    std::ostringstream reply;
+    reply<<"OK "<<path.size();
+    for(const auto& point : path)
+    {
+        reply<<" "<<point.x<<" "<<point.y;
+    }
+    return reply.str();
+}
 
-    std::deque<int> cell_path = {end_cell_index};
+// 每类请求只保留最近latency_window_size次的延迟用于分位数, 内存不随请求总数增长
+const size_t latency_window_size = 1024;
 
-    if(start_cell_index == end_cell_index)
+class LatencyWindow
+{
+public:
+    LatencyWindow()
     {
-        return cell_path;
+        count = 0;
     }
 
-    if(start_cell_index == end_cell_index)
+    void Add(double latency_ms)
     {
-        cell_path.emplace_back(start_cell_index);
-        return cell_path;
+        if(samples.size() < latency_window_size)
+        {
+            samples.emplace_back(latency_ms);
+        }
+        else
+        {
+            samples[count % latency_window_size] = latency_ms;
+        }
+        count++;
     }
 
-    std::vector<CellNode> cells;
-    cells.assign(cell_graph.begin(), cell_graph.end());
+    std::vector<double> samples;
+    size_t count;
+};
 
-    for(auto cell : cells)
+class PlanningService
+{
+public:
+    PlanningService()
     {
-        cell.isVisited = false;
-        cell.isCleaned = false;
-        cell.parentIndex = INT_MAX;
+        stopped = false;
     }
 
-    std::deque<int> search_queue = {start_cell_index};
-
-    CellNode curr_cell;
-
-    while(!search_queue.empty())
+    std::string HandleRequest(const std::string& request)
     {
-        curr_cell = cells[search_queue.front()];
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-        cells[search_queue.front()].isVisited = true;
-        search_queue.pop_front();
+        std::istringstream input(request);
+        std::string command;
+        input>>command;
 
-        for(int i = 0; i < curr_cell.neighbor_indices.size(); i++)
+        std::string reply;
+        if(command == "LOAD")
         {
-            if(curr_cell.neighbor_indices[i] == end_cell_index)
-            {
-                cells[curr_cell.neighbor_indices[i]].parentIndex = curr_cell.cellIndex;
-                search_queue.clear();
-                break;
-            }
-            else if(!cells[curr_cell.neighbor_indices[i]].isVisited)
-            {
-                cells[curr_cell.neighbor_indices[i]].isVisited = true;
-                cells[curr_cell.neighbor_indices[i]].parentIndex = curr_cell.cellIndex;
-                search_queue.emplace_back(curr_cell.neighbor_indices[i]);
-            }
+            reply = Load(input);
+        }
+        else if(command == "STATIC")
+        {
+            reply = Static(input);
+        }
+        else if(command == "RETURN")
+        {
+            reply = Return(input);
+        }
+        else if(command == "REPLAN")
+        {
+            reply = Replan(input);
+        }
+        else if(command == "STATS")
+        {
+            return Stats();
+        }
+        else if(command == "SHUTDOWN")
+        {
+            stopped = true;
+            return "OK";
+        }
+        else
+        {
+            return "ERROR unknown command "+command;
         }
 
+        RecordLatency(command, ElapsedMilliseconds(start));
+        return reply;
     }
 
-    curr_cell = cells[end_cell_index];
-    int prev_cell_index;
+    std::atomic<bool> stopped;
 
-    while(curr_cell.parentIndex != INT_MAX)
+private:
+    std::shared_ptr<const PlanningMap> FindMap(const std::string& name)
     {
-        prev_cell_index = curr_cell.parentIndex;
-        cell_path.emplace_front(prev_cell_index);
-        curr_cell = cells[prev_cell_index];
+        std::lock_guard<std::mutex> lock(maps_mutex);
+        auto iter = maps.find(name);
+        return (iter == maps.end()) ? nullptr : iter->second;
     }
 
-    return cell_path;
-}
-
-void InitializeColorMap(std::deque<cv::Scalar>& JetColorMap, int repeat_times)
-{
-    for(int i = 0; i <= 255; i++)
+    std::string Load(std::istringstream& input)
     {
-        for(int j = 0; j < repeat_times; j++)
+        std::string name, map_path;
+        int robot_radius = -1;
+        if(!(input>>name>>map_path>>robot_radius) || robot_radius < 0)
         {
-            JetColorMap.emplace_back(cv::Scalar(0, i, 255));
+            return "ERROR usage: LOAD <name> <map_path> <robot_radius>";
         }
-    }
 
-    for(int i = 254; i >= 0; i--)
-    {
-        for(int j = 0; j < repeat_times; j++)
+        cv::Mat1b map = ReadMap(map_path);
+        if(map.empty())
         {
-            JetColorMap.emplace_back(cv::Scalar(0, 255, i));
+            return "ERROR cannot read "+map_path;
         }
-    }
 
-    for(int i = 1; i <= 255; i++)
-    {
-        for(int j = 0; j < repeat_times; j++)
+        // 分解不持锁, 同名地图并发加载时以后完成的为准
+        std::shared_ptr<const PlanningMap> planning_map = BuildPlanningMap(PreprocessMap(map), robot_radius);
+        if(planning_map == nullptr)
         {
-            JetColorMap.emplace_back(cv::Scalar(i, 255, 0));
+            return "ERROR no free space in "+map_path;
         }
+
+        std::lock_guard<std::mutex> lock(maps_mutex);
+        maps[name] = planning_map;
+        return "OK "+std::to_string(planning_map->cell_graph.size())+" cells";
     }
 
-    for(int i = 254; i >= 0; i--)
+    std::string Static(std::istringstream& input)
     {
-        for(int j = 0; j < repeat_times; j++)
+        std::string name;
+        Point2D start;
+        if(!(input>>name>>start.x>>start.y))
         {
-            JetColorMap.emplace_back(cv::Scalar(255, i, 0));
+            return "ERROR usage: STATIC <name> <x> <y>";
         }
-    }
 
-    for(int i = 1; i <= 255; i++)
-    {
-        for(int j = 0; j < repeat_times; j++)
+        std::shared_ptr<const PlanningMap> planning_map = FindMap(name);
+        if(planning_map == nullptr)
         {
-            JetColorMap.emplace_back(cv::Scalar(255, 0, i));
+            return "ERROR unknown map "+name;
+        }
+
+        std::vector<CellNode> cell_graph = planning_map->cell_graph;
+        if(DetermineCellIndex(cell_graph, start).empty())
+        {
+            return "ERROR start point is not in free space";
         }
+
+        return FormatPath(FilterTrajectory(StaticPathPlanningParallel(cell_graph, start, planning_map->robot_radius, 1)));
     }
 
-    for(int i = 254; i >= 1; i--)
+    std::string Return(std::istringstream& input)
     {
-        for(int j = 0; j < repeat_times; j++)
+        std::string name;
+        Point2D curr_pos, original_pos;
+        if(!(input>>name>>curr_pos.x>>curr_pos.y>>original_pos.x>>original_pos.y))
         {
-            JetColorMap.emplace_back(cv::Scalar(i, 0, 255));
+            return "ERROR usage: RETURN <name> <x> <y> <home_x> <home_y>";
         }
-    }
-}
 
-void UpdateColorMap(std::deque<cv::Scalar>& JetColorMap)
-{
-    cv::Scalar color = JetColorMap.front();
-    JetColorMap.pop_front();
-    JetColorMap.emplace_back(color);
-}
+        std::shared_ptr<const PlanningMap> planning_map = FindMap(name);
+        if(planning_map == nullptr)
+        {
+            return "ERROR unknown map "+name;
+        }
 
+        std::vector<CellNode> cell_graph = planning_map->cell_graph;
+        if(DetermineCellIndex(cell_graph, curr_pos).empty() || DetermineCellIndex(cell_graph, original_pos).empty())
+        {
+            return "ERROR point is not in free space";
+        }
 
+        cv::Mat vis_map;
+        return FormatPath(ReturningPathPlanning(vis_map, cell_graph, curr_pos, original_pos, planning_map->robot_radius, false));
+    }
 
+    std::string Replan(std::istringstream& input)
+    {
+        std::string name;
+        Point2D start;
+        int vertex_num = 0;
+        if(!(input>>name>>start.x>>start.y>>vertex_num) || vertex_num < 3)
+        {
+            return "ERROR usage: REPLAN <name> <x> <y> <n> <x1> <y1> ... <xn> <yn>, n >= 3";
+        }
 
-/** 静态路径规划流程 **/
+        std::vector<cv::Point> new_obstacle(vertex_num);
+        for(auto& vertex : new_obstacle)
+        {
+            if(!(input>>vertex.x>>vertex.y))
+            {
+                return "ERROR obstacle has fewer than "+std::to_string(vertex_num)+" vertices";
+            }
+        }
 
+        std::shared_ptr<const PlanningMap> planning_map = FindMap(name);
+        if(planning_map == nullptr)
+        {
+            return "ERROR unknown map "+name;
+        }
 
-int ComputeRobotRadius(const double& meters_per_pix, const double& robot_size_in_meters)
-{
-    int robot_radius = int(robot_size_in_meters / meters_per_pix);
-    return robot_radius;
-}
+        cv::Mat1b map = planning_map->map.clone();
+        cv::fillPoly(map, std::vector<std::vector<cv::Point>>{new_obstacle}, 0);
 
-cv::Mat1b ReadMap(const std::string& map_file_path)
-{
-    cv::Mat1b original_map = cv::imread(map_file_path, CV_8U);
-    return original_map;
-}
+        std::shared_ptr<const PlanningMap> replanning_map = BuildPlanningMap(map, planning_map->robot_radius);
+        if(replanning_map == nullptr)
+        {
+            return "ERROR no free space left";
+        }
 
-cv::Mat1b PreprocessMap(const cv::Mat1b& original_map)
-{
-    cv::Mat1b map = original_map.clone();
-    cv::threshold(map, map, 128, 255, cv::THRESH_BINARY);
-    return map;
-}
+        std::vector<CellNode> cell_graph = replanning_map->cell_graph;
+        if(DetermineCellIndex(cell_graph, start).empty())
+        {
+            return "ERROR start point is not in free space";
+        }
 
-void ExtractRawContours(const cv::Mat& original_map, std::vector<std::vector<cv::Point>>& raw_wall_contours, std::vector<std::vector<cv::Point>>& raw_obstacle_contours)
-{
-    cv::Mat map = original_map.clone();
-    cv::threshold(map, map, 128, 255, cv::THRESH_BINARY_INV);
-    cv::cvtColor(map, map, cv::COLOR_GRAY2BGR);
+        return FormatPath(FilterTrajectory(StaticPathPlanningParallel(cell_graph, start, replanning_map->robot_radius, 1)));
+    }
 
-    std::vector<std::vector<cv::Point>> contours;
-    cv::findContours(original_map.clone(), contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
+    void RecordLatency(const std::string& command, double latency_ms)
+    {
+        std::lock_guard<std::mutex> lock(latency_mutex);
+        latencies[command].Add(latency_ms);
+    }
 
-    std::vector<int> wall_cnt_indices(contours.size());
-    std::iota(wall_cnt_indices.begin(), wall_cnt_indices.end(), 0);
+    std::string Stats()
+    {
+        std::lock_guard<std::mutex> lock(latency_mutex);
 
-//    std::sort(wall_cnt_indices.begin(), wall_cnt_indices.end(), [&contours](int lhs, int rhs){return contours[lhs].size() > contours[rhs].size();});
-    std::sort(wall_cnt_indices.begin(), wall_cnt_indices.end(), [&contours](int lhs, int rhs){return cv::contourArea(contours[lhs]) > cv::contourArea(contours[rhs]);});
+        std::ostringstream reply;
+        reply<<"OK";
+        for(auto& command_latencies : latencies)
+        {
+            std::vector<double> sorted_latencies = command_latencies.second.samples;
+            std::sort(sorted_latencies.begin(), sorted_latencies.end());
 
-    std::vector<cv::Point> raw_wall_contour = contours[wall_cnt_indices.front()];
-    raw_wall_contours = {raw_wall_contour};
+            auto percentile = [&](double p){ return sorted_latencies[std::min(sorted_latencies.size()-1, size_t(p * sorted_latencies.size()))]; };
+            reply<<" "<<command_latencies.first<<" count "<<command_latencies.second.count
+                 <<" p50 "<<percentile(0.5)<<" p90 "<<percentile(0.9)<<" p99 "<<percentile(0.99)<<" max "<<sorted_latencies.back()<<";";
+        }
+        return reply.str();
+    }
 
-    cv::Mat mask = cv::Mat(original_map.size(), original_map.type(), 255);
-    cv::fillPoly(mask, raw_wall_contours, 0);
+    std::mutex maps_mutex;
+    std::map<std::string, std::shared_ptr<const PlanningMap>> maps;
 
-    cv::Mat base = original_map.clone();
-    base += mask;
-    cv::threshold(base, base, 128, 255, cv::THRESH_BINARY_INV);
+    std::mutex latency_mutex;
+    std::map<std::string, LatencyWindow> latencies;
+};
 
-    cv::findContours(base, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
+// 从buffer中取出一行完整的请求(去掉行尾的\r), 没有完整的一行时返回false
+bool PopRequestLine(std::string& buffer, std::string& request)
+{
+    size_t line_end = buffer.find('\n');
+    if(line_end == std::string::npos)
+    {
+        return false;
+    }
 
-    raw_obstacle_contours = contours;
+    request = buffer.substr(0, line_end);
+    buffer.erase(0, line_end + 1);
+    if(!request.empty() && request.back() == '\r')
+    {
+        request.pop_back();
+    }
+    return true;
 }
 
-void ExtractContours(const cv::Mat& original_map, std::vector<std::vector<cv::Point>>& wall_contours, std::vector<std::vector<cv::Point>>& obstacle_contours, int robot_radius=0)
+// 客户端已断开时send返回EPIPE, MSG_NOSIGNAL避免SIGPIPE杀掉整个进程, 由调用者只关闭这一个连接
+bool SendReply(int client_fd, const std::string& reply)
 {
-    ExtractRawContours(original_map, wall_contours, obstacle_contours);
-
-    if(robot_radius != 0)
+    for(size_t sent = 0; sent < reply.size();)
     {
-        cv::Mat3b canvas = cv::Mat3b(original_map.size(), CV_8U);
-        canvas.setTo(cv::Scalar(255, 255, 255));
-
-        cv::fillPoly(canvas, wall_contours, cv::Scalar(0, 0, 0));
-        for(const auto& point:wall_contours.front())
+        ssize_t written = send(client_fd, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+        if(written < 0 && errno == EINTR)
         {
-            cv::circle(canvas, point, robot_radius, cv::Scalar(255, 255, 255), -1);
+            continue;
         }
-
-        cv::fillPoly(canvas, obstacle_contours, cv::Scalar(255, 255, 255));
-        for(const auto& obstacle_contour:obstacle_contours)
+        if(written <= 0)
         {
-            for(const auto& point:obstacle_contour)
-            {
-                cv::circle(canvas, point, robot_radius, cv::Scalar(255, 255, 255), -1);
-            }
+            return false;
         }
+        sent += written;
+    }
+    return true;
+}
 
-        cv::Mat canvas_;
-        cv::cvtColor(canvas, canvas_, cv::COLOR_BGR2GRAY);
-        cv::threshold(canvas_, canvas_, 200, 255, cv::THRESH_BINARY_INV);
+// 一行请求的最大长度; REPLAN的障碍物顶点都在一行里, 1MB约可容纳十万个顶点
+const size_t max_request_line_length = 1<<20;
 
-        cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(robot_radius,robot_radius), cv::Point(-1,-1));
-        cv::morphologyEx(canvas_, canvas_, cv::MORPH_OPEN, kernel);
+// 一个连接的读缓冲; busy时它的请求正在工作线程中处理, 回复写完之前不再读它的下一行, 保证回复按请求的顺序返回
+class PlanningConnection
+{
+public:
+    PlanningConnection()
+    {
+        busy = false;
+    }
 
-        ExtractRawContours(canvas_, wall_contours, obstacle_contours);
+    std::string buffer;
+    bool busy;
+};
 
+/**
+ * 在socket_path上监听. 主线程用poll同时等待新连接和各连接上的数据, 只把读到的完整请求行交给thread_num个工作线程,
+ * 空闲的连接不占用工作线程. 工作线程写完回复后通过wakeup管道通知主线程继续读这个连接.
+ * 收到SHUTDOWN后不再接受新连接和请求, 等正在处理的请求完成后返回.
+ **/
+int RunPlanningDaemon(const std::string& socket_path, int thread_num)
+{
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listen_fd < 0)
+    {
+        std::cout<<"cannot create socket"<<std::endl;
+        return 1;
+    }
 
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(socket_path.size() >= sizeof(address.sun_path))
+    {
+        std::cout<<"socket path is too long: "<<socket_path<<std::endl;
+        close(listen_fd);
+        return 1;
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path)-1);
 
-        std::vector<cv::Point> processed_wall_contour;
-        cv::approxPolyDP(cv::Mat(wall_contours.front()), processed_wall_contour, 1, true);
+    unlink(socket_path.c_str());
+    if(bind(listen_fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(listen_fd, 64) < 0)
+    {
+        std::cout<<"cannot listen on "<<socket_path<<std::endl;
+        close(listen_fd);
+        return 1;
+    }
 
-        std::vector<std::vector<cv::Point>> processed_obstacle_contours(obstacle_contours.size());
-        for(int i = 0; i < obstacle_contours.size(); i++)
+    int wakeup_fds[2];
+    if(pipe(wakeup_fds) < 0)
+    {
+        std::cout<<"cannot create wakeup pipe"<<std::endl;
+        close(listen_fd);
+        unlink(socket_path.c_str());
+        return 1;
+    }
+
+    // 在MSG_NOSIGNAL之外再忽略SIGPIPE, 写wakeup管道等其他写操作也不会因对端关闭而终止进程
+    signal(SIGPIPE, SIG_IGN);
+
+    PlanningService service;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_condition;
+    std::deque<std::pair<int, std::string>> request_queue;
+    // 工作线程处理完的连接及回复是否写成功, 由主线程恢复读取或关闭
+    std::deque<std::pair<int, bool>> finished_clients;
+    bool accepting = true;
+
+    auto wakeup = [&]()
+    {
+        char signal_byte = 0;
+        while(write(wakeup_fds[1], &signal_byte, 1) < 0 && errno == EINTR);
+    };
+
+    std::vector<std::thread> workers;
+    for(int i = 0; i < std::max(thread_num, 1); i++)
+    {
+        workers.emplace_back([&]()
         {
-            cv::approxPolyDP(cv::Mat(obstacle_contours[i]), processed_obstacle_contours[i], 1, true);
-        }
+            while(true)
+            {
+                std::pair<int, std::string> request;
+                {
+                    std::unique_lock<std::mutex> lock(queue_mutex);
+                    queue_condition.wait(lock, [&](){ return !request_queue.empty() || !accepting; });
+                    if(!accepting)
+                    {
+                        return;
+                    }
+                    request = std::move(request_queue.front());
+                    request_queue.pop_front();
+                }
 
-        wall_contours = {processed_wall_contour};
-        obstacle_contours = processed_obstacle_contours;
+                // 一个请求中的异常(如半径过大时膨胀核分配失败)只作为这个请求的错误回复, 不终止整个进程
+                std::string reply;
+                try
+                {
+                    reply = service.HandleRequest(request.second);
+                }
+                catch(const std::exception& error)
+                {
+                    std::string message = error.what();
+                    std::replace(message.begin(), message.end(), '\n', ' ');
+                    reply = "ERROR "+message;
+                }
+                catch(...)
+                {
+                    reply = "ERROR unknown exception";
+                }
+
+                bool replied = SendReply(request.first, reply + "\n");
+                {
+                    std::lock_guard<std::mutex> lock(queue_mutex);
+                    finished_clients.emplace_back(request.first, replied);
+                }
+                wakeup();
+            }
+        });
     }
-}
 
-PolygonList ConstructObstacles(const cv::Mat& original_map, const std::vector<std::vector<cv::Point>>& obstacle_contours)
-{
-    PolygonList obstacles;
-    Polygon obstacle;
+    std::cout<<"planning daemon listening on "<<socket_path<<" with "<<workers.size()<<" workers"<<std::endl;
 
-    for(const auto& obstacle_contour : obstacle_contours)
+    // 只有主线程访问connections
+    std::map<int, PlanningConnection> connections;
+    auto close_connection = [&](int client_fd)
     {
-        for(int j = 0; j < obstacle_contour.size()-1; j++)
+        connections.erase(client_fd);
+        close(client_fd);
+    };
+
+    // 连接空闲且缓冲中有完整的一行时, 把它交给工作线程
+    auto dispatch_request = [&](int client_fd)
+    {
+        PlanningConnection& connection = connections[client_fd];
+        std::string request;
+        while(!connection.busy && PopRequestLine(connection.buffer, request))
         {
-            cv::LineIterator line(original_map, obstacle_contour[j], obstacle_contour[j+1]);
-            for(int k = 0; k < line.count-1; k++)
+            if(request.empty())
             {
-                obstacle.emplace_back(Point2D(line.pos().x, line.pos().y));
-                line++;
+                continue;
             }
+            connection.busy = true;
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            request_queue.emplace_back(client_fd, std::move(request));
+            queue_condition.notify_one();
         }
-        cv::LineIterator line(original_map, obstacle_contour[obstacle_contour.size()-1], obstacle_contour[0]);
-        for(int j = 0; j < line.count-1; j++)
+    };
+
+    char chunk[4096];
+    while(!service.stopped)
+    {
+        std::vector<pollfd> poll_fds = {{listen_fd, POLLIN, 0}, {wakeup_fds[0], POLLIN, 0}};
+        for(const auto& connection : connections)
         {
-            obstacle.emplace_back(Point2D(line.pos().x, line.pos().y));
-            line++;
+            if(!connection.second.busy)
+            {
+                poll_fds.push_back({connection.first, POLLIN, 0});
+            }
         }
 
-        obstacles.emplace_back(obstacle);
-        obstacle.clear();
-    }
-
-    return obstacles;
-}
-
-Polygon ConstructDefaultWall(const cv::Mat& original_map)
-{
-    std::vector<cv::Point> default_wall_contour = {cv::Point(0, 0), cv::Point(0, original_map.rows-1), cv::Point(original_map.cols-1, original_map.rows-1), cv::Point(original_map.cols-1, 0)};
-    std::vector<std::vector<cv::Point>>default_wall_contours = {default_wall_contour};
-
-    Polygon default_wall = ConstructObstacles(original_map, default_wall_contours).front();
+        if(poll(poll_fds.data(), poll_fds.size(), -1) < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            std::cout<<"poll failed"<<std::endl;
+            break;
+        }
 
-    return default_wall;
-}
+        if(poll_fds[1].revents != 0)
+        {
+            while(read(wakeup_fds[0], chunk, sizeof(chunk)) == sizeof(chunk));
 
-Polygon ConstructWall(const cv::Mat& original_map, std::vector<cv::Point>& wall_contour)
-{
-    Polygon wall;
+            std::deque<std::pair<int, bool>> finished;
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                finished.swap(finished_clients);
+            }
+            for(const auto& client : finished)
+            {
+                if(!client.second)
+                {
+                    close_connection(client.first);
+                    continue;
+                }
+                connections[client.first].busy = false;
+                dispatch_request(client.first);
+            }
+        }
 
-    if(!wall_contour.empty())
-    {
-        for(int i = 0; i < wall_contour.size()-1; i++)
+        for(int i = 2; i < poll_fds.size(); i++)
         {
-            cv::LineIterator line(original_map, wall_contour[i], wall_contour[i+1]);
-            for(int j = 0; j < line.count-1; j++)
+            if(poll_fds[i].revents == 0)
+            {
+                continue;
+            }
+            int client_fd = poll_fds[i].fd;
+            ssize_t received = read(client_fd, chunk, sizeof(chunk));
+            if(received < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(received <= 0)
+            {
+                close_connection(client_fd);
+                continue;
+            }
+            connections[client_fd].buffer.append(chunk, received);
+            dispatch_request(client_fd);
+
+            // 空闲连接的缓冲里只剩不完整的一行, 超长时回复错误并断开, 避免一个客户端占满内存
+            if(!connections[client_fd].busy && connections[client_fd].buffer.size() > max_request_line_length)
             {
-                wall.emplace_back(Point2D(line.pos().x, line.pos().y));
-                line++;
+                SendReply(client_fd, "ERROR request line longer than "+std::to_string(max_request_line_length)+" bytes\n");
+                close_connection(client_fd);
             }
         }
-        cv::LineIterator line(original_map, wall_contour.back(), wall_contour.front());
-        for(int i = 0; i < line.count-1; i++)
+
+        if(poll_fds[0].revents != 0)
         {
-            wall.emplace_back(Point2D(line.pos().x, line.pos().y));
-            line++;
+            int client_fd = accept(listen_fd, nullptr, nullptr);
+            if(client_fd >= 0)
+            {
+                connections[client_fd] = PlanningConnection();
+            }
         }
-
-        return wall;
     }
-    else
+
     {
-        wall = ConstructDefaultWall(original_map);
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        accepting = false;
+        request_queue.clear();
+    }
+    queue_condition.notify_all();
 
-        for(const auto& point : wall)
-        {
-            wall_contour.emplace_back(cv::Point(point.x, point.y));
-        }
+    for(auto& worker : workers)
+    {
+        worker.join();
+    }
 
-        return wall;
+    for(const auto& connection : connections)
+    {
+        close(connection.first);
     }
+    close(wakeup_fds[0]);
+    close(wakeup_fds[1]);
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    return 0;
 }
 
-std::vector<CellNode> ConstructCellGraph(const cv::Mat& original_map, const std::vector<std::vector<cv::Point>>& wall_contours, const std::vector<std::vector<cv::Point>>& obstacle_contours, const Polygon& wall, const PolygonList& obstacles)
-{
-    cv::Mat3b map = cv::Mat3b(original_map.size());
-    map.setTo(cv::Scalar(0, 0, 0));
-
-    cv::fillPoly(map, wall_contours, cv::Scalar(255, 255, 255));
-    cv::fillPoly(map, obstacle_contours, cv::Scalar(0, 0, 0));
 
-    std::vector<Event> wall_event_list = GenerateWallEventList(map, wall);
-    std::vector<Event> obstacle_event_list = GenerateObstacleEventList(map, obstacles);
-    std::deque<std::deque<Event>> slice_list = SliceListGenerator(wall_event_list, obstacle_event_list);
 
-    std::vector<CellNode> cell_graph;
-    std::vector<int> cell_index_slice;
-    std::vector<int> original_cell_index_slice;
-    ExecuteCellDecomposition(cell_graph, cell_index_slice, original_cell_index_slice, slice_list);
+/** 批量规划: 读图、膨胀和单元分解、路径规划三级流水线, 级间用有界队列连接, 不同地图的各级在不同线程中重叠执行 **/
 
-    return cell_graph;
-}
+/**
+ * map_dir下有maps.txt时按其中的列表处理, 每行"<地图文件> <robot_radius> [<start_x> <start_y>]", #开头为注释;
+ * 没有maps.txt时处理目录下所有.png/.pgm/.bmp/.jpg地图, robot_radius都取default_robot_radius, 起点取第一个cell的左上角.
+ * 每张地图的路径写到output_dir/<地图文件名>.path, 每行一个点"x y"; 各地图的状态和各级耗时写到output_dir/summary.txt.
+ **/
 
-std::deque<std::deque<Point2D>> StaticPathPlanning(const cv::Mat& map, std::vector<CellNode>& cell_graph, const Point2D& start_point, int robot_radius, bool visualize_cells, bool visualize_path, int color_repeats=10)
+// 容量满时Push阻塞, 限制读入内存、尚未处理的地图数; Close后Pop取完剩余元素返回false
+template<typename T>
+class BoundedQueue
 {
-    cv::Mat3b vis_map;
-    cv::cvtColor(map, vis_map, cv::COLOR_GRAY2BGR);
-
-    std::deque<std::deque<Point2D>> global_path;
-    std::deque<Point2D> local_path;
-    int corner_indicator = TOPLEFT;
-
-    int start_cell_index = DetermineCellIndex(cell_graph, start_point).front();
-
-    std::deque<Point2D> init_path = WalkInsideCell(cell_graph[start_cell_index], start_point, ComputeCellCornerPoints(cell_graph[start_cell_index])[TOPLEFT]);
-    local_path.assign(init_path.begin(), init_path.end());
-
-    std::deque<CellNode> cell_path = GetVisittingPath(cell_graph, start_cell_index);
+public:
+    explicit BoundedQueue(size_t capacity_)
+    {
+        capacity = std::max<size_t>(capacity_, 1);
+        closed = false;
+    }
 
-    if(visualize_cells||visualize_path)
+    void Push(T item)
     {
-        cv::namedWindow("map", cv::WINDOW_NORMAL);
-        cv::imshow("map", vis_map);
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        not_full.wait(lock, [&](){ return items.size() < capacity; });
+        items.emplace_back(std::move(item));
+        not_empty.notify_one();
     }
 
-    if(visualize_cells)
+    bool Pop(T& item)
     {
-        std::cout<<"cell graph has "<<cell_graph.size()<<" cells."<<std::endl;
-        for(int i = 0; i < cell_graph.size(); i++)
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        not_empty.wait(lock, [&](){ return !items.empty() || closed; });
+        if(items.empty())
         {
-            for(int j = 0; j < cell_graph[i].neighbor_indices.size(); j++)
-            {
-                std::cout<<"cell "<< i << "'s neighbor: cell "<<cell_graph[cell_graph[i].neighbor_indices[j]].cellIndex<<std::endl;
-            }
+            return false;
         }
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
 
-        for(const auto& cell : cell_graph)
-        {
-            DrawCells(vis_map, cell);
-            cv::imshow("map", vis_map);
-            cv::waitKey(500);
-        }
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        closed = true;
+        not_empty.notify_all();
     }
 
-    std::deque<cv::Scalar> JetColorMap;
-    InitializeColorMap(JetColorMap, color_repeats);
+private:
+    size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex queue_mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+};
 
-    if(visualize_path)
+class BatchMapTask
+{
+public:
+    BatchMapTask()
+    {
+        robot_radius = 0;
+        has_start = false;
+        status = "OK";
+        read_ms = 0;
+        decompose_ms = 0;
+        plan_ms = 0;
+        cell_num = 0;
+        path_size = 0;
+    }
+
+    std::string map_file;
+    int robot_radius;
+    bool has_start;
+    Point2D start;
+
+    // 流水线中间结果, 下一级用完即释放
+    cv::Mat1b map;
+    std::shared_ptr<const PlanningMap> planning_map;
+
+    std::string status;
+    double read_ms;
+    double decompose_ms;
+    double plan_ms;
+    size_t cell_num;
+    size_t path_size;
+};
+
+bool HasMapExtension(const std::string& file_name)
+{
+    for(const std::string& extension : {std::string(".png"), std::string(".pgm"), std::string(".bmp"), std::string(".jpg")})
     {
-        cv::circle(vis_map, cv::Point(start_point.x, start_point.y), 1, cv::Scalar(0, 0, 255), -1);
-        for(const auto& point : init_path)
+        if(file_name.size() > extension.size() && file_name.compare(file_name.size()-extension.size(), extension.size(), extension) == 0)
         {
-            vis_map.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
-            UpdateColorMap(JetColorMap);
-            cv::imshow("map", vis_map);
-            cv::waitKey(1);
+            return true;
         }
     }
+    return false;
+}
 
-    std::deque<Point2D> inner_path;
-    std::deque<std::deque<Point2D>> link_path;
-    Point2D curr_exit;
-    Point2D next_entrance;
-
-    std::deque<int> return_cell_path;
-    std::deque<Point2D> return_path;
+std::vector<BatchMapTask> ReadBatchManifest(const std::string& map_dir, int default_robot_radius)
+{
+    std::vector<BatchMapTask> tasks;
 
-    for(int i = 0; i < cell_path.size(); i++)
+    std::ifstream manifest(map_dir+"/maps.txt");
+    if(manifest.is_open())
     {
-        inner_path = GetBoustrophedonPath(cell_graph, cell_path[i], corner_indicator, robot_radius);
-        local_path.insert(local_path.end(), inner_path.begin(), inner_path.end());
-        if(visualize_path)
+        std::string line;
+        while(std::getline(manifest, line))
         {
-            for(const auto& point : inner_path)
+            std::istringstream input(line);
+            BatchMapTask task;
+            if(!(input>>task.map_file) || task.map_file[0] == '#')
             {
-                vis_map.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
-                UpdateColorMap(JetColorMap);
-                cv::imshow("map", vis_map);
-                cv::waitKey(1);
+                continue;
             }
-        }
-
-        cell_graph[cell_path[i].cellIndex].isCleaned = true;
-
-        if(i < (cell_path.size()-1))
-        {
-            curr_exit = inner_path.back();
-            next_entrance = FindNextEntrance(curr_exit, cell_path[i+1], corner_indicator);
-            link_path = FindLinkingPath(curr_exit, next_entrance, corner_indicator, cell_path[i], cell_path[i+1]);
-
-            // for debugging
-//            std::cout<<std::endl;
-//            for(int i = 0; i < link_path.front().size(); i++)
-//            {
-//                int idx = DetermineCellIndex(cell_graph, link_path.front()[i]).front();
-//                std::cout<<"point lies in curr cell "<<idx<<std::endl;
-//            }
-//
-//            for(int i = 0; i < link_path.back().size(); i++)
-//            {
-//                int idx = DetermineCellIndex(cell_graph, link_path.back()[i]).front();
-//                std::cout<<"point lies in next cell "<<idx<<std::endl;
-//            }
-//            std::cout<<std::endl;
-
-
-            local_path.insert(local_path.end(), link_path.front().begin(), link_path.front().end());
-            global_path.emplace_back(local_path);
-            local_path.clear();
-            local_path.insert(local_path.end(), link_path.back().begin(), link_path.back().end());
-
-
-            if(visualize_path)
+            if(!(input>>task.robot_radius) || task.robot_radius < 0)
             {
-                for(const auto& point : link_path.front())
-                {
-//                    vis_map.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(255, 255, 255);
-                    vis_map.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
-                    UpdateColorMap(JetColorMap);
-                    cv::imshow("map", vis_map);
-                    cv::waitKey(1);
-                }
-
-                for(const auto& point: link_path.back())
-                {
-//                    vis_map.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(255, 255, 255);
-                    vis_map.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
-                    UpdateColorMap(JetColorMap);
-                    cv::imshow("map", vis_map);
-                    cv::waitKey(1);
-                }
-
+                task.robot_radius = default_robot_radius;
             }
+            task.has_start = bool(input>>task.start.x>>task.start.y);
+            tasks.emplace_back(task);
         }
+        return tasks;
     }
-    global_path.emplace_back(local_path);
 
-    if(visualize_cells||visualize_path)
+    DIR* dir = opendir(map_dir.c_str());
+    if(dir == nullptr)
     {
-        cv::waitKey(0);
+        return tasks;
+    }
+    for(dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir))
+    {
+        std::string file_name = entry->d_name;
+        if(HasMapExtension(file_name))
+        {
+            BatchMapTask task;
+            task.map_file = file_name;
+            task.robot_radius = default_robot_radius;
+            tasks.emplace_back(task);
+        }
     }
+    closedir(dir);
 
-    return global_path;
+    std::sort(tasks.begin(), tasks.end(), [](const BatchMapTask& lhs, const BatchMapTask& rhs){ return lhs.map_file < rhs.map_file; });
+    return tasks;
 }
 
-std::deque<Point2D> ReturningPathPlanning(cv::Mat& map, std::vector<CellNode>& cell_graph, const Point2D& curr_pos, const Point2D& original_pos, int robot_radius, bool visualize_path)
+bool WriteBatchPath(const std::string& path_file, const std::deque<Point2D>& path)
 {
-    std::deque<int> return_cell_path = FindShortestPath(cell_graph, curr_pos, original_pos);
-    std::deque<Point2D> returning_path;
+    std::ofstream output(path_file);
+    for(const auto& point : path)
+    {
+        output<<point.x<<" "<<point.y<<"\n";
+    }
+    return bool(output);
+}
 
-    if(return_cell_path.size() == 1)
+// 一张地图的某一级出错(包括抛出异常)只记在task.status里, 流水线继续处理其他地图
+template<typename Stage>
+void RunBatchStage(BatchMapTask& task, Stage stage)
+{
+    try
     {
-        returning_path = WalkInsideCell(cell_graph[return_cell_path.front()], curr_pos, original_pos);
+        stage();
     }
-    else
+    catch(const std::exception& error)
     {
-        returning_path = WalkCrossCells(cell_graph, return_cell_path, curr_pos, original_pos, robot_radius);
+        // summary.txt一张地图一行, cv::Exception的信息里带换行
+        std::string message = error.what();
+        std::replace(message.begin(), message.end(), '\n', ' ');
+        task.status = "ERROR "+message;
     }
-
-    if(visualize_path)
+    catch(...)
     {
-        cv::namedWindow("map", cv::WINDOW_NORMAL);
-        for(const auto& point : returning_path)
-        {
-            map.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(250, 250, 250);
-            cv::imshow("map", map);
-            cv::waitKey(1);
-        }
-        cv::waitKey(0);
+        task.status = "ERROR unknown exception";
     }
-
-    return returning_path;
 }
 
-std::deque<Point2D> FilterTrajectory(const std::deque<std::deque<Point2D>>& raw_trajectory)
+/**
+ * 读图由一个线程完成, 膨胀/分解和规划/写文件各用thread_num个线程; 两个队列的容量都是thread_num,
+ * 读得快时读图线程阻塞, 内存中最多同时有约3*thread_num张地图.
+ **/
+int RunBatchPlanning(const std::string& map_dir, const std::string& output_dir, int default_robot_radius, int thread_num)
 {
-    std::deque<Point2D> trajectory;
+    thread_num = std::max(thread_num, 1);
+
+    std::vector<BatchMapTask> tasks = ReadBatchManifest(map_dir, default_robot_radius);
+    if(tasks.empty())
+    {
+        std::cout<<"no maps found in "<<map_dir<<std::endl;
+        return 1;
+    }
+    mkdir(output_dir.c_str(), 0755);
+
+    BoundedQueue<int> read_queue(thread_num);
+    BoundedQueue<int> plan_queue(thread_num);
+
+    std::chrono::steady_clock::time_point batch_start = std::chrono::steady_clock::now();
+
+    std::thread reader([&]()
+    {
+        for(int task_index = 0; task_index < tasks.size(); task_index++)
+        {
+            BatchMapTask& task = tasks[task_index];
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            RunBatchStage(task, [&]()
+            {
+                task.map = ReadMap(map_dir+"/"+task.map_file);
+                if(task.map.empty())
+                {
+                    task.status = "ERROR cannot read map";
+                }
+            });
+            task.read_ms = ElapsedMilliseconds(start);
+            read_queue.Push(task_index);
+        }
+        read_queue.Close();
+    });
 
-    for(const auto& sub_trajectory : raw_trajectory)
+    std::vector<std::thread> decomposers;
+    for(int i = 0; i < thread_num; i++)
     {
-        for(const auto& position : sub_trajectory)
+        decomposers.emplace_back([&]()
         {
-            if(!trajectory.empty())
+            int task_index = -1;
+            while(read_queue.Pop(task_index))
             {
-                if(position != trajectory.back())
+                BatchMapTask& task = tasks[task_index];
+                if(task.status == "OK")
                 {
-                    trajectory.emplace_back(position);
+                    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                    RunBatchStage(task, [&]()
+                    {
+                        // 全黑或膨胀后没有可通行区域的地图BuildPlanningMap返回nullptr
+                        task.planning_map = BuildPlanningMap(PreprocessMap(task.map), task.robot_radius);
+                        if(task.planning_map == nullptr)
+                        {
+                            task.status = "ERROR no free space";
+                        }
+                    });
+                    task.decompose_ms = ElapsedMilliseconds(start);
                 }
+                task.map.release();
+                plan_queue.Push(task_index);
             }
-            else
+        });
+    }
+
+    std::vector<std::thread> planners;
+    for(int i = 0; i < thread_num; i++)
+    {
+        planners.emplace_back([&]()
+        {
+            int task_index = -1;
+            while(plan_queue.Pop(task_index))
             {
-                trajectory.emplace_back(position);
+                BatchMapTask& task = tasks[task_index];
+                if(task.status != "OK")
+                {
+                    continue;
+                }
+
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                RunBatchStage(task, [&]()
+                {
+                    std::vector<CellNode> cell_graph = task.planning_map->cell_graph;
+                    Point2D start_point = task.has_start ? task.start : cell_graph.front().ceiling.front();
+                    task.cell_num = cell_graph.size();
+                    if(DetermineCellIndex(cell_graph, start_point).empty())
+                    {
+                        task.status = "ERROR start point is not in free space";
+                        return;
+                    }
+
+                    std::deque<Point2D> path = FilterTrajectory(StaticPathPlanningParallel(cell_graph, start_point, task.planning_map->robot_radius, 1));
+                    task.path_size = path.size();
+                    if(!WriteBatchPath(output_dir+"/"+task.map_file+".path", path))
+                    {
+                        task.status = "ERROR cannot write path";
+                    }
+                });
+                task.plan_ms = ElapsedMilliseconds(start);
+                task.planning_map.reset();
             }
-        }
+        });
+    }
+
+    reader.join();
+    for(auto& decomposer : decomposers)
+    {
+        decomposer.join();
+    }
+    plan_queue.Close();
+    for(auto& planner : planners)
+    {
+        planner.join();
+    }
+
+    double batch_ms = ElapsedMilliseconds(batch_start);
+
+    double stage_ms = 0;
+    int failed_num = 0;
+    std::ofstream summary(output_dir+"/summary.txt");
+    summary<<"# map robot_radius cells path_points read_ms decompose_ms plan_ms status\n";
+    for(const auto& task : tasks)
+    {
+        summary<<task.map_file<<" "<<task.robot_radius<<" "<<task.cell_num<<" "<<task.path_size<<" "
+               <<task.read_ms<<" "<<task.decompose_ms<<" "<<task.plan_ms<<" "<<task.status<<"\n";
+        stage_ms += task.read_ms + task.decompose_ms + task.plan_ms;
+        failed_num += (task.status != "OK");
     }
+    summary<<"# "<<tasks.size()<<" maps, "<<failed_num<<" failed, "<<thread_num<<" threads, wall "<<batch_ms<<" ms, stages "<<stage_ms<<" ms\n";
 
-    return trajectory;
+    std::cout<<"planned "<<tasks.size()-failed_num<<"/"<<tasks.size()<<" maps in "<<batch_ms<<" ms (sum of stages "<<stage_ms<<" ms, "
+             <<thread_num<<" threads), summary in "<<output_dir<<"/summary.txt"<<std::endl;
+    return failed_num == 0 ? 0 : 1;
 }
 
-void VisualizeTrajectory(const cv::Mat& original_map, const std::deque<Point2D>& path, int robot_radius, int vis_mode, int time_interval=10, int colors=palette_colors)
-{
-    cv::Mat3b vis_map;
-    cv::cvtColor(original_map, vis_map, cv::COLOR_GRAY2BGR);
 
-    cv::namedWindow("map", cv::WINDOW_NORMAL);
 
-    std::deque<cv::Scalar> JetColorMap;
-    int color_repeated_times = path.size()/colors + 1;
-    InitializeColorMap(JetColorMap, color_repeated_times);
+/** 测试数据 **/
 
-    switch (vis_mode)
-    {
-        case PATH_MODE:
-            vis_map.at<cv::Vec3b>(path.front().y, path.front().x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
-            cv::imshow("map", vis_map);
-            cv::waitKey(0);
 
-            for(const auto& position:path)
-            {
-                vis_map.at<cv::Vec3b>(position.y, position.x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
-                UpdateColorMap(JetColorMap);
-                cv::imshow("map", vis_map);
-                cv::waitKey(time_interval);
-            }
-            break;
-        case ROBOT_MODE:
-            cv::circle(vis_map, cv::Point(path.front().x, path.front().y), robot_radius, cv::Scalar(255, 204, 153), -1);
-            cv::imshow("map", vis_map);
-            cv::waitKey(0);
+/** 静态地图路径规划测试多边形 **/
+std::vector<std::vector<cv::Point>> ConstructHandcraftedContours1()
+{
+    std::vector<cv::Point> handcrafted_polygon_1_1 = {cv::Point(200,300), cv::Point(300,200), cv::Point(200,100), cv::Point(100,200)};
+    std::vector<cv::Point> handcrafted_polygon_1_2 = {cv::Point(300,350), cv::Point(350,300), cv::Point(300,250), cv::Point(250,300)};
+    std::vector<std::vector<cv::Point>> contours = {handcrafted_polygon_1_1, handcrafted_polygon_1_2};
+    return contours;
+}
 
-            for(const auto& position:path)
-            {
-                cv::circle(vis_map, cv::Point(position.x, position.y), robot_radius, cv::Scalar(255, 204, 153), -1);
-                cv::imshow("map", vis_map);
-                cv::waitKey(time_interval);
+std::vector<std::vector<cv::Point>> ConstructHandcraftedContours2()
+{
+    std::vector<cv::Point> handcrafted_polygon_2 = {cv::Point(125,125), cv::Point(125,175), cv::Point(225,175), cv::Point(225,225),
+                                                    cv::Point(175,250), cv::Point(225,300), cv::Point(125,325), cv::Point(125,375),
+                                                    cv::Point(375,375), cv::Point(375,325), cv::Point(275,325), cv::Point(275,275),
+                                                    cv::Point(325,250), cv::Point(275,200), cv::Point(375,175), cv::Point(375,125)};
+    std::vector<std::vector<cv::Point>> contours = {handcrafted_polygon_2};
+    return contours;
+}
 
-                cv::circle(vis_map, cv::Point(position.x, position.y), robot_radius, cv::Scalar(255, 229, 204), -1);
-            }
-            break;
-        default:
-            break;
-    }
+std::vector<std::vector<cv::Point>> ConstructHandcraftedContours3()
+{
+    std::vector<cv::Point> handcrafted_polygon_3 = {cv::Point(100,100), cv::Point(100,500), cv::Point(150,500), cv::Point(150,150),
+                                                    cv::Point(450,150), cv::Point(450,300), cv::Point(300,300), cv::Point(300,250),
+                                                    cv::Point(350,250), cv::Point(350,200), cv::Point(250,200), cv::Point(250,350),
+                                                    cv::Point(500,350), cv::Point(500,100)};
+    std::vector<std::vector<cv::Point>> contours = {handcrafted_polygon_3};
+    return contours;
+}
 
-    cv::waitKey(0);
+std::vector<std::vector<cv::Point>> ConstructHandcraftedContours4()
+{
+    std::vector<cv::Point> handcrafted_polygon_4_1 = {cv::Point(20,20),  cv::Point(20,200), cv::Point(100,200),cv::Point(100,399),
+                                                      cv::Point(20,399), cv::Point(20, 579),cv::Point(200,579),cv::Point(200,499),cv::Point(399,499),cv::Point(399,579),
+                                                      cv::Point(579,579),cv::Point(579,399),cv::Point(499,399),cv::Point(499,200),cv::Point(579,200),cv::Point(579,20),
+                                                      cv::Point(349,20), cv::Point(349,100),cv::Point(250,100),cv::Point(250,20)};
+    std::vector<cv::Point> handcrafted_polygon_4_2 = {cv::Point(220,220),cv::Point(220,380),cv::Point(380,380),cv::Point(380,220)};
+    std::vector<std::vector<cv::Point>> contours = {handcrafted_polygon_4_1, handcrafted_polygon_4_2};
+    return contours;
 }
 
+/** 动态地图路径规划测试多边形 **/
+std::vector<std::vector<cv::Point>> ConstructHandcraftedContours5()
+{
+    std::vector<cv::Point> handcrafted_polygon_5_1 = {cv::Point(125, 50), cv::Point(50, 125), cv::Point(125, 200), cv::Point(200, 125)};
+    std::vector<cv::Point> handcrafted_polygon_5_2 = {cv::Point(80, 300), cv::Point(80, 400), cv::Point(160, 400), cv::Point(120, 350),
+                                                      cv::Point(160, 300)};
+    std::vector<cv::Point> handcrafted_polygon_5_3 = {cv::Point(100, 450), cv::Point(100, 550), cv::Point(140, 550), cv::Point(140, 450)};
+    std::vector<cv::Point> handcrafted_polygon_5_4 = {cv::Point(300, 150), cv::Point(300, 250), cv::Point(400, 220), cv::Point(400, 180)};
+    std::vector<std::vector<cv::Point>> contours = {handcrafted_polygon_5_1, handcrafted_polygon_5_2, handcrafted_polygon_5_3, handcrafted_polygon_5_4};
+    return contours;
+}
 
 
+/** 分解回归测试多边形: 第一个为外墙(整幅画布), 其余为障碍物, 均截取自逐像素分解出错的随机地图 **/
+// 开/合操作曾把同一列上障碍物另一侧的边界当作cell的新ceiling/floor
+std::vector<std::vector<cv::Point>> ConstructRegressionContours1()
+{
+    std::vector<cv::Point> regression_wall_1 = {cv::Point(0,0), cv::Point(0,106), cv::Point(104,106), cv::Point(104,0)};
+    std::vector<cv::Point> regression_polygon_1 = {cv::Point(39,10), cv::Point(37,12), cv::Point(35,36), cv::Point(18,34), cv::Point(12,34), cv::Point(10,36),
+                                                   cv::Point(28,52), cv::Point(28,54), cv::Point(11,72), cv::Point(13,74), cv::Point(16,74), cv::Point(36,71),
+                                                   cv::Point(38,73), cv::Point(39,89), cv::Point(40,94), cv::Point(42,96), cv::Point(56,74), cv::Point(77,86),
+                                                   cv::Point(79,83), cv::Point(70,62), cv::Point(74,59), cv::Point(85,56), cv::Point(94,51), cv::Point(90,48),
+                                                   cv::Point(76,45), cv::Point(70,42), cv::Point(77,20), cv::Point(75,17), cv::Point(56,31), cv::Point(54,31)};
+    std::vector<std::vector<cv::Point>> contours = {regression_wall_1, regression_polygon_1};
+    return contours;
+}
 
+// 星形障碍物的尖角在某列只有一个像素厚, 其CEILING曾排在FLOOR之前, 计数分到了错误的cell
+std::vector<std::vector<cv::Point>> ConstructRegressionContours2()
+{
+    std::vector<cv::Point> regression_wall_2 = {cv::Point(0,0), cv::Point(0,77), cv::Point(86,77), cv::Point(86,0)};
+    std::vector<cv::Point> regression_polygon_2 = {cv::Point(27,10), cv::Point(25,14), cv::Point(28,30), cv::Point(10,39), cv::Point(28,48), cv::Point(25,63),
+                                                   cv::Point(27,67), cv::Point(41,56), cv::Point(46,57), cv::Point(58,67), cv::Point(60,65), cv::Point(60,62),
+                                                   cv::Point(57,48), cv::Point(76,39), cv::Point(57,30), cv::Point(60,15), cv::Point(60,12), cv::Point(58,10),
+                                                   cv::Point(44,22), cv::Point(40,21)};
+    std::vector<std::vector<cv::Point>> contours = {regression_wall_2, regression_polygon_2};
+    return contours;
+}
 
-/** 生成运动指令 **/
-
-
-/** 两个输入参数都需要是单位向量, 输出的偏航角为正，则是顺时针旋转，为负则是逆时针旋转 **/
-double ComputeYaw(Eigen::Vector2d curr_direction, Eigen::Vector2d base_direction)
+// 两个不规则障碍物左端的凹凸使同一cell在同一列收到两个ceiling点
+std::vector<std::vector<cv::Point>> ConstructRegressionContours3()
 {
-    double yaw = std::atan2(curr_direction[1], curr_direction[0]) - std::atan2(base_direction[1], base_direction[0]);
+    std::vector<cv::Point> regression_wall_3 = {cv::Point(0,0), cv::Point(0,244), cv::Point(38,244), cv::Point(38,0)};
+    std::vector<cv::Point> regression_polygon_3_1 = {cv::Point(21,216), cv::Point(18,219), cv::Point(15,218), cv::Point(13,220), cv::Point(14,222), cv::Point(11,225),
+                                                     cv::Point(14,228), cv::Point(13,231), cv::Point(15,233), cv::Point(18,231), cv::Point(21,234), cv::Point(24,230),
+                                                     cv::Point(28,228), cv::Point(25,225), cv::Point(27,222)};
+    std::vector<cv::Point> regression_polygon_3_2 = {cv::Point(20,10), cv::Point(18,12), cv::Point(15,11), cv::Point(10,17), cv::Point(13,20), cv::Point(12,22),
+                                                     cv::Point(14,24), cv::Point(17,23), cv::Point(20,26), cv::Point(26,20), cv::Point(24,18), cv::Point(26,15)};
+    std::vector<std::vector<cv::Point>> contours = {regression_wall_3, regression_polygon_3_1, regression_polygon_3_2};
+    return contours;
+}
 
-    if(yaw > M_PI)
-    {
-        yaw -= 2*M_PI;
-    }
-    if(yaw < (-M_PI))
+/** 事件分类回归测试数据: contours中第一个为外墙, 其余为障碍物; 每个多边形给出按跟踪顺序的临界事件(MIDDLE/CEILING/FLOOR以外的事件)和CEILING/FLOOR的个数 **/
+class EventTypeRegressionCase
+{
+public:
+    EventTypeRegressionCase()
     {
-        yaw += 2*M_PI;
+        map_size = 0;
     }
 
-    yaw = yaw / M_PI * 180.0;
-
-    return yaw;
-}
+    std::string name;
+    int map_size;
+    std::vector<std::vector<cv::Point>> contours;
+    std::vector<std::vector<std::pair<Point2D, EventType>>> critical_events;
+    std::vector<std::pair<int, int>> ceiling_floor_nums;
+};
 
-/** 单位为米 **/
-double ComputeDistance(const Point2D& start, const Point2D& end, double meters_per_pix)
+// 四个用例合起来覆盖全部事件类型, 期望值由原来逐点级联比较的分类得到
+std::vector<EventTypeRegressionCase> ConstructEventTypeRegressionCases()
 {
-    double dist = std::sqrt(std::pow((end.x-start.x),2)+std::pow((end.y-start.y),2));
-    dist = dist * meters_per_pix;
-    return dist;
+    std::vector<EventTypeRegressionCase> cases(4);
+
+    cases[0].name = "rectangle room, diamond obstacle";
+    cases[0].map_size = 16;
+    cases[0].contours = {{cv::Point(1,1), cv::Point(1,14), cv::Point(14,14), cv::Point(14,1)},
+                         {cv::Point(4,7), cv::Point(7,4), cv::Point(10,7), cv::Point(7,10)}};
+    cases[0].critical_events = {{{Point2D(1,1), IN_TOP_EX}, {Point2D(1,14), IN_BOTTOM_EX}, {Point2D(14,14), OUT_BOTTOM_EX}, {Point2D(14,1), OUT_TOP_EX}},
+                                {{Point2D(4,7), IN}, {Point2D(10,7), OUT}}};
+    cases[0].ceiling_floor_nums = {{12, 12}, {5, 5}};
+
+    cases[1].name = "notched room, notched obstacles";
+    cases[1].map_size = 24;
+    cases[1].contours = {{cv::Point(1,1), cv::Point(1,10), cv::Point(6,12), cv::Point(1,14), cv::Point(1,22), cv::Point(22,22), cv::Point(22,16), cv::Point(17,16), cv::Point(17,8), cv::Point(22,8), cv::Point(22,1)},
+                         {cv::Point(8,3), cv::Point(8,7), cv::Point(14,7), cv::Point(14,6), cv::Point(11,6), cv::Point(11,4), cv::Point(14,4), cv::Point(14,3)},
+                         {cv::Point(8,17), cv::Point(10,19), cv::Point(15,19), cv::Point(15,15), cv::Point(10,15)}};
+    cases[1].critical_events = {{{Point2D(1,1), IN_TOP_EX}, {Point2D(1,10), IN_BOTTOM_EX}, {Point2D(6,12), INNER_OUT_EX}, {Point2D(1,14), IN_TOP_EX}, {Point2D(1,22), IN_BOTTOM_EX}, {Point2D(22,22), OUT_BOTTOM_EX}, {Point2D(22,16), OUT_TOP_EX}, {Point2D(17,16), INNER_IN_BOTTOM_EX}, {Point2D(17,8), INNER_IN_TOP_EX}, {Point2D(22,8), OUT_BOTTOM_EX}, {Point2D(22,1), OUT_TOP_EX}},
+                                {{Point2D(8,3), IN_TOP}, {Point2D(8,7), IN_BOTTOM}, {Point2D(14,7), OUT_BOTTOM}, {Point2D(14,6), OUT_TOP}, {Point2D(11,6), INNER_IN_BOTTOM}, {Point2D(11,4), INNER_IN_TOP}, {Point2D(14,4), OUT_BOTTOM}, {Point2D(14,3), OUT_TOP}},
+                                {{Point2D(8,17), IN}, {Point2D(15,19), OUT_BOTTOM}, {Point2D(15,15), OUT_TOP}}};
+    cases[1].ceiling_floor_nums = {{28, 28}, {7, 7}, {6, 6}};
+
+    cases[2].name = "diamond room, V-notched obstacle";
+    cases[2].map_size = 25;
+    cases[2].contours = {{cv::Point(1,12), cv::Point(12,23), cv::Point(23,12), cv::Point(12,1)},
+                         {cv::Point(8,8), cv::Point(8,14), cv::Point(14,14), cv::Point(11,11), cv::Point(14,8)}};
+    cases[2].critical_events = {{{Point2D(1,12), IN_EX}, {Point2D(23,12), OUT_EX}},
+                                {{Point2D(8,8), IN_TOP}, {Point2D(8,14), IN_BOTTOM}, {Point2D(14,14), OUT}, {Point2D(11,11), INNER_IN}, {Point2D(14,8), OUT}}};
+    cases[2].ceiling_floor_nums = {{21, 21}, {7, 7}};
+
+    cases[3].name = "room notched from both sides, obstacles notched from the left";
+    cases[3].map_size = 32;
+    cases[3].contours = {{cv::Point(1,1), cv::Point(1,8), cv::Point(8,8), cv::Point(8,12), cv::Point(1,12), cv::Point(1,30), cv::Point(30,30), cv::Point(30,20), cv::Point(22,17), cv::Point(30,14), cv::Point(30,1)},
+                         {cv::Point(5,17), cv::Point(8,20), cv::Point(5,23), cv::Point(12,23), cv::Point(12,17)},
+                         {cv::Point(12,3), cv::Point(12,5), cv::Point(15,5), cv::Point(15,7), cv::Point(12,7), cv::Point(12,9), cv::Point(19,9), cv::Point(19,3)}};
+    cases[3].critical_events = {{{Point2D(1,1), IN_TOP_EX}, {Point2D(1,8), IN_BOTTOM_EX}, {Point2D(8,8), INNER_OUT_TOP_EX}, {Point2D(8,12), INNER_OUT_BOTTOM_EX}, {Point2D(1,12), IN_TOP_EX}, {Point2D(1,30), IN_BOTTOM_EX}, {Point2D(30,30), OUT_BOTTOM_EX}, {Point2D(30,20), OUT_TOP_EX}, {Point2D(22,17), INNER_IN_EX}, {Point2D(30,14), OUT_BOTTOM_EX}, {Point2D(30,1), OUT_TOP_EX}},
+                                {{Point2D(5,17), IN}, {Point2D(8,20), INNER_OUT}, {Point2D(5,23), IN}, {Point2D(12,23), OUT_BOTTOM}, {Point2D(12,17), OUT_TOP}},
+                                {{Point2D(12,3), IN_TOP}, {Point2D(12,5), IN_BOTTOM}, {Point2D(15,5), INNER_OUT_TOP}, {Point2D(15,7), INNER_OUT_BOTTOM}, {Point2D(12,7), IN_TOP}, {Point2D(12,9), IN_BOTTOM}, {Point2D(19,9), OUT_BOTTOM}, {Point2D(19,3), OUT_TOP}}};
+    cases[3].ceiling_floor_nums = {{41, 41}, {8, 8}, {8, 8}};
+
+    return cases;
 }
 
-class NavigationMessage
+
+
+/**
+ * 随机地图: 房间是轴对齐或旋转了随机角度的矩形, 边上挖掉若干矩形缺口成为L/U形等凹多边形;
+ * 房间内随机放置互不接触的凸障碍物(旋转矩形、椭圆内接多边形)和凹障碍物(L形、星形). 同一组参数和种子生成的地图相同.
+ **/
+class RandomMapOptions
 {
 public:
-    NavigationMessage()
-    {
-        foward_distance = 0.0;
-        global_yaw_angle = 0.0;
-        local_yaw_angle = 0.0;
-    }
-    void SetDistance(double dist)
-    {
-        foward_distance = dist;
-    }
-    void SetGlobalYaw(double global_yaw)
-    {
-        global_yaw_angle = global_yaw;
-    }
-    void SetLocalYaw(double local_yaw)
-    {
-        local_yaw_angle = local_yaw;
-    }
+    RandomMapOptions()
+    {
+        width = 1000;
+        height = 1000;
+        obstacle_num = 100;
+        rotated_room = false;
+        notch_num = 2;
+        concave_ratio = 0.5;
+        obstacle_coverage = 0.2;
+        min_gap = 8;
+        seed = 0;
+    }
+
+    int width;
+    int height;
+    int obstacle_num;
+    bool rotated_room;
+    int notch_num;
+    double concave_ratio;       // 凹障碍物所占的比例
+    double obstacle_coverage;   // 障碍物总面积约占房间面积的比例, 由此确定单个障碍物的大小
+    int min_gap;                // 障碍物之间、障碍物与墙之间至少留出的空闲像素, 应大于膨胀半径的两倍, 否则膨胀后会连成一片
+    unsigned int seed;
+};
 
-    double GetDistance()
+std::vector<cv::Point> TransformPolygon(const std::vector<cv::Point2d>& local_polygon, const cv::Point2d& center, double angle)
+{
+    std::vector<cv::Point> polygon;
+    double cos_angle = std::cos(angle), sin_angle = std::sin(angle);
+    for(const auto& point : local_polygon)
     {
-        return foward_distance;
+        polygon.emplace_back(cv::Point(int(std::lround(center.x + cos_angle*point.x - sin_angle*point.y)),
+                                       int(std::lround(center.y + sin_angle*point.x + cos_angle*point.y))));
     }
+    return polygon;
+}
 
-    double GetGlobalYaw()
+// 以原点为中心、尺寸约为size的障碍物轮廓
+std::vector<cv::Point2d> GenerateLocalObstacle(std::mt19937& generator, double size, bool concave)
+{
+    std::uniform_real_distribution<double> unit_distribution(0.0, 1.0);
+    std::uniform_int_distribution<int> shape_distribution(0, 1);
+    std::vector<cv::Point2d> polygon;
+
+    if(!concave && shape_distribution(generator) == 0)
     {
-        return global_yaw_angle;
+        double half_width = size*(0.5+0.5*unit_distribution(generator));
+        double half_height = size*(0.5+0.5*unit_distribution(generator));
+        polygon = {cv::Point2d(-half_width, -half_height), cv::Point2d(-half_width, half_height),
+                   cv::Point2d(half_width, half_height), cv::Point2d(half_width, -half_height)};
     }
-
-    double GetLocalYaw()
+    else if(!concave)
     {
-        return local_yaw_angle;
+        // 椭圆上取随机角度的点, 按角度排序后一定是凸多边形
+        int vertex_num = 5 + int(unit_distribution(generator)*4);
+        double minor_ratio = 0.5 + 0.5*unit_distribution(generator);
+        std::vector<double> angles;
+        for(int i = 0; i < vertex_num; i++)
+        {
+            angles.emplace_back(2*M_PI*unit_distribution(generator));
+        }
+        std::sort(angles.begin(), angles.end());
+        for(double angle : angles)
+        {
+            polygon.emplace_back(cv::Point2d(size*std::cos(angle), size*minor_ratio*std::sin(angle)));
+        }
     }
-
-    void GetMotion(double& dist, double& global_yaw, double& local_yaw)
+    else if(shape_distribution(generator) == 0)
     {
-        dist = foward_distance;
-        global_yaw = global_yaw_angle;
-        local_yaw = local_yaw_angle;
+        double cut = size*(0.6+0.8*unit_distribution(generator));
+        polygon = {cv::Point2d(-size, -size), cv::Point2d(-size, size), cv::Point2d(size, size),
+                   cv::Point2d(size, -size + cut), cv::Point2d(-size + cut, -size + cut), cv::Point2d(-size + cut, -size)};
     }
-    void Reset()
+    else
     {
-        foward_distance = 0.0;
-        global_yaw_angle = 0.0;
-        local_yaw_angle = 0.0;
+        int spike_num = 5 + int(unit_distribution(generator)*3);
+        for(int i = 0; i < 2*spike_num; i++)
+        {
+            double radius = (i % 2 == 0) ? size : 0.45*size;
+            double angle = M_PI*i/spike_num;
+            polygon.emplace_back(cv::Point2d(radius*std::cos(angle), radius*std::sin(angle)));
+        }
     }
 
-private:
-    double foward_distance;
-    // 欧拉角表示，逆时针为正，顺时针为负
-    double global_yaw_angle;
-    double local_yaw_angle;
-};
+    return polygon;
+}
 
-std::vector<NavigationMessage> GetNavigationMessage(const Eigen::Vector2d& curr_direction, std::deque<Point2D> pos_path, double meters_per_pix)
+// 生成的障碍物轮廓写入obstacles, 放不下时实际数量会少于options.obstacle_num
+cv::Mat1b GenerateRandomMap(const RandomMapOptions& options, std::vector<std::vector<cv::Point>>& obstacles)
 {
-    // initialization
-    Eigen::Vector2d global_base_direction = {0, -1}; // {x, y}
-    Eigen::Vector2d local_base_direction = curr_direction;
-
-    Eigen::Vector2d curr_local_direction;
-    Eigen::Vector2d curr_global_direction;
-
-    NavigationMessage message;
-    std::vector<NavigationMessage> message_queue;
-
-    double distance = 0.0;
-    double step_distance = 0.0;
+    std::mt19937 generator(options.seed);
+    std::uniform_real_distribution<double> unit_distribution(0.0, 1.0);
 
-    double prev_global_yaw = ComputeYaw(curr_direction, global_base_direction);
+    cv::Mat1b map = cv::Mat1b(cv::Size(options.width, options.height), CV_8U);
+    map.setTo(0);
 
-    double curr_global_yaw = 0.0;
-    double curr_local_yaw = 0.0;
+    // 房间: 旋转后的外接框也要留在地图内
+    int margin = 2;
+    double room_angle = options.rotated_room ? 0.5*M_PI*unit_distribution(generator) : 0.0;
+    double cos_angle = std::abs(std::cos(room_angle)), sin_angle = std::abs(std::sin(room_angle));
+    double half_width = options.width/2.0, half_height = options.height/2.0;
+    double scale = std::min((half_width-margin)/(half_width*cos_angle + half_height*sin_angle),
+                            (half_height-margin)/(half_width*sin_angle + half_height*cos_angle));
+    double room_half_width = half_width*scale, room_half_height = half_height*scale;
+    cv::Point2d center(half_width, half_height);
 
-    message.SetGlobalYaw(DBL_MAX);
-    message.SetLocalYaw(DBL_MAX);
+    std::vector<cv::Point2d> room = {cv::Point2d(-room_half_width, -room_half_height), cv::Point2d(-room_half_width, room_half_height),
+                                     cv::Point2d(room_half_width, room_half_height), cv::Point2d(room_half_width, -room_half_height)};
+    cv::fillPoly(map, std::vector<std::vector<cv::Point>>{TransformPolygon(room, center, room_angle)}, cv::Scalar(255));
 
-    for(int i = 0; i < pos_path.size()-1; i++)
+    // 缺口: 沿某条边放置的矩形, 向外伸出房间, 靠近角落时房间成为L形
+    std::vector<std::vector<cv::Point>> notches;
+    for(int i = 0; i < options.notch_num; i++)
     {
-        if(pos_path[i+1]==pos_path[i])
+        double notch_width = room_half_width*(0.2+0.5*unit_distribution(generator));
+        double notch_height = room_half_height*(0.2+0.5*unit_distribution(generator));
+        double u = (2*unit_distribution(generator)-1)*room_half_width;
+        double v = (2*unit_distribution(generator)-1)*room_half_height;
+        std::vector<cv::Point2d> notch;
+        switch(i % 4)
         {
-            continue;
+            case 0: notch = {cv::Point2d(u, -room_half_height-1), cv::Point2d(u+notch_width, -room_half_height-1),
+                             cv::Point2d(u+notch_width, -room_half_height+notch_height), cv::Point2d(u, -room_half_height+notch_height)}; break;
+            case 1: notch = {cv::Point2d(u, room_half_height+1), cv::Point2d(u+notch_width, room_half_height+1),
+                             cv::Point2d(u+notch_width, room_half_height-notch_height), cv::Point2d(u, room_half_height-notch_height)}; break;
+            case 2: notch = {cv::Point2d(-room_half_width-1, v), cv::Point2d(-room_half_width-1, v+notch_height),
+                             cv::Point2d(-room_half_width+notch_width, v+notch_height), cv::Point2d(-room_half_width+notch_width, v)}; break;
+            default: notch = {cv::Point2d(room_half_width+1, v), cv::Point2d(room_half_width+1, v+notch_height),
+                              cv::Point2d(room_half_width-notch_width, v+notch_height), cv::Point2d(room_half_width-notch_width, v)}; break;
         }
-        else
+        notches.emplace_back(TransformPolygon(notch, center, room_angle));
+    }
+    if(!notches.empty())
+    {
+        cv::fillPoly(map, notches, cv::Scalar(0));
+    }
+
+    // 障碍物大小由覆盖比例决定: 总面积 ≈ obstacle_num * pi * size^2
+    int free_num = 0;
+    for(int i = 0; i < map.rows; i++)
+    {
+        for(int j = 0; j < map.cols; j++)
         {
-            curr_local_direction = {pos_path[i+1].x-pos_path[i].x, pos_path[i+1].y-pos_path[i].y};
-            curr_local_direction.normalize();
+            free_num += (map(i, j) == 255);
+        }
+    }
+    double size = std::max(3.0, std::sqrt(options.obstacle_coverage*free_num/(std::max(options.obstacle_num, 1)*M_PI)));
 
-            curr_global_yaw = ComputeYaw(curr_local_direction, global_base_direction);
-            curr_local_yaw = ComputeYaw(curr_local_direction, local_base_direction);
+    cv::Mat1b occupied = cv::Mat1b(map.size(), CV_8U);
+    occupied.setTo(0);
 
-            if(message.GetGlobalYaw()==DBL_MAX) // initialization
-            {
-                message.SetGlobalYaw(curr_global_yaw);
-            }
+    obstacles.clear();
+    for(int attempt = 0; attempt < options.obstacle_num*20 && obstacles.size() < options.obstacle_num; attempt++)
+    {
+        bool concave = unit_distribution(generator) < options.concave_ratio;
+        std::vector<cv::Point2d> local_obstacle = GenerateLocalObstacle(generator, size*(0.6+0.8*unit_distribution(generator)), concave);
+        cv::Point2d obstacle_center(unit_distribution(generator)*map.cols, unit_distribution(generator)*map.rows);
+        std::vector<cv::Point> obstacle = TransformPolygon(local_obstacle, obstacle_center, 2*M_PI*unit_distribution(generator));
 
-            if(message.GetLocalYaw()==DBL_MAX) // initialization
-            {
-                message.SetLocalYaw(curr_local_yaw);
-            }
+        int x_min = INT_MAX, y_min = INT_MAX, x_max = INT_MIN, y_max = INT_MIN;
+        for(const auto& point : obstacle)
+        {
+            x_min = std::min(x_min, point.x - options.min_gap);
+            y_min = std::min(y_min, point.y - options.min_gap);
+            x_max = std::max(x_max, point.x + options.min_gap);
+            y_max = std::max(y_max, point.y + options.min_gap);
+        }
+        if(x_min < 0 || y_min < 0 || x_max >= map.cols || y_max >= map.rows)
+        {
+            continue;
+        }
 
-            if(curr_global_yaw == prev_global_yaw)
-            {
-                step_distance = ComputeDistance(pos_path[i+1], pos_path[i], meters_per_pix);
-                distance += step_distance;
-            }
-            else
+        bool isFree = true;
+        for(int i = y_min; i <= y_max && isFree; i++)
+        {
+            for(int j = x_min; j <= x_max; j++)
             {
-                message.SetDistance(distance);
-                message_queue.emplace_back(message);
-
-                message.Reset();
-                message.SetGlobalYaw(curr_global_yaw);
-                message.SetLocalYaw(curr_local_yaw);
-
-                distance = 0.0;
-                step_distance = ComputeDistance(pos_path[i+1], pos_path[i], meters_per_pix);
-                distance += step_distance;
+                if(map(i, j) != 255 || occupied(i, j) != 0)
+                {
+                    isFree = false;
+                    break;
+                }
             }
-            prev_global_yaw = curr_global_yaw;
-
-            local_base_direction = curr_local_direction;
         }
+        if(!isFree)
+        {
+            continue;
+        }
+
+        obstacles.emplace_back(obstacle);
+        cv::rectangle(occupied, cv::Point(x_min, y_min), cv::Point(x_max, y_max), cv::Scalar(255), -1);
     }
 
-    message.SetDistance(distance);
-    message_queue.emplace_back(message);
+    if(!obstacles.empty())
+    {
+        cv::fillPoly(map, obstacles, cv::Scalar(0));
+    }
 
-    return message_queue;
+    return map;
 }
 
+/** 测试辅助函数 **/
 
 
+void CheckObstaclePointType(cv::Mat& map, const OccupancyGrid& occupancy_grid, const Polygon& obstacle)
+{
+    PolygonList obstacles = {obstacle};
 
-/** 动态路径规划（未完成） **/
-
+    std::vector<Event> event_list = GenerateObstacleEventList(occupancy_grid, obstacles);
 
-// 待重写
-const int UP = 0, UPRIGHT = 1, RIGHT = 2, DOWNRIGHT = 3, DOWN = 4, DOWNLEFT = 5, LEFT = 6, UPLEFT = 7, CENTER = 8;
-const std::vector<int> map_directions = {UP, UPRIGHT, RIGHT, DOWNRIGHT, DOWN, DOWNLEFT, LEFT, UPLEFT};
+    for(auto event: event_list)
+    {
+        if(event.event_type == IN)
+        {
+            std::cout<<event.x<<", "<<event.y<<", IN"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
+        }
+        if(event.event_type == IN_TOP)
+        {
+            std::cout<<event.x<<", "<<event.y<<", IN_TOP"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
+        }
+        if(event.event_type == IN_BOTTOM)
+        {
+            std::cout<<event.x<<", "<<event.y<<", IN_BOTTOM"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
+        }
+        if(event.event_type == OUT)
+        {
+            std::cout<<event.x<<", "<<event.y<<", OUT"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+        }
+        if(event.event_type == OUT_TOP)
+        {
+            std::cout<<event.x<<", "<<event.y<<", OUT_TOP"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+        }
+        if(event.event_type == OUT_BOTTOM)
+        {
+            std::cout<<event.x<<", "<<event.y<<", OUT_BOTTOM"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+        }
+        if(event.event_type == INNER_IN)
+        {
+            std::cout<<event.x<<", "<<event.y<<", INNER_IN"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
+        }
+        if(event.event_type == INNER_IN_TOP)
+        {
+            std::cout<<event.x<<", "<<event.y<<", INNER_IN_TOP"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
+        }
+        if(event.event_type == INNER_IN_BOTTOM)
+        {
+            std::cout<<event.x<<", "<<event.y<<", INNER_IN_BOTTOM"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
+        }
+        if(event.event_type == INNER_OUT)
+        {
+            std::cout<<event.x<<", "<<event.y<<", INNER_OUT"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+        }
+        if(event.event_type == INNER_OUT_TOP)
+        {
+            std::cout<<event.x<<", "<<event.y<<", INNER_OUT_TOP"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+        }
+        if(event.event_type == INNER_OUT_BOTTOM)
+        {
+            std::cout<<event.x<<", "<<event.y<<", INNER_OUT_BOTTOM"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+        }
+        if(event.event_type == MIDDLE)
+        {
+            map.at<cv::Vec3b>(event.y, event.x) = cv::Vec3b(50, 50 ,50);
+        }
+        if(event.event_type == CEILING)
+        {
+            map.at<cv::Vec3b>(event.y, event.x) = cv::Vec3b(0, 255 ,255);
+        }
+        if(event.event_type == FLOOR)
+        {
+            map.at<cv::Vec3b>(event.y, event.x) = cv::Vec3b(255, 0 ,0);
+        }
+    }
+}
 
-int GetFrontDirection(const Point2D& curr_pos, const Point2D& next_pos)
+void CheckWallPointType(cv::Mat& map, const OccupancyGrid& occupancy_grid, const Polygon& wall)
 {
-    int delta_x = next_pos.x - curr_pos.x;
-    int delta_y = next_pos.y - curr_pos.y;
-
-    if(delta_y < 0)
+    std::vector<Event> event_list = GenerateWallEventList(occupancy_grid, wall);
+    for(auto event: event_list)
     {
-        if(delta_x == 0)
+        if(event.event_type == IN_EX)
         {
-            return UP;
+            std::cout<<event.x<<", "<<event.y<<", IN_EX"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
         }
-        if(delta_x < 0)
+        if(event.event_type == IN_TOP_EX)
         {
-            return UPLEFT;
+            std::cout<<event.x<<", "<<event.y<<", IN_TOP_EX"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
         }
-        if(delta_x > 0)
+        if(event.event_type == IN_BOTTOM_EX)
         {
-            return UPRIGHT;
+            std::cout<<event.x<<", "<<event.y<<", IN_BOTTOM_EX"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
         }
-    }
-
-    if(delta_y > 0)
-    {
-        if(delta_x == 0)
+        if(event.event_type == OUT_EX)
         {
-            return DOWN;
+            std::cout<<event.x<<", "<<event.y<<", OUT_EX"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
         }
-        if(delta_x < 0)
+        if(event.event_type == OUT_TOP_EX)
         {
-            return DOWNLEFT;
+            std::cout<<event.x<<", "<<event.y<<", OUT_TOP_EX"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
         }
-        if(delta_x > 0)
+        if(event.event_type == OUT_BOTTOM_EX)
         {
-            return DOWNRIGHT;
+            std::cout<<event.x<<", "<<event.y<<", OUT_BOTTOM_EX"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
         }
-    }
-
-    if(delta_y == 0)
-    {
-        if(delta_x == 0)
+        if(event.event_type == INNER_IN_EX)
         {
-            return CENTER;
+            std::cout<<event.x<<", "<<event.y<<", INNER_IN_EX"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
         }
-        if(delta_x < 0)
+        if(event.event_type == INNER_IN_TOP_EX)
         {
-            return LEFT;
+            std::cout<<event.x<<", "<<event.y<<", INNER_IN_TOP_EX"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
         }
-        if(delta_x > 0)
+        if(event.event_type == INNER_IN_BOTTOM_EX)
         {
-            return RIGHT;
+            std::cout<<event.x<<", "<<event.y<<", INNER_IN_BOTTOM_EX"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
+        }
+        if(event.event_type == INNER_OUT_EX)
+        {
+            std::cout<<event.x<<", "<<event.y<<", INNER_OUT_EX"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+        }
+        if(event.event_type == INNER_OUT_TOP_EX)
+        {
+            std::cout<<event.x<<", "<<event.y<<", INNER_OUT_TOP_EX"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+        }
+        if(event.event_type == INNER_OUT_BOTTOM_EX)
+        {
+            std::cout<<event.x<<", "<<event.y<<", INNER_OUT_BOTTOM_EX"<<std::endl;
+            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+        }
+        if(event.event_type == MIDDLE)
+        {
+            map.at<cv::Vec3b>(event.y, event.x) = cv::Vec3b(50, 50 ,50);
+        }
+        if(event.event_type == CEILING)
+        {
+            map.at<cv::Vec3b>(event.y, event.x) = cv::Vec3b(0, 255 ,255);
+        }
+        if(event.event_type == FLOOR)
+        {
+            map.at<cv::Vec3b>(event.y, event.x) = cv::Vec3b(255, 0 ,0);
         }
     }
 }
 
-int GetBackDirection(int front_direction)
+void CheckPointType(const cv::Mat& map, const Polygon& wall, const PolygonList& obstacles)
 {
-    if(front_direction + 4 >= map_directions.size())
-    {
-        int index_offset = front_direction + 4 - map_directions.size();
-        return map_directions[index_offset];
-    }
-    else
-    {
-        return map_directions[front_direction+4];
-    }
-}
+    cv::Mat vis_map = map.clone();
+    cv::cvtColor(vis_map, vis_map, cv::COLOR_GRAY2BGR);
 
-int GetLeftDirection(int front_direction)
-{
-    if(front_direction - 2 < 0)
-    {
-        int index_offset = 2 - front_direction;
-        return map_directions[map_directions.size()-index_offset];
-    }
-    else
+    // 事件类型只看原始地图, 不受画在vis_map上的标记影响
+    OccupancyGrid occupancy_grid = ConstructOccupancyGrid(map, cv::Vec3b(0, 0, 0));
+
+    cv::namedWindow("map", cv::WINDOW_NORMAL);
+
+    for(const auto& obstacle:obstacles)
     {
-        return map_directions[front_direction-2];
+        CheckObstaclePointType(vis_map, occupancy_grid, obstacle);
+        cv::imshow("map", vis_map);
+        cv::waitKey(0);
+        std::cout<<std::endl;
     }
+
+    CheckWallPointType(vis_map, occupancy_grid, wall);
+    cv::imshow("map", vis_map);
+    cv::waitKey(0);
 }
 
-int GetRightDirection(int front_direction)
+void CheckSlicelist(const std::deque<std::deque<Event>>& slice_list)
 {
-    if(front_direction + 2 >= map_directions.size())
-    {
-        int index_offset = front_direction + 2 - map_directions.size();
-        return map_directions[index_offset];
-    }
-    else
+    std::deque<Event> slice;
+    for(int i = 0; i < slice_list.size(); i++)
     {
-        return map_directions[front_direction+2];
+        slice = FilterSlice(slice_list[i]);
+        std::cout<<"slice "<<i<<": ";
+        for(const auto& event : slice)
+        {
+            EventType type = event.event_type;
+            switch (type)
+            {
+                case IN:
+                    std::cout<<"IN; ";
+                    break;
+                case IN_TOP:
+                    std::cout<<"IN_TOP; ";
+                    break;
+                case IN_BOTTOM:
+                    std::cout<<"IN_BOTTOM; ";
+                    break;
+                case OUT:
+                    std::cout<<"OUT; ";
+                    break;
+                case OUT_TOP:
+                    std::cout<<"OUT_TOP; ";
+                    break;
+                case OUT_BOTTOM:
+                    std::cout<<"OUT_BOTTOM; ";
+                    break;
+                case INNER_IN:
+                    std::cout<<"INNER_IN; ";
+                    break;
+                case INNER_IN_TOP:
+                    std::cout<<"INNER_IN_TOP; ";
+                    break;
+                case INNER_IN_BOTTOM:
+                    std::cout<<"INNER_IN_BOTTOM; ";
+                    break;
+                case INNER_OUT:
+                    std::cout<<"INNER_OUT; ";
+                    break;
+                case INNER_OUT_TOP:
+                    std::cout<<"INNER_OUT_TOP; ";
+                    break;
+                case INNER_OUT_BOTTOM:
+                    std::cout<<"INNER_OUT_BOTTOM; ";
+                    break;
+                case IN_EX:
+                    std::cout<<"IN_EX; ";
+                    break;
+                case IN_TOP_EX:
+                    std::cout<<"IN_TOP_EX; ";
+                    break;
+                case IN_BOTTOM_EX:
+                    std::cout<<"IN_BOTTOM_EX; ";
+                    break;
+                case OUT_EX:
+                    std::cout<<"OUT_EX; ";
+                    break;
+                case OUT_TOP_EX:
+                    std::cout<<"OUT_TOP_EX; ";
+                    break;
+                case OUT_BOTTOM_EX:
+                    std::cout<<"OUT_BOTTOM_EX; ";
+                    break;
+                case INNER_IN_EX:
+                    std::cout<<"INNER_IN_EX; ";
+                    break;
+                case INNER_IN_TOP_EX:
+                    std::cout<<"INNER_IN_TOP_EX; ";
+                    break;
+                case INNER_IN_BOTTOM_EX:
+                    std::cout<<"INNER_IN_BOTTOM_EX; ";
+                    break;
+                case INNER_OUT_EX:
+                    std::cout<<"INNER_OUT_EX; ";
+                    break;
+                case INNER_OUT_TOP_EX:
+                    std::cout<<"INNER_OUT_TOP_EX; ";
+                    break;
+                case INNER_OUT_BOTTOM_EX:
+                    std::cout<<"INNER_OUT_BOTTOM_EX; ";
+                    break;
+                case MIDDLE:
+                    std::cout<<"MIDDLE; ";
+                    break;
+                case CEILING:
+                    std::cout<<"CEILING; ";
+                    break;
+                case FLOOR:
+                    std::cout<<"FLOOR; ";
+                    break;
+                case UNALLOCATED:
+                    std::cout<<"UNALLOCATED; ";
+                    break;
+            }
+        }
+        std::cout<<std::endl;
     }
 }
 
-// 模拟机器人尝试旋转, 旋转方向都是顺时针排列
-std::vector<int> GetFrontDirectionCandidates(int front_direction)
+void CheckExtractedContours(const cv::Mat& map, const std::vector<std::vector<cv::Point>>& contours)
 {
-    std::vector<int> front_directions;
-
-    if(front_direction - 2 < 0)
-    {
-        int index_offset = 2 - front_direction;
-        front_directions.emplace_back(map_directions[map_directions.size()-index_offset]);
-    }
-    else
-    {
-        front_directions.emplace_back(map_directions[front_direction-2]);
-    }
-
-    if(front_direction - 1 < 0)
-    {
-        int index_offset = 1 - front_direction;
-        front_directions.emplace_back(map_directions[map_directions.size()-index_offset]);
-    }
-    else
-    {
-        front_directions.emplace_back(map_directions[front_direction-1]);
-    }
-
-    front_directions.emplace_back(map_directions[front_direction]);
-
+    cv::namedWindow("map", cv::WINDOW_NORMAL);
 
-    if(front_direction + 1 >= map_directions.size())
-    {
-        int index_offset = front_direction + 1 - map_directions.size();
-        front_directions.emplace_back(map_directions[index_offset]);
-    }
-    else
-    {
-        front_directions.emplace_back(map_directions[front_direction+1]);
-    }
+    cv::Mat3b canvas = cv::Mat3b(map.size(), CV_8U);
+    canvas.setTo(cv::Scalar(0,0,0));
 
-    if(front_direction + 2 >= map_directions.size())
+    for(int i = 0; i<=contours.size()-1; i++)
     {
-        int index_offset = front_direction + 2 - map_directions.size();
-        front_directions.emplace_back(map_directions[index_offset]);
+        cv::drawContours(canvas, contours, i, cv::Scalar(255, 0, 0));
+        cv::imshow("map", canvas);
+        cv::waitKey(0);
     }
-    else
+}
+
+void CheckGeneratedCells(const cv::Mat& map, const std::vector<CellNode>& cell_graph)
+{
+    cv::Mat vis_map = map.clone();
+    cv::cvtColor(vis_map, vis_map, cv::COLOR_GRAY2BGR);
+
+    cv::namedWindow("map", cv::WINDOW_NORMAL);
+
+    for(const auto& cell : cell_graph)
     {
-        front_directions.emplace_back(map_directions[front_direction+2]);
+        DrawCells(vis_map, cell, cv::Scalar(255, 0, 255));
+        cv::imshow("map", vis_map);
+        cv::waitKey(0);
     }
-
-    return front_directions;
 }
 
-std::vector<int> GetBackDirectionCandidates(int front_direction)
+// 每个cell的ceiling和floor须逐列连续且一一对应, 否则路径生成会越界读取
+bool CheckCellBoundaries(const std::vector<CellNode>& cell_graph)
 {
-    std::vector<int> back_directions;
-    int first_direction = GetRightDirection(front_direction);
-
-    for(int i = 0; i <= 4; i++)
+    bool is_valid = true;
+    for(const auto& cell : cell_graph)
     {
-        if(first_direction + i >= map_directions.size())
+        if(IsSegmentedCell(cell))
         {
-            int index_offset = first_direction + i - map_directions.size();
-            back_directions.emplace_back(map_directions[index_offset]);
+            // 分段边界由逐列合法的边界压缩而来, 只需两端对齐
+            if(cell.ceiling_segments.front().x != cell.floor_segments.front().x || cell.ceiling_segments.back().x != cell.floor_segments.back().x)
+            {
+                std::cout<<"segmented cell "<<cell.cellIndex<<" has misaligned ceiling and floor"<<std::endl;
+                is_valid = false;
+            }
+            continue;
         }
-        else
+
+        bool is_cell_valid = !cell.ceiling.empty() && cell.ceiling.size() == cell.floor.size();
+        for(int i = 0; is_cell_valid && i < cell.ceiling.size(); i++)
         {
-            back_directions.emplace_back(map_directions[first_direction + i]);
+            is_cell_valid = cell.ceiling[i].x == cell.ceiling.front().x + i && cell.floor[i].x == cell.ceiling[i].x;
+        }
+        if(!is_cell_valid)
+        {
+            std::cout<<"cell "<<cell.cellIndex<<" has "<<cell.ceiling.size()<<" ceiling points and "<<cell.floor.size()<<" floor points"<<std::endl;
+            is_valid = false;
         }
     }
+    return is_valid;
+}
 
-    return back_directions;
+void CheckPathNodes(const std::deque<std::deque<Point2D>>& path)
+{
+    for(const auto& subpath : path)
+    {
+        for(const auto& point : subpath)
+        {
+            std::cout<<point.x<<", "<<point.y<<std::endl;
+        }
+        std::cout<<std::endl;
+    }
 }
 
-std::vector<int> GetLeftDirectionCandidates(int front_direction)
+void CheckPathConsistency(const std::deque<Point2D>& path)
 {
-    std::vector<int> left_directions;
+    int breakpoints = 0;
+    int duplicates = 0;
 
-    for(int i = 4; i >= 0; i--)
+    for(int i = 1; i < path.size(); i++)
     {
-        if(front_direction - i < 0)
+        if(std::abs(path[WrappedIndex((i-1),path.size())].x-path[i].x)>1||std::abs(path[WrappedIndex((i-1),path.size())].y-path[i].y)>1)
         {
-            int index_offset = i - front_direction;
-            left_directions.emplace_back(map_directions[map_directions.size()-index_offset]);
+            breakpoints++;
+            std::cout<<"break points :"<<path[WrappedIndex((i-1),path.size())].x<<", "<<path[WrappedIndex((i-1),path.size())].y
+                     <<"---->"<<path[i].x<<", "<<path[i].y<<std::endl;
         }
-        else
+        if(path[WrappedIndex((i-1),path.size())]==path[i])
         {
-            left_directions.emplace_back(map_directions[front_direction-i]);
+            duplicates++;
         }
-    }
 
-    return left_directions;
+    }
+    std::cout<<"breakpoints: "<<breakpoints<<std::endl;
+    std::cout<<"duplicates: "<<duplicates<<std::endl;
 }
 
-std::vector<int> GetRightDirectionCandidates(int front_direction)
+void CheckClearanceMap(const cv::Mat& map, const ClearanceMap& clearance_map, int robot_radius)
 {
-    std::vector<int> right_directions;
+    int mismatches = 0;
 
-    for(int i = 0; i <= 4; i++)
+    for(int y = 0; y < map.rows; y++)
     {
-        if(front_direction + i >= map_directions.size())
-        {
-            int index_offset = front_direction + i - map_directions.size();
-            right_directions.emplace_back(map_directions[index_offset]);
-        }
-        else
+        for(int x = 0; x < map.cols; x++)
         {
-            right_directions.emplace_back(map_directions[front_direction + i]);
+            for(auto direction : map_directions)
+            {
+                if(CollisionOccurs(map, Point2D(x, y), direction, robot_radius) != CollisionOccurs(clearance_map, Point2D(x, y), direction, robot_radius))
+                {
+                    mismatches++;
+                }
+            }
         }
     }
+    std::cout<<"clearance map mismatches: "<<mismatches<<std::endl;
+}
 
-    return right_directions;
+void CheckPathCoverage(const cv::Mat1b& map, const std::deque<Point2D>& path, int robot_radius)
+{
+    CoverageReport report = EvaluateCoverage(map, path, robot_radius);
+    std::cout<<"path covers "<<report.covered_pixels<<" of "<<report.free_pixels<<" free pixels ("<<report.coverage_rate*100<<"%), "<<report.missed_pixels<<" missed"<<std::endl;
 }
 
-Point2D GetNextPosition(const Point2D& curr_pos, int direction, int steps)
+void CheckSimplifiedTrajectory(const std::deque<Point2D>& path, const std::deque<Point2D>& simplified_path)
 {
-    Point2D next_position;
+    std::cout<<"simplified trajectory from "<<path.size()<<" points to "<<simplified_path.size()<<" points"<<std::endl;
+}
 
-    switch (direction)
+void CheckMotionCommands(const std::vector<NavigationMessage>& navigation_messages)
+{
+    double dist = 0.0, global_yaw = 0.0, local_yaw = 0.0;
+    for(auto message : navigation_messages)
     {
-        case UP:
-            next_position.x = int(curr_pos.x);
-            next_position.y = int(curr_pos.y - steps);
-            return next_position;
-        case UPRIGHT:
-            next_position.x = int(curr_pos.x + steps);
-            next_position.y = int(curr_pos.y - steps);
-            return next_position;
-        case RIGHT:
-            next_position.x = int(curr_pos.x + steps);
-            next_position.y = int(curr_pos.y);
-            return next_position;
-        case DOWNRIGHT:
-            next_position.x = int(curr_pos.x + steps);
-            next_position.y = int(curr_pos.y + steps);
-            return next_position;
-        case DOWN:
-            next_position.x = int(curr_pos.x);
-            next_position.y = int(curr_pos.y + steps);
-            return next_position;
-        case DOWNLEFT:
-            next_position.x = int(curr_pos.x - steps);
-            next_position.y = int(curr_pos.y + steps);
-            return next_position;
-        case LEFT:
-            next_position.x = int(curr_pos.x - steps);
-            next_position.y = int(curr_pos.y);
-            return next_position;
-        case UPLEFT:
-            next_position.x = int(curr_pos.x - steps);
-            next_position.y = int(curr_pos.y - steps);
-            return next_position;
-        case CENTER:
-            next_position.x = int(curr_pos.x);
-            next_position.y = int(curr_pos.y);
-            return next_position;
-        default:
-            return next_position;
+        message.GetMotion(dist, global_yaw, local_yaw);
+        std::cout<<"globally rotate "<<global_yaw<<" degree(locally rotate "<<local_yaw<<" degree) and go forward for "<<dist<<" m."<<std::endl;
     }
 }
 
-// 模拟碰撞传感器信号
-bool CollisionOccurs(const cv::Mat& map, const Point2D& curr_pos, int detect_direction, int robot_radius)
+
+/** 测试用例 **/
+
+
+/** 使用图像数据 **/
+void StaticPathPlanningExample1()
 {
-    int obstacle_dist = INT_MAX;
-    Point2D ray_pos;
+    double meters_per_pix = 0.02;
+    double robot_size_in_meters = 0.15;
 
-    for(int i = 1; i <= (robot_radius+1); i++)
-    {
-        ray_pos = GetNextPosition(curr_pos, detect_direction, i);
+    int robot_radius = ComputeRobotRadius(meters_per_pix, robot_size_in_meters);
 
-        if(ray_pos.x < 0 || ray_pos.y < 0 || ray_pos.x >= map.cols || ray_pos.y >= map.rows)
-        {
-            break;
-        }
+    cv::Mat1b map = ReadMap("../map.png");
+    map = PreprocessMap(map);
 
-        if(map.at<cv::Vec3b>(ray_pos.y, ray_pos.x) == cv::Vec3b(255,255,255))
-        {
-            obstacle_dist = i;
-            break;
-        }
-    }
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    std::vector<std::vector<cv::Point>> wall_contours;
+    ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
 
-    return (obstacle_dist == (robot_radius+1));
-}
 
-// 结束返回false, 继续则返回true
-bool WalkAlongObstacle(const cv::Mat& map,      const Point2D& obstacle_origin,               const Point2D& contouring_origin,
-                       int detecting_direction, const std::vector<int>& direction_candidates,
-                       Point2D& curr_pos,       int first_turning_direction,                  int second_turning_direction,
-                       Polygon& obstacle,       Polygon& new_obstacle,                        bool& isObstacleCompleted,
-                       std::deque<Point2D>& contouring_path,                                  int robot_radius)
-{
-    bool turning = false;
-    Point2D last_curr_pos = curr_pos;
-    Point2D next_pos;
-    Point2D obstacle_point;
+    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
 
-    while(!turning)
-    {
-        for (auto direction: direction_candidates)
-        {
-            next_pos = GetNextPosition(curr_pos, direction, 1);
-            if(next_pos.x < 0 || next_pos.y < 0 || next_pos.x >= map.cols || next_pos.y >= map.rows)
-            {
-                continue;
-            }
+    Point2D start = Point2D(map.cols/2, map.rows/2);
+    std::deque<std::deque<Point2D>> original_planning_path = StaticPathPlanning(map, cell_graph, start, robot_radius, false, false);
 
-            if (CollisionOccurs(map, next_pos, detecting_direction, robot_radius))
-            {
-                contouring_path.emplace_back(next_pos);
-                curr_pos = next_pos;
-                obstacle_point = GetNextPosition(next_pos, detecting_direction, robot_radius+1);
-                if(obstacle_point.x==obstacle_origin.x && obstacle_point.y == obstacle_origin.y)
-                {
-                    if(!isObstacleCompleted)
-                    {
-                        obstacle.assign(new_obstacle.begin(), new_obstacle.end());
-                        isObstacleCompleted = true;
-                    }
-                }
-                new_obstacle.emplace_back(obstacle_point);
-                break;
-            }
-        }
-        if(curr_pos.x==last_curr_pos.x&&curr_pos.y==last_curr_pos.y)
-        {
-            turning = true;
-        }
-        else
-        {
-            last_curr_pos = curr_pos;
-        }
+    std::deque<Point2D> path = FilterTrajectory(original_planning_path);
+    CheckPathConsistency(path);
+    CheckPathCoverage(map, path, robot_radius);
 
-        if(std::find(contouring_path.begin(), (contouring_path.end()-1), next_pos)!=(contouring_path.end()-1)
-        &&contouring_path.size()>1
-        &&isObstacleCompleted)
-        {
-            return false;
-        }
-    }
-    for(int i = 1; i <= (robot_radius+1); i++)
-    {
-        next_pos = GetNextPosition(curr_pos, first_turning_direction, 1);
-        contouring_path.emplace_back(next_pos);
-        curr_pos = next_pos;
+    VisualizeTrajectory(map, path, robot_radius, PATH_MODE);
 
-        if(std::find(contouring_path.begin(), (contouring_path.end()-1), next_pos)!=(contouring_path.end()-1)
-        &&contouring_path.size()>1
-        &&isObstacleCompleted)
-        {
-            return false;
-        }
-    }
-    for(int i = 1; i <= (robot_radius+1); i++)
-    {
-        next_pos = GetNextPosition(curr_pos, second_turning_direction, 1);
-        contouring_path.emplace_back(next_pos);
-        curr_pos = next_pos;
+    OccupancyGrid free_space_map = ConstructFreeSpaceMap(map, wall_contours, obstacle_contours);
+    std::deque<Point2D> simplified_path = SimplifyTrajectory(free_space_map, path);
+    CheckSimplifiedTrajectory(path, simplified_path);
 
-        if(std::find(contouring_path.begin(), (contouring_path.end()-1), next_pos)!=(contouring_path.end()-1)
-        &&contouring_path.size()>1
-        &&isObstacleCompleted)
-        {
-            return false;
-        }
-    }
-    return true;
+    Eigen::Vector2d curr_direction = {0, -1};
+    std::vector<NavigationMessage> messages = GetNavigationMessage(curr_direction, simplified_path, meters_per_pix);
+    CheckMotionCommands(messages);
 }
 
-Polygon GetNewObstacle(const cv::Mat& map, Point2D origin, int front_direction, std::deque<Point2D>& contouring_path, int robot_radius)
-{
-    contouring_path.emplace_back(origin);
+void StaticPathPlanningExample2()
+{
+    int robot_radius = 5;
+
+    cv::Mat1b map = ReadMap("../complicate_map.png");
+    map = PreprocessMap(map);
+
+    std::vector<std::vector<cv::Point>> wall_contours;
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    ExtractContours(map, wall_contours, obstacle_contours);
+
 
-    Point2D curr_pos = origin;
+    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
 
-    Point2D obstacle_point;
-    Polygon new_obstacle;
-    Polygon obstacle;
+    Point2D start = cell_graph.front().ceiling.front();
+    std::deque<std::deque<Point2D>> original_planning_path = StaticPathPlanning(map, cell_graph, start, robot_radius, false, false);
 
-    bool isObstacleCompleted = false;
+    std::deque<Point2D> path = FilterTrajectory(original_planning_path);
+    CheckPathConsistency(path);
 
-    int left_direction = GetLeftDirection(front_direction);
-    int right_direction = GetRightDirection(front_direction);
-    int back_direction = GetBackDirection(front_direction);
+    int time_interval = 1;
+    VisualizeTrajectory(map, path, robot_radius, PATH_MODE, time_interval);
+}
 
-    std::deque<int> direcition_list = {right_direction, front_direction, left_direction, back_direction};
 
-    std::vector<int> right_direction_candidates = GetRightDirectionCandidates(front_direction);
-    std::vector<int> front_direction_candidates = GetFrontDirectionCandidates(front_direction);
-    std::vector<int> left_direction_candidates = GetLeftDirectionCandidates(front_direction);
-    std::vector<int> back_direction_candidates = GetBackDirectionCandidates(front_direction);
+/** 使用构造数据 **/
+void StaticPathPlanningExample3()
+{
+    int robot_radius = 5;
 
-    std::deque<std::vector<int>> direction_candidates_list = {right_direction_candidates, front_direction_candidates, left_direction_candidates, back_direction_candidates};
+    cv::Mat1b map = cv::Mat1b(cv::Size(500, 500), CV_8U);
+    map.setTo(255);
 
-    obstacle_point = GetNextPosition(origin, front_direction, robot_radius+1);
-    new_obstacle.emplace_back(obstacle_point);
+    std::vector<std::vector<cv::Point>> contours = ConstructHandcraftedContours1();
+    cv::fillPoly(map, contours, 0);
 
-    Point2D obstacle_origin = new_obstacle.front();
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    std::vector<std::vector<cv::Point>> wall_contours;
+    ExtractContours(map, wall_contours, obstacle_contours);
+    CheckExtractedContours(map, wall_contours);
+    CheckExtractedContours(map, obstacle_contours);
 
-    int detecting_direction;
-    int first_turning_direction;
-    int second_turning_direction;
-    int temp_direction;
+    PolygonList obstacles = ConstructObstacles(obstacle_contours);
+    Polygon wall = ConstructWall(map, wall_contours.front());
 
-    bool keepContouring = true;
-    std::vector<int> direction_candidates;
-    std::vector<int> temp_direction_candidates;
+    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+    CheckPointType(map, wall ,obstacles);
+    CheckGeneratedCells(map, cell_graph);
 
+    Point2D start = cell_graph.front().ceiling.front();
+    std::deque<std::deque<Point2D>> original_planning_path = StaticPathPlanning(map, cell_graph, start, robot_radius, false, false);
+    CheckPathNodes(original_planning_path);
 
-    while(keepContouring)
-    {
-        direction_candidates = direction_candidates_list[0];
-        first_turning_direction = direcition_list[0];
-        second_turning_direction = direcition_list[1];
-        detecting_direction = direcition_list[1];
+    std::deque<Point2D> path = FilterTrajectory(original_planning_path);
+    CheckPathConsistency(path);
 
-        keepContouring = WalkAlongObstacle(map, obstacle_origin, origin, detecting_direction, direction_candidates, curr_pos, first_turning_direction, second_turning_direction
-                , obstacle, new_obstacle, isObstacleCompleted, contouring_path, robot_radius);
+    int time_interval = 1;
+    VisualizeTrajectory(map, path, robot_radius, PATH_MODE, time_interval);
+}
 
-        temp_direction = direcition_list.front();
-        direcition_list.pop_front();
-        direcition_list.emplace_back(temp_direction);
+void StaticPathPlanningExample4()
+{
+    int robot_radius = 5;
 
-        temp_direction_candidates = direction_candidates_list.front();
-        direction_candidates_list.pop_front();
-        direction_candidates_list.emplace_back(temp_direction_candidates);
-    }
+    cv::Mat1b map = cv::Mat1b(cv::Size(600, 600), CV_8U);
+    map.setTo(255);
 
-    contouring_path.pop_front();
+    std::vector<std::vector<cv::Point>> contours = ConstructHandcraftedContours2();
+    cv::fillPoly(map, contours, 0);
 
-    return obstacle;
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    std::vector<std::vector<cv::Point>> wall_contours;
+    ExtractContours(map, wall_contours, obstacle_contours);
+    CheckExtractedContours(map, wall_contours);
+    CheckExtractedContours(map, obstacle_contours);
 
-} //考虑使用contouring path当障碍物
+    PolygonList obstacles = ConstructObstacles(obstacle_contours);
+    Polygon wall = ConstructWall(map, wall_contours.front());
 
-int GetCleaningDirection(const CellNode& cell, Point2D exit)
-{
-    std::vector<Point2D> corner_points = ComputeCellCornerPoints(cell);
+    OccupancyGrid occupancy_grid = ConstructOccupancyGrid(map.size(), wall_contours, obstacle_contours);
 
-//    if(exit.x == corner_points[TOPLEFT].x && exit.y == corner_points[TOPLEFT].y)
-//    {
-//        return LEFT;
-//    }
-//    if(exit.x == corner_points[BOTTOMLEFT].x && exit.y == corner_points[BOTTOMLEFT].y)
-//    {
-//        return LEFT;
-//    }
-//    if(exit.x == corner_points[TOPRIGHT].x && exit.y == corner_points[TOPRIGHT].y)
-//    {
-//        return RIGHT;
-//    }
-//    if(exit.x == corner_points[BOTTOMRIGHT].x && exit.y == corner_points[BOTTOMRIGHT].y)
-//    {
-//        return RIGHT;
-//    }
+    std::vector<Event> wall_event_list = GenerateWallEventList(occupancy_grid, wall);
+    std::vector<Event> obstacle_event_list = GenerateObstacleEventList(occupancy_grid, obstacles);
+    std::deque<std::deque<Event>> slice_list = SliceListGenerator(wall_event_list, obstacle_event_list);
+    CheckSlicelist(slice_list);
 
-    double dist_to_left = std::abs(exit.x - corner_points[TOPLEFT].x);
-    double dist_to_right = std::abs(exit.x = corner_points[TOPRIGHT].x);
+    std::vector<CellNode> cell_graph;
+    std::vector<int> cell_index_slice;
+    std::vector<int> original_cell_index_slice;
+    ExecuteCellDecomposition(cell_graph, cell_index_slice, original_cell_index_slice, slice_list);
+    CheckPointType(map, wall ,obstacles);
+    CheckGeneratedCells(map, cell_graph);
 
-    if(dist_to_left >= dist_to_right)
-    {
-        return RIGHT;
-    }
-    else
-    {
-        return LEFT;
-    }
+    Point2D start = cell_graph.front().ceiling.front();
+    std::deque<std::deque<Point2D>> original_planning_path = StaticPathPlanning(map, cell_graph, start, robot_radius, false, false);
+    CheckPathNodes(original_planning_path);
+
+    std::deque<Point2D> path = FilterTrajectory(original_planning_path);
+    CheckPathConsistency(path);
 
+    int time_interval = 1;
+    VisualizeTrajectory(map, path, robot_radius, PATH_MODE, time_interval);
 }
 
-// 清扫方向只分向左和向右
-std::deque<std::deque<Point2D>> LocalReplanning(cv::Mat& map, CellNode outer_cell, const PolygonList& obstacles, const Point2D& curr_pos, std::vector<CellNode>& curr_cell_graph, int cleaning_direction, int robot_radius, bool visualize_cells=false, bool visualize_path=false)
+void StaticPathPlanningExample5()
 {
-    //TODO: 边界判断
-    int start_x = INT_MAX;
-    int end_x = INT_MAX;
+    int robot_radius = 5;
 
-    if(cleaning_direction == LEFT)
-    {
-        start_x = outer_cell.ceiling.front().x;
+    cv::Mat1b map = cv::Mat1b(cv::Size(600, 600), CV_8U);
+    map.setTo(255);
 
-        if(curr_pos.x + 2*(robot_radius + 1) <= outer_cell.ceiling.back().x)
-        {
-            end_x =  curr_pos.x + 2*(robot_radius + 1);
-        }
-        else
-        {
-            end_x = outer_cell.ceiling.back().x;
-        }
-    }
-    if(cleaning_direction == RIGHT)
-    {
-        end_x = outer_cell.ceiling.back().x;
+    std::vector<std::vector<cv::Point>> contours = ConstructHandcraftedContours3();
+    cv::fillPoly(map, contours, 0);
 
-        if(curr_pos.x - 2*(robot_radius + 1) >= outer_cell.ceiling.front().x)
-        {
-            start_x = curr_pos.x - 2*(robot_radius + 1);
-        }
-        else
-        {
-            start_x = outer_cell.ceiling.front().x;
-        }
-    }
-    int outer_cell_start_index_offset = start_x - outer_cell.ceiling.front().x;
-    int outer_cell_end_index_offset = end_x - outer_cell.ceiling.front().x;
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    std::vector<std::vector<cv::Point>> wall_contours;
+    ExtractContours(map, wall_contours, obstacle_contours);
+    CheckExtractedContours(map, wall_contours);
+    CheckExtractedContours(map, obstacle_contours);
 
-    CellNode inner_cell;
-    for(int i = outer_cell_start_index_offset; i <= outer_cell_end_index_offset; i++)
-    {
-        inner_cell.ceiling.emplace_back(outer_cell.ceiling[i]);
-        inner_cell.floor.emplace_back(outer_cell.floor[i]);
-    }
+    PolygonList obstacles = ConstructObstacles(obstacle_contours);
+    Polygon wall = ConstructWall(map, wall_contours.front());
 
-//    curr_cell_graph = GenerateCells(map, inner_cell, obstacles);   // 这里需要改
-    std::deque<std::deque<Point2D>> replanning_path = StaticPathPlanning(map, curr_cell_graph, curr_pos, robot_radius, visualize_cells, visualize_path);
+    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+    CheckPointType(map, wall ,obstacles);
+    CheckGeneratedCells(map, cell_graph);
 
-    return replanning_path;
-} //回退区域需要几个r+1
+    Point2D start = cell_graph.front().ceiling.front();
+    std::deque<std::deque<Point2D>> original_planning_path = StaticPathPlanning(map, cell_graph, start, robot_radius, false, false);
+    CheckPathNodes(original_planning_path);
 
-// 每一段都是在一个cell中的路径
-std::deque<Point2D> DynamicPathPlanning(cv::Mat& map, const std::vector<CellNode>& global_cell_graph, std::deque<std::deque<Point2D>> global_path, int robot_radius, bool returning_home, bool visualize_path, int color_repeats=10)
-{
-    std::deque<Point2D> dynamic_path;
+    std::deque<Point2D> path = FilterTrajectory(original_planning_path);
+    CheckPathConsistency(path);
 
-    std::deque<std::deque<Point2D>> curr_path;
-    std::deque<Point2D> curr_sub_path;
-    std::deque<Point2D> contouring_path;
+    int time_interval = 1;
+    VisualizeTrajectory(map, path, robot_radius, PATH_MODE, time_interval);
+}
 
-    std::deque<std::deque<Point2D>> replanning_path;
-    std::deque<std::deque<Point2D>> remaining_curr_path;
+void StaticPathPlanningExample6()
+{
+    int robot_radius = 5;
 
-    std::deque<Point2D> linking_path;
+    cv::Mat1b map = cv::Mat1b(cv::Size(600, 600), CV_8U);
+    map.setTo(0);
 
-    Point2D curr_pos;
-    Point2D next_pos;
-    Point2D curr_exit;
+    std::vector<std::vector<cv::Point>> contours = ConstructHandcraftedContours4();
+    std::vector<std::vector<cv::Point>> external_contours = {contours.front()};
+    std::vector<std::vector<cv::Point>> inner_contours = {contours.back()};
+    cv::fillPoly(map, external_contours, 255);
+    cv::fillPoly(map, inner_contours, 0);
 
-    int front_direction;
-    int cleaning_direction;
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    std::vector<std::vector<cv::Point>> wall_contours;
+    ExtractContours(map, wall_contours, obstacle_contours);
+    CheckExtractedContours(map, wall_contours);
+    CheckExtractedContours(map, obstacle_contours);
 
-    Polygon new_obstacle;
-//    Polygon temp_new_obstacle;
+    PolygonList obstacles = ConstructObstacles(obstacle_contours);
+    Polygon wall = ConstructWall(map, wall_contours.front());
 
-    int curr_cell_index;
-    CellNode curr_cell;
+    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+    CheckPointType(map, wall ,obstacles);
+    CheckGeneratedCells(map, cell_graph);
 
-    std::vector<CellNode> curr_cell_graph;
+    Point2D start = cell_graph.front().ceiling.front();
+    std::deque<std::deque<Point2D>> original_planning_path = StaticPathPlanning(map, cell_graph, start, robot_radius, false, false);
+    CheckPathNodes(original_planning_path);
 
-    PolygonList overall_obstacles;
-    PolygonList curr_obstacles;
-    std::vector<cv::Point> visited_obstacle_contour;
-    std::vector<std::vector<cv::Point>> visited_obstacle_contours;
+    std::deque<Point2D> path = FilterTrajectory(original_planning_path);
+    CheckPathConsistency(path);
 
-    std::vector<std::deque<std::deque<Point2D>>> unvisited_paths = {global_path};
-    std::vector<std::vector<CellNode>> cell_graph_list = {global_cell_graph};
-    std::vector<Point2D> exit_list = {global_path.back().back()};
+    int time_interval = 1;
+    VisualizeTrajectory(map, path, robot_radius, PATH_MODE, time_interval);
+}
 
-    cv::Mat vismap = map.clone();
-    std::deque<cv::Scalar> JetColorMap;
-    InitializeColorMap(JetColorMap, color_repeats);
-    if(visualize_path)
-    {
-        cv::namedWindow("map", cv::WINDOW_NORMAL);
-        cv::imshow("map", vismap);
-    }
+/** 未知障碍物的动态路径规划仿真(无界面) **/
+void DynamicPathPlanningExample1()
+{
+    int robot_radius = 5;
 
+    cv::Mat1b map = cv::Mat1b(cv::Size(600, 600), CV_8U);
+    map.setTo(255);
 
-    while(!unvisited_paths.empty() && !cell_graph_list.empty())
-    {
-        curr_path = unvisited_paths.back();
-        curr_cell_graph = cell_graph_list.back();
+    std::vector<std::vector<cv::Point>> contours = ConstructHandcraftedContours5();
+    cv::fillPoly(map, contours, 0);
 
-        for(int i = 0; i < curr_path.size(); i++)
-        {
-            curr_sub_path.assign(curr_path[i].begin(), curr_path[i].end());
+    Point2D start = Point2D(map.cols/2, map.rows/2);
 
-            for(int j = 0; j < curr_sub_path.size()-1; j++)
-            {
-                curr_pos = curr_sub_path[j];
-                next_pos = curr_sub_path[j+1];
-                dynamic_path.emplace_back(curr_pos);
+    int layout_num = 1;
+    int obstacle_num = 5;
+    int thread_num = 1;
+    unsigned int seed = 0;
 
-                if(visualize_path)
-                {
-                    vismap.at<cv::Vec3b>(curr_pos.y, curr_pos.x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
-                    UpdateColorMap(JetColorMap);
-                    cv::imshow("map", vismap);
-                    cv::waitKey(1);
-                }
+    std::vector<SimulationResult> results = RunDynamicSimulationBatch(map, start, robot_radius, layout_num, obstacle_num, thread_num, seed);
 
-                front_direction = GetFrontDirection(curr_pos, next_pos);
-                if(CollisionOccurs(map, curr_pos, front_direction, robot_radius))
-                {
-                    new_obstacle = GetNewObstacle(map, curr_pos, front_direction, contouring_path, robot_radius);
-//                    new_obstacle = GetSingleContouringArea(map, temp_new_obstacle, robot_radius);
-                    overall_obstacles.emplace_back(new_obstacle);
+    std::cout<<"hidden obstacles: "<<results.front().hidden_obstacles<<", replans: "<<results.front().replans
+             <<", path length: "<<results.front().path_length<<std::endl;
+}
 
-                    // for debugging
-//                    for(int i = 0; i < new_obstacle.size(); i++)
-//                    {
-//                        std::cout<<"x:"<< new_obstacle[i].x <<", y:"<< new_obstacle[i].y <<std::endl;
-//                    }
-//
-//                    for(int i = 0; i < new_obstacle.size(); i++)
-//                    {
-//                        vismap.at<cv::Vec3b>(new_obstacle[i].y, new_obstacle[i].x)=cv::Vec3b(0, 255, 0);
-//                    }
-//                    for(int i = 0; i < contouring_path.size(); i++)
-//                    {
-//                        vismap.at<cv::Vec3b>(contouring_path[i].y, contouring_path[i].x)=cv::Vec3b(255, 0, 0);
-//                    }
-//                    cv::circle(map, cv::Point(contouring_path.front().x, contouring_path.front().y), 2, cv::Scalar(0, 255, 255), -1);
-//                    cv::circle(map, cv::Point(contouring_path.back().x, contouring_path.back().y), 2, cv::Scalar(255, 0, 255), -1);
-//                    PointTypeTest(map, new_obstacle);
-//                    cv::imshow("map", vismap);
-//                    cv::waitKey(0);
 
-                    dynamic_path.insert(dynamic_path.end(), contouring_path.begin(), contouring_path.end());
+void TestAllExamples()
+{
+    StaticPathPlanningExample1();
 
-                    if(visualize_path)
-                    {
-                        for(const auto& point : contouring_path)
-                        {
-                            vismap.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
-                            UpdateColorMap(JetColorMap);
-                            cv::imshow("map", vismap);
-                            cv::waitKey(1);
-                        }
-                    }
+    StaticPathPlanningExample2();
 
-                    contouring_path.clear();
+    StaticPathPlanningExample3();
 
-                    visited_obstacle_contour.clear();
-                    visited_obstacle_contours.clear();
+    StaticPathPlanningExample4();
 
-                    for(const auto& point: new_obstacle)
-                    {
-                        visited_obstacle_contour.emplace_back(cv::Point(point.x,point.y));
-                    }
+    StaticPathPlanningExample5();
 
-                    visited_obstacle_contours.emplace_back(visited_obstacle_contour);
+    StaticPathPlanningExample6();
 
-                    curr_cell_index = DetermineCellIndex(curr_cell_graph, curr_pos).front();
-                    curr_cell = curr_cell_graph[curr_cell_index];
-                    curr_obstacles={new_obstacle};
-                    curr_exit = curr_sub_path.back();
+    DynamicPathPlanningExample1();
+}
 
-                    // for debugging
-//                    DrawCells(map, curr_cell, cv::Scalar(255, 0, 255));
-//                    vismap.at<cv::Vec3b>(curr_exit.y, curr_exit.x)=cv::Vec3b(0,255,255);
-//                    cv::imshow("map", vismap);
-//                    cv::waitKey(0);
 
-                    cleaning_direction = GetCleaningDirection(curr_cell, curr_exit);
+/** 回归测试 **/
 
-                    replanning_path = LocalReplanning(map, curr_cell, curr_obstacles, dynamic_path.back(), curr_cell_graph, cleaning_direction, robot_radius, false, false); // 此处会更新curr_cell_graph
-                    cv::fillPoly(map, visited_obstacle_contours, cv::Scalar(50, 50, 50));
-                    cv::fillPoly(vismap, visited_obstacle_contours, cv::Scalar(50, 50, 50));
 
-                    remaining_curr_path.assign(curr_path.begin()+i+1, curr_path.end());
+/** 分解回归测试: 逐像素轮廓上的分解与直接由轮廓顶点生成事件的顶点级分解都须得到合法且相同的cell **/
+bool DecompositionRegressionTest(const std::string& name, const std::vector<std::vector<cv::Point>>& contours)
+{
+    std::vector<std::vector<cv::Point>> wall_contours = {contours.front()};
+    std::vector<std::vector<cv::Point>> obstacle_contours(contours.begin()+1, contours.end());
 
-                    goto UPDATING_REMAINING_PATHS;
-                }
-            }
-        }
+    cv::Rect bounding_box = cv::boundingRect(contours.front());
+    cv::Mat1b map = cv::Mat1b(cv::Size(bounding_box.x + bounding_box.width, bounding_box.y + bounding_box.height), CV_8U);
+    map.setTo(255);
 
-        if(dynamic_path.back().x != exit_list.back().x && dynamic_path.back().y != exit_list.back().y)
-        {
-            linking_path = ReturningPathPlanning(map, cell_graph_list.back(), dynamic_path.back(), exit_list.back(), robot_radius, false);
-            dynamic_path.insert(dynamic_path.end(), linking_path.begin(), linking_path.end());
+    Polygon wall = ConstructWall(map, wall_contours.front());
+    PolygonList obstacles = ConstructObstacles(obstacle_contours);
+    OccupancyGrid occupancy_grid = ConstructOccupancyGrid(map.size(), wall_contours, obstacle_contours);
 
-            if(visualize_path)
-            {
-                for(const auto& point : linking_path)
-                {
-                    vismap.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(uchar(JetColorMap.front()[0]),uchar(JetColorMap.front()[1]),uchar(JetColorMap.front()[2]));
-                    UpdateColorMap(JetColorMap);
-                    cv::imshow("map", vismap);
-                    cv::waitKey(1);
-                }
-            }
-        }
+    std::vector<Event> wall_event_list = GenerateWallEventList(occupancy_grid, wall);
+    std::vector<Event> obstacle_event_list = GenerateObstacleEventList(occupancy_grid, obstacles);
+    std::deque<std::deque<Event>> slice_list = SliceListGenerator(wall_event_list, obstacle_event_list);
 
-        exit_list.pop_back();
-        unvisited_paths.pop_back();
-        cell_graph_list.pop_back();
-        continue;
+    std::vector<CellNode> pixel_cell_graph;
+    std::vector<int> pixel_cell_index_slice;
+    std::vector<int> pixel_original_cell_index_slice;
+    ExecuteCellDecomposition(pixel_cell_graph, pixel_cell_index_slice, pixel_original_cell_index_slice, slice_list);
 
-        UPDATING_REMAINING_PATHS:
-        exit_list.emplace_back(curr_exit);
-        unvisited_paths.pop_back();
-        unvisited_paths.emplace_back(remaining_curr_path);
-        unvisited_paths.emplace_back(replanning_path);
-        cell_graph_list.emplace_back(curr_cell_graph);
+    std::vector<std::vector<Point2D>> obstacle_vertices;
+    for(const auto& obstacle_contour : obstacle_contours)
+    {
+        obstacle_vertices.emplace_back(ConstructVertices(obstacle_contour));
     }
+    VertexEventList vertex_event_list = GenerateVertexEventList(occupancy_grid, ConstructVertices(wall_contours.front()), obstacle_vertices);
+    std::vector<CellNode> vertex_cell_graph;
+    std::vector<int> vertex_cell_index_slice;
+    std::vector<int> vertex_original_cell_index_slice;
+    ExecuteVertexCellDecomposition(vertex_cell_graph, vertex_cell_index_slice, vertex_original_cell_index_slice, vertex_event_list);
 
-    if(returning_home)
+    bool is_passed = CheckCellBoundaries(pixel_cell_graph) && CheckCellBoundaries(vertex_cell_graph)
+                  && pixel_cell_graph.size() == vertex_cell_graph.size();
+    for(int i = 0; is_passed && i < pixel_cell_graph.size(); i++)
     {
-        cv::Mat3b returning_map = cv::Mat3b(map.size(), CV_8U);
-        returning_map.setTo(cv::Scalar(0, 0, 0));
-        std::vector<cv::Point> returning_obstacle_contour;
-        std::vector<std::vector<cv::Point>> returning_obstacle_contours;
+        is_passed = pixel_cell_graph[i].ceiling == vertex_cell_graph[i].ceiling && pixel_cell_graph[i].floor == vertex_cell_graph[i].floor;
+    }
 
-        for(const auto& obstacle: overall_obstacles)
+    std::cout<<"decomposition regression "<<name<<": "<<pixel_cell_graph.size()<<" cells, "<<(is_passed ? "passed" : "FAILED")<<std::endl;
+    return is_passed;
+}
+
+/** 事件分类回归测试: 查表分类得到的临界事件和CEILING/FLOOR个数须与保存的期望值相同 **/
+bool EventTypeRegressionTest(const EventTypeRegressionCase& test_case)
+{
+    std::vector<std::vector<cv::Point>> wall_contours = {test_case.contours.front()};
+    std::vector<std::vector<cv::Point>> obstacle_contours(test_case.contours.begin()+1, test_case.contours.end());
+
+    cv::Mat1b map = cv::Mat1b(cv::Size(test_case.map_size, test_case.map_size), CV_8U);
+    map.setTo(255);
+
+    Polygon wall = ConstructWall(map, wall_contours.front());
+    PolygonList obstacles = ConstructObstacles(obstacle_contours);
+    OccupancyGrid occupancy_grid = ConstructOccupancyGrid(map.size(), wall_contours, obstacle_contours);
+
+    std::vector<std::vector<Event>> event_lists = {InitializeEventList(wall, INT_MAX)};
+    AllocateWallEventType(occupancy_grid, event_lists.front());
+    for(int i = 0; i < obstacles.size(); i++)
+    {
+        event_lists.emplace_back(InitializeEventList(obstacles[i], i));
+        AllocateObstacleEventType(occupancy_grid, event_lists.back());
+    }
+
+    bool is_passed = event_lists.size() == test_case.critical_events.size();
+    for(int i = 0; is_passed && i < event_lists.size(); i++)
+    {
+        std::vector<std::pair<Point2D, EventType>> critical_events;
+        std::pair<int, int> ceiling_floor_num(0, 0);
+        for(const auto& event : event_lists[i])
         {
-            for(const auto& point : obstacle)
+            if(event.event_type == CEILING)
             {
-                returning_obstacle_contour.emplace_back(cv::Point(point.x,point.y));
+                ceiling_floor_num.first++;
+            }
+            else if(event.event_type == FLOOR)
+            {
+                ceiling_floor_num.second++;
+            }
+            else if(event.event_type != MIDDLE)
+            {
+                critical_events.emplace_back(Point2D(event.x, event.y), event.event_type);
             }
-            returning_obstacle_contours.emplace_back(returning_obstacle_contour);
-            returning_obstacle_contour.clear();
         }
+        is_passed = critical_events == test_case.critical_events[i] && ceiling_floor_num == test_case.ceiling_floor_nums[i];
+    }
 
-        cv::fillPoly(returning_map, returning_obstacle_contours, cv::Scalar(255, 255, 255));
+    std::cout<<"event type regression "<<test_case.name<<": "<<(is_passed ? "passed" : "FAILED")<<std::endl;
+    return is_passed;
+}
 
-        Polygon returning_map_border = ConstructDefaultWall(returning_map);
-//        std::vector<CellNode> returning_cell_graph = GenerateCells(returning_map, returning_map_border, overall_obstacles);//这里需要改
-        std::vector<CellNode> returning_cell_graph; //这里需要改
+/** 随机地图回归测试: 压力测试中曾让分解出错的(地图边长, 障碍物数, 种子), 同一组参数生成的地图不变 **/
+bool RandomMapRegressionTest(int map_size, int obstacle_num, unsigned int seed, int robot_radius = 2)
+{
+    RandomMapOptions options;
+    options.width = map_size;
+    options.height = map_size;
+    options.obstacle_num = obstacle_num;
+    options.min_gap = 2*robot_radius + 4;
+    options.seed = seed;
 
-        // for debugging
-//        for(auto cell:returning_cell_graph)
-//        {
-//            DrawCells(vismap, cell, cv::Scalar(0, 255, 255));
-//            cv::imshow("map", vismap);
-//            cv::waitKey(0);
-//        }
-        //
+    std::vector<std::vector<cv::Point>> generated_obstacles;
+    cv::Mat1b map = GenerateRandomMap(options, generated_obstacles);
 
-        for(auto cell : returning_cell_graph)
-        {
-            cell.isCleaned = true;
-        }
+    std::vector<std::vector<cv::Point>> wall_contours;
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
 
-        std::deque<Point2D> returning_path = ReturningPathPlanning(returning_map, returning_cell_graph, dynamic_path.back(), dynamic_path.front(), robot_radius, false);
+    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
 
-        if(visualize_path)
+    bool is_passed = !cell_graph.empty() && CheckCellBoundaries(cell_graph);
+    size_t path_point_num = 0;
+    if(is_passed)
+    {
+        path_point_num = FilterTrajectory(StaticPathPlanningParallel(cell_graph, cell_graph.front().ceiling.front(), robot_radius, 1)).size();
+        is_passed = path_point_num > 0;
+    }
+
+    std::cout<<"random map regression "<<map_size<<"x"<<map_size<<", "<<obstacle_num<<" obstacles, seed "<<seed<<": "
+             <<cell_graph.size()<<" cells, "<<path_point_num<<" path points, "<<(is_passed ? "passed" : "FAILED")<<std::endl;
+    return is_passed;
+}
+
+/** 轮廓跟踪回归测试: 单线程和多线程的跟踪结果都须与两次cv::findContours(ExtractRawContoursTwoPass)得到的轮廓完全相同 **/
+bool ContourTracingRegressionTest(const std::string& name, const cv::Mat1b& map)
+{
+    std::vector<std::vector<cv::Point>> two_pass_wall, two_pass_obstacles;
+    ExtractRawContoursTwoPass(map, two_pass_wall, two_pass_obstacles);
+
+    std::vector<std::vector<cv::Point>> serial_wall, serial_obstacles;
+    std::vector<std::vector<cv::Point>> parallel_wall, parallel_obstacles;
+    bool is_passed = ExtractRawContours(map, serial_wall, serial_obstacles) && ExtractRawContours(map, parallel_wall, parallel_obstacles, 4)
+                  && serial_wall == two_pass_wall && serial_obstacles == two_pass_obstacles
+                  && parallel_wall == two_pass_wall && parallel_obstacles == two_pass_obstacles;
+
+    std::cout<<"contour tracing regression "<<name<<": "<<two_pass_obstacles.size()<<" obstacles, "<<(is_passed ? "passed" : "FAILED")<<std::endl;
+    return is_passed;
+}
+
+// 可通行区域里随机撒占据像素, 得到大量单像素和相互粘连的小障碍物
+cv::Mat1b GenerateNoiseMap(int map_size, double obstacle_density, unsigned int seed)
+{
+    cv::Mat1b map = cv::Mat1b(cv::Size(map_size, map_size), CV_8U);
+    map.setTo(0);
+    cv::rectangle(map, cv::Point(2, 2), cv::Point(map_size-3, map_size-3), 255, -1);
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> unit_distribution(0.0, 1.0);
+    for(int y = 3; y < map_size-3; y++)
+    {
+        for(int x = 3; x < map_size-3; x++)
         {
-            for(const auto& point : returning_path)
+            if(unit_distribution(generator) < obstacle_density)
             {
-                vismap.at<cv::Vec3b>(point.y, point.x)=cv::Vec3b(250,250,250);
-                cv::imshow("map", vismap);
-                cv::waitKey(1);
+                map(y, x) = 0;
             }
         }
-
-        dynamic_path.insert(dynamic_path.end(), returning_path.begin(), returning_path.end());
     }
+    return map;
+}
 
-    if(visualize_path)
-    {
-        cv::waitKey(5000);
-    }
+/** 没有可通行像素的地图: 轮廓提取须报错, 不能输出空的外墙让后面退回到整张图的外框 **/
+bool NoFreeSpaceRegressionTest()
+{
+    cv::Mat1b map = cv::Mat1b(cv::Size(64, 64), CV_8U);
+    map.setTo(0);
 
-    return dynamic_path;
+    std::vector<std::vector<cv::Point>> wall_contours, obstacle_contours;
+    bool is_passed = !ExtractRawContours(map, wall_contours, obstacle_contours) && wall_contours.empty()
+                  && !ExtractContours(map, wall_contours, obstacle_contours, 2);
+
+    // 通道比机器人窄, 膨胀后没有可通行区域
+    cv::rectangle(map, cv::Point(10, 10), cv::Point(50, 12), 255, -1);
+    is_passed = is_passed && ExtractContours(map, wall_contours, obstacle_contours) && !ExtractContours(map, wall_contours, obstacle_contours, 5);
+
+    std::cout<<"no free space regression: "<<(is_passed ? "passed" : "FAILED")<<std::endl;
+    return is_passed;
 }
 
-void MoveAsPathPlannedTest(cv::Mat& map, double meters_per_pix, const Point2D& start, const std::vector<NavigationMessage>& motion_commands)
+/** 压缩cell图回归测试: 压缩后的cell图经过代价估计、边界检查和动态规划, 结果须与未压缩时相同 **/
+bool CompressedCellGraphRegressionTest(int robot_radius = 5)
 {
-    int pixs;
-    Point2D begin = start, end;
+    cv::Mat1b map = cv::Mat1b(cv::Size(600, 600), CV_8U);
+    map.setTo(255);
+    cv::fillPoly(map, ConstructHandcraftedContours5(), 0);
 
-    cv::namedWindow("original_map", cv::WINDOW_NORMAL);
+    std::vector<std::vector<cv::Point>> wall_contours;
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
 
-    for(auto command:motion_commands)
+    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+
+    std::vector<CellNode> compressed_cell_graph = cell_graph;
+    int compressed_num = CompressCellGraph(compressed_cell_graph);
+    bool is_passed = compressed_num > 0 && CheckCellBoundaries(compressed_cell_graph);
+
+    double meters_per_pix = 0.02;
+    KinematicModel model;
+    std::vector<CellNode> visitting_cell_graph = cell_graph;
+    std::deque<CellNode> cell_path = GetVisittingPath(visitting_cell_graph, 0);
+    std::deque<CellNode> compressed_cell_path;
+    for(const auto& cell : cell_path)
     {
-        pixs = int(command.GetDistance()/meters_per_pix);
-        if(command.GetGlobalYaw()==0.0)
-        {
-            end = Point2D(begin.x, begin.y-pixs);
-            cv::line(map, cv::Point(begin.x, begin.y), cv::Point(end.x, end.y), cv::Scalar(0, 0, 255));
-            cv::imshow("original_map", map);
-            cv::waitKey(100);
-        }
-        if(command.GetGlobalYaw()==180.0)
-        {
-            end = Point2D(begin.x, begin.y+pixs);
-            cv::line(map, cv::Point(begin.x, begin.y), cv::Point(end.x, end.y), cv::Scalar(255, 0, 0));
-            cv::imshow("original_map", map);
-            cv::waitKey(100);
-        }
-        if(command.GetGlobalYaw()==90.0)
-        {
-            end = Point2D(begin.x+pixs, begin.y);
-            cv::line(map, cv::Point(begin.x, begin.y), cv::Point(end.x, end.y), cv::Scalar(0, 255, 0));
-            cv::imshow("original_map", map);
-            cv::waitKey(100);
-        }
-        if(command.GetGlobalYaw()==-90.0)
-        {
-            end = Point2D(begin.x-pixs, begin.y);
-            cv::line(map, cv::Point(begin.x, begin.y), cv::Point(end.x, end.y), cv::Scalar(0, 255, 255));
-            cv::imshow("original_map", map);
-            cv::waitKey(100);
+        compressed_cell_path.emplace_back(compressed_cell_graph[cell.cellIndex]);
+    }
+    PathCost cost = EstimatePathCost(cell_path, AssignSweepCorners(cell_graph, cell_path, robot_radius), robot_radius, meters_per_pix, model);
+    PathCost compressed_cost = EstimatePathCost(compressed_cell_path, AssignSweepCorners(compressed_cell_graph, compressed_cell_path, robot_radius), robot_radius, meters_per_pix, model);
+    is_passed = is_passed && cost.length == compressed_cost.length && cost.turn_num == compressed_cost.turn_num && cost.time == compressed_cost.time;
+
+    std::vector<CellNode> expanded_cell_graph = compressed_cell_graph;
+    ExpandCellGraph(expanded_cell_graph);
+    for(int i = 0; is_passed && i < cell_graph.size(); i++)
+    {
+        is_passed = expanded_cell_graph[i].ceiling == cell_graph[i].ceiling && expanded_cell_graph[i].floor == cell_graph[i].floor;
+    }
+
+    // 动态规划入口要按下标访问上下边界, 压缩的cell图须在入口展开
+    int replans = 0;
+    if(is_passed)
+    {
+        std::vector<CellNode> planning_cell_graph = cell_graph;
+        std::deque<std::deque<Point2D>> global_path = StaticPathPlanningParallel(planning_cell_graph, cell_graph.front().ceiling.front(), robot_radius, 1);
+        std::vector<std::vector<cv::Point>> hidden_obstacles = GenerateHiddenObstacles(map, 8, 2*(robot_radius+1), 4*(robot_radius+1), robot_radius, 2019);
+        SimulationResult result = RunDynamicSimulation(map, cell_graph, global_path, hidden_obstacles, robot_radius);
+        SimulationResult compressed_result = RunDynamicSimulation(map, compressed_cell_graph, global_path, hidden_obstacles, robot_radius);
+        is_passed = result.replans == compressed_result.replans && result.path_length == compressed_result.path_length
+                 && result.coverage_rate == compressed_result.coverage_rate;
+        replans = result.replans;
+    }
+
+    std::cout<<"compressed cell graph regression: "<<compressed_num<<" of "<<cell_graph.size()<<" cells compressed, "<<replans<<" replans, "<<(is_passed ? "passed" : "FAILED")<<std::endl;
+    return is_passed;
+}
+
+/** 动态规划日志回归测试: 记录的日志能原样读回; 数目被改大或地图尺寸非法的日志须返回false, 不能按文件里的数目分配内存 **/
+bool DynamicPlanningLogRegressionTest(int robot_radius = 5)
+{
+    cv::Mat1b map = cv::Mat1b(cv::Size(600, 600), CV_8U);
+    map.setTo(255);
+    cv::fillPoly(map, ConstructHandcraftedContours5(), 0);
+
+    std::vector<std::vector<cv::Point>> wall_contours;
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
+
+    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+    std::deque<std::deque<Point2D>> global_path = StaticPathPlanning(map, cell_graph, Point2D(map.cols/2, map.rows/2), robot_radius, false, false);
+
+    std::vector<std::vector<cv::Point>> hidden_obstacles = GenerateHiddenObstacles(map, 8, 2*(robot_radius+1), 4*(robot_radius+1), robot_radius, 2019);
+    DynamicPlanningLog log;
+    RunDynamicSimulation(map, cell_graph, global_path, hidden_obstacles, robot_radius, &log);
+
+    std::string log_file = "dynamic_planning_regression.log";
+    DynamicPlanningLog read_log;
+    bool is_passed = WriteDynamicPlanningLog(log_file, log) && ReadDynamicPlanningLog(log_file, read_log)
+                  && read_log.dynamic_path == log.dynamic_path && read_log.replans.size() == log.replans.size();
+
+    std::stringstream log_stream;
+    log_stream<<std::ifstream(log_file).rdbuf();
+    std::string log_text = log_stream.str();
+
+    // (原文, 损坏后的内容)
+    std::string cells_line = "cells " + std::to_string(log.global_cell_graph.size()) + "\n";
+    std::string replans_line = "replans " + std::to_string(log.replans.size()) + "\n";
+    std::string dynamic_path_line = "dynamic_path " + std::to_string(log.dynamic_path.size()) + " ";
+    std::vector<std::pair<std::string, std::string>> corruptions = {
+        {"map 600 600", "map -600 600"},
+        {"map 600 600", "map 600 1000000000"},
+        {cells_line, "cells 4000000000\n"},
+        {replans_line, "replans 4000000000\n"},
+        {dynamic_path_line, "dynamic_path 4000000000 "},
+        {"global_path ", "global_path 4000000000\n"}};
+    for(const auto& corruption : corruptions)
+    {
+        size_t position = log_text.find(corruption.first);
+        if(position == std::string::npos)
+        {
+            is_passed = false;
+            break;
         }
-        begin = end;
+        std::string corrupted_text = log_text;
+        corrupted_text.replace(position, corruption.first.size(), corruption.second);
+        std::ofstream(log_file)<<corrupted_text;
+        is_passed = is_passed && !ReadDynamicPlanningLog(log_file, read_log);
     }
-    cv::waitKey(0);
+    std::remove(log_file.c_str());
+
+    std::cout<<"dynamic planning log regression: "<<log.replans.size()<<" replans, "<<(is_passed ? "passed" : "FAILED")<<std::endl;
+    return is_passed;
 }
 
+// 返回失败的用例数
+int TestAllRegressions()
+{
+    int failed_num = 0;
+
+    failed_num += DecompositionRegressionTest("nearest opposite boundary", ConstructRegressionContours1()) ? 0 : 1;
 
+    failed_num += DecompositionRegressionTest("one-pixel-thick column", ConstructRegressionContours2()) ? 0 : 1;
 
+    failed_num += DecompositionRegressionTest("duplicate ceiling column", ConstructRegressionContours3()) ? 0 : 1;
 
-/** 测试数据 **/
+    for(const auto& test_case : ConstructEventTypeRegressionCases())
+    {
+        failed_num += EventTypeRegressionTest(test_case) ? 0 : 1;
+    }
 
+    failed_num += RandomMapRegressionTest(500, 10, 1) ? 0 : 1;
 
-/** 静态地图路径规划测试多边形 **/
-std::vector<std::vector<cv::Point>> ConstructHandcraftedContours1()
-{
-    std::vector<cv::Point> handcrafted_polygon_1_1 = {cv::Point(200,300), cv::Point(300,200), cv::Point(200,100), cv::Point(100,200)};
-    std::vector<cv::Point> handcrafted_polygon_1_2 = {cv::Point(300,350), cv::Point(350,300), cv::Point(300,250), cv::Point(250,300)};
-    std::vector<std::vector<cv::Point>> contours = {handcrafted_polygon_1_1, handcrafted_polygon_1_2};
-    return contours;
+    failed_num += RandomMapRegressionTest(1000, 100, 6) ? 0 : 1;
+
+    failed_num += RandomMapRegressionTest(1000, 1000, 1) ? 0 : 1;
+
+    for(const std::string& map_name : {std::string("map.png"), std::string("complicate_map.png")})
+    {
+        failed_num += ContourTracingRegressionTest(map_name, PreprocessMap(ReadMap("../" + map_name))) ? 0 : 1;
+    }
+
+    for(unsigned int seed : {1, 2, 3})
+    {
+        RandomMapOptions options;
+        options.width = 400;
+        options.height = 400;
+        options.obstacle_num = 60;
+        options.rotated_room = (seed % 2 == 0);
+        options.min_gap = 1;
+        options.seed = seed;
+        std::vector<std::vector<cv::Point>> generated_obstacles;
+        failed_num += ContourTracingRegressionTest("random map seed "+std::to_string(seed), GenerateRandomMap(options, generated_obstacles)) ? 0 : 1;
+
+        failed_num += ContourTracingRegressionTest("noise map seed "+std::to_string(seed), GenerateNoiseMap(200, 0.1, seed)) ? 0 : 1;
+    }
+
+    failed_num += CompressedCellGraphRegressionTest() ? 0 : 1;
+
+    failed_num += NoFreeSpaceRegressionTest() ? 0 : 1;
+
+    failed_num += DynamicPlanningLogRegressionTest() ? 0 : 1;
+
+    return failed_num;
 }
 
-std::vector<std::vector<cv::Point>> ConstructHandcraftedContours2()
+
+/** 性能测试 **/
+
+
+/** 沿大障碍物绕行一周(周长数千像素)的耗时 **/
+void GetNewObstacleBenchmark()
 {
-    std::vector<cv::Point> handcrafted_polygon_2 = {cv::Point(125,125), cv::Point(125,175), cv::Point(225,175), cv::Point(225,225),
-                                                    cv::Point(175,250), cv::Point(225,300), cv::Point(125,325), cv::Point(125,375),
-                                                    cv::Point(375,375), cv::Point(375,325), cv::Point(275,325), cv::Point(275,275),
-                                                    cv::Point(325,250), cv::Point(275,200), cv::Point(375,175), cv::Point(375,125)};
-    std::vector<std::vector<cv::Point>> contours = {handcrafted_polygon_2};
-    return contours;
+    int robot_radius = 3;
+
+    for(int obstacle_radius : {100, 400, 800, 1600})
+    {
+        cv::Mat3b map = cv::Mat3b(cv::Size(2*obstacle_radius+200, 2*obstacle_radius+200), CV_8U);
+        map.setTo(cv::Scalar(0, 0, 0));
+
+        // 圆形加一个矩形凸起, 让绕行路径同时包含斜线和直角
+        cv::Point center(obstacle_radius+100, obstacle_radius+100);
+        cv::circle(map, center, obstacle_radius, cv::Scalar(255, 255, 255), -1);
+        cv::rectangle(map, cv::Point(center.x-obstacle_radius/2, center.y), cv::Point(center.x+obstacle_radius/2, center.y+obstacle_radius+50), cv::Scalar(255, 255, 255), -1);
+
+        ClearanceMap clearance_map;
+        BuildClearanceMap(map, clearance_map, robot_radius);
+
+        Point2D origin = Point2D(center.x-obstacle_radius-(robot_radius+1), center.y);
+        std::deque<Point2D> contouring_path;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Polygon obstacle = GetNewObstacle(clearance_map, origin, RIGHT, contouring_path, robot_radius);
+        double elapsed_ms = ElapsedMilliseconds(start);
+
+        std::cout<<"GetNewObstacle: obstacle perimeter "<<obstacle.size()<<" pixels, contouring path "<<contouring_path.size()
+                 <<" pixels, "<<elapsed_ms<<" ms"<<std::endl;
+    }
 }
 
-std::vector<std::vector<cv::Point>> ConstructHandcraftedContours3()
+/** 随机未知障碍物布局下DynamicPathPlanning的吞吐量 **/
+void DynamicPathPlanningBenchmark()
 {
-    std::vector<cv::Point> handcrafted_polygon_3 = {cv::Point(100,100), cv::Point(100,500), cv::Point(150,500), cv::Point(150,150),
-                                                    cv::Point(450,150), cv::Point(450,300), cv::Point(300,300), cv::Point(300,250),
-                                                    cv::Point(350,250), cv::Point(350,200), cv::Point(250,200), cv::Point(250,350),
-                                                    cv::Point(500,350), cv::Point(500,100)};
-    std::vector<std::vector<cv::Point>> contours = {handcrafted_polygon_3};
-    return contours;
+    int robot_radius = 5;
+
+    cv::Mat1b map = cv::Mat1b(cv::Size(600, 600), CV_8U);
+    map.setTo(255);
+
+    std::vector<std::vector<cv::Point>> contours = ConstructHandcraftedContours5();
+    cv::fillPoly(map, contours, 0);
+
+    Point2D start = Point2D(map.cols/2, map.rows/2);
+
+    int layout_num = 64;
+    int obstacle_num = 8;
+    int thread_num = std::max(int(std::thread::hardware_concurrency()), 1);
+    unsigned int seed = 2019;
+
+    RunDynamicSimulationBatch(map, start, robot_radius, layout_num, obstacle_num, thread_num, seed);
 }
 
-std::vector<std::vector<cv::Point>> ConstructHandcraftedContours4()
+/** 记录一次动态仿真并反复回放: 回放只执行重规划, 不含仿真地图上的碰撞检测和绕障 **/
+void DynamicPlanningReplayBenchmark()
 {
-    std::vector<cv::Point> handcrafted_polygon_4_1 = {cv::Point(20,20),  cv::Point(20,200), cv::Point(100,200),cv::Point(100,399),
-                                                      cv::Point(20,399), cv::Point(20, 579),cv::Point(200,579),cv::Point(200,499),cv::Point(399,499),cv::Point(399,579),
-                                                      cv::Point(579,579),cv::Point(579,399),cv::Point(499,399),cv::Point(499,200),cv::Point(579,200),cv::Point(579,20),
-                                                      cv::Point(349,20), cv::Point(349,100),cv::Point(250,100),cv::Point(250,20)};
-    std::vector<cv::Point> handcrafted_polygon_4_2 = {cv::Point(220,220),cv::Point(220,380),cv::Point(380,380),cv::Point(380,220)};
-    std::vector<std::vector<cv::Point>> contours = {handcrafted_polygon_4_1, handcrafted_polygon_4_2};
-    return contours;
+    int robot_radius = 5;
+
+    cv::Mat1b map = cv::Mat1b(cv::Size(600, 600), CV_8U);
+    map.setTo(255);
+    cv::fillPoly(map, ConstructHandcraftedContours5(), 0);
+
+    std::vector<std::vector<cv::Point>> wall_contours;
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
+
+    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+    std::deque<std::deque<Point2D>> global_path = StaticPathPlanning(map, cell_graph, Point2D(map.cols/2, map.rows/2), robot_radius, false, false);
+
+    std::vector<std::vector<cv::Point>> hidden_obstacles = GenerateHiddenObstacles(map, 8, 2*(robot_radius+1), 4*(robot_radius+1), robot_radius, 2019);
+    DynamicPlanningLog log;
+    SimulationResult result = RunDynamicSimulation(map, cell_graph, global_path, hidden_obstacles, robot_radius, &log);
+
+    std::string log_file = "dynamic_planning.log";
+    if(!WriteDynamicPlanningLog(log_file, log))
+    {
+        std::cout<<"failed to write "<<log_file<<std::endl;
+        return;
+    }
+    std::ifstream written_log(log_file, std::ios::binary | std::ios::ate);
+    std::cout<<"recorded "<<result.replans<<" replans in "<<result.planning_time_ms<<" ms ("<<result.replanning_time_ms<<" ms replanning), "
+             <<log.dynamic_path.size()<<" path points, log "<<written_log.tellg()<<" bytes"<<std::endl;
+
+    RunDynamicPlanningReplay(log_file, 10);
 }
 
-/** 动态地图路径规划测试多边形 **/
-std::vector<std::vector<cv::Point>> ConstructHandcraftedContours5()
+/** 百万级像素的牛耕式路径转换成运动指令的耗时 **/
+void GetNavigationMessageBenchmark()
 {
-    std::vector<cv::Point> handcrafted_polygon_5_1 = {cv::Point(125, 50), cv::Point(50, 125), cv::Point(125, 200), cv::Point(200, 125)};
-    std::vector<cv::Point> handcrafted_polygon_5_2 = {cv::Point(80, 300), cv::Point(80, 400), cv::Point(160, 400), cv::Point(120, 350),
-                                                      cv::Point(160, 300)};
-    std::vector<cv::Point> handcrafted_polygon_5_3 = {cv::Point(100, 450), cv::Point(100, 550), cv::Point(140, 550), cv::Point(140, 450)};
-    std::vector<cv::Point> handcrafted_polygon_5_4 = {cv::Point(300, 150), cv::Point(300, 250), cv::Point(400, 220), cv::Point(400, 180)};
-    std::vector<std::vector<cv::Point>> contours = {handcrafted_polygon_5_1, handcrafted_polygon_5_2, handcrafted_polygon_5_3, handcrafted_polygon_5_4};
-    return contours;
-}
+    double meters_per_pix = 0.02;
 
+    for(int lane_length : {1000, 4000})
+    {
+        // 竖直往返的牛耕路径, 换行处走一段斜线
+        std::deque<Point2D> path;
+        int x = 0;
+        for(int lane = 0; lane < 500; lane++)
+        {
+            for(int y = 0; y < lane_length; y++)
+            {
+                path.emplace_back(Point2D(x, (lane%2==0) ? y : lane_length-1-y));
+            }
+            for(int step = 1; step <= 3; step++)
+            {
+                path.emplace_back(Point2D(x+step, (lane%2==0) ? lane_length-1-step+1 : step-1));
+            }
+            x += 4;
+        }
 
+        Eigen::Vector2d curr_direction = {0, -1};
 
-/** 测试辅助函数 **/
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<NavigationMessage> messages = GetNavigationMessage(curr_direction, path, meters_per_pix);
+        double elapsed_ms = ElapsedMilliseconds(start);
 
+        std::cout<<"GetNavigationMessage: "<<path.size()<<" points, "<<messages.size()<<" messages, "<<elapsed_ms<<" ms, "
+                 <<elapsed_ms*1e6/path.size()<<" ns per point"<<std::endl;
+    }
+}
 
-void CheckObstaclePointType(cv::Mat& map, const Polygon& obstacle)
+/** 位栅格与三通道地图的内存占用和整图扫描耗时对比 **/
+void OccupancyGridBenchmark()
 {
-    PolygonList obstacles = {obstacle};
+    int map_size = 4000;
 
-    std::vector<Event> event_list = GenerateObstacleEventList(map, obstacles);
+    cv::Mat3b map = cv::Mat3b(cv::Size(map_size, map_size), CV_8U);
+    map.setTo(cv::Scalar(0, 0, 0));
 
-    for(auto event: event_list)
+    std::mt19937 generator(2019);
+    std::uniform_int_distribution<int> position_distribution(0, map_size-1);
+    std::uniform_int_distribution<int> radius_distribution(10, 80);
+    for(int i = 0; i < 400; i++)
     {
-        if(event.event_type == IN)
-        {
-            std::cout<<event.x<<", "<<event.y<<", IN"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
-        }
-        if(event.event_type == IN_TOP)
-        {
-            std::cout<<event.x<<", "<<event.y<<", IN_TOP"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
-        }
-        if(event.event_type == IN_BOTTOM)
-        {
-            std::cout<<event.x<<", "<<event.y<<", IN_BOTTOM"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
-        }
-        if(event.event_type == OUT)
-        {
-            std::cout<<event.x<<", "<<event.y<<", OUT"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
-        }
-        if(event.event_type == OUT_TOP)
-        {
-            std::cout<<event.x<<", "<<event.y<<", OUT_TOP"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
-        }
-        if(event.event_type == OUT_BOTTOM)
-        {
-            std::cout<<event.x<<", "<<event.y<<", OUT_BOTTOM"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
-        }
-        if(event.event_type == INNER_IN)
-        {
-            std::cout<<event.x<<", "<<event.y<<", INNER_IN"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
-        }
-        if(event.event_type == INNER_IN_TOP)
-        {
-            std::cout<<event.x<<", "<<event.y<<", INNER_IN_TOP"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
-        }
-        if(event.event_type == INNER_IN_BOTTOM)
-        {
-            std::cout<<event.x<<", "<<event.y<<", INNER_IN_BOTTOM"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
-        }
-        if(event.event_type == INNER_OUT)
-        {
-            std::cout<<event.x<<", "<<event.y<<", INNER_OUT"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
-        }
-        if(event.event_type == INNER_OUT_TOP)
-        {
-            std::cout<<event.x<<", "<<event.y<<", INNER_OUT_TOP"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
-        }
-        if(event.event_type == INNER_OUT_BOTTOM)
+        cv::circle(map, cv::Point(position_distribution(generator), position_distribution(generator)), radius_distribution(generator), cv::Scalar(255, 255, 255), -1);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    OccupancyGrid occupancy_grid = ConstructOccupancyGrid(map, cv::Vec3b(255, 255, 255));
+    double packing_ms = ElapsedMilliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    size_t map_occupied = 0;
+    for(int y = 0; y < map.rows; y++)
+    {
+        for(int x = 0; x < map.cols; x++)
         {
-            std::cout<<event.x<<", "<<event.y<<", INNER_OUT_BOTTOM"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+            if(map.at<cv::Vec3b>(y, x) == cv::Vec3b(255, 255, 255))
+            {
+                map_occupied++;
+            }
         }
-        if(event.event_type == MIDDLE)
+    }
+    double map_scan_ms = ElapsedMilliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    size_t grid_occupied = occupancy_grid.CountOccupied();
+    double grid_scan_ms = ElapsedMilliseconds(start);
+
+    std::cout<<"OccupancyGrid: "<<map_size<<"x"<<map_size<<" map, Mat3b "<<map.rows*map.cols*3/1024<<" KB, grid "<<occupancy_grid.MemoryBytes()/1024
+             <<" KB, packing "<<packing_ms<<" ms"<<std::endl;
+    std::cout<<"OccupancyGrid: "<<map_occupied<<" occupied pixels by Vec3b scan in "<<map_scan_ms<<" ms, "
+             <<grid_occupied<<" by popcount in "<<grid_scan_ms<<" ms"<<std::endl;
+}
+
+void StaticPathPlanningParallelBenchmark()
+{
+    int thread_num = std::max(int(std::thread::hardware_concurrency()), 1);
+    int repeats = 10;
+
+    cv::Mat1b complicate_map = PreprocessMap(ReadMap("../complicate_map.png"));
+    for(int scale : {1, 2, 4})
+    {
+        int robot_radius = 5*scale;
+        cv::Mat1b map;
+        cv::resize(complicate_map, map, cv::Size(complicate_map.cols*scale, complicate_map.rows*scale), 0, 0, cv::INTER_NEAREST);
+
+        std::vector<std::vector<cv::Point>> wall_contours;
+        std::vector<std::vector<cv::Point>> obstacle_contours;
+        ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
+
+        std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+        Point2D start = cell_graph.front().ceiling.front();
+
+        std::deque<std::deque<Point2D>> serial_path, parallel_path;
+
+        std::chrono::steady_clock::time_point serial_start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repeats; i++)
         {
-            map.at<cv::Vec3b>(event.y, event.x) = cv::Vec3b(50, 50 ,50);
+            std::vector<CellNode> serial_cell_graph = cell_graph;
+            serial_path = StaticPathPlanning(map, serial_cell_graph, start, robot_radius, false, false);
         }
-        if(event.event_type == CEILING)
+        double serial_time_ms = ElapsedMilliseconds(serial_start) / repeats;
+
+        std::chrono::steady_clock::time_point parallel_start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repeats; i++)
         {
-            map.at<cv::Vec3b>(event.y, event.x) = cv::Vec3b(0, 255 ,255);
+            std::vector<CellNode> parallel_cell_graph = cell_graph;
+            parallel_path = StaticPathPlanningParallel(parallel_cell_graph, start, robot_radius, thread_num);
         }
-        if(event.event_type == FLOOR)
+        double parallel_time_ms = ElapsedMilliseconds(parallel_start) / repeats;
+
+        bool is_same = serial_path.size() == parallel_path.size();
+        for(int i = 0; is_same && i < serial_path.size(); i++)
         {
-            map.at<cv::Vec3b>(event.y, event.x) = cv::Vec3b(255, 0 ,0);
+            is_same = serial_path[i] == parallel_path[i];
         }
+
+        std::cout<<"static planning of complicate_map.png x"<<scale<<" ("<<cell_graph.size()<<" cells): serial "<<serial_time_ms<<" ms, "
+                 <<thread_num<<" threads "<<parallel_time_ms<<" ms, "<<(is_same ? "same path" : "different path")<<std::endl;
     }
 }
 
-void CheckWallPointType(cv::Mat& map, const Polygon& wall)
+void SweepAngleBenchmark()
 {
-    std::vector<Event> event_list = GenerateWallEventList(map, wall);
-    for(auto event: event_list)
+    double meters_per_pix = 0.02;
+    double robot_size_in_meters = 0.15;
+    int robot_radius = ComputeRobotRadius(meters_per_pix, robot_size_in_meters);
+    int thread_num = std::max(int(std::thread::hardware_concurrency()), 1);
+
+    // 把地图转30度, 模拟与图像坐标轴不对齐的房间
+    cv::Mat1b map = PreprocessMap(RotateMap(PreprocessMap(ReadMap("../map.png")), 30.0));
+    Point2D start = Point2D(map.cols/2, map.rows/2);
+
+    std::vector<double> angles;
+    for(double angle = 0.0; angle < 180.0; angle += 15.0)
     {
-        if(event.event_type == IN_EX)
-        {
-            std::cout<<event.x<<", "<<event.y<<", IN_EX"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
-        }
-        if(event.event_type == IN_TOP_EX)
-        {
-            std::cout<<event.x<<", "<<event.y<<", IN_TOP_EX"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
-        }
-        if(event.event_type == IN_BOTTOM_EX)
+        angles.emplace_back(angle);
+    }
+
+    std::vector<SweepPlan> candidates;
+    std::chrono::steady_clock::time_point planning_start = std::chrono::steady_clock::now();
+    SweepPlan best_plan = PlanBestSweepAngle(map, start, robot_radius, meters_per_pix, angles, thread_num, KinematicModel(), &candidates);
+    double planning_time_ms = ElapsedMilliseconds(planning_start);
+
+    for(const auto& plan : candidates)
+    {
+        std::cout<<"sweep angle "<<plan.angle<<": "<<plan.cell_num<<" cells, "<<plan.lane_num<<" lanes, "<<plan.turn_num<<" turns, "
+                 <<plan.length<<" m, estimated "<<plan.estimated_time<<" s"<<(plan.is_start_snapped ? ", start moved into the nearest cell" : "");
+        if(plan.is_path_generated)
         {
-            std::cout<<event.x<<", "<<event.y<<", IN_BOTTOM_EX"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
+            std::cout<<", path generated, "<<plan.blocked_point_num<<" blocked points";
         }
-        if(event.event_type == OUT_EX)
+        std::cout<<std::endl;
+    }
+
+    int blocked_points = 0;
+    for(const auto& point : best_plan.path)
+    {
+        if(map(point.y, point.x) == 0)
         {
-            std::cout<<event.x<<", "<<event.y<<", OUT_EX"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+            blocked_points++;
         }
-        if(event.event_type == OUT_TOP_EX)
+    }
+    std::cout<<"best sweep angle "<<best_plan.angle<<" out of "<<angles.size()<<" candidates on "<<thread_num<<" threads in "<<planning_time_ms<<" ms, "
+             <<best_plan.path.size()<<" path points, "<<blocked_points<<" on obstacles"<<std::endl;
+}
+
+void PathCostModelBenchmark()
+{
+    double meters_per_pix = 0.02;
+    int robot_radius = 5;
+    KinematicModel model;
+
+    cv::Mat1b map = PreprocessMap(ReadMap("../complicate_map.png"));
+
+    std::vector<std::vector<cv::Point>> wall_contours;
+    std::vector<std::vector<cv::Point>> obstacle_contours;
+    ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
+
+    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+
+    // 候选方案: 每个cell作为起始cell, 每个角点作为起始角点
+    std::vector<std::deque<CellNode>> cell_paths;
+    for(int i = 0; i < cell_graph.size(); i++)
+    {
+        std::vector<CellNode> candidate_cell_graph = cell_graph;
+        cell_paths.emplace_back(GetVisittingPath(candidate_cell_graph, i));
+    }
+
+    int repeats = 100;
+    int candidate_num = 0;
+    PathCost best_cost;
+    best_cost.time = DBL_MAX;
+    int best_start_cell = 0, best_start_corner = TOPLEFT;
+
+    std::chrono::steady_clock::time_point estimation_start = std::chrono::steady_clock::now();
+    for(int repeat = 0; repeat < repeats; repeat++)
+    {
+        for(int i = 0; i < cell_paths.size(); i++)
         {
-            std::cout<<event.x<<", "<<event.y<<", OUT_TOP_EX"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+            for(int corner : {TOPLEFT, BOTTOMLEFT, BOTTOMRIGHT, TOPRIGHT})
+            {
+                std::vector<CellSweepPlan> sweep_plans = AssignSweepCorners(cell_graph, cell_paths[i], robot_radius, corner);
+                PathCost cost = EstimatePathCost(cell_paths[i], sweep_plans, robot_radius, meters_per_pix, model);
+                if(cost.time < best_cost.time)
+                {
+                    best_cost = cost;
+                    best_start_cell = i;
+                    best_start_corner = corner;
+                }
+                candidate_num++;
+            }
         }
-        if(event.event_type == OUT_BOTTOM_EX)
+    }
+    double estimation_time_ms = ElapsedMilliseconds(estimation_start);
+
+    // 默认方案(从第一个cell的左上角出发)的估计值与生成路径后的统计值对照
+    std::vector<CellSweepPlan> default_sweep_plans = AssignSweepCorners(cell_graph, cell_paths.front(), robot_radius);
+    PathCost estimated_cost = EstimatePathCost(cell_paths.front(), default_sweep_plans, robot_radius, meters_per_pix, model);
+
+    std::chrono::steady_clock::time_point planning_start = std::chrono::steady_clock::now();
+    std::vector<CellNode> planning_cell_graph = cell_graph;
+    std::deque<Point2D> path = FilterTrajectory(StaticPathPlanning(map, planning_cell_graph, cell_graph.front().ceiling.front(), robot_radius, false, false));
+    PathCost measured_cost = MeasurePathCost(path, meters_per_pix, model);
+    double planning_time_ms = ElapsedMilliseconds(planning_start);
+
+    std::cout<<"path cost model: "<<candidate_num<<" candidates in "<<estimation_time_ms<<" ms, "<<1000.0*estimation_time_ms/candidate_num<<" us per candidate, "
+             <<"full planning and measuring "<<planning_time_ms<<" ms per candidate"<<std::endl;
+    std::cout<<"default plan estimated: "<<estimated_cost.length<<" m, "<<estimated_cost.turn_num<<" turns, "<<estimated_cost.overlap_length<<" m overlap, "<<estimated_cost.time<<" s"<<std::endl;
+    std::cout<<"default plan measured: "<<measured_cost.length<<" m, "<<measured_cost.turn_num<<" turns, "<<measured_cost.overlap_length<<" m overlap, "<<measured_cost.time<<" s"<<std::endl;
+    std::cout<<"best plan starts from cell "<<best_start_cell<<" corner "<<best_start_corner<<": "<<best_cost.length<<" m, "<<best_cost.turn_num<<" turns, "<<best_cost.time<<" s"<<std::endl;
+}
+
+void CoverageEvaluationBenchmark()
+{
+    cv::Mat1b complicate_map = PreprocessMap(ReadMap("../complicate_map.png"));
+    for(int scale : {1, 4})
+    {
+        int robot_radius = 5*scale;
+        cv::Mat1b map;
+        cv::resize(complicate_map, map, cv::Size(complicate_map.cols*scale, complicate_map.rows*scale), 0, 0, cv::INTER_NEAREST);
+
+        std::vector<std::vector<cv::Point>> wall_contours;
+        std::vector<std::vector<cv::Point>> obstacle_contours;
+        ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
+
+        std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+        std::deque<Point2D> path = FilterTrajectory(StaticPathPlanning(map, cell_graph, cell_graph.front().ceiling.front(), robot_radius, false, false));
+
+        // 逐点画圆的做法
+        std::chrono::steady_clock::time_point circle_start = std::chrono::steady_clock::now();
+        cv::Mat1b covered_space = cv::Mat1b(map.size(), CV_8U);
+        covered_space.setTo(0);
+        for(const auto& position : path)
         {
-            std::cout<<event.x<<", "<<event.y<<", OUT_BOTTOM_EX"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+            cv::circle(covered_space, cv::Point(position.x, position.y), robot_radius, cv::Scalar(255), -1);
         }
-        if(event.event_type == INNER_IN_EX)
+        int free_pixels = 0, covered_pixels = 0;
+        for(int y = 0; y < map.rows; y++)
         {
-            std::cout<<event.x<<", "<<event.y<<", INNER_IN_EX"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
+            for(int x = 0; x < map.cols; x++)
+            {
+                free_pixels += (map(y, x) == 255);
+                covered_pixels += (map(y, x) == 255 && covered_space(y, x) == 255);
+            }
         }
-        if(event.event_type == INNER_IN_TOP_EX)
+        double circle_time_ms = ElapsedMilliseconds(circle_start);
+
+        std::chrono::steady_clock::time_point interval_start = std::chrono::steady_clock::now();
+        CoverageReport report = EvaluateCoverage(map, path, robot_radius);
+        double interval_time_ms = ElapsedMilliseconds(interval_start);
+
+        std::chrono::steady_clock::time_point heatmap_start = std::chrono::steady_clock::now();
+        CoverageReport heatmap_report = EvaluateCoverage(map, path, robot_radius, robot_radius+1);
+        double heatmap_time_ms = ElapsedMilliseconds(heatmap_start);
+
+        std::cout<<"coverage of complicate_map.png x"<<scale<<" ("<<path.size()<<" path points, robot radius "<<robot_radius<<"): "
+                 <<"circles "<<circle_time_ms<<" ms, "<<100.0*covered_pixels/free_pixels<<"%; "
+                 <<"intervals "<<interval_time_ms<<" ms, "<<100.0*report.coverage_rate<<"%, "<<report.missed_pixels<<" pixels missed; "
+                 <<"with heatmap "<<heatmap_time_ms<<" ms"<<std::endl;
+    }
+}
+
+void ContourTracingBenchmark()
+{
+    int thread_num = std::max(int(std::thread::hardware_concurrency()), 1);
+    int repeats = 10;
+
+    for(const std::string& map_name : {std::string("map.png"), std::string("complicate_map.png")})
+    {
+        cv::Mat1b original_map = PreprocessMap(ReadMap("../" + map_name));
+        for(int scale : {1, 4})
         {
-            std::cout<<event.x<<", "<<event.y<<", INNER_IN_TOP_EX"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
+            cv::Mat1b map;
+            cv::resize(original_map, map, cv::Size(original_map.cols*scale, original_map.rows*scale), 0, 0, cv::INTER_NEAREST);
+
+            std::vector<std::vector<cv::Point>> two_pass_wall, two_pass_obstacles;
+            std::chrono::steady_clock::time_point two_pass_start = std::chrono::steady_clock::now();
+            for(int i = 0; i < repeats; i++)
+            {
+                ExtractRawContoursTwoPass(map, two_pass_wall, two_pass_obstacles);
+            }
+            double two_pass_time_ms = ElapsedMilliseconds(two_pass_start) / repeats;
+
+            std::vector<std::vector<cv::Point>> traced_wall, traced_obstacles;
+            std::chrono::steady_clock::time_point serial_start = std::chrono::steady_clock::now();
+            for(int i = 0; i < repeats; i++)
+            {
+                ExtractRawContours(map, traced_wall, traced_obstacles);
+            }
+            double serial_time_ms = ElapsedMilliseconds(serial_start) / repeats;
+
+            std::chrono::steady_clock::time_point parallel_start = std::chrono::steady_clock::now();
+            for(int i = 0; i < repeats; i++)
+            {
+                ExtractRawContours(map, traced_wall, traced_obstacles, thread_num);
+            }
+            double parallel_time_ms = ElapsedMilliseconds(parallel_start) / repeats;
+
+            bool is_same = (two_pass_wall == traced_wall && two_pass_obstacles == traced_obstacles);
+
+            std::cout<<"contours of "<<map_name<<" x"<<scale<<" ("<<traced_obstacles.size()<<" obstacles): findContours twice "<<two_pass_time_ms<<" ms, "
+                     <<"tracer "<<serial_time_ms<<" ms, "<<thread_num<<" threads "<<parallel_time_ms<<" ms, "<<(is_same ? "same contours" : "different contours")<<std::endl;
         }
-        if(event.event_type == INNER_IN_BOTTOM_EX)
+    }
+}
+
+/** std::deque<Point2D>与结构数组PathBuffer的去重耗时、内存和路径长度计算耗时对比 **/
+void PathBufferBenchmark()
+{
+    int repeats = 20;
+
+    cv::Mat1b complicate_map = PreprocessMap(ReadMap("../complicate_map.png"));
+    for(int scale : {1, 4})
+    {
+        int robot_radius = 5*scale;
+        cv::Mat1b map;
+        cv::resize(complicate_map, map, cv::Size(complicate_map.cols*scale, complicate_map.rows*scale), 0, 0, cv::INTER_NEAREST);
+
+        std::vector<std::vector<cv::Point>> wall_contours;
+        std::vector<std::vector<cv::Point>> obstacle_contours;
+        ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
+
+        std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+        std::deque<std::deque<Point2D>> raw_path = StaticPathPlanning(map, cell_graph, cell_graph.front().ceiling.front(), robot_radius, false, false);
+
+        std::deque<Point2D> path;
+        std::chrono::steady_clock::time_point deque_start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repeats; i++)
         {
-            std::cout<<event.x<<", "<<event.y<<", INNER_IN_BOTTOM_EX"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 255, 0), -1);
+            path = FilterTrajectory(raw_path);
         }
-        if(event.event_type == INNER_OUT_EX)
+        double deque_filter_ms = ElapsedMilliseconds(deque_start) / repeats;
+
+        PathBuffer path_buffer;
+        std::chrono::steady_clock::time_point buffer_start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repeats; i++)
         {
-            std::cout<<event.x<<", "<<event.y<<", INNER_OUT_EX"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+            path_buffer = FilterTrajectoryCompact(raw_path);
         }
-        if(event.event_type == INNER_OUT_TOP_EX)
+        double buffer_filter_ms = ElapsedMilliseconds(buffer_start) / repeats;
+
+        double deque_length = 0;
+        deque_start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repeats; i++)
         {
-            std::cout<<event.x<<", "<<event.y<<", INNER_OUT_TOP_EX"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+            deque_length = 0;
+            for(int j = 1; j < path.size(); j++)
+            {
+                deque_length += std::sqrt(double(path[j].x-path[j-1].x)*(path[j].x-path[j-1].x)+double(path[j].y-path[j-1].y)*(path[j].y-path[j-1].y));
+            }
         }
-        if(event.event_type == INNER_OUT_BOTTOM_EX)
+        double deque_length_ms = ElapsedMilliseconds(deque_start) / repeats;
+
+        double buffer_length = 0;
+        buffer_start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repeats; i++)
         {
-            std::cout<<event.x<<", "<<event.y<<", INNER_OUT_BOTTOM_EX"<<std::endl;
-            cv::circle(map, cv::Point(event.x, event.y), 2, cv::Scalar(0, 0, 255), -1);
+            buffer_length = ComputePathLength(path_buffer);
         }
-        if(event.event_type == MIDDLE)
+        double buffer_length_ms = ElapsedMilliseconds(buffer_start) / repeats;
+
+        bool is_same = (path == path_buffer.ToDeque() && std::abs(deque_length - buffer_length) < 1e-6);
+
+        std::cout<<"path of complicate_map.png x"<<scale<<" ("<<path.size()<<" points): "
+                 <<"deque "<<path.size()*sizeof(Point2D)/1024<<" KB, filter "<<deque_filter_ms<<" ms, length "<<deque_length_ms<<" ms; "
+                 <<"PathBuffer "<<path_buffer.MemoryBytes()/1024<<" KB, filter "<<buffer_filter_ms<<" ms, length "<<buffer_length_ms<<" ms, "
+                 <<(is_same ? "same path" : "different path")<<std::endl;
+    }
+}
+
+/** 一次性生成整条路径与CoveragePathGenerator按需生成的首段耗时(机器人开始运动前的等待)和缓存点数对比 **/
+void LazyPathGeneratorBenchmark()
+{
+    int repeats = 10;
+
+    cv::Mat1b complicate_map = PreprocessMap(ReadMap("../complicate_map.png"));
+    for(int scale : {1, 4})
+    {
+        int robot_radius = 5*scale;
+        cv::Mat1b map;
+        cv::resize(complicate_map, map, cv::Size(complicate_map.cols*scale, complicate_map.rows*scale), 0, 0, cv::INTER_NEAREST);
+
+        std::vector<std::vector<cv::Point>> wall_contours;
+        std::vector<std::vector<cv::Point>> obstacle_contours;
+        ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
+
+        std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+        Point2D start = cell_graph.front().ceiling.front();
+
+        std::deque<std::deque<Point2D>> eager_path;
+        size_t eager_point_num = 0;
+        std::vector<std::vector<CellNode>> eager_cell_graphs(repeats, cell_graph);
+        std::chrono::steady_clock::time_point eager_start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repeats; i++)
         {
-            map.at<cv::Vec3b>(event.y, event.x) = cv::Vec3b(50, 50 ,50);
+            eager_path = StaticPathPlanning(map, eager_cell_graphs[i], start, robot_radius, false, false);
         }
-        if(event.event_type == CEILING)
+        double eager_time_ms = ElapsedMilliseconds(eager_start) / repeats;
+        for(const auto& segment : eager_path)
         {
-            map.at<cv::Vec3b>(event.y, event.x) = cv::Vec3b(0, 255 ,255);
+            eager_point_num += segment.size();
         }
-        if(event.event_type == FLOOR)
+
+        double first_segment_ms = 0;
+        double total_time_ms = 0;
+        size_t max_buffered_num = 0;
+        bool is_same = true;
+        for(int i = 0; i < repeats; i++)
         {
-            map.at<cv::Vec3b>(event.y, event.x) = cv::Vec3b(255, 0 ,0);
+            std::vector<CellNode> lazy_cell_graph = cell_graph;
+            std::chrono::steady_clock::time_point lazy_start = std::chrono::steady_clock::now();
+            CoveragePathGenerator generator(lazy_cell_graph, start, robot_radius);
+            std::deque<Point2D> segment;
+            generator.NextSegment(segment);
+            first_segment_ms += ElapsedMilliseconds(lazy_start);
+
+            int segment_index = 0;
+            do
+            {
+                is_same = is_same && segment_index < eager_path.size() && segment == eager_path[segment_index];
+                max_buffered_num = std::max(max_buffered_num, segment.size() + generator.BufferedPointNum());
+                segment_index++;
+            }while(generator.NextSegment(segment));
+            is_same = is_same && segment_index == eager_path.size();
+            total_time_ms += ElapsedMilliseconds(lazy_start);
         }
+        first_segment_ms /= repeats;
+        total_time_ms /= repeats;
+
+        std::cout<<"lazy path of complicate_map.png x"<<scale<<" ("<<eager_path.size()<<" segments): "
+                 <<"StaticPathPlanning "<<eager_time_ms<<" ms, "<<eager_point_num<<" points held; "
+                 <<"generator first segment "<<first_segment_ms<<" ms, all segments "<<total_time_ms<<" ms, at most "<<max_buffered_num<<" points held, "
+                 <<(is_same ? "same path" : "different path")<<std::endl;
     }
 }
 
-void CheckPointType(const cv::Mat& map, const Polygon& wall, const PolygonList& obstacles)
+// 外顶点和内顶点交替的星形, 共2*spike_num个顶点
+std::vector<Point2D> GenerateStarPolygon(const Point2D& center, int spike_num, int outer_radius, int inner_radius)
 {
-    cv::Mat vis_map = map.clone();
-    cv::cvtColor(vis_map, vis_map, cv::COLOR_GRAY2BGR);
-
-    cv::namedWindow("map", cv::WINDOW_NORMAL);
-
-    for(const auto& obstacle:obstacles)
+    std::vector<Point2D> vertices;
+    for(int i = 0; i < 2*spike_num; i++)
     {
-        CheckObstaclePointType(vis_map, obstacle);
-        cv::imshow("map", vis_map);
-        cv::waitKey(0);
-        std::cout<<std::endl;
+        double angle = M_PI * i / spike_num;
+        int radius = (i % 2 == 0) ? outer_radius : inner_radius;
+        vertices.emplace_back(Point2D(center.x + int(std::lround(radius*std::cos(angle))), center.y + int(std::lround(radius*std::sin(angle)))));
     }
-
-    CheckWallPointType(vis_map, wall);
-    cv::imshow("map", vis_map);
-    cv::waitKey(0);
+    return vertices;
 }
 
-void CheckSlicelist(const std::deque<std::deque<Event>>& slice_list)
+// 对外墙和各障碍物的事件表分类repeats次, 返回每次的平均耗时(毫秒)
+double TimeEventClassification(const OccupancyGrid& occupancy_grid, const Polygon& wall, const PolygonList& obstacles, int repeats)
 {
-    std::deque<Event> slice;
-    for(int i = 0; i < slice_list.size(); i++)
+    std::vector<std::vector<Event>> initial_lists = {InitializeEventList(wall, INT_MAX)};
+    for(int i = 0; i < obstacles.size(); i++)
     {
-        slice = FilterSlice(slice_list[i]);
-        std::cout<<"slice "<<i<<": ";
-        for(const auto& event : slice)
+        initial_lists.emplace_back(InitializeEventList(obstacles[i], i));
+    }
+
+    std::vector<std::vector<Event>> table_lists;
+    std::chrono::steady_clock::time_point table_start = std::chrono::steady_clock::now();
+    for(int i = 0; i < repeats; i++)
+    {
+        table_lists = initial_lists;
+        AllocateWallEventType(occupancy_grid, table_lists.front());
+        for(int j = 1; j < table_lists.size(); j++)
         {
-            EventType type = event.event_type;
-            switch (type)
-            {
-                case IN:
-                    std::cout<<"IN; ";
-                    break;
-                case IN_TOP:
-                    std::cout<<"IN_TOP; ";
-                    break;
-                case IN_BOTTOM:
-                    std::cout<<"IN_BOTTOM; ";
-                    break;
-                case OUT:
-                    std::cout<<"OUT; ";
-                    break;
-                case OUT_TOP:
-                    std::cout<<"OUT_TOP; ";
-                    break;
-                case OUT_BOTTOM:
-                    std::cout<<"OUT_BOTTOM; ";
-                    break;
-                case INNER_IN:
-                    std::cout<<"INNER_IN; ";
-                    break;
-                case INNER_IN_TOP:
-                    std::cout<<"INNER_IN_TOP; ";
-                    break;
-                case INNER_IN_BOTTOM:
-                    std::cout<<"INNER_IN_BOTTOM; ";
-                    break;
-                case INNER_OUT:
-                    std::cout<<"INNER_OUT; ";
-                    break;
-                case INNER_OUT_TOP:
-                    std::cout<<"INNER_OUT_TOP; ";
-                    break;
-                case INNER_OUT_BOTTOM:
-                    std::cout<<"INNER_OUT_BOTTOM; ";
-                    break;
-                case IN_EX:
-                    std::cout<<"IN_EX; ";
-                    break;
-                case IN_TOP_EX:
-                    std::cout<<"IN_TOP_EX; ";
-                    break;
-                case IN_BOTTOM_EX:
-                    std::cout<<"IN_BOTTOM_EX; ";
-                    break;
-                case OUT_EX:
-                    std::cout<<"OUT_EX; ";
-                    break;
-                case OUT_TOP_EX:
-                    std::cout<<"OUT_TOP_EX; ";
-                    break;
-                case OUT_BOTTOM_EX:
-                    std::cout<<"OUT_BOTTOM_EX; ";
-                    break;
-                case INNER_IN_EX:
-                    std::cout<<"INNER_IN_EX; ";
-                    break;
-                case INNER_IN_TOP_EX:
-                    std::cout<<"INNER_IN_TOP_EX; ";
-                    break;
-                case INNER_IN_BOTTOM_EX:
-                    std::cout<<"INNER_IN_BOTTOM_EX; ";
-                    break;
-                case INNER_OUT_EX:
-                    std::cout<<"INNER_OUT_EX; ";
-                    break;
-                case INNER_OUT_TOP_EX:
-                    std::cout<<"INNER_OUT_TOP_EX; ";
-                    break;
-                case INNER_OUT_BOTTOM_EX:
-                    std::cout<<"INNER_OUT_BOTTOM_EX; ";
-                    break;
-                case MIDDLE:
-                    std::cout<<"MIDDLE; ";
-                    break;
-                case CEILING:
-                    std::cout<<"CEILING; ";
-                    break;
-                case FLOOR:
-                    std::cout<<"FLOOR; ";
-                    break;
-                case UNALLOCATED:
-                    std::cout<<"UNALLOCATED; ";
-                    break;
-            }
+            AllocateObstacleEventType(occupancy_grid, table_lists[j]);
         }
-        std::cout<<std::endl;
     }
+    return ElapsedMilliseconds(table_start) / repeats;
 }
 
-void CheckExtractedContours(const cv::Mat& map, const std::vector<std::vector<cv::Point>>& contours)
+/**
+ * 查表事件分类在上万个顶点的多边形上的吞吐量, 分类结果由EventTypeRegressionTest检查.
+ * 星形多边形的对照值是查表之前逐个比较的分类器(52984e5)在同样输入、-O2下测得的, 换机器后只作数量级参考.
+ **/
+void EventClassificationBenchmark()
 {
-    cv::namedWindow("map", cv::WINDOW_NORMAL);
-
-    cv::Mat3b canvas = cv::Mat3b(map.size(), CV_8U);
-    canvas.setTo(cv::Scalar(0,0,0));
+    int repeats = 10;
 
-    for(int i = 0; i<=contours.size()-1; i++)
+    cv::Mat1b complicate_map = PreprocessMap(ReadMap("../complicate_map.png"));
+    for(int scale : {1, 4, 8})
     {
-        cv::drawContours(canvas, contours, i, cv::Scalar(255, 0, 0));
-        cv::imshow("map", canvas);
-        cv::waitKey(0);
-    }
-}
+        cv::Mat1b map;
+        cv::resize(complicate_map, map, cv::Size(complicate_map.cols*scale, complicate_map.rows*scale), 0, 0, cv::INTER_NEAREST);
 
-void CheckGeneratedCells(const cv::Mat& map, const std::vector<CellNode>& cell_graph)
-{
-    cv::Mat vis_map = map.clone();
-    cv::cvtColor(vis_map, vis_map, cv::COLOR_GRAY2BGR);
+        std::vector<std::vector<cv::Point>> wall_contours;
+        std::vector<std::vector<cv::Point>> obstacle_contours;
+        ExtractContours(map, wall_contours, obstacle_contours);
 
-    cv::namedWindow("map", cv::WINDOW_NORMAL);
+        Polygon wall = ConstructWall(map, wall_contours.front());
+        PolygonList obstacles = ConstructObstacles(obstacle_contours);
+        OccupancyGrid occupancy_grid = ConstructOccupancyGrid(map.size(), wall_contours, obstacle_contours);
 
-    for(const auto& cell : cell_graph)
-    {
-        DrawCells(vis_map, cell, cv::Scalar(255, 0, 255));
-        cv::imshow("map", vis_map);
-        cv::waitKey(0);
+        size_t vertex_num = wall.size();
+        for(const auto& obstacle : obstacles)
+        {
+            vertex_num += obstacle.size();
+        }
+
+        double table_time_ms = TimeEventClassification(occupancy_grid, wall, obstacles, repeats);
+        std::cout<<"event classification of complicate_map.png x"<<scale<<" (wall "<<wall.size()<<" vertices, "<<vertex_num<<" in total): "
+                 <<"table "<<table_time_ms<<" ms, "<<vertex_num/table_time_ms/1000.0<<" M vertices per second"<<std::endl;
     }
-}
 
-void CheckPathNodes(const std::deque<std::deque<Point2D>>& path)
-{
-    for(const auto& subpath : path)
+    // 5000个尖角的星形分别作为障碍物和外墙, 光栅化后约九十万个顶点
+    int map_size = 4000;
+    std::vector<Point2D> rectangle = {Point2D(2, 2), Point2D(map_size-3, 2), Point2D(map_size-3, map_size-3), Point2D(2, map_size-3)};
+    std::vector<Point2D> star = GenerateStarPolygon(Point2D(map_size/2, map_size/2), 5000, 1900, 1800);
+
+    for(bool is_star_wall : {false, true})
     {
-        for(const auto& point : subpath)
+        std::vector<Point2D> wall_vertices = is_star_wall ? star : rectangle;
+        std::vector<std::vector<Point2D>> obstacle_vertices;
+        if(!is_star_wall)
         {
-            std::cout<<point.x<<", "<<point.y<<std::endl;
+            obstacle_vertices.emplace_back(star);
         }
-        std::cout<<std::endl;
+        // 查表前的分类器每秒处理的顶点数(百万)
+        double baseline_vertices_per_second = is_star_wall ? 21.0 : 19.6;
+
+        OccupancyGrid occupancy_grid = ConstructOccupancyGrid(map_size, map_size, wall_vertices, obstacle_vertices);
+
+        Polygon wall = TracePolygon(wall_vertices);
+        PolygonList obstacles;
+        size_t vertex_num = wall.size();
+        for(const auto& vertices : obstacle_vertices)
+        {
+            obstacles.emplace_back(TracePolygon(vertices));
+            vertex_num += obstacles.back().size();
+        }
+
+        double table_time_ms = TimeEventClassification(occupancy_grid, wall, obstacles, repeats);
+        double vertices_per_second = vertex_num/table_time_ms/1000.0;
+        std::cout<<"event classification of star "<<(is_star_wall ? "wall" : "obstacle")<<" ("<<star.size()<<" polygon vertices, "<<vertex_num<<" traced vertices): "
+                 <<"table "<<table_time_ms<<" ms, "<<vertices_per_second<<" M vertices per second, "
+                 <<"cascaded classifier before the table "<<baseline_vertices_per_second<<" M vertices per second, "
+                 <<vertices_per_second/baseline_vertices_per_second<<"x"<<std::endl;
     }
 }
 
-void CheckPathConsistency(const std::deque<Point2D>& path)
+/** 逐像素事件与顶点级事件(临界事件+边界链)两种分解的事件数和耗时对比, 两者得到的cell应完全相同; 逐像素一侧的耗时含轮廓光栅化 **/
+void VertexEventBenchmark()
 {
-    int breakpoints = 0;
-    int duplicates = 0;
+    int repeats = 10;
+
+    cv::Mat1b complicate_map = PreprocessMap(ReadMap("../complicate_map.png"));
+    for(int scale : {1, 4, 8})
+    {
+        int robot_radius = 5*scale;
+        cv::Mat1b map;
+        cv::resize(complicate_map, map, cv::Size(complicate_map.cols*scale, complicate_map.rows*scale), 0, 0, cv::INTER_NEAREST);
+
+        std::vector<std::vector<cv::Point>> wall_contours;
+        std::vector<std::vector<cv::Point>> obstacle_contours;
+        ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
+
+        OccupancyGrid occupancy_grid = ConstructOccupancyGrid(map.size(), wall_contours, obstacle_contours);
+        std::vector<Point2D> wall_vertices = ConstructVertices(wall_contours.front());
+        std::vector<std::vector<Point2D>> obstacle_vertices;
+        int vertex_num = wall_vertices.size();
+        for(const auto& obstacle_contour : obstacle_contours)
+        {
+            obstacle_vertices.emplace_back(ConstructVertices(obstacle_contour));
+            vertex_num += obstacle_vertices.back().size();
+        }
+
+        std::vector<CellNode> pixel_cell_graph;
+        std::chrono::steady_clock::time_point pixel_start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repeats; i++)
+        {
+            Polygon wall = ConstructWall(map, wall_contours.front());
+            PolygonList obstacles = ConstructObstacles(obstacle_contours);
+            std::vector<Event> wall_event_list = GenerateWallEventList(occupancy_grid, wall);
+            std::vector<Event> obstacle_event_list = GenerateObstacleEventList(occupancy_grid, obstacles);
+            std::deque<std::deque<Event>> slice_list = SliceListGenerator(wall_event_list, obstacle_event_list);
+
+            std::vector<int> cell_index_slice;
+            std::vector<int> original_cell_index_slice;
+            pixel_cell_graph.clear();
+            ExecuteCellDecomposition(pixel_cell_graph, cell_index_slice, original_cell_index_slice, slice_list);
+        }
+        double pixel_time_ms = ElapsedMilliseconds(pixel_start) / repeats;
+
+        VertexEventList vertex_event_list;
+        std::vector<CellNode> vertex_cell_graph;
+        std::chrono::steady_clock::time_point vertex_start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repeats; i++)
+        {
+            vertex_event_list = GenerateVertexEventList(occupancy_grid, wall_vertices, obstacle_vertices);
 
-    for(int i = 1; i < path.size(); i++)
-    {
-        if(std::abs(path[WrappedIndex((i-1),path.size())].x-path[i].x)>1||std::abs(path[WrappedIndex((i-1),path.size())].y-path[i].y)>1)
+            std::vector<int> cell_index_slice;
+            std::vector<int> original_cell_index_slice;
+            vertex_cell_graph.clear();
+            ExecuteVertexCellDecomposition(vertex_cell_graph, cell_index_slice, original_cell_index_slice, vertex_event_list);
+        }
+        double vertex_time_ms = ElapsedMilliseconds(vertex_start) / repeats;
+
+        int piece_num = 0;
+        for(const auto& chain : vertex_event_list.chains)
         {
-            breakpoints++;
-            std::cout<<"break points :"<<path[WrappedIndex((i-1),path.size())].x<<", "<<path[WrappedIndex((i-1),path.size())].y
-                     <<"---->"<<path[i].x<<", "<<path[i].y<<std::endl;
+            piece_num += chain.pieces.size();
         }
-        if(path[WrappedIndex((i-1),path.size())]==path[i])
+
+        bool is_same = pixel_cell_graph.size() == vertex_cell_graph.size();
+        for(int i = 0; is_same && i < pixel_cell_graph.size(); i++)
         {
-            duplicates++;
+            is_same = pixel_cell_graph[i].ceiling == vertex_cell_graph[i].ceiling
+                   && pixel_cell_graph[i].floor == vertex_cell_graph[i].floor
+                   && pixel_cell_graph[i].neighbor_indices == vertex_cell_graph[i].neighbor_indices;
         }
 
+        std::cout<<"vertex-level events of complicate_map.png x"<<scale<<" ("<<vertex_num<<" polygon vertices): "
+                 <<"pixel "<<vertex_event_list.pixel_event_num<<" events "<<pixel_time_ms<<" ms, "
+                 <<"vertex "<<vertex_event_list.critical_events.size()<<" critical events + "<<vertex_event_list.chains.size()<<" chains of "<<piece_num<<" pieces "
+                 <<vertex_time_ms<<" ms, "<<pixel_time_ms/vertex_time_ms<<"x, "
+                 <<pixel_cell_graph.size()<<" cells, "<<(is_same ? "same cells" : "different cells")<<std::endl;
     }
-    std::cout<<"breakpoints: "<<breakpoints<<std::endl;
-    std::cout<<"duplicates: "<<duplicates<<std::endl;
 }
 
-void CheckMotionCommands(const std::vector<NavigationMessage>& navigation_messages)
+/** 逐列存储与分段线性存储的cell边界: 边界点数/内存和整图规划耗时对比, 两者规划出的路径应完全相同 **/
+void SegmentedCellBenchmark()
 {
-    double dist = 0.0, global_yaw = 0.0, local_yaw = 0.0;
-    for(auto message : navigation_messages)
-    {
-        message.GetMotion(dist, global_yaw, local_yaw);
-        std::cout<<"globally rotate "<<global_yaw<<" degree(locally rotate "<<local_yaw<<" degree) and go forward for "<<dist<<" m."<<std::endl;
-    }
-}
-
-
-/** 测试用例 **/
+    int repeats = 10;
 
+    cv::Mat1b complicate_map = PreprocessMap(ReadMap("../complicate_map.png"));
+    for(int scale : {1, 4, 8})
+    {
+        int robot_radius = 5*scale;
+        cv::Mat1b map;
+        cv::resize(complicate_map, map, cv::Size(complicate_map.cols*scale, complicate_map.rows*scale), 0, 0, cv::INTER_NEAREST);
 
-/** 使用图像数据 **/
-void StaticPathPlanningExample1()
-{
-    double meters_per_pix = 0.02;
-    double robot_size_in_meters = 0.15;
+        std::vector<std::vector<cv::Point>> wall_contours;
+        std::vector<std::vector<cv::Point>> obstacle_contours;
+        ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
 
-    int robot_radius = ComputeRobotRadius(meters_per_pix, robot_size_in_meters);
+        std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+        Point2D start = cell_graph.front().ceiling.front();
 
-    cv::Mat1b map = ReadMap("../map.png");
-    map = PreprocessMap(map);
+        std::vector<CellNode> segmented_cell_graph = cell_graph;
+        std::chrono::steady_clock::time_point compress_start = std::chrono::steady_clock::now();
+        int compressed_num = CompressCellGraph(segmented_cell_graph);
+        double compress_time_ms = ElapsedMilliseconds(compress_start);
 
-    std::vector<std::vector<cv::Point>> obstacle_contours;
-    std::vector<std::vector<cv::Point>> wall_contours;
-    ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
+        size_t point_num = 0, vertex_num = 0;
+        for(int i = 0; i < cell_graph.size(); i++)
+        {
+            point_num += cell_graph[i].ceiling.size() + cell_graph[i].floor.size();
+            vertex_num += segmented_cell_graph[i].ceiling_segments.vertices.size() + segmented_cell_graph[i].floor_segments.vertices.size()
+                        + segmented_cell_graph[i].ceiling.size() + segmented_cell_graph[i].floor.size();
+        }
 
-    Polygon wall = ConstructWall(map, wall_contours.front());
-    PolygonList obstacles = ConstructObstacles(map, obstacle_contours);
+        std::deque<std::deque<Point2D>> dense_path, segmented_path;
+        std::vector<std::vector<CellNode>> dense_cell_graphs(repeats, cell_graph);
+        std::chrono::steady_clock::time_point dense_start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repeats; i++)
+        {
+            dense_path = StaticPathPlanning(map, dense_cell_graphs[i], start, robot_radius, false, false);
+        }
+        double dense_time_ms = ElapsedMilliseconds(dense_start) / repeats;
 
-    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours, wall, obstacles);
+        std::vector<std::vector<CellNode>> segmented_cell_graphs(repeats, segmented_cell_graph);
+        std::chrono::steady_clock::time_point segmented_start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repeats; i++)
+        {
+            segmented_path = StaticPathPlanning(map, segmented_cell_graphs[i], start, robot_radius, false, false);
+        }
+        double segmented_time_ms = ElapsedMilliseconds(segmented_start) / repeats;
 
-    Point2D start = Point2D(map.cols/2, map.rows/2);
-    std::deque<std::deque<Point2D>> original_planning_path = StaticPathPlanning(map, cell_graph, start, robot_radius, false, false);
+        std::cout<<"segmented cells of complicate_map.png x"<<scale<<" ("<<compressed_num<<"/"<<cell_graph.size()<<" cells compressed in "<<compress_time_ms<<" ms): "
+                 <<"boundary "<<point_num<<" points ("<<point_num*sizeof(Point2D)/1024<<" KiB) -> "<<vertex_num<<" vertices ("<<vertex_num*sizeof(Point2D)/1024<<" KiB), "
+                 <<"planning dense "<<dense_time_ms<<" ms, segmented "<<segmented_time_ms<<" ms, "
+                 <<(dense_path == segmented_path ? "same path" : "different path")<<std::endl;
+    }
+}
 
-    std::deque<Point2D> path = FilterTrajectory(original_planning_path);
-    CheckPathConsistency(path);
+/** 随机地图压力测试: 按障碍物数量和地图边长扫描, 记录完整流程各阶段的耗时和峰值内存, 用相邻两档的增长指数发现超线性的阶段 **/
 
-    VisualizeTrajectory(map, path, robot_radius, PATH_MODE);
+// 把进程的峰值常驻内存(VmHWM)重置为当前值, 需要Linux 4.0以上; 不支持时峰值从进程启动算起
+void ResetPeakResidentMemory()
+{
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs<<"5";
+}
 
-    Eigen::Vector2d curr_direction = {0, -1};
-    std::vector<NavigationMessage> messages = GetNavigationMessage(curr_direction, path, meters_per_pix);
-    CheckMotionCommands(messages);
+long ReadPeakResidentMemoryKiB()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while(std::getline(status, line))
+    {
+        if(line.compare(0, 6, "VmHWM:") == 0)
+        {
+            return std::atol(line.c_str()+6);
+        }
+    }
+    return -1;
 }
 
-void StaticPathPlanningExample2()
+class StressCase
 {
-    int robot_radius = 5;
+public:
+    StressCase()
+    {
+        obstacle_num = 0;
+        cell_num = 0;
+        boundary_point_num = 0;
+        path_point_num = 0;
+        generate_ms = 0;
+        contour_ms = 0;
+        decompose_ms = 0;
+        plan_ms = 0;
+        peak_memory_kib = -1;
+        status = "OK";
+    }
+
+    std::string sweep;          // "obstacles"或"size", 决定增长指数按哪个量计算
+    RandomMapOptions options;
+    int obstacle_num;           // 实际放下的障碍物数
+    int cell_num;
+    size_t boundary_point_num;  // 全部cell的ceiling/floor点数
+    size_t path_point_num;
+    double generate_ms;
+    double contour_ms;
+    double decompose_ms;
+    double plan_ms;
+    long peak_memory_kib;
+    std::string status;
+};
 
-    cv::Mat1b map = ReadMap("../complicate_map.png");
-    map = PreprocessMap(map);
+void RunStressCase(StressCase& stress_case, int robot_radius)
+{
+    ResetPeakResidentMemory();
 
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::vector<cv::Point>> generated_obstacles;
+    cv::Mat1b map = GenerateRandomMap(stress_case.options, generated_obstacles);
+    stress_case.obstacle_num = int(generated_obstacles.size());
+    stress_case.generate_ms = ElapsedMilliseconds(start);
+
+    start = std::chrono::steady_clock::now();
     std::vector<std::vector<cv::Point>> wall_contours;
     std::vector<std::vector<cv::Point>> obstacle_contours;
-    ExtractContours(map, wall_contours, obstacle_contours);
-
-    Polygon wall = ConstructWall(map, wall_contours.front());
-    PolygonList obstacles = ConstructObstacles(map, obstacle_contours);
-
-    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours, wall, obstacles);
+    ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
+    stress_case.contour_ms = ElapsedMilliseconds(start);
+    if(wall_contours.empty())
+    {
+        stress_case.status = "ERROR no free space";
+        return;
+    }
 
-    Point2D start = cell_graph.front().ceiling.front();
-    std::deque<std::deque<Point2D>> original_planning_path = StaticPathPlanning(map, cell_graph, start, robot_radius, false, false);
+    start = std::chrono::steady_clock::now();
+    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+    stress_case.decompose_ms = ElapsedMilliseconds(start);
+    if(cell_graph.empty())
+    {
+        stress_case.status = "ERROR no cells";
+        return;
+    }
+    stress_case.cell_num = int(cell_graph.size());
+    for(const auto& cell : cell_graph)
+    {
+        stress_case.boundary_point_num += cell.ceiling.size() + cell.floor.size();
+    }
 
-    std::deque<Point2D> path = FilterTrajectory(original_planning_path);
-    CheckPathConsistency(path);
+    start = std::chrono::steady_clock::now();
+    Point2D start_point = cell_graph.front().ceiling.front();
+    std::deque<Point2D> path = FilterTrajectory(StaticPathPlanningParallel(cell_graph, start_point, robot_radius, 1));
+    stress_case.plan_ms = ElapsedMilliseconds(start);
+    stress_case.path_point_num = path.size();
 
-    int time_interval = 1;
-    VisualizeTrajectory(map, path, robot_radius, PATH_MODE, time_interval);
+    stress_case.peak_memory_kib = ReadPeakResidentMemoryKiB();
 }
 
-
-/** 使用构造数据 **/
-void StaticPathPlanningExample3()
+// 相邻两档之间的增长指数 log(耗时比)/log(规模比); 规模为障碍物数或像素数, 两档耗时都太短时不计
+double EstimateGrowthExponent(double prev_scale, double curr_scale, double prev_ms, double curr_ms)
 {
-    int robot_radius = 5;
+    if(prev_scale <= 0 || curr_scale <= prev_scale || prev_ms < 0.5 || curr_ms < 0.5)
+    {
+        return 0;
+    }
+    return std::log(curr_ms/prev_ms)/std::log(curr_scale/prev_scale);
+}
 
-    cv::Mat1b map = cv::Mat1b(cv::Size(500, 500), CV_8U);
-    map.setTo(255);
+/**
+ * 两组扫描, 每组分别用直角房间和旋转房间:
+ *   obstacles: 地图边长固定(不超过2000), 障碍物数从10按约3倍递增到max_obstacle_num;
+ *   size:      障碍物密度固定(每100x100像素一个), 地图边长从250倍增到max_map_size.
+ * 结果逐行打印, output_file非空时另存为CSV. 某阶段相邻两档的增长指数超过1.3时打印警告, 返回警告数.
+ **/
+int RunStressTest(const std::string& output_file, unsigned int seed, int max_obstacle_num, int max_map_size, int robot_radius = 2)
+{
+    std::vector<StressCase> stress_cases;
+    auto add_stress_case = [&](const std::string& sweep, bool rotated_room, int map_size, int obstacle_num)
+    {
+        StressCase stress_case;
+        stress_case.sweep = sweep;
+        stress_case.options.width = map_size;
+        stress_case.options.height = map_size;
+        stress_case.options.obstacle_num = obstacle_num;
+        stress_case.options.rotated_room = rotated_room;
+        stress_case.options.min_gap = 2*robot_radius + 4;
+        stress_case.options.seed = seed + stress_cases.size();
+        stress_cases.emplace_back(stress_case);
+    };
 
-    std::vector<std::vector<cv::Point>> contours = ConstructHandcraftedContours1();
-    cv::fillPoly(map, contours, 0);
+    for(bool rotated_room : {false, true})
+    {
+        for(int obstacle_num = 10; obstacle_num <= max_obstacle_num; obstacle_num = (obstacle_num % 3 == 0) ? obstacle_num*10/3 : obstacle_num*3)
+        {
+            add_stress_case("obstacles", rotated_room, std::min(2000, max_map_size), obstacle_num);
+        }
+        for(int map_size = 250; map_size <= max_map_size; map_size *= 2)
+        {
+            add_stress_case("size", rotated_room, map_size, std::max(map_size*map_size/10000, 1));
+        }
+    }
 
-    std::vector<std::vector<cv::Point>> obstacle_contours;
-    std::vector<std::vector<cv::Point>> wall_contours;
-    ExtractContours(map, wall_contours, obstacle_contours);
-    CheckExtractedContours(map, wall_contours);
-    CheckExtractedContours(map, obstacle_contours);
+    std::ofstream csv;
+    if(!output_file.empty())
+    {
+        csv.open(output_file);
+        csv<<"sweep,room,width,height,requested_obstacles,obstacles,cells,boundary_points,path_points,"
+           <<"generate_ms,contour_ms,decompose_ms,plan_ms,peak_memory_kib,status\n";
+    }
 
-    PolygonList obstacles = ConstructObstacles(map, obstacle_contours);
-    Polygon wall = ConstructWall(map, wall_contours.front());
+    int warning_num = 0;
+    for(int i = 0; i < stress_cases.size(); i++)
+    {
+        StressCase& stress_case = stress_cases[i];
+        RunStressCase(stress_case, robot_radius);
 
-    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours, wall, obstacles);
-    CheckPointType(map, wall ,obstacles);
-    CheckGeneratedCells(map, cell_graph);
+        std::string room = stress_case.options.rotated_room ? "rotated" : "rectilinear";
+        std::cout<<stress_case.sweep<<" "<<room<<" "<<stress_case.options.width<<"x"<<stress_case.options.height<<", "
+                 <<stress_case.obstacle_num<<"/"<<stress_case.options.obstacle_num<<" obstacles, "<<stress_case.cell_num<<" cells, "
+                 <<stress_case.boundary_point_num<<" boundary points, "<<stress_case.path_point_num<<" path points: "
+                 <<"generate "<<stress_case.generate_ms<<" ms, contours "<<stress_case.contour_ms<<" ms, decompose "<<stress_case.decompose_ms<<" ms, "
+                 <<"plan "<<stress_case.plan_ms<<" ms, peak "<<stress_case.peak_memory_kib<<" KiB, "<<stress_case.status<<std::endl;
+        if(csv.is_open())
+        {
+            csv<<stress_case.sweep<<","<<room<<","<<stress_case.options.width<<","<<stress_case.options.height<<","
+               <<stress_case.options.obstacle_num<<","<<stress_case.obstacle_num<<","<<stress_case.cell_num<<","
+               <<stress_case.boundary_point_num<<","<<stress_case.path_point_num<<","
+               <<stress_case.generate_ms<<","<<stress_case.contour_ms<<","<<stress_case.decompose_ms<<","<<stress_case.plan_ms<<","
+               <<stress_case.peak_memory_kib<<","<<stress_case.status<<"\n";
+        }
 
-    Point2D start = cell_graph.front().ceiling.front();
-    std::deque<std::deque<Point2D>> original_planning_path = StaticPathPlanning(map, cell_graph, start, robot_radius, false, false);
-    CheckPathNodes(original_planning_path);
+        if(i == 0)
+        {
+            continue;
+        }
+        const StressCase& prev_case = stress_cases[i-1];
+        if(prev_case.sweep != stress_case.sweep || prev_case.options.rotated_room != stress_case.options.rotated_room
+           || prev_case.status != "OK" || stress_case.status != "OK")
+        {
+            continue;
+        }
 
-    std::deque<Point2D> path = FilterTrajectory(original_planning_path);
-    CheckPathConsistency(path);
+        bool by_obstacles = stress_case.sweep == "obstacles";
+        double prev_scale = by_obstacles ? prev_case.obstacle_num : double(prev_case.options.width)*prev_case.options.height;
+        double curr_scale = by_obstacles ? stress_case.obstacle_num : double(stress_case.options.width)*stress_case.options.height;
+        std::vector<std::pair<std::string, double>> exponents = {
+            {"contours",  EstimateGrowthExponent(prev_scale, curr_scale, prev_case.contour_ms, stress_case.contour_ms)},
+            {"decompose", EstimateGrowthExponent(prev_scale, curr_scale, prev_case.decompose_ms, stress_case.decompose_ms)},
+            {"plan",      EstimateGrowthExponent(prev_scale, curr_scale, prev_case.plan_ms, stress_case.plan_ms)}};
+        for(const auto& exponent : exponents)
+        {
+            if(exponent.second > 1.3)
+            {
+                std::cout<<"  warning: "<<exponent.first<<" grows as "<<(by_obstacles ? "obstacles" : "pixels")<<"^"<<exponent.second
+                         <<" from "<<prev_scale<<" to "<<curr_scale<<std::endl;
+                warning_num++;
+            }
+        }
+    }
 
-    int time_interval = 1;
-    VisualizeTrajectory(map, path, robot_radius, PATH_MODE, time_interval);
+    return warning_num;
 }
 
-void StaticPathPlanningExample4()
+void RandomMapScalingBenchmark()
 {
-    int robot_radius = 5;
-
-    cv::Mat1b map = cv::Mat1b(cv::Size(600, 600), CV_8U);
-    map.setTo(255);
-
-    std::vector<std::vector<cv::Point>> contours = ConstructHandcraftedContours2();
-    cv::fillPoly(map, contours, 0);
+    RunStressTest("", 1, 1000, 1000);
+}
 
-    std::vector<std::vector<cv::Point>> obstacle_contours;
-    std::vector<std::vector<cv::Point>> wall_contours;
-    ExtractContours(map, wall_contours, obstacle_contours);
-    CheckExtractedContours(map, wall_contours);
-    CheckExtractedContours(map, obstacle_contours);
+/** Chrome trace-event导出, 需要以-DBCD_TRACE_EVENTS编译: 记录一次多线程静态规划和一批动态仿真, 写出bcd_trace.json **/
+void TraceEventBenchmark()
+{
+    if(!IsTraceEventsEnabled())
+    {
+        std::cout<<"trace events: rebuild with -DBCD_TRACE_EVENTS (cmake -DBCD_TRACE_EVENTS=ON) to enable"<<std::endl;
+        return;
+    }
 
-    PolygonList obstacles = ConstructObstacles(map, obstacle_contours);
-    Polygon wall = ConstructWall(map, wall_contours.front());
+    int scale = 4;
+    int robot_radius = 5*scale;
+    int thread_num = std::max(int(std::thread::hardware_concurrency()), 1);
 
-    cv::Mat3b map_ = cv::Mat3b(map.size());
-    map_.setTo(cv::Scalar(0, 0, 0));
+    cv::Mat1b original_map = PreprocessMap(ReadMap("../complicate_map.png"));
+    cv::Mat1b map;
+    cv::resize(original_map, map, cv::Size(original_map.cols*scale, original_map.rows*scale), 0, 0, cv::INTER_NEAREST);
 
-    cv::fillPoly(map_, wall_contours, cv::Scalar(255, 255, 255));
-    cv::fillPoly(map_, obstacle_contours, cv::Scalar(0, 0, 0));
+    auto plan = [&]()
+    {
+        std::vector<std::vector<cv::Point>> wall_contours;
+        std::vector<std::vector<cv::Point>> obstacle_contours;
+        ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
 
-    std::vector<Event> wall_event_list = GenerateWallEventList(map_, wall);
-    std::vector<Event> obstacle_event_list = GenerateObstacleEventList(map_, obstacles);
-    std::deque<std::deque<Event>> slice_list = SliceListGenerator(wall_event_list, obstacle_event_list);
-    CheckSlicelist(slice_list);
+        std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+        return FilterTrajectory(StaticPathPlanningParallel(cell_graph, cell_graph.front().ceiling.front(), robot_radius, thread_num));
+    };
 
-    std::vector<CellNode> cell_graph;
-    std::vector<int> cell_index_slice;
-    std::vector<int> original_cell_index_slice;
-    ExecuteCellDecomposition(cell_graph, cell_index_slice, original_cell_index_slice, slice_list);
-    CheckPointType(map, wall ,obstacles);
-    CheckGeneratedCells(map, cell_graph);
+    // 未开启记录时的耗时作为对照
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    plan();
+    double untraced_ms = ElapsedMilliseconds(start);
 
-    Point2D start = cell_graph.front().ceiling.front();
-    std::deque<std::deque<Point2D>> original_planning_path = StaticPathPlanning(map, cell_graph, start, robot_radius, false, false);
-    CheckPathNodes(original_planning_path);
+    StartTraceRecording();
+    start = std::chrono::steady_clock::now();
+    plan();
+    double traced_ms = ElapsedMilliseconds(start);
+    size_t static_event_num = RecordedTraceEventNum();
 
-    std::deque<Point2D> path = FilterTrajectory(original_planning_path);
-    CheckPathConsistency(path);
+    cv::Mat1b dynamic_map = cv::Mat1b(cv::Size(600, 600), CV_8U);
+    dynamic_map.setTo(255);
+    cv::fillPoly(dynamic_map, ConstructHandcraftedContours5(), 0);
+    RunDynamicSimulationBatch(dynamic_map, Point2D(dynamic_map.cols/2, dynamic_map.rows/2), 5, 8, 8, thread_num, 2019);
+    StopTraceRecording();
 
-    int time_interval = 1;
-    VisualizeTrajectory(map, path, robot_radius, PATH_MODE, time_interval);
+    std::string file_name = "bcd_trace.json";
+    if(!WriteTraceEvents(file_name))
+    {
+        std::cout<<"trace events: failed to write "<<file_name<<std::endl;
+        return;
+    }
+    std::cout<<"trace events: complicate_map.png x"<<scale<<" on "<<thread_num<<" threads "<<untraced_ms<<" ms untraced, "<<traced_ms<<" ms traced ("
+             <<static_event_num<<" events); "<<RecordedTraceEventNum()<<" events including dynamic simulation written to "<<file_name<<std::endl;
 }
 
-void StaticPathPlanningExample5()
+/** 完整规划流程各阶段的耗时和堆分配次数/字节数, 需要以-DBCD_PROFILE_ALLOCATIONS编译 **/
+void AllocationProfileBenchmark()
 {
-    int robot_radius = 5;
-
-    cv::Mat1b map = cv::Mat1b(cv::Size(600, 600), CV_8U);
-    map.setTo(255);
-
-    std::vector<std::vector<cv::Point>> contours = ConstructHandcraftedContours3();
-    cv::fillPoly(map, contours, 0);
-
-    std::vector<std::vector<cv::Point>> obstacle_contours;
-    std::vector<std::vector<cv::Point>> wall_contours;
-    ExtractContours(map, wall_contours, obstacle_contours);
-    CheckExtractedContours(map, wall_contours);
-    CheckExtractedContours(map, obstacle_contours);
+    if(!IsAllocationProfilingEnabled())
+    {
+        std::cout<<"allocation profile: rebuild with -DBCD_PROFILE_ALLOCATIONS (cmake -DBCD_PROFILE_ALLOCATIONS=ON) to enable"<<std::endl;
+        return;
+    }
 
-    PolygonList obstacles = ConstructObstacles(map, obstacle_contours);
-    Polygon wall = ConstructWall(map, wall_contours.front());
+    int repeats = 20;
 
-    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours, wall, obstacles);
-    CheckPointType(map, wall ,obstacles);
-    CheckGeneratedCells(map, cell_graph);
+    for(const std::string& map_name : {std::string("map.png"), std::string("complicate_map.png")})
+    {
+        cv::Mat1b original_map = PreprocessMap(ReadMap("../" + map_name));
+        for(int scale : {1, 4})
+        {
+            int robot_radius = 5*scale;
+            cv::Mat1b map;
+            cv::resize(original_map, map, cv::Size(original_map.cols*scale, original_map.rows*scale), 0, 0, cv::INTER_NEAREST);
 
-    Point2D start = cell_graph.front().ceiling.front();
-    std::deque<std::deque<Point2D>> original_planning_path = StaticPathPlanning(map, cell_graph, start, robot_radius, false, false);
-    CheckPathNodes(original_planning_path);
+            ResetAllocationProfile();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for(int i = 0; i < repeats; i++)
+            {
+                std::vector<std::vector<cv::Point>> wall_contours;
+                std::vector<std::vector<cv::Point>> obstacle_contours;
+                ExtractContours(map, wall_contours, obstacle_contours, robot_radius);
 
-    std::deque<Point2D> path = FilterTrajectory(original_planning_path);
-    CheckPathConsistency(path);
+                std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours);
+                std::deque<std::deque<Point2D>> raw_path = StaticPathPlanning(map, cell_graph, cell_graph.front().ceiling.front(), robot_radius, false, false);
+                std::deque<Point2D> path = FilterTrajectory(raw_path);
+            }
+            double total_time_ms = ElapsedMilliseconds(start) / repeats;
 
-    int time_interval = 1;
-    VisualizeTrajectory(map, path, robot_radius, PATH_MODE, time_interval);
+            std::cout<<"allocation profile of "<<map_name<<" x"<<scale<<": "<<total_time_ms<<" ms per planning"<<std::endl;
+            PrintAllocationProfile(repeats);
+        }
+    }
 }
 
-void StaticPathPlanningExample6()
+void TestAllBenchmarks()
 {
-    int robot_radius = 5;
+    GetNewObstacleBenchmark();
 
-    cv::Mat1b map = cv::Mat1b(cv::Size(600, 600), CV_8U);
-    map.setTo(0);
+    DynamicPathPlanningBenchmark();
 
-    std::vector<std::vector<cv::Point>> contours = ConstructHandcraftedContours4();
-    std::vector<std::vector<cv::Point>> external_contours = {contours.front()};
-    std::vector<std::vector<cv::Point>> inner_contours = {contours.back()};
-    cv::fillPoly(map, external_contours, 255);
-    cv::fillPoly(map, inner_contours, 0);
+    DynamicPlanningReplayBenchmark();
 
-    std::vector<std::vector<cv::Point>> obstacle_contours;
-    std::vector<std::vector<cv::Point>> wall_contours;
-    ExtractContours(map, wall_contours, obstacle_contours);
-    CheckExtractedContours(map, wall_contours);
-    CheckExtractedContours(map, obstacle_contours);
+    GetNavigationMessageBenchmark();
 
-    PolygonList obstacles = ConstructObstacles(map, obstacle_contours);
-    Polygon wall = ConstructWall(map, wall_contours.front());
+    OccupancyGridBenchmark();
 
-    std::vector<CellNode> cell_graph = ConstructCellGraph(map, wall_contours, obstacle_contours, wall, obstacles);
-    CheckPointType(map, wall ,obstacles);
-    CheckGeneratedCells(map, cell_graph);
+    StaticPathPlanningParallelBenchmark();
 
-    Point2D start = cell_graph.front().ceiling.front();
-    std::deque<std::deque<Point2D>> original_planning_path = StaticPathPlanning(map, cell_graph, start, robot_radius, false, false);
-    CheckPathNodes(original_planning_path);
+    SweepAngleBenchmark();
 
-    std::deque<Point2D> path = FilterTrajectory(original_planning_path);
-    CheckPathConsistency(path);
+    PathCostModelBenchmark();
 
-    int time_interval = 1;
-    VisualizeTrajectory(map, path, robot_radius, PATH_MODE, time_interval);
-}
+    CoverageEvaluationBenchmark();
 
-// 未完成
-void DynamicPathPlanningExample1()
-{
+    ContourTracingBenchmark();
 
-}
+    PathBufferBenchmark();
 
+    LazyPathGeneratorBenchmark();
 
-void TestAllExamples()
-{
-    StaticPathPlanningExample1();
+    EventClassificationBenchmark();
 
-    StaticPathPlanningExample2();
+    VertexEventBenchmark();
 
-    StaticPathPlanningExample3();
+    SegmentedCellBenchmark();
 
-    StaticPathPlanningExample4();
+    RandomMapScalingBenchmark();
 
-    StaticPathPlanningExample5();
+    TraceEventBenchmark();
 
-    StaticPathPlanningExample6();
+    AllocationProfileBenchmark();
 }
 
 
-int main()
+int main(int argc, char** argv)
 {
-    TestAllExamples();
+    if(argc > 1 && std::string(argv[1]) == "benchmark")
+    {
+        TestAllBenchmarks();
+    }
+    else if(argc > 2 && std::string(argv[1]) == "daemon")
+    {
+        int thread_num = (argc > 3) ? std::atoi(argv[3]) : std::max(int(std::thread::hardware_concurrency()), 1);
+        return RunPlanningDaemon(argv[2], thread_num);
+    }
+    else if(argc > 3 && std::string(argv[1]) == "batch")
+    {
+        int robot_radius = (argc > 4) ? std::atoi(argv[4]) : 5;
+        int thread_num = (argc > 5) ? std::atoi(argv[5]) : std::max(int(std::thread::hardware_concurrency()), 1);
+        return RunBatchPlanning(argv[2], argv[3], robot_radius, thread_num);
+    }
+    else if(argc > 2 && std::string(argv[1]) == "replay")
+    {
+        int repeat_num = (argc > 3) ? std::atoi(argv[3]) : 1;
+        return RunDynamicPlanningReplay(argv[2], repeat_num);
+    }
+    else if(argc > 2 && std::string(argv[1]) == "stress")
+    {
+        unsigned int seed = (argc > 3) ? (unsigned int)std::atoi(argv[3]) : 1;
+        int max_obstacle_num = (argc > 4) ? std::atoi(argv[4]) : 30000;
+        int max_map_size = (argc > 5) ? std::atoi(argv[5]) : 4000;
+        return RunStressTest(argv[2], seed, max_obstacle_num, max_map_size) == 0 ? 0 : 1;
+    }
+    else if(argc > 1 && std::string(argv[1]) == "test")
+    {
+        return TestAllRegressions() == 0 ? 0 : 1;
+    }
+    else
+    {
+        TestAllExamples();
+    }
 
     return 0;
 }
\ No newline at end of file